@@ -0,0 +1,634 @@
+// Contains OS-independent implementation of conversion of XML files into HTML files.
+
+#include "BatchConverter.h"
+#include "XmlParserWrapper.h"
+#include "CatalogEngine.h"
+#include "CatalogIndex.h"
+#include "OutputSink.h"
+#include "Trace.h"
+#include "XmlPullParser.h"
+#include "Util.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <string.h>
+#include <wctype.h>
+
+namespace OTInterviewExercise1
+{
+    namespace
+    {
+        // Outside of Windows std::filesystem converts wchar_t path names using global
+        // C++ locale, while the rest of the application uses UTF8 - so conversion is explicit
+        std::filesystem::path ToPath(const std::wstring& sPathName)
+        {
+            std::string sUtf8PathName;
+            if (!WideToUtf8(sPathName.data(), sPathName.size(), sUtf8PathName))
+            {
+                THROW_ERROR(L"Failed to convert path name to UTF8");
+            }
+            return std::filesystem::u8path(sUtf8PathName);
+        }
+
+        std::wstring FromPath(const std::filesystem::path& path)
+        {
+            std::string sUtf8PathName = path.u8string();
+            std::wstring sPathName;
+            if (!Utf8ToWide(sUtf8PathName.data(), sUtf8PathName.size(), sPathName))
+            {
+                THROW_ERROR(L"Path name isn't valid UTF8");
+            }
+            return sPathName;
+        }
+
+        // Passes chunks of XML file to the parser. Waiting for them is Read phase.
+        class CXmlFileInput : public CXmlInputSource
+        {
+        public:
+            CXmlFileInput(CChunkedFileReader& reader, std::string_view sFirstChunk, CConversionMetrics* metrics) :
+                mReader(reader),
+                msFirstChunk(sFirstChunk),
+                mIsFirstChunkTaken(false),
+                mMetrics(metrics),
+                mSize(sFirstChunk.size())
+            {}
+            std::string_view NextChunk() override
+            {
+                if (!mIsFirstChunkTaken)
+                {
+                    mIsFirstChunkTaken = true;
+                    return msFirstChunk;
+                }
+                CTraceSpan readSpan("read");
+                CMetricsTimer readTimer(mMetrics, CConversionMetrics::EMPhase::Read);
+                std::string_view sChunk;
+                if (!mReader.NextChunk(sChunk, msReadError))
+                {
+                    THROW_ERROR(msReadError.c_str());
+                }
+                readTimer.SetBytes(sChunk.size());
+                mSize += sChunk.size();
+                return sChunk;
+            }
+            // Error message if reading failed (empty if it didn't)
+            const std::wstring& GetReadError() const noexcept
+            {
+                return msReadError;
+            }
+            // Bytes passed to the parser so far
+            uint64_t GetSize() const noexcept
+            {
+                return mSize;
+            }
+        private:
+            CChunkedFileReader& mReader;
+            std::string_view msFirstChunk;
+            bool mIsFirstChunkTaken;
+            CConversionMetrics* mMetrics;
+            uint64_t mSize;
+            std::wstring msReadError;
+        };
+
+        // Maps XML file (o_xmlFileReader owns mapped contents). Returns SUCCESS or code of
+        // the failure (o_sError contains error message then).
+        OTInterviewExercise1ExitCode MapXmlFile(
+            CXmlParserWrapper& parser,
+            const wchar_t* sXmlFilePathName,
+            std::unique_ptr<CTextFileReader>& o_xmlFileReader,
+            std::string_view& o_sXml,
+            std::wstring& o_sError)
+        {
+            // Mapped file is read while it's parsed - so only mapping is Read phase
+            CTraceSpan readSpan("read");
+            CMetricsTimer readTimer(parser.GetMetrics(), CConversionMetrics::EMPhase::Read);
+            o_xmlFileReader = std::make_unique<CTextFileReader>(sXmlFilePathName, CTextFileReader::ReadMode::Map);
+            // Messages are built only on failure (missing and empty files are common in
+            // batches)
+            std::wstring sErrorMsg;
+            if (!o_xmlFileReader->Exists(sErrorMsg))
+            {
+                o_sError = L"File: " + std::wstring(sXmlFilePathName) + L" couldn't be opened. " + sErrorMsg;
+                return OTInterviewExercise1ExitCode::XML_FILE_NOT_FOUND;
+            }
+            else if (!o_xmlFileReader->GetBytes(o_sXml, sErrorMsg))
+            {
+                o_sError = L"Error reading contents of file: " + std::wstring(sXmlFilePathName) + L" " + sErrorMsg;
+                return OTInterviewExercise1ExitCode::COULDNT_READ_XML_FILE;
+            }
+            else if (o_sXml.empty())
+            {
+                o_sError = L"File: " + std::wstring(sXmlFilePathName) + L" doesn't contain any XML.";
+                return OTInterviewExercise1ExitCode::XML_FILE_IS_EMPTY;
+            }
+            readTimer.SetBytes(o_sXml.size());
+            return OTInterviewExercise1ExitCode::SUCCESS;
+        }
+
+        OTInterviewExercise1ExitCode ConvertIndexedXmlFile(
+            CXmlParserWrapper& parser,
+            const wchar_t* sXmlFilePathName,
+            COutputSink& o_html,
+            uint64_t& o_xmlSize,
+            std::wstring& o_sError)
+        {
+            std::wstring sIndexFilePathName = std::wstring(sXmlFilePathName) + CCatalogIndex::FILE_EXTENSION;
+            std::wstring sErrorMsg;
+            CCatalogIndex index;
+            bool isLoaded = false;
+            {
+                CTraceSpan readSpan("read");
+                CMetricsTimer readTimer(parser.GetMetrics(), CConversionMetrics::EMPhase::Read);
+                isLoaded = index.Load(sIndexFilePathName.c_str(), sXmlFilePathName, sErrorMsg);
+                readTimer.SetBytes(index.GetSize());
+            }
+            if (!isLoaded)
+            {
+                // Info is filtered out by default - message isn't built then
+                if (IsLogEnabled(CLogger::LogLevel::Info))
+                    LogInfo(__FUNCTION__, __LINE__, L"Catalog index " + sIndexFilePathName + L" is built. " + sErrorMsg);
+                // Version is taken before the file is read - if it changes meanwhile then
+                // index is stale next time
+                CFileVersion xmlFileVersion;
+                GetFileVersion(sXmlFilePathName, xmlFileVersion, sErrorMsg);
+                std::unique_ptr<CTextFileReader> xmlFileReader;
+                std::string_view sXml;
+                OTInterviewExercise1ExitCode exitCode = MapXmlFile(parser, sXmlFilePathName, xmlFileReader, sXml, o_sError);
+                if (exitCode != OTInterviewExercise1ExitCode::SUCCESS)
+                    return exitCode;
+                CStatus status;
+                try
+                {
+                    status = index.Build(sXml, xmlFileVersion, parser.GetMetrics());
+                }
+                catch (const CException& ex)
+                {
+                    if (parser.GetMetrics() != nullptr)
+                        parser.GetMetrics()->AddConversion(false);
+                    o_sError = L"Xml parser error encountered. Exception caught. System error: " + ex.mErrorDescription;
+                    LogError(ex.mFunctionName.c_str(), ex.mLineNo, o_sError);
+                    return OTInterviewExercise1ExitCode::XML_PARSER_ERROR;
+                }
+                if (!status)
+                {
+                    if (parser.GetMetrics() != nullptr)
+                        parser.GetMetrics()->AddConversion(false);
+                    o_sError = L"Xml parser error encountered. " + FormatParseError(status.GetError());
+                    LogError(__FUNCTION__, __LINE__, o_sError);
+                    return OTInterviewExercise1ExitCode::XML_PARSER_ERROR;
+                }
+                try
+                {
+                    index.Save(sIndexFilePathName.c_str());
+                }
+                catch (const CException& ex)
+                {
+                    // Output isn't affected - next conversion just parses XML again
+                    LogError(ex.mFunctionName.c_str(), ex.mLineNo, L"Catalog index file wasn't saved. " + ex.mErrorDescription);
+                }
+            }
+            o_xmlSize = index.GetXmlSize();
+            if (!parser.Parse(index, o_html, sErrorMsg))
+            {
+                o_sError = L"Xml parser error encountered. " + sErrorMsg;
+                return OTInterviewExercise1ExitCode::XML_PARSER_ERROR;
+            }
+            o_sError.clear();
+            return OTInterviewExercise1ExitCode::SUCCESS;
+        }
+
+        OTInterviewExercise1ExitCode ConvertPipelinedXmlFile(
+            CXmlParserWrapper& parser,
+            const wchar_t* sXmlFilePathName,
+            COutputSink& o_html,
+            uint64_t& o_xmlSize,
+            std::wstring& o_sError)
+        {
+            std::wstring sErrorMsg;
+            // Reads of the first chunks are queued when file is opened
+            CTraceSpan readSpan("read");
+            CMetricsTimer readTimer(parser.GetMetrics(), CConversionMetrics::EMPhase::Read);
+            CChunkedFileReader xmlFileReader(sXmlFilePathName);
+            std::string_view sFirstChunk;
+            if (!xmlFileReader.Exists(sErrorMsg))
+            {
+                o_sError = L"File: " + std::wstring(sXmlFilePathName) + L" couldn't be opened. " + sErrorMsg;
+                return OTInterviewExercise1ExitCode::XML_FILE_NOT_FOUND;
+            }
+            else if (!xmlFileReader.NextChunk(sFirstChunk, sErrorMsg))
+            {
+                o_sError = L"Error reading contents of file: " + std::wstring(sXmlFilePathName) + L" " + sErrorMsg;
+                return OTInterviewExercise1ExitCode::COULDNT_READ_XML_FILE;
+            }
+            else if (sFirstChunk.empty())
+            {
+                o_sError = L"File: " + std::wstring(sXmlFilePathName) + L" doesn't contain any XML.";
+                return OTInterviewExercise1ExitCode::XML_FILE_IS_EMPTY;
+            }
+            readTimer.SetBytes(sFirstChunk.size());
+            readTimer.Stop();
+            readSpan.Stop();
+
+            CXmlFileInput xmlInput(xmlFileReader, sFirstChunk, parser.GetMetrics());
+            bool isParsed = parser.Parse(xmlInput, o_html, sErrorMsg);
+            o_xmlSize = xmlInput.GetSize();
+            if (!xmlInput.GetReadError().empty())
+            {
+                o_sError = L"Error reading contents of file: " + std::wstring(sXmlFilePathName) + L" " +
+                    xmlInput.GetReadError();
+                return OTInterviewExercise1ExitCode::COULDNT_READ_XML_FILE;
+            }
+            if (!isParsed)
+            {
+                o_sError = L"Xml parser error encountered. " + sErrorMsg;
+                return OTInterviewExercise1ExitCode::XML_PARSER_ERROR;
+            }
+            o_sError.clear();
+            return OTInterviewExercise1ExitCode::SUCCESS;
+        }
+    }
+
+    OTInterviewExercise1ExitCode ConvertXmlFile(
+        CXmlParserWrapper& parser,
+        const wchar_t* sXmlFilePathName,
+        COutputSink& o_html,
+        uint64_t& o_xmlSize,
+        std::wstring& o_sError,
+        EMXmlFileInput input) noexcept
+    {
+        o_xmlSize = 0;
+        std::wstring sErrorMsg;
+        CTraceSpan convertSpan("convert");
+        convertSpan.SetDetail(sXmlFilePathName);
+        try
+        {
+            // Large files are pipelined anyway, so that memory use doesn't depend on their size
+            CFileVersion xmlFileVersion;
+            if (input == EMXmlFileInput::Indexed && parser.SupportsCatalogIndex())
+            {
+                return ConvertIndexedXmlFile(parser, sXmlFilePathName, o_html, o_xmlSize, o_sError);
+            }
+            if (input == EMXmlFileInput::Pipelined ||
+                (GetFileVersion(sXmlFilePathName, xmlFileVersion, sErrorMsg) && xmlFileVersion.mSize > MAX_MAPPED_XML_SIZE))
+            {
+                return ConvertPipelinedXmlFile(parser, sXmlFilePathName, o_html, o_xmlSize, o_sError);
+            }
+            // Reader owns mapped contents of XML file - so it's kept until the file is parsed
+            std::unique_ptr<CTextFileReader> xmlFileReader;
+            std::string_view sXml;
+            OTInterviewExercise1ExitCode exitCode = MapXmlFile(parser, sXmlFilePathName, xmlFileReader, sXml, o_sError);
+            if (exitCode != OTInterviewExercise1ExitCode::SUCCESS)
+                return exitCode;
+            o_xmlSize = sXml.size();
+
+            if (!parser.Parse(sXml, o_html, sErrorMsg))
+            {
+                o_sError = L"Xml parser error encountered. " + sErrorMsg;
+                return OTInterviewExercise1ExitCode::XML_PARSER_ERROR;
+            }
+            o_sError.clear();
+            return OTInterviewExercise1ExitCode::SUCCESS;
+        }
+        catch (...)
+        {
+            // Only error messages can throw here (Parse() reports its errors itself)
+            o_sError = L"Memory allocation error.";
+            return OTInterviewExercise1ExitCode::XML_PARSER_ERROR;
+        }
+    }
+
+    CBatchConverter::CBatchConverter(unsigned int threadCount, const std::wstring& sOutputDir,
+        const std::wstring& sXSLTFilePathName) :
+        mThreadCount(threadCount),
+        mOutputDir(sOutputDir),
+        mXSLTFilePathName(sXSLTFilePathName),
+        mSortMemoryBudget(CTransformOptions::DEFAULT_SORT_MEMORY_BUDGET),
+        mUseRowCache(false),
+        mPageSize(0),
+        mCollectMetrics(false),
+        mInput(EMXmlFileInput::Mapped)
+    {
+        if (mThreadCount == 0)
+        {
+            mThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+    }
+
+    bool CBatchConverter::Run(const std::vector<std::wstring>& xmlFiles,
+        std::vector<CFileResult>& o_results,
+        double& o_seconds,
+        std::wstring& o_sError) noexcept
+    {
+        std::string functionName;
+        unsigned int lineNo = 0;
+        try
+        {
+            o_sError.clear();
+            o_seconds = 0;
+            o_results.clear();
+            o_results.resize(xmlFiles.size());
+            auto startTime = std::chrono::steady_clock::now();
+            mMetrics.Reset();
+
+            // There is no point in starting more workers than files
+            size_t threadCount = std::min<size_t>(mThreadCount, xmlFiles.size());
+            std::atomic<size_t> nextFile(0);
+            std::vector<std::thread> workers;
+            workers.reserve(threadCount);
+            auto joinWorkers = MakeRAIICleanup([&workers]() {
+                for (auto& worker : workers)
+                {
+                    if (worker.joinable())
+                        worker.join();
+                }
+            });
+            for (size_t i = 0; i < threadCount; ++i)
+            {
+                workers.emplace_back(&CBatchConverter::ConvertFiles, this,
+                    std::cref(xmlFiles), std::ref(nextFile), std::ref(o_results));
+            }
+            for (auto& worker : workers)
+            {
+                worker.join();
+            }
+
+            o_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            return true;
+        }
+        catch (const CException& ex)
+        {
+            std::wostringstream ss;
+            ss << L"Exception caught. ";
+            if (!ex.mErrorDescription.empty())
+            {
+                ss << L"System error: " << ex.mErrorDescription;
+            }
+            o_sError = ss.str();
+            functionName = ex.mFunctionName;
+            lineNo = ex.mLineNo;
+        }
+        catch (const std::bad_alloc& /*ex*/)
+        {
+            o_sError = L"Memory allocation error.";
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+        }
+        catch (const std::exception& ex)
+        {
+            std::wostringstream ss;
+            ss << L"C++ exception caught. ";
+            std::wstring what;
+            if (ex.what() && Utf8ToWide(ex.what(), strlen(ex.what()), what))
+            {
+                ss << what;
+            }
+            o_sError = ss.str();
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+        }
+        catch (...)
+        {
+            o_sError = L"Unknown exception caught.";
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+        }
+        LogError(functionName.c_str(), lineNo, o_sError);
+
+        return false;
+    }
+
+    void CBatchConverter::ConvertFiles(const std::vector<std::wstring>& xmlFiles,
+        std::atomic<size_t>& nextFile,
+        std::vector<CFileResult>& o_results) noexcept
+    {
+        // OS-specific initialization is per thread (e.g. COM apartment)
+        COsInitialization init;
+        std::wstring sInitError;
+        bool isInitialized = init.IsOk(sInitError);
+        // Create XML parser object using XSLT style-sheet file or the one in resources
+        // (stored in our EXE)
+        CXmlParserWrapper parser(
+            mXSLTFilePathName.empty() ? CXmlParserWrapper::EMXSLTFile::CatalogResources : CXmlParserWrapper::EMXSLTFile::File,
+            mXSLTFilePathName.empty() ? nullptr : mXSLTFilePathName.c_str());
+        parser.SetSortMemoryBudget(mSortMemoryBudget);
+        // Files are already converted in parallel - so hardware threads are shared by workers
+        parser.SetThreadCount(std::max(std::thread::hardware_concurrency() / mThreadCount, 1u));
+        parser.EnableMetrics(mCollectMetrics);
+        auto mergeMetrics = MakeRAIICleanup([this, &parser]() {
+            if (parser.GetMetrics() != nullptr)
+                mMetrics.Merge(*parser.GetMetrics());
+        });
+
+        for (size_t i = nextFile++; i < xmlFiles.size(); i = nextFile++)
+        {
+            CFileResult& result = o_results[i];
+            try
+            {
+                result.mXmlFilePathName = xmlFiles[i];
+                if (!isInitialized)
+                {
+                    result.mExitCode = OTInterviewExercise1ExitCode::INIT_ERROR;
+                    result.mError = L"Initialization error encountered. " + sInitError;
+                    continue;
+                }
+                ConvertFile(parser, xmlFiles[i], result);
+            }
+            catch (...)
+            {
+                result.mExitCode = OTInterviewExercise1ExitCode::XML_PARSER_ERROR;
+                result.mError = L"Memory allocation error.";
+            }
+        }
+    }
+
+    void CBatchConverter::ConvertFile(CXmlParserWrapper& parser, const std::wstring& sXmlFilePathName,
+        CFileResult& o_result)
+    {
+        o_result.mHtmlFilePathName = GetHtmlFilePathName(sXmlFilePathName, mOutputDir);
+
+        // HTML is written to the file as it's produced. HTML is about as large as XML - so
+        // that much disk space is preallocated (unless rows go to pages).
+        CFileVersion xmlFileVersion;
+        std::wstring sErrorMsg;
+        uint64_t preallocatedSize = 0;
+        if (mPageSize == 0 && GetFileVersion(sXmlFilePathName.c_str(), xmlFileVersion, sErrorMsg))
+        {
+            preallocatedSize = xmlFileVersion.mSize;
+        }
+        std::unique_ptr<CFileOutputSink> htmlSink;
+        try
+        {
+            htmlSink = std::make_unique<CFileOutputSink>(o_result.mHtmlFilePathName.c_str(), preallocatedSize);
+        }
+        catch (const CException& ex)
+        {
+            o_result.mExitCode = OTInterviewExercise1ExitCode::COULDNT_WRITE_HTML_FILE;
+            o_result.mError = L"File: " + o_result.mHtmlFilePathName + L" couldn't be created. " +
+                ex.mErrorDescription;
+            return;
+        }
+        std::wstring sRowCacheFilePathName;
+        if (mUseRowCache)
+        {
+            sRowCacheFilePathName = o_result.mHtmlFilePathName + L".rowcache";
+        }
+        parser.SetRowCacheFile(mUseRowCache ? sRowCacheFilePathName.c_str() : nullptr);
+        std::unique_ptr<CFilePageOutput> pageOutput;
+        if (mPageSize != 0)
+        {
+            pageOutput = std::make_unique<CFilePageOutput>(o_result.mHtmlFilePathName);
+        }
+        parser.SetPageOutput(pageOutput.get(), mPageSize);
+        o_result.mExitCode = ConvertXmlFile(parser, sXmlFilePathName.c_str(), *htmlSink,
+            o_result.mXmlSize, o_result.mError, mInput);
+        if (o_result.mExitCode == OTInterviewExercise1ExitCode::SUCCESS)
+        {
+            try
+            {
+                // Buffered HTML is written by Close()
+                CMetricsTimer outputTimer(parser.GetMetrics(), CConversionMetrics::EMPhase::Output);
+                htmlSink->Close();
+            }
+            catch (const CException& ex)
+            {
+                o_result.mError = ex.mErrorDescription;
+            }
+        }
+        if (htmlSink->HasWriteError())
+        {
+            o_result.mExitCode = OTInterviewExercise1ExitCode::COULDNT_WRITE_HTML_FILE;
+            o_result.mError = L"File: " + o_result.mHtmlFilePathName + L" couldn't be written. " +
+                o_result.mError;
+        }
+        if (o_result.mExitCode != OTInterviewExercise1ExitCode::SUCCESS)
+        {
+            // Failed conversion doesn't leave partial HTML file (nor pages of it)
+            htmlSink->Discard();
+            if (pageOutput != nullptr)
+                pageOutput->Discard();
+            return;
+        }
+        o_result.mHtmlSize = htmlSink->GetSize();
+        if (pageOutput != nullptr)
+            o_result.mHtmlSize += pageOutput->GetSize();
+    }
+
+    bool CBatchConverter::CollectXmlFiles(const std::vector<std::wstring>& args,
+        std::istream& manifest,
+        std::vector<std::wstring>& o_xmlFiles,
+        std::wstring& o_sError) noexcept
+    {
+        std::string functionName;
+        unsigned int lineNo = 0;
+        try
+        {
+            o_sError.clear();
+            o_xmlFiles.clear();
+            for (const auto& arg : args)
+            {
+                if (arg == L"-")
+                {
+                    std::string sLine;
+                    while (std::getline(manifest, sLine))
+                    {
+                        if (!sLine.empty() && sLine.back() == '\r')
+                            sLine.pop_back();
+                        if (sLine.empty())
+                            continue;
+                        std::wstring sXmlFilePathName;
+                        if (!Utf8ToWide(sLine.data(), sLine.size(), sXmlFilePathName))
+                        {
+                            THROW_ERROR(L"Manifest contains invalid UTF8 path name");
+                        }
+                        o_xmlFiles.push_back(std::move(sXmlFilePathName));
+                    }
+                    continue;
+                }
+
+                std::error_code ec;
+                std::filesystem::path argPath = ToPath(arg);
+                if (!std::filesystem::is_directory(argPath, ec))
+                {
+                    // Missing files are reported per file
+                    o_xmlFiles.push_back(arg);
+                    continue;
+                }
+                std::vector<std::wstring> dirFiles;
+                for (std::filesystem::directory_iterator it(argPath, ec), end; !ec && it != end; it.increment(ec))
+                {
+                    std::wstring sExtension = FromPath(it->path().extension());
+                    std::transform(sExtension.begin(), sExtension.end(), sExtension.begin(), towlower);
+                    if (sExtension == L".xml" && it->is_regular_file(ec))
+                    {
+                        dirFiles.push_back(FromPath(it->path()));
+                    }
+                }
+                if (ec)
+                {
+                    std::wstring sSystemError;
+                    Utf8ToWide(ec.message().data(), ec.message().size(), sSystemError);
+                    std::wostringstream ss;
+                    ss << L"Directory: " << arg << L" couldn't be listed. " << sSystemError;
+                    THROW_ERROR(ss.str().c_str());
+                }
+                std::sort(dirFiles.begin(), dirFiles.end());
+                o_xmlFiles.insert(o_xmlFiles.end(), dirFiles.begin(), dirFiles.end());
+            }
+            return true;
+        }
+        catch (const CException& ex)
+        {
+            std::wostringstream ss;
+            ss << L"Exception caught. ";
+            if (!ex.mErrorDescription.empty())
+            {
+                ss << L"System error: " << ex.mErrorDescription;
+            }
+            o_sError = ss.str();
+            functionName = ex.mFunctionName;
+            lineNo = ex.mLineNo;
+        }
+        catch (const std::bad_alloc& /*ex*/)
+        {
+            o_sError = L"Memory allocation error.";
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+        }
+        catch (const std::exception& ex)
+        {
+            std::wostringstream ss;
+            ss << L"C++ exception caught. ";
+            std::wstring what;
+            if (ex.what() && Utf8ToWide(ex.what(), strlen(ex.what()), what))
+            {
+                ss << what;
+            }
+            o_sError = ss.str();
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+        }
+        catch (...)
+        {
+            o_sError = L"Unknown exception caught.";
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+        }
+        LogError(functionName.c_str(), lineNo, o_sError);
+
+        return false;
+    }
+
+    std::wstring CBatchConverter::GetHtmlFilePathName(const std::wstring& sXmlFilePathName,
+        const std::wstring& sOutputDir)
+    {
+        std::filesystem::path htmlPath = ToPath(sXmlFilePathName);
+        htmlPath.replace_extension(".html");
+        if (!sOutputDir.empty())
+        {
+            htmlPath = ToPath(sOutputDir) / htmlPath.filename();
+        }
+        return FromPath(htmlPath);
+    }
+}
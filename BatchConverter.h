@@ -0,0 +1,153 @@
+// Contains declaration of OS-independent functions/classes that convert XML files
+// into HTML files (one file or many files in one process).
+#ifndef OT_BATCHCONVERTER_H__
+#define OT_BATCHCONVERTER_H__
+
+#include "ExitCode.h"
+#include "ConversionMetrics.h"
+#include <string>
+#include <vector>
+#include <istream>
+#include <atomic>
+#include <stdint.h>
+
+namespace OTInterviewExercise1
+{
+    class CXmlParserWrapper;
+    class COutputSink;
+
+    // How ConvertXmlFile() reads XML file
+    enum class EMXmlFileInput
+    {
+        Mapped, // File is memory-mapped (or read into memory) before it's converted
+                // (unless it's larger than MAX_MAPPED_XML_SIZE)
+        Pipelined, // File is read in chunks while it's converted (see CChunkedFileReader) -
+                   // conversion takes about as long as the slower of reading and converting
+        Indexed // Rows are rendered from {xml-file}.catidx (see CCatalogIndex) - XML is parsed
+                // only if the index is missing or stale, and the index is rebuilt then.
+                // Engines that don't support catalog index convert the file Mapped.
+    };
+
+    // Files larger than that are converted Pipelined even if Mapped input is requested
+    constexpr uint64_t MAX_MAPPED_XML_SIZE = 1024 * 1024 * 1024;
+
+    // Reads XML file and converts it into HTML using parser. Returns SUCCESS or
+    // code of the step that failed. o_sError contains error message if conversion failed.
+    // o_xmlSize receives size of XML file (in bytes).
+    OTInterviewExercise1ExitCode ConvertXmlFile(
+        CXmlParserWrapper& parser,
+        const wchar_t* sXmlFilePathName,
+        COutputSink& o_html,
+        uint64_t& o_xmlSize,
+        std::wstring& o_sError,
+        EMXmlFileInput input = EMXmlFileInput::Mapped) noexcept;
+
+    // Converts many XML files using fixed pool of worker threads. Each worker performs
+    // OS-specific initialization and creates its parser once (so style sheet is loaded
+    // once per worker rather than once per file) and then takes files from the shared list.
+    class CBatchConverter
+    {
+    public:
+        // Result of conversion of one file
+        struct CFileResult
+        {
+            CFileResult() :
+                mExitCode(OTInterviewExercise1ExitCode::SUCCESS),
+                mXmlSize(0),
+                mHtmlSize(0)
+            {}
+            std::wstring mXmlFilePathName;
+            std::wstring mHtmlFilePathName;
+            OTInterviewExercise1ExitCode mExitCode;
+            // Error message if mExitCode isn't SUCCESS
+            std::wstring mError;
+            uint64_t mXmlSize;
+            // Including pages of paginated output
+            uint64_t mHtmlSize;
+        };
+
+        // threadCount - number of workers (0 means number of hardware threads).
+        // sOutputDir - directory for HTML files. If it's empty HTML file is written
+        // next to XML file.
+        // sXSLTFilePathName - style sheet file (built-in catalog style sheet is used if it's empty).
+        CBatchConverter(unsigned int threadCount, const std::wstring& sOutputDir,
+            const std::wstring& sXSLTFilePathName = std::wstring());
+
+        // Converts all files. o_results are in the order of xmlFiles.
+        // o_seconds receives wall-clock duration of the batch.
+        // Returns false if batch couldn't be run (o_sError contains error message).
+        // Failures of individual files are reported in o_results only.
+        bool Run(const std::vector<std::wstring>& xmlFiles,
+            std::vector<CFileResult>& o_results,
+            double& o_seconds,
+            std::wstring& o_sError) noexcept;
+
+        // Builds list of XML files from command-line arguments. Argument can be a file,
+        // a directory (its *.xml files are added in name order) or "-" (stdin contains
+        // manifest: one UTF8 file path name per line).
+        static bool CollectXmlFiles(const std::vector<std::wstring>& args,
+            std::istream& manifest,
+            std::vector<std::wstring>& o_xmlFiles,
+            std::wstring& o_sError) noexcept;
+
+        // Returns path name of HTML file for XML file: extension is replaced with .html
+        // and directory is replaced with sOutputDir (if it isn't empty).
+        static std::wstring GetHtmlFilePathName(const std::wstring& sXmlFilePathName,
+            const std::wstring& sOutputDir);
+
+        unsigned int GetThreadCount() const noexcept
+        {
+            return mThreadCount;
+        }
+        // Memory budget for sorting of rows of one file (see CXmlParserWrapper::SetSortMemoryBudget)
+        void SetSortMemoryBudget(size_t memoryBudget) noexcept
+        {
+            mSortMemoryBudget = memoryBudget;
+        }
+        // Rows of every HTML file are cached in {HTML file}.rowcache, so that files that
+        // are converted again are converted incrementally (see CXmlParserWrapper::SetRowCacheFile)
+        void SetUseRowCache(bool useRowCache) noexcept
+        {
+            mUseRowCache = useRowCache;
+        }
+        // Rows of every file are split into pages of pageSize rows (0 disables it): HTML
+        // file becomes index page that links to the pages (see CFilePageOutput). It can't
+        // be combined with row cache.
+        void SetPageSize(size_t pageSize) noexcept
+        {
+            mPageSize = pageSize;
+        }
+        // Workers collect per-phase metrics of conversions (see CXmlParserWrapper::EnableMetrics)
+        void SetCollectMetrics(bool collectMetrics) noexcept
+        {
+            mCollectMetrics = collectMetrics;
+        }
+        // How XML files are read (see EMXmlFileInput)
+        void SetXmlFileInput(EMXmlFileInput input) noexcept
+        {
+            mInput = input;
+        }
+        // Metrics of all workers of the last Run() (if they were collected)
+        const CConversionMetrics& GetMetrics() const noexcept
+        {
+            return mMetrics;
+        }
+    private:
+        // Worker thread: converts files until shared list is exhausted
+        void ConvertFiles(const std::vector<std::wstring>& xmlFiles,
+            std::atomic<size_t>& nextFile,
+            std::vector<CFileResult>& o_results) noexcept;
+        void ConvertFile(CXmlParserWrapper& parser, const std::wstring& sXmlFilePathName, CFileResult& o_result);
+
+        unsigned int mThreadCount;
+        std::wstring mOutputDir;
+        std::wstring mXSLTFilePathName;
+        size_t mSortMemoryBudget;
+        bool mUseRowCache;
+        size_t mPageSize;
+        bool mCollectMetrics;
+        EMXmlFileInput mInput;
+        CConversionMetrics mMetrics;
+    };
+}
+#endif
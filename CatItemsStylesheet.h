@@ -0,0 +1,62 @@
+// Generated by codegen/XsltCodegen from cat_items.xslt. Don't edit: run
+// "make -C linux codegen" after changing the style sheet.
+#ifndef OT_CATITEMSSTYLESHEET_H__
+#define OT_CATITEMSSTYLESHEET_H__
+
+#include "CatalogEngine.h"
+#include <string>
+
+namespace OTInterviewExercise1
+{
+    namespace CatItemsStylesheet
+    {
+        // Rows are sorted by this field (ECatalogField::Count if they aren't sorted)
+        constexpr ECatalogField SortField = ECatalogField::Artist;
+
+        // Output before rows
+        constexpr char Header[] = "<html><body><h2>CD Catalog</h2><table border=\"1\"><tr bgcolor=\"#9acd32\"><th>Title</th><th>Artist</th><th>Country</th><th>Company</th><th>Price</th><th>Year</th></tr>";
+        // Output after rows
+        constexpr char Footer[] = "</table></body></html>";
+
+        constexpr char RowLiteral0[] = "<tr><td>";
+        constexpr char RowLiteral1[] = "</td><td>";
+        constexpr char RowLiteral2[] = "</td></tr>";
+
+        // Output of one CATALOG/CD element
+        inline void WriteRow(const CCatalogRecord& record, std::pmr::string& o_sHtml)
+        {
+            o_sHtml.append(RowLiteral0, sizeof(RowLiteral0) - 1);
+            if (record.Has(ECatalogField::Title))
+            {
+                CCatalogHtmlRenderer::AppendEscaped(record.Get(ECatalogField::Title), o_sHtml);
+            }
+            o_sHtml.append(RowLiteral1, sizeof(RowLiteral1) - 1);
+            if (record.Has(ECatalogField::Artist))
+            {
+                CCatalogHtmlRenderer::AppendEscaped(record.Get(ECatalogField::Artist), o_sHtml);
+            }
+            o_sHtml.append(RowLiteral1, sizeof(RowLiteral1) - 1);
+            if (record.Has(ECatalogField::Country))
+            {
+                CCatalogHtmlRenderer::AppendEscaped(record.Get(ECatalogField::Country), o_sHtml);
+            }
+            o_sHtml.append(RowLiteral1, sizeof(RowLiteral1) - 1);
+            if (record.Has(ECatalogField::Company))
+            {
+                CCatalogHtmlRenderer::AppendEscaped(record.Get(ECatalogField::Company), o_sHtml);
+            }
+            o_sHtml.append(RowLiteral1, sizeof(RowLiteral1) - 1);
+            if (record.Has(ECatalogField::Price))
+            {
+                CCatalogHtmlRenderer::AppendEscaped(record.Get(ECatalogField::Price), o_sHtml);
+            }
+            o_sHtml.append(RowLiteral1, sizeof(RowLiteral1) - 1);
+            if (record.Has(ECatalogField::Year))
+            {
+                CCatalogHtmlRenderer::AppendEscaped(record.Get(ECatalogField::Year), o_sHtml);
+            }
+            o_sHtml.append(RowLiteral2, sizeof(RowLiteral2) - 1);
+        }
+    }
+}
+#endif
@@ -0,0 +1,970 @@
+// Contains implementation of OS-independent native CATALOG/CD -> HTML engine.
+
+#include "CatalogEngine.h"
+#include "CatItemsStylesheet.h"
+#include "CatalogIndex.h"
+#include "CatalogRecordSorter.h"
+#include "CatalogRowCache.h"
+#include "ConversionMetrics.h"
+#include "HtmlEscaper.h"
+#include "Trace.h"
+#include "XmlPullParser.h"
+#include "OutputSink.h"
+#include "Utf8Transcoder.h"
+#include "Util.h"
+#include <algorithm>
+#include <sstream>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <exception>
+
+namespace OTInterviewExercise1
+{
+    namespace
+    {
+        const std::string_view FieldElementNames[] = {
+            "TITLE",
+            "ARTIST",
+            "COUNTRY",
+            "COMPANY",
+            "PRICE",
+            "YEAR"
+        };
+        static_assert(sizeof(FieldElementNames) / sizeof(FieldElementNames[0]) ==
+            static_cast<size_t>(ECatalogField::Count), "Field names don't match ECatalogField");
+        // Column headers of fields (as in the style sheet)
+        const std::string_view FieldColumnNames[] = {
+            "Title",
+            "Artist",
+            "Country",
+            "Company",
+            "Price",
+            "Year"
+        };
+        static_assert(sizeof(FieldColumnNames) / sizeof(FieldColumnNames[0]) ==
+            static_cast<size_t>(ECatalogField::Count), "Column names don't match ECatalogField");
+
+        // Depth of elements in CATALOG/CD/FIELD path
+        enum
+        {
+            CATALOG_DEPTH = 1,
+            CD_DEPTH = 2,
+            FIELD_DEPTH = 3
+        };
+
+        // Size of output chunks passed to COutputSink
+        const size_t OUTPUT_CHUNK_SIZE = 64 * 1024;
+        // Number of rows rendered by a thread at once
+        const size_t ROWS_PER_BATCH = 1024;
+
+        // Renders batches of rows on worker threads. Rendered batches are passed to the
+        // sink in order of Render() calls (consecutive ready batches - by one gather write).
+        // Number of batches in flight is limited, so memory use doesn't depend on
+        // number of rows.
+        class CParallelRowRenderer
+        {
+        public:
+            CParallelRowRenderer(unsigned int threadCount, COutputSink& o_html,
+                std::pmr::memory_resource* memoryResource) :
+                mHtml(o_html),
+                mMemoryResource(memoryResource),
+                mMaxBatches(2 * static_cast<size_t>(threadCount)),
+                mNextBatch(0),
+                mIsStopping(false)
+            {
+                try
+                {
+                    for (unsigned int i = 0; i < threadCount; ++i)
+                        mWorkers.emplace_back(&CParallelRowRenderer::Work, this);
+                }
+                catch (...)
+                {
+                    Stop();
+                    throw;
+                }
+            }
+            ~CParallelRowRenderer()
+            {
+                Stop();
+            }
+
+            CParallelRowRenderer(const CParallelRowRenderer&) = delete;
+            CParallelRowRenderer& operator=(const CParallelRowRenderer&) = delete;
+
+            // Queues first count records of io_records. io_records receives records of a
+            // batch that was written (or empty vector), so their buffers are reused.
+            void Render(std::pmr::vector<CCatalogRecord>& io_records, size_t count)
+            {
+                WriteRendered(mMaxBatches - 1);
+                std::unique_ptr<CBatch> batch;
+                if (!mFreeBatches.empty())
+                {
+                    batch = std::move(mFreeBatches.back());
+                    mFreeBatches.pop_back();
+                }
+                else
+                {
+                    batch = std::make_unique<CBatch>(mMemoryResource);
+                }
+                batch->mRecords.swap(io_records);
+                batch->mCount = count;
+                batch->mIsRendered = false;
+                {
+                    std::lock_guard<std::mutex> lock(mMutex);
+                    mBatches.push_back(std::move(batch));
+                }
+                mWorkCondition.notify_one();
+            }
+            // Waits until all batches are rendered and written
+            void Finish()
+            {
+                WriteRendered(0);
+            }
+        private:
+            struct CBatch
+            {
+                // Records are swapped with caller's ones - so they use the same memory
+                // resource. HTML is rendered by worker threads - so it's allocated from heap.
+                explicit CBatch(std::pmr::memory_resource* memoryResource) :
+                    mRecords(memoryResource),
+                    mCount(0),
+                    mIsRendered(false)
+                {}
+                std::pmr::vector<CCatalogRecord> mRecords;
+                size_t mCount;
+                std::pmr::string mHtml;
+                bool mIsRendered;
+                std::exception_ptr mError;
+            };
+
+            void Work() noexcept
+            {
+                for (;;)
+                {
+                    CBatch* batch = nullptr;
+                    {
+                        std::unique_lock<std::mutex> lock(mMutex);
+                        mWorkCondition.wait(lock, [this]() {
+                            return mIsStopping || mNextBatch < mBatches.size();
+                        });
+                        if (mIsStopping)
+                            return;
+                        batch = mBatches[mNextBatch++].get();
+                    }
+                    try
+                    {
+                        CTraceSpan renderSpan("render");
+                        batch->mHtml.clear();
+                        for (size_t i = 0; i < batch->mCount; ++i)
+                            CCatalogHtmlRenderer::WriteRow(batch->mRecords[i], batch->mHtml);
+                    }
+                    catch (...)
+                    {
+                        batch->mError = std::current_exception();
+                    }
+                    {
+                        std::lock_guard<std::mutex> lock(mMutex);
+                        batch->mIsRendered = true;
+                    }
+                    mRenderedCondition.notify_one();
+                }
+            }
+
+            // Writes rendered batches from the front of the queue. Waits until no more
+            // than maxPending batches are left.
+            void WriteRendered(size_t maxPending)
+            {
+                std::vector<std::unique_ptr<CBatch>> rendered;
+                std::vector<std::string_view> buffers;
+                for (;;)
+                {
+                    {
+                        std::unique_lock<std::mutex> lock(mMutex);
+                        mRenderedCondition.wait(lock, [this, maxPending]() {
+                            return mBatches.size() <= maxPending || mBatches.front()->mIsRendered;
+                        });
+                        while (!mBatches.empty() && mBatches.front()->mIsRendered)
+                        {
+                            rendered.push_back(std::move(mBatches.front()));
+                            mBatches.pop_front();
+                            mNextBatch--;
+                        }
+                    }
+                    if (rendered.empty())
+                        return;
+                    buffers.clear();
+                    for (const auto& batch : rendered)
+                    {
+                        if (batch->mError)
+                            std::rethrow_exception(batch->mError);
+                        buffers.push_back(batch->mHtml);
+                    }
+                    mHtml.WriteGather(buffers.data(), buffers.size());
+                    for (auto& batch : rendered)
+                        mFreeBatches.push_back(std::move(batch));
+                    rendered.clear();
+                }
+            }
+
+            void Stop() noexcept
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mMutex);
+                    mIsStopping = true;
+                }
+                mWorkCondition.notify_all();
+                for (auto& worker : mWorkers)
+                    worker.join();
+                mWorkers.clear();
+            }
+
+            COutputSink& mHtml;
+            std::pmr::memory_resource* mMemoryResource;
+            size_t mMaxBatches;
+            // Batches that were written and can be reused (used by caller's thread only)
+            std::vector<std::unique_ptr<CBatch>> mFreeBatches;
+
+            // Guards members below
+            std::mutex mMutex;
+            std::condition_variable mWorkCondition;
+            std::condition_variable mRenderedCondition;
+            // Batches that weren't written yet (in output order)
+            std::deque<std::unique_ptr<CBatch>> mBatches;
+            // Index of the first batch in mBatches that isn't taken by a worker
+            size_t mNextBatch;
+            bool mIsStopping;
+
+            std::vector<std::thread> mWorkers;
+        };
+
+        // Renders pages of rows on worker threads. Every page is passed to page output by
+        // the worker that rendered it (pages don't depend on each other - so they're
+        // written in any order). Number of pages in flight is limited, so memory use
+        // doesn't depend on number of rows.
+        class CParallelPageRenderer
+        {
+        public:
+            CParallelPageRenderer(unsigned int threadCount, CPageOutput& pageOutput,
+                std::pmr::memory_resource* memoryResource) :
+                mPageOutput(pageOutput),
+                mMemoryResource(memoryResource),
+                mMaxPages(2 * static_cast<size_t>(threadCount)),
+                mPagesInFlight(0),
+                mIsStopping(false)
+            {
+                // Pages are returned to it by workers - so it never grows then
+                mFreePages.reserve(mMaxPages);
+                try
+                {
+                    for (unsigned int i = 0; i < threadCount; ++i)
+                        mWorkers.emplace_back(&CParallelPageRenderer::Work, this);
+                }
+                catch (...)
+                {
+                    Stop();
+                    throw;
+                }
+            }
+            ~CParallelPageRenderer()
+            {
+                Stop();
+            }
+
+            CParallelPageRenderer(const CParallelPageRenderer&) = delete;
+            CParallelPageRenderer& operator=(const CParallelPageRenderer&) = delete;
+
+            // Queues first count records of io_records as page (numbered from 0). io_records
+            // receives records of a page that was written (or empty vector), so their buffers
+            // are reused. Rethrows failure of a page rendered before.
+            void Render(size_t page, std::pmr::vector<CCatalogRecord>& io_records, size_t count)
+            {
+                std::unique_ptr<CPage> pageToRender;
+                {
+                    std::unique_lock<std::mutex> lock(mMutex);
+                    mDoneCondition.wait(lock, [this]() {
+                        return mPagesInFlight < mMaxPages || mError != nullptr;
+                    });
+                    if (mError != nullptr)
+                        std::rethrow_exception(mError);
+                    if (!mFreePages.empty())
+                    {
+                        pageToRender = std::move(mFreePages.back());
+                        mFreePages.pop_back();
+                    }
+                }
+                if (pageToRender == nullptr)
+                    pageToRender = std::make_unique<CPage>(mMemoryResource);
+                pageToRender->mRecords.swap(io_records);
+                pageToRender->mCount = count;
+                pageToRender->mIndex = page;
+                {
+                    std::lock_guard<std::mutex> lock(mMutex);
+                    mPendingPages.push_back(std::move(pageToRender));
+                    mPagesInFlight++;
+                }
+                mWorkCondition.notify_one();
+            }
+            // Waits until all pages are written. Rethrows the first failure of a page.
+            void Finish()
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mDoneCondition.wait(lock, [this]() {
+                    return mPagesInFlight == 0;
+                });
+                if (mError != nullptr)
+                    std::rethrow_exception(mError);
+            }
+        private:
+            struct CPage
+            {
+                // Records are swapped with caller's ones - so they use the same memory resource
+                explicit CPage(std::pmr::memory_resource* memoryResource) :
+                    mRecords(memoryResource),
+                    mCount(0),
+                    mIndex(0)
+                {}
+                std::pmr::vector<CCatalogRecord> mRecords;
+                size_t mCount;
+                size_t mIndex;
+            };
+
+            void Work() noexcept
+            {
+                // HTML is rendered by worker threads - so it's allocated from heap
+                std::pmr::string sHtml;
+                for (;;)
+                {
+                    std::unique_ptr<CPage> page;
+                    bool isFailed = false;
+                    {
+                        std::unique_lock<std::mutex> lock(mMutex);
+                        mWorkCondition.wait(lock, [this]() {
+                            return mIsStopping || !mPendingPages.empty();
+                        });
+                        if (mIsStopping)
+                            return;
+                        page = std::move(mPendingPages.front());
+                        mPendingPages.pop_front();
+                        // Pages after a failed one aren't written
+                        isFailed = mError != nullptr;
+                    }
+                    std::exception_ptr error;
+                    if (!isFailed)
+                    {
+                        try
+                        {
+                            CTraceSpan pageSpan("page");
+                            sHtml.clear();
+                            CCatalogHtmlRenderer::WriteHeader(sHtml);
+                            for (size_t i = 0; i < page->mCount; ++i)
+                                CCatalogHtmlRenderer::WriteRow(page->mRecords[i], sHtml);
+                            CCatalogHtmlRenderer::WriteFooter(sHtml);
+                            mPageOutput.WritePage(page->mIndex, sHtml);
+                        }
+                        catch (...)
+                        {
+                            error = std::current_exception();
+                        }
+                    }
+                    {
+                        std::lock_guard<std::mutex> lock(mMutex);
+                        if (error != nullptr && mError == nullptr)
+                            mError = error;
+                        mFreePages.push_back(std::move(page));
+                        mPagesInFlight--;
+                    }
+                    mDoneCondition.notify_one();
+                }
+            }
+
+            void Stop() noexcept
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mMutex);
+                    mIsStopping = true;
+                }
+                mWorkCondition.notify_all();
+                for (auto& worker : mWorkers)
+                    worker.join();
+                mWorkers.clear();
+            }
+
+            CPageOutput& mPageOutput;
+            std::pmr::memory_resource* mMemoryResource;
+            size_t mMaxPages;
+
+            // Guards members below
+            std::mutex mMutex;
+            std::condition_variable mWorkCondition;
+            std::condition_variable mDoneCondition;
+            // Pages that aren't taken by a worker yet
+            std::deque<std::unique_ptr<CPage>> mPendingPages;
+            // Pages that were written and can be reused
+            std::vector<std::unique_ptr<CPage>> mFreePages;
+            // Number of queued pages that weren't written yet
+            size_t mPagesInFlight;
+            // The first failure of a page
+            std::exception_ptr mError;
+            bool mIsStopping;
+
+            std::vector<std::thread> mWorkers;
+        };
+
+        // Page of paginated output as it's listed by index page
+        struct CPageSummary
+        {
+            explicit CPageSummary(std::pmr::memory_resource* memoryResource) :
+                mFirstRow(0),
+                mRowCount(0),
+                msFirstKey(memoryResource),
+                msLastKey(memoryResource)
+            {}
+            size_t mFirstRow;
+            size_t mRowCount;
+            // Values of sort field of the first and the last row
+            std::pmr::string msFirstKey;
+            std::pmr::string msLastKey;
+        };
+
+        // Index page links to every page and shows range of sort field values of its rows
+        void WriteIndexPage(const std::pmr::vector<CPageSummary>& pages, const CPageOutput& pageOutput,
+            std::pmr::string& o_sHtml)
+        {
+            const bool isSorted = CatItemsStylesheet::SortField != ECatalogField::Count;
+            o_sHtml.append("<html><body><h2>CD Catalog</h2><table border=\"1\"><tr bgcolor=\"#9acd32\">"
+                "<th>Page</th><th>Rows</th>");
+            if (isSorted)
+            {
+                std::string_view sColumnName = FieldColumnNames[static_cast<size_t>(CatItemsStylesheet::SortField)];
+                o_sHtml.append("<th>First ").append(sColumnName).append("</th>");
+                o_sHtml.append("<th>Last ").append(sColumnName).append("</th>");
+            }
+            o_sHtml.append("</tr>");
+            for (size_t i = 0; i < pages.size(); ++i)
+            {
+                const CPageSummary& page = pages[i];
+                o_sHtml.append("<tr><td><a href=\"");
+                CHtmlEscaper::Append(pageOutput.GetPageLink(i), o_sHtml, CHtmlEscaper::EMContext::Attribute);
+                o_sHtml.append("\">").append(std::to_string(i + 1)).append("</a></td><td>");
+                o_sHtml.append(std::to_string(page.mFirstRow + 1)).append("-");
+                o_sHtml.append(std::to_string(page.mFirstRow + page.mRowCount)).append("</td>");
+                if (isSorted)
+                {
+                    o_sHtml.append("<td>");
+                    CCatalogHtmlRenderer::AppendEscaped(page.msFirstKey, o_sHtml);
+                    o_sHtml.append("</td><td>");
+                    CCatalogHtmlRenderer::AppendEscaped(page.msLastKey, o_sHtml);
+                    o_sHtml.append("</td>");
+                }
+                o_sHtml.append("</tr>");
+            }
+            o_sHtml.append("</table></body></html>");
+        }
+
+        // Splits records into pages that are rendered in parallel (see CTransformOptions::mPageOutput)
+        void RenderPages(const std::function<bool(CCatalogRecord&)>& nextRecord, COutputSink& o_html,
+            const CTransformOptions& options, unsigned int threadCount)
+        {
+            std::pmr::memory_resource* memoryResource = options.mMemoryResource;
+            const size_t pageSize = std::max<size_t>(options.mPageSize, 1);
+            std::pmr::vector<CPageSummary> pages(memoryResource);
+            {
+                CParallelPageRenderer renderer(threadCount, *options.mPageOutput, memoryResource);
+                std::pmr::vector<CCatalogRecord> records(memoryResource);
+                size_t rowCount = 0;
+                for (;;)
+                {
+                    records.resize(pageSize);
+                    size_t count = 0;
+                    while (count < records.size() && nextRecord(records[count]))
+                        count++;
+                    if (count == 0)
+                        break;
+                    CPageSummary page(memoryResource);
+                    page.mFirstRow = rowCount;
+                    page.mRowCount = count;
+                    if (CatItemsStylesheet::SortField != ECatalogField::Count)
+                    {
+                        page.msFirstKey = records[0].Get(CatItemsStylesheet::SortField);
+                        page.msLastKey = records[count - 1].Get(CatItemsStylesheet::SortField);
+                    }
+                    pages.push_back(std::move(page));
+                    rowCount += count;
+                    renderer.Render(pages.size() - 1, records, count);
+                    if (count < pageSize)
+                        break;
+                }
+                renderer.Finish();
+            }
+            std::pmr::string sIndex(memoryResource);
+            WriteIndexPage(pages, *options.mPageOutput, sIndex);
+            o_html.Write(sIndex.data(), sIndex.size());
+        }
+
+        // Renders rows that aren't in the cache and adds them to it. Rows are sorted in
+        // memory by key ranks (keys are compared only if ranks can't tell their order).
+        // Returns error of malformed document (nothing is written then).
+        CStatus TransformIncremental(CCatalogReader& reader, CCatalogRowCache& rowCache, COutputSink& o_html,
+            std::pmr::memory_resource* memoryResource)
+        {
+            std::pmr::vector<CCatalogCachedRow> rows(memoryResource);
+            CCatalogRecord record(memoryResource);
+            std::pmr::string sRow(memoryResource);
+            bool isCached = false;
+            CCatalogCachedRow row;
+            std::string_view sRecordBytes;
+            while (reader.Next(record, rowCache, isCached, row, sRecordBytes))
+            {
+                if (!isCached)
+                {
+                    sRow.clear();
+                    CCatalogHtmlRenderer::WriteRow(record, sRow);
+                    std::string_view sKey;
+                    if (CatItemsStylesheet::SortField != ECatalogField::Count)
+                        sKey = record.Get(CatItemsStylesheet::SortField);
+                    rowCache.Add(sRecordBytes, sKey, sRow, row);
+                }
+                rows.push_back(row);
+            }
+            CStatus status = reader.GetStatus();
+            if (!status)
+                return status;
+
+            // Document indexes of rows in output order
+            std::pmr::vector<size_t> order(rows.size(), memoryResource);
+            uint64_t maxKeyRank = 0;
+            for (const auto& row : rows)
+                maxKeyRank = std::max(maxKeyRank, row.mKeyRank);
+            auto isKeyLess = [&rows](size_t left, size_t right) {
+                return CompareSortKeys(rows[left].mKey, rows[right].mKey) < 0;
+            };
+            if (CatItemsStylesheet::SortField == ECatalogField::Count)
+            {
+                for (size_t i = 0; i < rows.size(); ++i)
+                    order[i] = i;
+            }
+            else if (maxKeyRank / 4 <= rows.size() && rows.size() < UINT32_MAX)
+            {
+                // Ranks are dense (a cache file has two ranks per key) - so rows are
+                // sorted by counting sort, which keeps document order of equal ranks
+                std::pmr::vector<uint32_t> rankStarts(static_cast<size_t>(maxKeyRank) + 2, 0, memoryResource);
+                for (const auto& row : rows)
+                    rankStarts[static_cast<size_t>(row.mKeyRank) + 1]++;
+                for (size_t i = 1; i < rankStarts.size(); ++i)
+                    rankStarts[i] += rankStarts[i - 1];
+                for (size_t i = 0; i < rows.size(); ++i)
+                    order[rankStarts[static_cast<size_t>(rows[i].mKeyRank)]++] = i;
+                // Rows with odd rank are new keys between two cached ones
+                for (size_t first = 0; first < order.size(); )
+                {
+                    size_t last = first + 1;
+                    uint64_t keyRank = rows[order[first]].mKeyRank;
+                    while (last < order.size() && rows[order[last]].mKeyRank == keyRank)
+                        last++;
+                    if ((keyRank & 1) != 0 && last - first > 1)
+                        std::stable_sort(order.begin() + first, order.begin() + last, isKeyLess);
+                    first = last;
+                }
+            }
+            else
+            {
+                for (size_t i = 0; i < rows.size(); ++i)
+                    order[i] = i;
+                std::stable_sort(order.begin(), order.end(), [&rows, &isKeyLess](size_t left, size_t right) {
+                    if (rows[left].mKeyRank != rows[right].mKeyRank)
+                        return rows[left].mKeyRank < rows[right].mKeyRank;
+                    return (rows[left].mKeyRank & 1) != 0 && isKeyLess(left, right);
+                });
+            }
+            std::vector<uint32_t> keyOrder;
+            keyOrder.reserve(order.size());
+            for (size_t documentIndex : order)
+                keyOrder.push_back(rows[documentIndex].mId);
+            rowCache.SetKeyOrder(std::move(keyOrder));
+
+            std::pmr::string sHtml(memoryResource);
+            CCatalogHtmlRenderer::WriteHeader(sHtml);
+            o_html.Write(sHtml.data(), sHtml.size());
+            std::pmr::vector<std::string_view> buffers(memoryResource);
+            buffers.reserve(std::min(rows.size(), ROWS_PER_BATCH));
+            for (size_t first = 0; first < rows.size(); first += ROWS_PER_BATCH)
+            {
+                buffers.clear();
+                size_t last = std::min(first + ROWS_PER_BATCH, rows.size());
+                for (size_t i = first; i < last; ++i)
+                    buffers.push_back(rows[order[i]].mRow);
+                o_html.WriteGather(buffers.data(), buffers.size());
+            }
+            sHtml.clear();
+            CCatalogHtmlRenderer::WriteFooter(sHtml);
+            o_html.Write(sHtml.data(), sHtml.size());
+            return status;
+        }
+
+        // Renders records in order they're returned by nextRecord
+        void RenderRecords(const std::function<bool(CCatalogRecord&)>& nextRecord, COutputSink& o_html,
+            const CTransformOptions& options)
+        {
+            std::pmr::memory_resource* memoryResource = options.mMemoryResource;
+            auto readBatch = [&nextRecord](std::pmr::vector<CCatalogRecord>& o_records) {
+                o_records.resize(ROWS_PER_BATCH);
+                size_t count = 0;
+                while (count < o_records.size() && nextRecord(o_records[count]))
+                    count++;
+                return count;
+            };
+
+            unsigned int threadCount = options.mThreadCount != 0 ? options.mThreadCount :
+                std::max(std::thread::hardware_concurrency(), 1u);
+            if (options.mPageOutput != nullptr)
+            {
+                RenderPages(nextRecord, o_html, options, threadCount);
+                return;
+            }
+            std::pmr::vector<CCatalogRecord> records(memoryResource);
+            size_t count = readBatch(records);
+            if (threadCount > 1 && count == ROWS_PER_BATCH)
+            {
+                // There are more rows than one batch - so they are rendered in parallel
+                std::pmr::string sHeader(memoryResource);
+                CCatalogHtmlRenderer::WriteHeader(sHeader);
+                o_html.Write(sHeader.data(), sHeader.size());
+                CParallelRowRenderer renderer(threadCount, o_html, memoryResource);
+                while (count != 0)
+                {
+                    renderer.Render(records, count);
+                    count = readBatch(records);
+                }
+                renderer.Finish();
+                std::pmr::string sFooter(memoryResource);
+                CCatalogHtmlRenderer::WriteFooter(sFooter);
+                o_html.Write(sFooter.data(), sFooter.size());
+                return;
+            }
+
+            // Rows are rendered into a buffer that's passed to the sink whenever it's full
+            std::pmr::string sChunk(memoryResource);
+            sChunk.reserve(OUTPUT_CHUNK_SIZE);
+            CCatalogHtmlRenderer::WriteHeader(sChunk);
+            while (count != 0)
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    CCatalogHtmlRenderer::WriteRow(records[i], sChunk);
+                    if (sChunk.size() >= OUTPUT_CHUNK_SIZE)
+                    {
+                        o_html.Write(sChunk.data(), sChunk.size());
+                        sChunk.clear();
+                    }
+                }
+                count = readBatch(records);
+            }
+            CCatalogHtmlRenderer::WriteFooter(sChunk);
+            o_html.Write(sChunk.data(), sChunk.size());
+        }
+
+        // Converts document that parser was created for (CCatalogEngine::Transform()
+        // validates its UTF8). Returns error of malformed document.
+        CStatus TransformDocument(CXmlPullParser& parser, COutputSink& o_html, const CTransformOptions& options)
+        {
+            std::pmr::memory_resource* memoryResource = options.mMemoryResource;
+            CCatalogReader reader(parser);
+            if (options.mRowCache != nullptr)
+            {
+                if (options.mPageOutput != nullptr)
+                {
+                    THROW_ERROR(L"Incremental conversion doesn't support paginated output");
+                }
+                return TransformIncremental(reader, *options.mRowCache, o_html, memoryResource);
+            }
+
+            // Rows come either from the sorter or (unsorted) directly from the document
+            std::unique_ptr<CCatalogRecordSorter> sorter;
+            std::function<bool(CCatalogRecord&)> nextRecord;
+            if (CatItemsStylesheet::SortField != ECatalogField::Count)
+            {
+                sorter = std::make_unique<CCatalogRecordSorter>(CatItemsStylesheet::SortField,
+                    options.mSortMemoryBudget, memoryResource);
+                CCatalogRecord record(memoryResource);
+                {
+                    CTraceSpan loadSpan("load");
+                    // Input source might be read and decoded while records are pulled
+                    CExclusiveMetricsTimer loadTimer(options.mMetrics, CConversionMetrics::EMPhase::Load);
+                    while (reader.Next(record))
+                    {
+                        sorter->Add(record);
+                    }
+                    loadTimer.SetBytes(parser.Offset());
+                }
+                CStatus status = reader.GetStatus();
+                if (!status)
+                    return status;
+                CTraceSpan sortSpan("sort");
+                sorter->Sort();
+                nextRecord = [&sorter](CCatalogRecord& o_record) { return sorter->Next(o_record); };
+            }
+            else
+            {
+                nextRecord = [&reader](CCatalogRecord& o_record) { return reader.Next(o_record); };
+            }
+            RenderRecords(nextRecord, o_html, options);
+            // Rows that aren't sorted are read while they're rendered
+            return reader.GetStatus();
+        }
+
+        // Validates UTF8 of chunks while parser pulls them from input
+        class CUtf8ValidatingInput : public CXmlInputSource
+        {
+        public:
+            CUtf8ValidatingInput(CXmlInputSource& input, CConversionMetrics* metrics) :
+                mInput(input),
+                mMetrics(metrics)
+            {}
+            std::string_view NextChunk() override
+            {
+                std::string_view sChunk = mInput.NextChunk();
+                CTraceSpan decodeSpan("decode");
+                CMetricsTimer decodeTimer(mMetrics, CConversionMetrics::EMPhase::Decode, sChunk.size());
+                uint64_t errorOffset = 0;
+                if (!(sChunk.empty() ? mValidator.Finish(&errorOffset) : mValidator.Validate(sChunk, &errorOffset)))
+                {
+                    std::wostringstream ss;
+                    ss << L"Document isn't valid UTF8. Invalid UTF8 sequence at offset " << errorOffset;
+                    THROW_ERROR(ss.str().c_str());
+                }
+                return sChunk;
+            }
+        private:
+            CXmlInputSource& mInput;
+            CConversionMetrics* mMetrics;
+            CUtf8StreamValidator mValidator;
+        };
+    }
+
+    CCatalogRecord::CCatalogRecord(const allocator_type& allocator) :
+        mFields{
+            std::pmr::string(allocator),
+            std::pmr::string(allocator),
+            std::pmr::string(allocator),
+            std::pmr::string(allocator),
+            std::pmr::string(allocator),
+            std::pmr::string(allocator)
+        },
+        mPresentFields(0)
+    {
+        static_assert(static_cast<size_t>(ECatalogField::Count) == 6, "All fields should be initialized");
+    }
+
+    // Assignment keeps allocator of this record (fields are copied if allocators differ)
+    CCatalogRecord::CCatalogRecord(const CCatalogRecord& other, const allocator_type& allocator) :
+        CCatalogRecord(allocator)
+    {
+        *this = other;
+    }
+
+    CCatalogRecord::CCatalogRecord(CCatalogRecord&& other, const allocator_type& allocator) :
+        CCatalogRecord(allocator)
+    {
+        *this = std::move(other);
+    }
+
+    void CCatalogRecord::Clear() noexcept
+    {
+        for (auto& field : mFields)
+            field.clear();
+        mPresentFields = 0;
+    }
+
+    CCatalogReader::CCatalogReader(CXmlPullParser& parser) :
+        mParser(parser),
+        mIsCatalog(false)
+    {}
+
+    bool CCatalogReader::Next(CCatalogRecord& o_record)
+    {
+        return Next(o_record, nullptr, nullptr, nullptr, nullptr);
+    }
+
+    bool CCatalogReader::Next(CCatalogRecord& o_record, CCatalogRowCache& rowCache, bool& o_isCached,
+        CCatalogCachedRow& o_cachedRow, std::string_view& o_sRecordBytes)
+    {
+        return Next(o_record, &rowCache, &o_isCached, &o_cachedRow, &o_sRecordBytes);
+    }
+
+    bool CCatalogReader::Next(CCatalogRecord& o_record, CCatalogRowCache* rowCache, bool* o_isCached,
+        CCatalogCachedRow* o_cachedRow, std::string_view* o_sRecordBytes)
+    {
+        o_record.Clear();
+        if (o_isCached != nullptr)
+            *o_isCached = false;
+        bool inRecord = false;
+        size_t recordOffset = 0;
+        std::pmr::string* capturedField = nullptr;
+        for (;;)
+        {
+            switch (mParser.Next())
+            {
+            case CXmlPullParser::Token::StartElement:
+                switch (mParser.Depth())
+                {
+                case CATALOG_DEPTH:
+                    mIsCatalog = mParser.Name() == "CATALOG";
+                    break;
+                case CD_DEPTH:
+                    inRecord = mIsCatalog && mParser.Name() == "CD";
+                    // Record bytes are used only for whole documents (row cache) - so
+                    // their offsets fit into size_t
+                    recordOffset = static_cast<size_t>(mParser.StartTagOffset());
+                    if (inRecord && rowCache != nullptr && !mParser.IsEmptyElement())
+                    {
+                        // Element that ends with the first end tag found is looked up. If
+                        // it contains nested CD elements it's never found (it's cached with
+                        // its real end) - so it's parsed every time, which is still correct.
+                        const std::string_view sEndTag = "</CD>";
+                        std::string_view sXml = mParser.Document();
+                        size_t endOffset = sXml.find(sEndTag, static_cast<size_t>(mParser.Offset()));
+                        if (endOffset != std::string_view::npos)
+                        {
+                            endOffset += sEndTag.size();
+                            std::string_view sRecordBytes = sXml.substr(recordOffset, endOffset - recordOffset);
+                            if (rowCache->Find(sRecordBytes, *o_cachedRow))
+                            {
+                                mParser.SkipElement(endOffset);
+                                *o_isCached = true;
+                                *o_sRecordBytes = sRecordBytes;
+                                return true;
+                            }
+                        }
+                    }
+                    break;
+                case FIELD_DEPTH:
+                    if (!inRecord)
+                        break;
+                    for (size_t i = 0; i < static_cast<size_t>(ECatalogField::Count); ++i)
+                    {
+                        if (mParser.Name() == FieldElementNames[i])
+                        {
+                            if ((o_record.mPresentFields & (1u << i)) == 0)
+                            {
+                                o_record.mPresentFields |= 1u << i;
+                                capturedField = &o_record.mFields[i];
+                            }
+                            break;
+                        }
+                    }
+                    break;
+                }
+                break;
+            case CXmlPullParser::Token::Text:
+                // String value of field element includes text of all its descendants
+                if (capturedField != nullptr)
+                    capturedField->append(mParser.Text());
+                break;
+            case CXmlPullParser::Token::EndElement:
+                if (mParser.Depth() == FIELD_DEPTH)
+                {
+                    capturedField = nullptr;
+                }
+                else if (mParser.Depth() == CD_DEPTH && inRecord)
+                {
+                    if (o_sRecordBytes != nullptr)
+                        *o_sRecordBytes = mParser.Document().substr(recordOffset,
+                            static_cast<size_t>(mParser.Offset()) - recordOffset);
+                    return true;
+                }
+                break;
+            case CXmlPullParser::Token::EndOfDocument:
+            case CXmlPullParser::Token::Error:
+                o_record.Clear();
+                return false;
+            }
+        }
+    }
+
+    CStatus CCatalogReader::GetStatus() const noexcept
+    {
+        return mParser.GetStatus();
+    }
+
+    void CCatalogHtmlRenderer::WriteHeader(std::pmr::string& o_sHtml)
+    {
+        o_sHtml.append(CatItemsStylesheet::Header, sizeof(CatItemsStylesheet::Header) - 1);
+    }
+
+    void CCatalogHtmlRenderer::WriteRow(const CCatalogRecord& record, std::pmr::string& o_sHtml)
+    {
+        CatItemsStylesheet::WriteRow(record, o_sHtml);
+    }
+
+    void CCatalogHtmlRenderer::WriteFooter(std::pmr::string& o_sHtml)
+    {
+        o_sHtml.append(CatItemsStylesheet::Footer, sizeof(CatItemsStylesheet::Footer) - 1);
+    }
+
+    void CCatalogHtmlRenderer::AppendEscaped(std::string_view sText, std::pmr::string& o_sHtml)
+    {
+        CHtmlEscaper::Append(sText, o_sHtml);
+    }
+
+    CStatus CCatalogEngine::Transform(std::string_view sXml, COutputSink& o_html, const CTransformOptions& options)
+    {
+        {
+            CTraceSpan decodeSpan("decode");
+            CMetricsTimer decodeTimer(options.mMetrics, CConversionMetrics::EMPhase::Decode, sXml.size());
+            size_t errorOffset = 0;
+            if (!CUtf8Transcoder::Validate(sXml, &errorOffset))
+            {
+                std::wostringstream ss;
+                ss << L"Document isn't valid UTF8. Invalid UTF8 sequence at offset " << errorOffset;
+                THROW_ERROR(ss.str().c_str());
+            }
+        }
+        // Document is loaded while it's transformed (except for records pulled into the
+        // sorter) - so it's Transform phase. Writes to the sink are Output phase.
+        CExclusiveMetricsTimer transformTimer(options.mMetrics, CConversionMetrics::EMPhase::Transform, sXml.size());
+        CTraceSpan transformSpan("transform");
+        CXmlPullParser parser(sXml, options.mMemoryResource);
+        return TransformDocument(parser, o_html, options);
+    }
+
+    CStatus CCatalogEngine::Transform(CXmlInputSource& xml, COutputSink& o_html, const CTransformOptions& options)
+    {
+        // Cached rows are found by bytes of whole document
+        if (options.mRowCache != nullptr)
+        {
+            THROW_ERROR(L"Incremental conversion requires whole document");
+        }
+        // Input is read and decoded while it's loaded - time of those phases is excluded
+        CExclusiveMetricsTimer transformTimer(options.mMetrics, CConversionMetrics::EMPhase::Transform);
+        CTraceSpan transformSpan("transform");
+        CUtf8ValidatingInput validatingInput(xml, options.mMetrics);
+        CXmlPullParser parser(validatingInput, options.mMemoryResource);
+        CStatus status = TransformDocument(parser, o_html, options);
+        transformTimer.SetBytes(parser.Offset());
+        return status;
+    }
+
+    void CCatalogEngine::Transform(const CCatalogIndex& index, COutputSink& o_html, const CTransformOptions& options)
+    {
+        // Rows are rendered straight from columns - so there's nothing to load
+        CExclusiveMetricsTimer transformTimer(options.mMetrics, CConversionMetrics::EMPhase::Transform, index.GetSize());
+        CTraceSpan transformSpan("transform");
+        size_t position = 0;
+        RenderRecords([&index, &position](CCatalogRecord& o_record) {
+            if (position == index.GetRecordCount())
+                return false;
+            index.GetRecord(index.GetSortedRecord(position++), o_record);
+            return true;
+        }, o_html, options);
+    }
+
+    CStatus CCatalogEngine::Transform(std::string_view sXml, std::string& o_sHtml)
+    {
+        o_sHtml.clear();
+        CStringOutputSink htmlSink(o_sHtml);
+        return Transform(sXml, htmlSink);
+    }
+}
@@ -0,0 +1,189 @@
+// Contains declaration of OS-independent native engine that converts CATALOG/CD XML
+// documents into HTML. It's equivalent to win/xslt/cat_items.xslt stylesheet, but
+// doesn't build a DOM: the input is tokenized once and only the fields used by the
+// stylesheet are kept in memory.
+#ifndef OT_CATALOGENGINE_H__
+#define OT_CATALOGENGINE_H__
+
+#include "Util.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory_resource>
+
+namespace OTInterviewExercise1
+{
+    class CXmlPullParser;
+    class CXmlInputSource;
+    class COutputSink;
+    class CPageOutput;
+    class CCatalogRowCache;
+    class CCatalogIndex;
+    class CConversionMetrics;
+    struct CCatalogCachedRow;
+
+    // Fields of CATALOG/CD element that are used by the stylesheet (in column order)
+    enum class ECatalogField
+    {
+        Title,
+        Artist,
+        Country,
+        Company,
+        Price,
+        Year,
+        Count
+    };
+
+    // Compares values of the sort field (returns <0, 0 or >0). MSXML sorts text by
+    // case-insensitive collation, so ASCII letters are compared regardless of case ("alice"
+    // sorts before "Bob"); other bytes are compared by code point order. Keys that differ
+    // only in case are equal - they keep document order. Linguistic rules of MSXML for
+    // non-ASCII letters and punctuation aren't reproduced.
+    inline int CompareSortKeys(std::string_view sLeft, std::string_view sRight) noexcept
+    {
+        const size_t size = sLeft.size() < sRight.size() ? sLeft.size() : sRight.size();
+        for (size_t i = 0; i < size; ++i)
+        {
+            unsigned char left = static_cast<unsigned char>(sLeft[i]);
+            unsigned char right = static_cast<unsigned char>(sRight[i]);
+            if (left == right)
+                continue;
+            if (left >= 'A' && left <= 'Z')
+                left += 'a' - 'A';
+            if (right >= 'A' && right <= 'Z')
+                right += 'a' - 'A';
+            if (left != right)
+                return left < right ? -1 : 1;
+        }
+        return sLeft.size() == sRight.size() ? 0 : (sLeft.size() < sRight.size() ? -1 : 1);
+    }
+
+    // Fields of one CATALOG/CD element (UTF8). Fields are allocated from memory resource
+    // of the allocator (std::pmr containers pass theirs to the records).
+    struct CCatalogRecord
+    {
+        using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+        CCatalogRecord() :
+            CCatalogRecord(allocator_type())
+        {}
+        explicit CCatalogRecord(const allocator_type& allocator);
+        CCatalogRecord(const CCatalogRecord& other, const allocator_type& allocator);
+        CCatalogRecord(CCatalogRecord&& other, const allocator_type& allocator);
+        CCatalogRecord(const CCatalogRecord& other) = default;
+        CCatalogRecord(CCatalogRecord&& other) = default;
+        CCatalogRecord& operator=(const CCatalogRecord& other) = default;
+        CCatalogRecord& operator=(CCatalogRecord&& other) = default;
+
+        bool Has(ECatalogField field) const noexcept
+        {
+            return (mPresentFields & (1u << static_cast<unsigned int>(field))) != 0;
+        }
+        const std::pmr::string& Get(ECatalogField field) const noexcept
+        {
+            return mFields[static_cast<size_t>(field)];
+        }
+        void Clear() noexcept;
+
+        std::pmr::string mFields[static_cast<size_t>(ECatalogField::Count)];
+        // Bit mask of fields present in the element (1 << ECatalogField)
+        unsigned int mPresentFields;
+    };
+
+    // Pulls CATALOG/CD records from XML document one at a time. Only the first
+    // occurrence of each field element is used (as xsl:value-of does).
+    class CCatalogReader
+    {
+    public:
+        explicit CCatalogReader(CXmlPullParser& parser);
+        // Returns false when end of document was reached or document is malformed (see
+        // GetStatus()).
+        bool Next(CCatalogRecord& o_record);
+        // Same as above, but CD elements found in the cache are skipped without being
+        // parsed: o_isCached is set and o_cachedRow receives their row (o_record is empty
+        // then). o_sRecordBytes receives bytes of the element.
+        bool Next(CCatalogRecord& o_record, CCatalogRowCache& rowCache, bool& o_isCached,
+            CCatalogCachedRow& o_cachedRow, std::string_view& o_sRecordBytes);
+        // Error of malformed document (see CXmlPullParser::GetStatus())
+        CStatus GetStatus() const noexcept;
+    private:
+        bool Next(CCatalogRecord& o_record, CCatalogRowCache* rowCache, bool* o_isCached,
+            CCatalogCachedRow* o_cachedRow, std::string_view* o_sRecordBytes);
+
+        CXmlPullParser& mParser;
+        bool mIsCatalog;
+    };
+
+    // Produces HTML markup identical to the output of cat_items.xslt (markup is
+    // generated from the style sheet at build time, see CatItemsStylesheet.h)
+    class CCatalogHtmlRenderer
+    {
+    public:
+        static void WriteHeader(std::pmr::string& o_sHtml);
+        static void WriteRow(const CCatalogRecord& record, std::pmr::string& o_sHtml);
+        static void WriteFooter(std::pmr::string& o_sHtml);
+        // Appends text escaping HTML special characters
+        static void AppendEscaped(std::string_view sText, std::pmr::string& o_sHtml);
+    };
+
+    struct CTransformOptions
+    {
+        CTransformOptions() :
+            mSortMemoryBudget(DEFAULT_SORT_MEMORY_BUDGET),
+            mThreadCount(0),
+            mMemoryResource(std::pmr::get_default_resource()),
+            mRowCache(nullptr),
+            mPageOutput(nullptr),
+            mPageSize(DEFAULT_PAGE_SIZE),
+            mMetrics(nullptr)
+        {}
+        // Records kept for sorting take about that many bytes at most - the rest is
+        // sorted in temporary files (see CCatalogRecordSorter)
+        size_t mSortMemoryBudget;
+        // Number of threads rendering rows (0 means number of hardware threads)
+        unsigned int mThreadCount;
+        // Tokens, records and output chunks of the conversion are allocated from it. It's
+        // used by the calling thread only (worker threads render into heap buffers that
+        // are reused).
+        std::pmr::memory_resource* mMemoryResource;
+        // If it isn't nullptr only CD elements that aren't in the cache are parsed and
+        // rendered (on the calling thread) - other rows are copied from the cache. Rows of
+        // the document are kept in memory (they're sorted in memory, too).
+        CCatalogRowCache* mRowCache;
+        // If it isn't nullptr sorted rows are split into pages of mPageSize rows that are
+        // rendered in parallel and passed to it, while the output receives index page that
+        // links to the pages (with range of sort field values of every page). It can't be
+        // combined with mRowCache.
+        CPageOutput* mPageOutput;
+        size_t mPageSize;
+        // Time of phases of the conversion is added to it if it isn't nullptr
+        CConversionMetrics* mMetrics;
+
+        static constexpr size_t DEFAULT_SORT_MEMORY_BUDGET = 256 * 1024 * 1024;
+        static constexpr size_t DEFAULT_PAGE_SIZE = 1000;
+    };
+
+    class CCatalogEngine
+    {
+    public:
+        // Converts UTF8 XML document to UTF8 HTML. Rows are sorted by ARTIST (stable, see
+        // CompareSortKeys() for how it differs from <xsl:sort select="ARTIST"/> of MSXML).
+        // Large documents are rendered in batches of rows on several threads; batches are
+        // passed to the sink in order.
+        // Malformed XML is reported by returned status (see FormatParseError()) - output
+        // is incomplete then. Invalid UTF8 and other failures are thrown as CException.
+        static CStatus Transform(std::string_view sXml, COutputSink& o_html,
+            const CTransformOptions& options = CTransformOptions());
+        static CStatus Transform(std::string_view sXml, std::string& o_sHtml);
+        // Same as above, but document is pulled from input as it's parsed (its UTF8 is
+        // validated chunk by chunk) - so reading of input overlaps conversion. Incremental
+        // conversion (mRowCache) isn't supported.
+        static CStatus Transform(CXmlInputSource& xml, COutputSink& o_html,
+            const CTransformOptions& options = CTransformOptions());
+        // Renders records of catalog index (in its sort order) - no XML is parsed.
+        // mRowCache and mSortMemoryBudget aren't used.
+        static void Transform(const CCatalogIndex& index, COutputSink& o_html,
+            const CTransformOptions& options = CTransformOptions());
+    };
+}
+#endif
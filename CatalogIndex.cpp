@@ -0,0 +1,353 @@
+// Contains OS-independent implementation of columnar index of CATALOG/CD records.
+
+#include "CatalogIndex.h"
+#include "CatItemsStylesheet.h"
+#include "CatalogRowCache.h"
+#include "ConversionMetrics.h"
+#include "OutputSink.h"
+#include "Trace.h"
+#include "Utf8Transcoder.h"
+#include "XmlPullParser.h"
+#include "Util.h"
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+#include <vector>
+#include <string.h>
+
+namespace OTInterviewExercise1
+{
+    namespace
+    {
+        // File layout (integers are in native byte order - the file is a local cache):
+        //   header: magic, XML file size (u64), XML file modification time (i64), hash of
+        //     XML file (u64), sort field (u32), record count (u32)
+        //   present fields: bit mask (u8) of every record, padded to 8 bytes
+        //   offsets: offset (u64) of every value in the heap - values of the first field of
+        //     all records, then of the second one, etc. - and the end of the heap
+        //   sort order: record indexes (u32) sorted by sort field (stable)
+        //   heap: values
+        const char FileMagic[] = "OTCATX02";
+        const size_t FILE_MAGIC_SIZE = sizeof(FileMagic) - 1;
+        // Offsets of fields in header
+        enum
+        {
+            HEADER_XML_SIZE = FILE_MAGIC_SIZE,
+            HEADER_XML_TIME = HEADER_XML_SIZE + 8,
+            HEADER_XML_HASH = HEADER_XML_TIME + 8,
+            HEADER_SORT_FIELD = HEADER_XML_HASH + 8,
+            HEADER_RECORD_COUNT = HEADER_SORT_FIELD + 4,
+            FILE_HEADER_SIZE = HEADER_RECORD_COUNT + 4
+        };
+        const size_t FIELD_COUNT = static_cast<size_t>(ECatalogField::Count);
+        static_assert(FIELD_COUNT <= 8, "Present fields don't fit into a byte");
+
+        template<typename T> T ReadInteger(const char* data) noexcept
+        {
+            T value;
+            memcpy(&value, data, sizeof(T));
+            return value;
+        }
+
+        template<typename T> void AppendInteger(T value, std::string& o_sData)
+        {
+            o_sData.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        inline uint64_t GetPresentFieldsSize(uint64_t recordCount) noexcept
+        {
+            return (recordCount + 7) & ~static_cast<uint64_t>(7);
+        }
+    }
+
+    CCatalogIndex::CCatalogIndex() :
+        mPresentFields(nullptr),
+        mOffsets(nullptr),
+        mSortOrder(nullptr),
+        mHeap(nullptr),
+        mRecordCount(0)
+    {}
+
+    CCatalogIndex::~CCatalogIndex()
+    {}
+
+    bool CCatalogIndex::Load(const wchar_t* sIndexFilePathName, const wchar_t* sXmlFilePathName, std::wstring& o_sReason)
+    {
+        Reset();
+        o_sReason.clear();
+        // Missing file is the normal case for the first conversion
+        CFileVersion indexVersion;
+        CFileVersion xmlVersion;
+        std::wstring sErrorMsg;
+        if (!GetFileVersion(sIndexFilePathName, indexVersion, sErrorMsg))
+        {
+            o_sReason = L"Index file doesn't exist. " + sErrorMsg;
+            return false;
+        }
+        if (!GetFileVersion(sXmlFilePathName, xmlVersion, sErrorMsg))
+        {
+            o_sReason = L"XML file doesn't exist. " + sErrorMsg;
+            return false;
+        }
+        mFile = std::make_unique<CTextFileReader>(sIndexFilePathName, CTextFileReader::ReadMode::Map);
+        std::string_view sData;
+        if (!mFile->GetBytes(sData, sErrorMsg))
+        {
+            Reset();
+            o_sReason = L"Index file can't be read. " + sErrorMsg;
+            return false;
+        }
+        if (sData.size() < FILE_HEADER_SIZE || sData.substr(0, FILE_MAGIC_SIZE) != FileMagic)
+        {
+            Reset();
+            o_sReason = L"Index file has unknown format";
+            return false;
+        }
+        if (ReadInteger<uint32_t>(sData.data() + HEADER_SORT_FIELD) != static_cast<uint32_t>(CatItemsStylesheet::SortField))
+        {
+            Reset();
+            o_sReason = L"Index is sorted by a different field";
+            return false;
+        }
+        bool isStale = ReadInteger<uint64_t>(sData.data() + HEADER_XML_SIZE) != xmlVersion.mSize;
+        if (!isStale && ReadInteger<int64_t>(sData.data() + HEADER_XML_TIME) != xmlVersion.mModificationTime)
+        {
+            // File was touched or copied - it's the same file if its contents are. Index
+            // isn't updated, so that's checked every time until the file is rebuilt.
+            CTextFileReader xmlFile(sXmlFilePathName, CTextFileReader::ReadMode::Map);
+            std::string_view sXml;
+            isStale = !xmlFile.GetBytes(sXml, sErrorMsg) ||
+                CCatalogRowCache::Hash(sXml) != ReadInteger<uint64_t>(sData.data() + HEADER_XML_HASH);
+        }
+        if (isStale)
+        {
+            Reset();
+            o_sReason = L"XML file changed since index was built";
+            return false;
+        }
+        if (!Attach(sData))
+        {
+            Reset();
+            o_sReason = L"Index file is corrupt";
+            LogWarn(__FUNCTION__, __LINE__, L"Catalog index file is corrupt - it's rebuilt");
+            return false;
+        }
+        return true;
+    }
+
+    CStatus CCatalogIndex::Build(std::string_view sXml, const CFileVersion& xmlVersion, CConversionMetrics* metrics)
+    {
+        Reset();
+        {
+            CTraceSpan decodeSpan("decode");
+            CMetricsTimer decodeTimer(metrics, CConversionMetrics::EMPhase::Decode, sXml.size());
+            size_t errorOffset = 0;
+            if (!CUtf8Transcoder::Validate(sXml, &errorOffset))
+            {
+                std::wostringstream ss;
+                ss << L"Document isn't valid UTF8. Invalid UTF8 sequence at offset " << errorOffset;
+                THROW_ERROR(ss.str().c_str());
+            }
+        }
+        CTraceSpan loadSpan("load");
+        CMetricsTimer loadTimer(metrics, CConversionMetrics::EMPhase::Load, sXml.size());
+        // Values of every field and their end offsets in it
+        std::string columns[FIELD_COUNT];
+        std::vector<uint64_t> columnEnds[FIELD_COUNT];
+        std::string sPresentFields;
+        CXmlPullParser parser(sXml);
+        CCatalogReader reader(parser);
+        CCatalogRecord record;
+        while (reader.Next(record))
+        {
+            if (sPresentFields.size() >= UINT32_MAX)
+            {
+                THROW_ERROR(L"Too many records for catalog index");
+            }
+            sPresentFields.push_back(static_cast<char>(record.mPresentFields));
+            for (size_t i = 0; i < FIELD_COUNT; ++i)
+            {
+                columns[i].append(record.mFields[i]);
+                columnEnds[i].push_back(columns[i].size());
+            }
+        }
+        CStatus status = reader.GetStatus();
+        if (!status)
+            return status;
+        const uint32_t recordCount = static_cast<uint32_t>(sPresentFields.size());
+
+        std::vector<uint32_t> sortOrder(recordCount);
+        std::iota(sortOrder.begin(), sortOrder.end(), 0);
+        if (CatItemsStylesheet::SortField != ECatalogField::Count)
+        {
+            // Missing field sorts as empty string (like in xsl:sort)
+            const size_t field = static_cast<size_t>(CatItemsStylesheet::SortField);
+            auto getKey = [&columns, &columnEnds, field](uint32_t index) {
+                size_t start = index == 0 ? 0 : static_cast<size_t>(columnEnds[field][index - 1]);
+                return std::string_view(columns[field]).substr(start, static_cast<size_t>(columnEnds[field][index]) - start);
+            };
+            std::stable_sort(sortOrder.begin(), sortOrder.end(), [&getKey](uint32_t left, uint32_t right) {
+                return CompareSortKeys(getKey(left), getKey(right)) < 0;
+            });
+        }
+
+        std::string sData;
+        uint64_t heapSize = 0;
+        for (const auto& column : columns)
+            heapSize += column.size();
+        sData.reserve(static_cast<size_t>(FILE_HEADER_SIZE + GetPresentFieldsSize(recordCount) +
+            (FIELD_COUNT * recordCount + 1) * sizeof(uint64_t) + recordCount * sizeof(uint32_t) + heapSize));
+        sData.append(FileMagic, FILE_MAGIC_SIZE);
+        AppendInteger(static_cast<uint64_t>(sXml.size()), sData);
+        AppendInteger(xmlVersion.mModificationTime, sData);
+        AppendInteger(CCatalogRowCache::Hash(sXml), sData);
+        AppendInteger(static_cast<uint32_t>(CatItemsStylesheet::SortField), sData);
+        AppendInteger(recordCount, sData);
+        sData.append(sPresentFields);
+        sData.append(static_cast<size_t>(GetPresentFieldsSize(recordCount)) - recordCount, '\0');
+        uint64_t columnOffset = 0;
+        for (size_t i = 0; i < FIELD_COUNT; ++i)
+        {
+            for (uint32_t j = 0; j < recordCount; ++j)
+                AppendInteger(columnOffset + (j == 0 ? 0 : columnEnds[i][j - 1]), sData);
+            columnOffset += columns[i].size();
+        }
+        AppendInteger(columnOffset, sData);
+        for (uint32_t index : sortOrder)
+            AppendInteger(index, sData);
+        for (auto& column : columns)
+        {
+            sData.append(column);
+            std::string().swap(column);
+        }
+
+        msBuiltData = std::move(sData);
+        if (!Attach(msBuiltData))
+        {
+            Reset();
+            THROW_ERROR(L"Built catalog index is invalid");
+        }
+        return status;
+    }
+
+    void CCatalogIndex::Save(const wchar_t* sIndexFilePathName) const
+    {
+        if (msData.empty())
+        {
+            THROW_ERROR(L"Catalog index isn't built");
+        }
+        // New file is written next to the old one and replaces it when it's complete, so
+        // that the index file is never left half-written
+        std::wstring sTempFilePathName = std::wstring(sIndexFilePathName) + L".tmp";
+        {
+            CFileOutputSink file(sTempFilePathName.c_str(), msData.size());
+            try
+            {
+                file.Write(msData.data(), msData.size());
+                file.Close();
+            }
+            catch (...)
+            {
+                file.Discard();
+                throw;
+            }
+        }
+        std::wstring sErrorMsg;
+        if (!RenameFile(sTempFilePathName.c_str(), sIndexFilePathName, sErrorMsg))
+        {
+            THROW_ERROR(sErrorMsg.c_str());
+        }
+    }
+
+    uint32_t CCatalogIndex::GetSortedRecord(size_t position) const noexcept
+    {
+        return ReadInteger<uint32_t>(mSortOrder + position * sizeof(uint32_t));
+    }
+
+    bool CCatalogIndex::Has(uint32_t record, ECatalogField field) const noexcept
+    {
+        return (static_cast<unsigned char>(mPresentFields[record]) & (1u << static_cast<unsigned int>(field))) != 0;
+    }
+
+    std::string_view CCatalogIndex::Get(uint32_t record, ECatalogField field) const noexcept
+    {
+        const char* offset = mOffsets + (static_cast<size_t>(field) * mRecordCount + record) * sizeof(uint64_t);
+        size_t start = static_cast<size_t>(ReadInteger<uint64_t>(offset));
+        size_t end = static_cast<size_t>(ReadInteger<uint64_t>(offset + sizeof(uint64_t)));
+        return std::string_view(mHeap + start, end - start);
+    }
+
+    void CCatalogIndex::GetRecord(uint32_t record, CCatalogRecord& o_record) const
+    {
+        o_record.Clear();
+        o_record.mPresentFields = static_cast<unsigned char>(mPresentFields[record]);
+        for (size_t i = 0; i < FIELD_COUNT; ++i)
+        {
+            if (Has(record, static_cast<ECatalogField>(i)))
+                o_record.mFields[i].assign(Get(record, static_cast<ECatalogField>(i)));
+        }
+    }
+
+    uint64_t CCatalogIndex::GetXmlSize() const noexcept
+    {
+        return msData.size() < FILE_HEADER_SIZE ? 0 : ReadInteger<uint64_t>(msData.data() + HEADER_XML_SIZE);
+    }
+
+    bool CCatalogIndex::Attach(std::string_view sData)
+    {
+        if (sData.size() < FILE_HEADER_SIZE)
+            return false;
+        const uint64_t recordCount = ReadInteger<uint32_t>(sData.data() + HEADER_RECORD_COUNT);
+        const uint64_t offsetCount = FIELD_COUNT * recordCount + 1;
+        const uint64_t heapOffset = FILE_HEADER_SIZE + GetPresentFieldsSize(recordCount) +
+            offsetCount * sizeof(uint64_t) + recordCount * sizeof(uint32_t);
+        if (heapOffset > sData.size())
+            return false;
+        const uint64_t heapSize = sData.size() - heapOffset;
+        const char* presentFields = sData.data() + FILE_HEADER_SIZE;
+        const char* offsets = presentFields + GetPresentFieldsSize(recordCount);
+        const char* sortOrder = offsets + offsetCount * sizeof(uint64_t);
+        // Whole index is checked (it's much less work than parsing of XML), so that
+        // values and records are read without checks
+        for (uint64_t i = 0; i < recordCount; ++i)
+        {
+            if ((static_cast<unsigned char>(presentFields[i]) >> FIELD_COUNT) != 0)
+                return false;
+        }
+        uint64_t previousOffset = 0;
+        for (uint64_t i = 0; i < offsetCount; ++i)
+        {
+            uint64_t offset = ReadInteger<uint64_t>(offsets + i * sizeof(uint64_t));
+            if (offset < previousOffset || offset > heapSize)
+                return false;
+            previousOffset = offset;
+        }
+        std::vector<bool> isSorted(static_cast<size_t>(recordCount), false);
+        for (uint64_t i = 0; i < recordCount; ++i)
+        {
+            uint32_t index = ReadInteger<uint32_t>(sortOrder + i * sizeof(uint32_t));
+            if (index >= recordCount || isSorted[index])
+                return false;
+            isSorted[index] = true;
+        }
+        msData = sData;
+        mPresentFields = presentFields;
+        mOffsets = offsets;
+        mSortOrder = sortOrder;
+        mHeap = sData.data() + heapOffset;
+        mRecordCount = static_cast<uint32_t>(recordCount);
+        return true;
+    }
+
+    void CCatalogIndex::Reset() noexcept
+    {
+        msData = std::string_view();
+        mPresentFields = nullptr;
+        mOffsets = nullptr;
+        mSortOrder = nullptr;
+        mHeap = nullptr;
+        mRecordCount = 0;
+        mFile.reset();
+        std::string().swap(msBuiltData);
+    }
+}
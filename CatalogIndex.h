@@ -0,0 +1,82 @@
+// Contains declaration of OS-independent columnar index of CATALOG/CD records of an XML
+// file. It's kept in a sidecar file (.catidx), so that repeated conversions of the same
+// XML file don't parse it at all.
+#ifndef OT_CATALOGINDEX_H__
+#define OT_CATALOGINDEX_H__
+
+#include "CatalogEngine.h"
+#include <string>
+#include <string_view>
+#include <memory>
+#include <stdint.h>
+
+namespace OTInterviewExercise1
+{
+    class CTextFileReader;
+    class CConversionMetrics;
+    struct CFileVersion;
+
+    // Fields of records are kept by columns: values of a field of all records follow each
+    // other in a string heap and are found by an array of offsets. Order of records sorted
+    // by the sort field of the style sheet is kept, too - so rows are rendered straight
+    // from the memory-mapped file. The file identifies the XML file it was built from (its
+    // size, modification time and hash of contents): the index is stale once the XML file
+    // changes (or the sort field of the build changes) and it has to be built again.
+    // Not thread-safe. Errors (except malformed XML) are reported by throwing CException.
+    class CCatalogIndex
+    {
+    public:
+        CCatalogIndex();
+        ~CCatalogIndex();
+
+        CCatalogIndex(const CCatalogIndex&) = delete;
+        CCatalogIndex& operator=(const CCatalogIndex&) = delete;
+
+        // Maps index file of XML file. Returns false if the index file is missing, corrupt
+        // or stale (o_sReason contains the reason). XML file is read only if its
+        // modification time changed, but its size didn't (contents are compared by hash).
+        bool Load(const wchar_t* sIndexFilePathName, const wchar_t* sXmlFilePathName, std::wstring& o_sReason);
+        // Parses XML document (contents of XML file of version xmlVersion) into index.
+        // Malformed XML is reported by returned status (index isn't built then); invalid
+        // UTF8 is thrown.
+        CStatus Build(std::string_view sXml, const CFileVersion& xmlVersion, CConversionMetrics* metrics = nullptr);
+        // Writes built index to file (stale file is replaced atomically)
+        void Save(const wchar_t* sIndexFilePathName) const;
+
+        size_t GetRecordCount() const noexcept
+        {
+            return mRecordCount;
+        }
+        // Index of record at position in sort order
+        uint32_t GetSortedRecord(size_t position) const noexcept;
+        bool Has(uint32_t record, ECatalogField field) const noexcept;
+        std::string_view Get(uint32_t record, ECatalogField field) const noexcept;
+        // Copies fields of record
+        void GetRecord(uint32_t record, CCatalogRecord& o_record) const;
+        // Size of XML file that index was built from
+        uint64_t GetXmlSize() const noexcept;
+        // Size of the index (file)
+        size_t GetSize() const noexcept
+        {
+            return msData.size();
+        }
+
+        static constexpr const wchar_t* FILE_EXTENSION = L".catidx";
+    private:
+        // Points columns into index data. Returns false if data is corrupt.
+        bool Attach(std::string_view sData);
+        void Reset() noexcept;
+
+        std::unique_ptr<CTextFileReader> mFile;
+        // Built index (mapped file is used otherwise)
+        std::string msBuiltData;
+        // Parts of index data (see CatalogIndex.cpp)
+        std::string_view msData;
+        const char* mPresentFields;
+        const char* mOffsets;
+        const char* mSortOrder;
+        const char* mHeap;
+        uint32_t mRecordCount;
+    };
+}
+#endif
@@ -0,0 +1,425 @@
+// Contains OS-independent implementation of sorter of CATALOG/CD records that works
+// within a memory budget.
+
+#include "CatalogRecordSorter.h"
+#include "Util.h"
+#include <algorithm>
+#include <sstream>
+#include <errno.h>
+#include <string.h>
+
+namespace OTInterviewExercise1
+{
+    namespace
+    {
+        // Serialized record: varint size of the rest of record, bit mask of present
+        // fields, then varint size and bytes of each present field.
+        const size_t MIN_READ_BUFFER_SIZE = 4 * 1024;
+        const size_t MAX_READ_BUFFER_SIZE = 1024 * 1024;
+        const size_t WRITE_BUFFER_SIZE = 64 * 1024;
+        // Most runs that are merged at once
+        const size_t MAX_MERGE_WIDTH = 64;
+        // Runs are merged while records are added when there are that many of them
+        const size_t MAX_RUN_COUNT = 512;
+
+        void AppendVarint(size_t value, std::string& o_data)
+        {
+            while (value >= 0x80)
+            {
+                o_data.push_back(static_cast<char>((value & 0x7F) | 0x80));
+                value >>= 7;
+            }
+            o_data.push_back(static_cast<char>(value));
+        }
+
+        // Returns false if data ends before varint does
+        bool ReadVarint(const char*& io_data, const char* end, size_t& o_value)
+        {
+            o_value = 0;
+            for (unsigned int shift = 0; io_data < end && shift < 64; shift += 7)
+            {
+                unsigned char c = static_cast<unsigned char>(*io_data++);
+                o_value |= static_cast<size_t>(c & 0x7F) << shift;
+                if ((c & 0x80) == 0)
+                    return true;
+            }
+            return false;
+        }
+
+        size_t GetVarintSize(size_t value)
+        {
+            size_t size = 1;
+            for (; value >= 0x80; value >>= 7)
+                ++size;
+            return size;
+        }
+
+        // Appends serialized record. o_keyOffset receives offset of sort field value in
+        // o_data (npos if record has no such field).
+        void AppendRecord(const CCatalogRecord& record, ECatalogField sortField, std::string& o_data,
+            size_t& o_keyOffset)
+        {
+            size_t bodySize = 1;
+            for (size_t i = 0; i < static_cast<size_t>(ECatalogField::Count); ++i)
+            {
+                if (record.Has(static_cast<ECatalogField>(i)))
+                    bodySize += GetVarintSize(record.mFields[i].size()) + record.mFields[i].size();
+            }
+            AppendVarint(bodySize, o_data);
+            o_data.push_back(static_cast<char>(record.mPresentFields));
+            o_keyOffset = std::string::npos;
+            for (size_t i = 0; i < static_cast<size_t>(ECatalogField::Count); ++i)
+            {
+                if (!record.Has(static_cast<ECatalogField>(i)))
+                    continue;
+                AppendVarint(record.mFields[i].size(), o_data);
+                if (static_cast<ECatalogField>(i) == sortField)
+                    o_keyOffset = o_data.size();
+                o_data.append(record.mFields[i]);
+            }
+        }
+
+        // Decodes record body (data after size prefix)
+        void DecodeRecord(const char* data, const char* end, CCatalogRecord& o_record)
+        {
+            o_record.Clear();
+            if (data >= end)
+                THROW_ERROR(L"Temporary file contains corrupted record");
+            unsigned int presentFields = static_cast<unsigned char>(*data++);
+            for (size_t i = 0; i < static_cast<size_t>(ECatalogField::Count); ++i)
+            {
+                if ((presentFields & (1u << i)) == 0)
+                    continue;
+                size_t fieldSize = 0;
+                if (!ReadVarint(data, end, fieldSize) || fieldSize > static_cast<size_t>(end - data))
+                    THROW_ERROR(L"Temporary file contains corrupted record");
+                o_record.mFields[i].assign(data, fieldSize);
+                data += fieldSize;
+            }
+            o_record.mPresentFields = presentFields;
+        }
+
+        void ThrowFileError(const wchar_t* sOperation)
+        {
+            int lastErr = errno;
+            std::wostringstream ss;
+            ss << sOperation << L" failed. Error code: " << lastErr;
+            THROW_ERROR(ss.str().c_str());
+        }
+    }
+
+    class CCatalogRecordSorter::CRunReader
+    {
+    public:
+        virtual ~CRunReader() = default;
+        // Returns false when run ended
+        virtual bool Next(CCatalogRecord& o_record) = 0;
+    };
+
+    // Reads sorted records that are kept in memory
+    class CCatalogRecordSorter::CMemoryRunReader : public CCatalogRecordSorter::CRunReader
+    {
+    public:
+        CMemoryRunReader(const std::string& records, const std::vector<CEntry>& entries) :
+            mRecords(records),
+            mEntries(entries),
+            mNextEntry(0)
+        {}
+        bool Next(CCatalogRecord& o_record) override
+        {
+            if (mNextEntry >= mEntries.size())
+                return false;
+            const CEntry& entry = mEntries[mNextEntry++];
+            const char* data = mRecords.data() + entry.mOffset;
+            const char* end = data + entry.mSize;
+            size_t bodySize = 0;
+            ReadVarint(data, end, bodySize);
+            DecodeRecord(data, end, o_record);
+            return true;
+        }
+    private:
+        const std::string& mRecords;
+        const std::vector<CEntry>& mEntries;
+        size_t mNextEntry;
+    };
+
+    // Reads run from temporary file
+    class CCatalogRecordSorter::CFileRunReader : public CCatalogRecordSorter::CRunReader
+    {
+    public:
+        CFileRunReader(FILE* file, size_t bufferSize) :
+            mFile(file),
+            mBufferSize(bufferSize),
+            mPos(0),
+            mIsEof(false)
+        {
+            if (fseek(mFile, 0, SEEK_SET) != 0)
+                ThrowFileError(L"fseek");
+            mBuffer.reserve(mBufferSize);
+        }
+        bool Next(CCatalogRecord& o_record) override
+        {
+            const char* data = mBuffer.data() + mPos;
+            const char* end = mBuffer.data() + mBuffer.size();
+            size_t bodySize = 0;
+            while (!ReadVarint(data, end, bodySize) || bodySize > static_cast<size_t>(end - data))
+            {
+                if (mIsEof)
+                {
+                    if (mPos != mBuffer.size())
+                        THROW_ERROR(L"Temporary file contains truncated record");
+                    return false;
+                }
+                // Record doesn't fit into buffer - so buffer is refilled (and grown if needed)
+                Fill(bodySize + GetVarintSize(bodySize));
+                data = mBuffer.data() + mPos;
+                end = mBuffer.data() + mBuffer.size();
+            }
+            DecodeRecord(data, data + bodySize, o_record);
+            mPos = data + bodySize - mBuffer.data();
+            return true;
+        }
+    private:
+        void Fill(size_t minSize)
+        {
+            mBuffer.erase(0, mPos);
+            mPos = 0;
+            size_t size = mBuffer.size();
+            mBuffer.resize(std::max(mBufferSize, minSize));
+            size_t bytesRead = fread(&mBuffer[size], 1, mBuffer.size() - size, mFile);
+            if (bytesRead < mBuffer.size() - size)
+            {
+                if (ferror(mFile))
+                    ThrowFileError(L"Reading of temporary file");
+                mIsEof = true;
+            }
+            mBuffer.resize(size + bytesRead);
+        }
+
+        FILE* mFile;
+        size_t mBufferSize;
+        std::string mBuffer;
+        size_t mPos;
+        bool mIsEof;
+    };
+
+    // Merges sorted runs. Records with equal keys are returned in order of runs, so merge
+    // of consecutive runs of a stable sort is stable.
+    class CCatalogRecordSorter::CRunMerger
+    {
+    public:
+        CRunMerger(ECatalogField sortField, std::vector<std::unique_ptr<CRunReader>> readers,
+            std::pmr::memory_resource* memoryResource) :
+            mSortField(sortField),
+            mReaders(std::move(readers)),
+            mCurrent(mReaders.size(), memoryResource)
+        {
+            for (size_t i = 0; i < mReaders.size(); ++i)
+            {
+                if (mReaders[i]->Next(mCurrent[i]))
+                    mHeap.push_back(i);
+            }
+            std::make_heap(mHeap.begin(), mHeap.end(), Greater(*this));
+        }
+        bool Next(CCatalogRecord& o_record)
+        {
+            if (mHeap.empty())
+                return false;
+            std::pop_heap(mHeap.begin(), mHeap.end(), Greater(*this));
+            size_t run = mHeap.back();
+            std::swap(o_record, mCurrent[run]);
+            if (mReaders[run]->Next(mCurrent[run]))
+                std::push_heap(mHeap.begin(), mHeap.end(), Greater(*this));
+            else
+                mHeap.pop_back();
+            return true;
+        }
+    private:
+        // Heap is max-heap - so comparison is inverted to get the smallest record first
+        struct Greater
+        {
+            explicit Greater(const CRunMerger& merger) :
+                mMerger(merger)
+            {}
+            bool operator()(size_t left, size_t right) const
+            {
+                const std::pmr::string& leftKey = mMerger.mCurrent[left].Get(mMerger.mSortField);
+                const std::pmr::string& rightKey = mMerger.mCurrent[right].Get(mMerger.mSortField);
+                int result = CompareSortKeys(leftKey, rightKey);
+                return result > 0 || (result == 0 && left > right);
+            }
+            const CRunMerger& mMerger;
+        };
+
+        ECatalogField mSortField;
+        std::vector<std::unique_ptr<CRunReader>> mReaders;
+        // Current record of every run
+        std::pmr::vector<CCatalogRecord> mCurrent;
+        // Runs that have records
+        std::vector<size_t> mHeap;
+    };
+
+    CCatalogRecordSorter::CCatalogRecordSorter(ECatalogField sortField, size_t memoryBudget,
+        std::pmr::memory_resource* memoryResource) :
+        mSortField(sortField),
+        mMemoryBudget(std::max(memoryBudget, MIN_MEMORY_BUDGET)),
+        mMemoryResource(memoryResource)
+    {}
+
+    CCatalogRecordSorter::~CCatalogRecordSorter()
+    {}
+
+    void CCatalogRecordSorter::Add(const CCatalogRecord& record)
+    {
+        size_t usedMemory = mRecords.size() + mEntries.size() * sizeof(CEntry);
+        if (!mEntries.empty() && usedMemory >= mMemoryBudget)
+        {
+            SpillRun();
+        }
+        CEntry entry;
+        entry.mOffset = mRecords.size();
+        AppendRecord(record, mSortField, mRecords, entry.mKeyOffset);
+        entry.mSize = mRecords.size() - entry.mOffset;
+        entry.mKeyLength = record.Get(mSortField).size();
+        if (entry.mKeyOffset == std::string::npos)
+        {
+            entry.mKeyOffset = 0;
+            entry.mKeyLength = 0;
+        }
+        mEntries.push_back(entry);
+    }
+
+    void CCatalogRecordSorter::Sort()
+    {
+        std::vector<std::unique_ptr<CRunReader>> readers;
+        if (mRunFiles.empty())
+        {
+            // Everything fits into memory
+            SortRecords();
+            readers.push_back(std::make_unique<CMemoryRunReader>(mRecords, mEntries));
+        }
+        else
+        {
+            if (!mEntries.empty())
+                SpillRun();
+            // Memory of records is given to read buffers
+            std::string().swap(mRecords);
+            std::vector<CEntry>().swap(mEntries);
+            ReduceRuns();
+            size_t bufferSize = GetReadBufferSize(mRunFiles.size());
+            for (auto& runFile : mRunFiles)
+                readers.push_back(std::make_unique<CFileRunReader>(runFile.get(), bufferSize));
+        }
+        mMerger = std::make_unique<CRunMerger>(mSortField, std::move(readers), mMemoryResource);
+    }
+
+    bool CCatalogRecordSorter::Next(CCatalogRecord& o_record)
+    {
+        if (mMerger == nullptr)
+            THROW_ERROR(L"Records weren't sorted");
+        return mMerger->Next(o_record);
+    }
+
+    void CCatalogRecordSorter::SortRecords()
+    {
+        const char* records = mRecords.data();
+        std::stable_sort(mEntries.begin(), mEntries.end(),
+            [records](const CEntry& left, const CEntry& right) {
+                return CompareSortKeys(std::string_view(records + left.mKeyOffset, left.mKeyLength),
+                    std::string_view(records + right.mKeyOffset, right.mKeyLength)) < 0;
+            });
+    }
+
+    void CCatalogRecordSorter::SpillRun()
+    {
+        SortRecords();
+        FilePtr runFile(tmpfile());
+        if (runFile == nullptr)
+            ThrowFileError(L"Creation of temporary file");
+        std::string sBuffer;
+        sBuffer.reserve(WRITE_BUFFER_SIZE);
+        for (const auto& entry : mEntries)
+        {
+            sBuffer.append(mRecords, entry.mOffset, entry.mSize);
+            if (sBuffer.size() >= WRITE_BUFFER_SIZE)
+            {
+                if (fwrite(sBuffer.data(), 1, sBuffer.size(), runFile.get()) != sBuffer.size())
+                    ThrowFileError(L"Writing of temporary file");
+                sBuffer.clear();
+            }
+        }
+        if (fwrite(sBuffer.data(), 1, sBuffer.size(), runFile.get()) != sBuffer.size() ||
+            fflush(runFile.get()) != 0)
+        {
+            ThrowFileError(L"Writing of temporary file");
+        }
+        mRunFiles.push_back(std::move(runFile));
+        // Capacity is kept as the buffers are filled again up to the budget (unless a huge
+        // record made them grow beyond it)
+        mRecords.clear();
+        mEntries.clear();
+        if (mRecords.capacity() > mMemoryBudget)
+            std::string().swap(mRecords);
+        // Number of open temporary files is limited
+        if (mRunFiles.size() >= MAX_RUN_COUNT)
+            ReduceRuns();
+    }
+
+    void CCatalogRecordSorter::ReduceRuns()
+    {
+        size_t maxRuns = std::min(MAX_MERGE_WIDTH,
+            std::max<size_t>(2, mMemoryBudget / (2 * MIN_READ_BUFFER_SIZE)));
+        while (mRunFiles.size() > maxRuns)
+        {
+            // Consecutive runs are merged (order of runs is kept for stability)
+            std::vector<FilePtr> mergedRuns;
+            size_t bufferSize = GetReadBufferSize(maxRuns);
+            for (size_t first = 0; first < mRunFiles.size(); first += maxRuns)
+            {
+                size_t last = std::min(first + maxRuns, mRunFiles.size());
+                if (last - first == 1)
+                {
+                    mergedRuns.push_back(std::move(mRunFiles[first]));
+                    continue;
+                }
+                std::vector<std::unique_ptr<CRunReader>> readers;
+                for (size_t i = first; i < last; ++i)
+                    readers.push_back(std::make_unique<CFileRunReader>(mRunFiles[i].get(), bufferSize));
+                CRunMerger merger(mSortField, std::move(readers), mMemoryResource);
+
+                FilePtr runFile(tmpfile());
+                if (runFile == nullptr)
+                    ThrowFileError(L"Creation of temporary file");
+                std::string sBuffer;
+                CCatalogRecord record(mMemoryResource);
+                size_t keyOffset = 0;
+                while (merger.Next(record))
+                {
+                    AppendRecord(record, mSortField, sBuffer, keyOffset);
+                    if (sBuffer.size() >= WRITE_BUFFER_SIZE)
+                    {
+                        if (fwrite(sBuffer.data(), 1, sBuffer.size(), runFile.get()) != sBuffer.size())
+                            ThrowFileError(L"Writing of temporary file");
+                        sBuffer.clear();
+                    }
+                }
+                if (fwrite(sBuffer.data(), 1, sBuffer.size(), runFile.get()) != sBuffer.size() ||
+                    fflush(runFile.get()) != 0)
+                {
+                    ThrowFileError(L"Writing of temporary file");
+                }
+                mergedRuns.push_back(std::move(runFile));
+                // Merged runs are closed (and deleted) right away
+                for (size_t i = first; i < last; ++i)
+                    mRunFiles[i].reset();
+            }
+            mRunFiles = std::move(mergedRuns);
+        }
+    }
+
+    size_t CCatalogRecordSorter::GetReadBufferSize(size_t runCount) const noexcept
+    {
+        size_t bufferSize = mMemoryBudget / (2 * std::max<size_t>(runCount, 1));
+        return std::min(std::max(bufferSize, MIN_READ_BUFFER_SIZE), MAX_READ_BUFFER_SIZE);
+    }
+}
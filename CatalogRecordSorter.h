@@ -0,0 +1,90 @@
+// Contains declaration of OS-independent sorter of CATALOG/CD records that works within
+// a memory budget (external merge sort).
+#ifndef OT_CATALOGRECORDSORTER_H__
+#define OT_CATALOGRECORDSORTER_H__
+
+#include "CatalogEngine.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <stdio.h>
+
+namespace OTInterviewExercise1
+{
+    // Sorts records by a field (stable, see CompareSortKeys()). Records are kept in memory
+    // in compact serialized form; whenever they exceed the memory budget they are sorted
+    // and written to a temporary file as a run. Runs are merged (k-way) while records
+    // are read back, so memory use doesn't depend on number of records (the budget is
+    // approximate: buffers grow by doubling and a record is never split).
+    // Errors are reported by throwing CException.
+    class CCatalogRecordSorter
+    {
+    public:
+        // Records that are read back are allocated from memoryResource. Buffers that grow
+        // up to the memory budget are allocated from heap (an arena wouldn't reuse memory
+        // released while they grow).
+        CCatalogRecordSorter(ECatalogField sortField, size_t memoryBudget,
+            std::pmr::memory_resource* memoryResource = std::pmr::get_default_resource());
+        ~CCatalogRecordSorter();
+
+        CCatalogRecordSorter(const CCatalogRecordSorter&) = delete;
+        CCatalogRecordSorter& operator=(const CCatalogRecordSorter&) = delete;
+
+        void Add(const CCatalogRecord& record);
+        // Called after all records were added. Records are returned by Next() after that.
+        void Sort();
+        // Returns false when all records were returned
+        bool Next(CCatalogRecord& o_record);
+
+        // Number of runs written to temporary files
+        size_t GetRunCount() const noexcept
+        {
+            return mRunFiles.size();
+        }
+
+        // Smallest memory budget (smaller budgets are rounded up to it)
+        static constexpr size_t MIN_MEMORY_BUDGET = 64 * 1024;
+    private:
+        // Record in mRecords buffer
+        struct CEntry
+        {
+            size_t mOffset;
+            size_t mSize;
+            size_t mKeyOffset;
+            size_t mKeyLength;
+        };
+        // Source of sorted records that's merged with other sources
+        class CRunReader;
+        class CMemoryRunReader;
+        class CFileRunReader;
+        class CRunMerger;
+        // Temporary file that's deleted when it's closed
+        struct CFileCloser
+        {
+            void operator()(FILE* file) const noexcept
+            {
+                fclose(file);
+            }
+        };
+        using FilePtr = std::unique_ptr<FILE, CFileCloser>;
+
+        void SortRecords();
+        void SpillRun();
+        // Merges runs until they fit into memory budget (each run needs read buffer) and
+        // limit of merge width
+        void ReduceRuns();
+        size_t GetReadBufferSize(size_t runCount) const noexcept;
+
+        ECatalogField mSortField;
+        size_t mMemoryBudget;
+        std::pmr::memory_resource* mMemoryResource;
+        // Serialized records and their index
+        std::string mRecords;
+        std::vector<CEntry> mEntries;
+        std::vector<FilePtr> mRunFiles;
+        std::unique_ptr<CRunMerger> mMerger;
+    };
+}
+#endif
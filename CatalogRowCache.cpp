@@ -0,0 +1,521 @@
+// Contains OS-independent implementation of cache of rendered CATALOG/CD rows.
+
+#include "CatalogRowCache.h"
+#include "CatalogEngine.h"
+#include "CatItemsStylesheet.h"
+#include "OutputSink.h"
+#include "Util.h"
+#include <algorithm>
+#include <string.h>
+
+namespace OTInterviewExercise1
+{
+    namespace
+    {
+        // File layout (integers are in native byte order - the file is a local cache):
+        //   header: magic, stylesheet fingerprint (u64), row count (u32), slot count (u32)
+        //   index: element hash (u64), element size (u64), key rank (u64), data offset (u64),
+        //     key size (u32), row size (u32) of every row (in document order)
+        //   rank order: row indexes (u32) ordered by key rank
+        //   slots: hash table of row indexes (u32, UINT32_MAX in empty slots, linear
+        //     probing, number of slots is power of 2)
+        //   data: key and row of every row (in document order)
+        const char FileMagic[] = "OTROWC02";
+        const size_t FILE_MAGIC_SIZE = sizeof(FileMagic) - 1;
+        const size_t FILE_HEADER_SIZE = FILE_MAGIC_SIZE + sizeof(uint64_t) + 2 * sizeof(uint32_t);
+        const size_t INDEX_ENTRY_SIZE = 4 * sizeof(uint64_t) + 2 * sizeof(uint32_t);
+        // Offsets of fields in index entry
+        enum
+        {
+            INDEX_HASH = 0,
+            INDEX_SIZE = 8,
+            INDEX_KEY_RANK = 16,
+            INDEX_DATA_OFFSET = 24,
+            INDEX_KEY_SIZE = 32,
+            INDEX_ROW_SIZE = 36
+        };
+        const uint32_t MIN_SLOT_COUNT = 64;
+        // Number of buffers passed to the file by one gather write
+        const size_t WRITE_GATHER_COUNT = 1024;
+
+        template<typename T> T ReadInteger(const char* data) noexcept
+        {
+            T value;
+            memcpy(&value, data, sizeof(T));
+            return value;
+        }
+
+        template<typename T> void AppendInteger(T value, std::string& o_sData)
+        {
+            o_sData.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        inline uint64_t RotateLeft(uint64_t value, unsigned int bits) noexcept
+        {
+            return (value << bits) | (value >> (64 - bits));
+        }
+
+        inline uint64_t MixWord(uint64_t word) noexcept
+        {
+            word *= 0xBF58476D1CE4E5B9ull;
+            return word ^ (word >> 31);
+        }
+
+        // Key order of rows (see CCatalogCachedRow::mKeyRank)
+        inline bool IsKeyEqual(const CCatalogCachedRow& left, const CCatalogCachedRow& right) noexcept
+        {
+            if ((left.mKeyRank & 1) == 0 && (right.mKeyRank & 1) == 0)
+                return left.mKeyRank == right.mKeyRank;
+            return CompareSortKeys(left.mKey, right.mKey) == 0;
+        }
+    }
+
+    CCatalogRowCache::CCatalogRowCache(const wchar_t* sFilePathName) :
+        msFilePathName(sFilePathName != nullptr ? sFilePathName : L""),
+        mIndex(nullptr),
+        mRankOrder(nullptr),
+        mSlots(nullptr),
+        mSlotCount(0),
+        mLoadedCount(0),
+        mNextLoaded(0),
+        mIsUnchanged(true),
+        mHitCount(0),
+        mMissCount(0)
+    {
+        if (msFilePathName.empty())
+        {
+            THROW_ERROR(L"Row cache file name is empty");
+        }
+        Load();
+    }
+
+    CCatalogRowCache::~CCatalogRowCache()
+    {}
+
+    bool CCatalogRowCache::Find(std::string_view sRecordBytes, CCatalogCachedRow& o_row)
+    {
+        uint64_t hash = Hash(sRecordBytes);
+        uint32_t index = NO_ROW;
+        if (mNextLoaded < mLoadedCount && IsLoadedElement(mNextLoaded, hash, sRecordBytes.size()))
+        {
+            index = mNextLoaded++;
+        }
+        else
+        {
+            index = FindLoaded(hash, sRecordBytes.size());
+            // Duplicate elements don't change contents of the file
+            if (index != NO_ROW && !mIsLoadedUsed[index])
+            {
+                mIsUnchanged = false;
+                mNextLoaded = index + 1;
+            }
+        }
+        if (index != NO_ROW)
+        {
+            UseRow(index);
+            GetLoadedRow(index, o_row);
+            mHitCount++;
+            return true;
+        }
+        auto range = mAddedIndex.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            const CAddedRow& addedRow = mAddedRows[it->second];
+            if (addedRow.mSize == sRecordBytes.size())
+            {
+                o_row = addedRow.mRow;
+                mHitCount++;
+                return true;
+            }
+        }
+        mIsUnchanged = false;
+        mMissCount++;
+        return false;
+    }
+
+    void CCatalogRowCache::Add(std::string_view sRecordBytes, std::string_view sKey, std::string_view sRow,
+        CCatalogCachedRow& o_row)
+    {
+        // Element might be cached if caller couldn't look it up (it's added as it is then)
+        uint64_t hash = Hash(sRecordBytes);
+        uint32_t index = FindLoaded(hash, sRecordBytes.size());
+        if (index != NO_ROW)
+        {
+            UseRow(index);
+            GetLoadedRow(index, o_row);
+            return;
+        }
+        auto range = mAddedIndex.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (mAddedRows[it->second].mSize == sRecordBytes.size())
+            {
+                o_row = mAddedRows[it->second].mRow;
+                return;
+            }
+        }
+        if (mAddedRows.size() >= NO_ROW - mLoadedCount)
+        {
+            THROW_ERROR(L"Too many rows in row cache");
+        }
+        CAddedRow& addedRow = mAddedRows.emplace_back();
+        addedRow.mHash = hash;
+        addedRow.mSize = sRecordBytes.size();
+        addedRow.mData.reserve(sKey.size() + sRow.size());
+        addedRow.mData.append(sKey).append(sRow);
+        addedRow.mRow.mKey = std::string_view(addedRow.mData.data(), sKey.size());
+        addedRow.mRow.mRow = std::string_view(addedRow.mData.data() + sKey.size(), sRow.size());
+        addedRow.mRow.mKeyRank = GetKeyRank(sKey);
+        addedRow.mRow.mId = static_cast<uint32_t>(mLoadedCount + mAddedRows.size() - 1);
+        mAddedIndex.emplace(hash, static_cast<uint32_t>(mAddedRows.size() - 1));
+        mDocumentOrder.push_back(addedRow.mRow.mId);
+        mIsUnchanged = false;
+        o_row = addedRow.mRow;
+    }
+
+    void CCatalogRowCache::Save()
+    {
+        auto releaseFile = [this]() {
+            mAddedIndex.clear();
+            mAddedRows.clear();
+            mLoadedCount = 0;
+            mSlotCount = 0;
+            msFileData = std::string_view();
+            mFile.reset();
+        };
+        if (mIsUnchanged && mFile != nullptr && mDocumentOrder.size() == mLoadedCount)
+        {
+            // The file has the same rows in the same order
+            releaseFile();
+            return;
+        }
+
+        const size_t rowCount = mDocumentOrder.size();
+        auto getRow = [this](uint32_t rowId, CCatalogCachedRow& o_row) {
+            if (rowId < mLoadedCount)
+                GetLoadedRow(rowId, o_row);
+            else
+                o_row = mAddedRows[rowId - mLoadedCount].mRow;
+        };
+        // Position of every row in the new file
+        std::vector<uint32_t> positions(mLoadedCount + mAddedRows.size(), NO_ROW);
+        for (size_t i = 0; i < rowCount; ++i)
+            positions[mDocumentOrder[i]] = static_cast<uint32_t>(i);
+        // Ranks are renumbered in key order (0 - rank wasn't assigned yet)
+        std::vector<uint64_t> keyRanks(rowCount, 0);
+        std::vector<uint32_t> rankOrder;
+        rankOrder.reserve(rowCount);
+        uint64_t keyRank = 0;
+        CCatalogCachedRow previousRow{};
+        CCatalogCachedRow row{};
+        for (uint32_t rowId : mKeyOrder)
+        {
+            if (rowId >= positions.size() || positions[rowId] == NO_ROW)
+            {
+                THROW_ERROR(L"Order of rows doesn't match the cache");
+            }
+            uint32_t position = positions[rowId];
+            if (keyRanks[position] != 0)
+                continue;
+            getRow(rowId, row);
+            if (keyRank == 0 || !IsKeyEqual(previousRow, row))
+                keyRank += 2;
+            keyRanks[position] = keyRank;
+            rankOrder.push_back(position);
+            previousRow = row;
+        }
+        if (rankOrder.size() != rowCount)
+        {
+            THROW_ERROR(L"Order of rows wasn't set");
+        }
+        uint32_t slotCount = MIN_SLOT_COUNT;
+        while (slotCount < 2 * rowCount)
+            slotCount *= 2;
+        std::vector<uint32_t> slots(slotCount, NO_ROW);
+        std::vector<uint64_t> hashes(rowCount);
+        std::vector<uint64_t> sizes(rowCount);
+        for (size_t i = 0; i < rowCount; ++i)
+        {
+            uint32_t rowId = mDocumentOrder[i];
+            if (rowId < mLoadedCount)
+            {
+                const char* entry = mIndex + static_cast<size_t>(rowId) * INDEX_ENTRY_SIZE;
+                hashes[i] = ReadInteger<uint64_t>(entry + INDEX_HASH);
+                sizes[i] = ReadInteger<uint64_t>(entry + INDEX_SIZE);
+            }
+            else
+            {
+                hashes[i] = mAddedRows[rowId - mLoadedCount].mHash;
+                sizes[i] = mAddedRows[rowId - mLoadedCount].mSize;
+            }
+            uint32_t slot = static_cast<uint32_t>(hashes[i]) & (slotCount - 1);
+            while (slots[slot] != NO_ROW)
+                slot = (slot + 1) & (slotCount - 1);
+            slots[slot] = static_cast<uint32_t>(i);
+        }
+
+        // New file is written next to the old one and replaces it when it's complete, so
+        // that the cache file is never left half-written
+        std::wstring sTempFilePathName = msFilePathName + L".tmp";
+        {
+            CFileOutputSink file(sTempFilePathName.c_str());
+            try
+            {
+                std::string sData;
+                auto flush = [&sData, &file](bool isLast) {
+                    if (isLast || sData.size() >= CFileOutputSink::BUFFER_SIZE)
+                    {
+                        file.Write(sData.data(), sData.size());
+                        sData.clear();
+                    }
+                };
+                sData.append(FileMagic, FILE_MAGIC_SIZE);
+                AppendInteger(GetStylesheetFingerprint(), sData);
+                AppendInteger(static_cast<uint32_t>(rowCount), sData);
+                AppendInteger(slotCount, sData);
+                uint64_t dataOffset = FILE_HEADER_SIZE + rowCount * (INDEX_ENTRY_SIZE + sizeof(uint32_t)) +
+                    static_cast<uint64_t>(slotCount) * sizeof(uint32_t);
+                for (size_t i = 0; i < rowCount; ++i)
+                {
+                    getRow(mDocumentOrder[i], row);
+                    AppendInteger(hashes[i], sData);
+                    AppendInteger(sizes[i], sData);
+                    AppendInteger(keyRanks[i], sData);
+                    AppendInteger(dataOffset, sData);
+                    AppendInteger(static_cast<uint32_t>(row.mKey.size()), sData);
+                    AppendInteger(static_cast<uint32_t>(row.mRow.size()), sData);
+                    dataOffset += row.mKey.size() + row.mRow.size();
+                    flush(false);
+                }
+                for (uint32_t position : rankOrder)
+                {
+                    AppendInteger(position, sData);
+                    flush(false);
+                }
+                for (uint32_t slot : slots)
+                {
+                    AppendInteger(slot, sData);
+                    flush(false);
+                }
+                flush(true);
+                std::vector<std::string_view> buffers;
+                for (size_t first = 0; first < rowCount; first += WRITE_GATHER_COUNT)
+                {
+                    buffers.clear();
+                    size_t last = std::min(first + WRITE_GATHER_COUNT, rowCount);
+                    for (size_t i = first; i < last; ++i)
+                    {
+                        getRow(mDocumentOrder[i], row);
+                        buffers.push_back(row.mKey);
+                        buffers.push_back(row.mRow);
+                    }
+                    file.WriteGather(buffers.data(), buffers.size());
+                }
+                file.Close();
+            }
+            catch (...)
+            {
+                file.Discard();
+                throw;
+            }
+        }
+        // Mapped file can't be replaced on Windows
+        releaseFile();
+        std::wstring sErrorMsg;
+        if (!RenameFile(sTempFilePathName.c_str(), msFilePathName.c_str(), sErrorMsg))
+        {
+            THROW_ERROR(sErrorMsg.c_str());
+        }
+    }
+
+    uint64_t CCatalogRowCache::Hash(std::string_view sData) noexcept
+    {
+        const uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+        uint64_t hash = (sData.size() + 1) * multiplier;
+        size_t pos = 0;
+        for (; pos + sizeof(uint64_t) <= sData.size(); pos += sizeof(uint64_t))
+        {
+            uint64_t word;
+            memcpy(&word, sData.data() + pos, sizeof(word));
+            hash = RotateLeft(hash ^ MixWord(word), 27) * multiplier;
+        }
+        if (pos != sData.size())
+        {
+            uint64_t word = 0;
+            memcpy(&word, sData.data() + pos, sData.size() - pos);
+            hash = RotateLeft(hash ^ MixWord(word), 27) * multiplier;
+        }
+        hash ^= hash >> 32;
+        hash *= 0x94D049BB133111EBull;
+        return hash ^ (hash >> 29);
+    }
+
+    void CCatalogRowCache::Load()
+    {
+        // Missing file is the normal case for the first conversion
+        CFileVersion version;
+        std::wstring sErrorMsg;
+        if (!GetFileVersion(msFilePathName.c_str(), version, sErrorMsg))
+            return;
+        mFile = std::make_unique<CTextFileReader>(msFilePathName.c_str(), CTextFileReader::ReadMode::Map);
+        std::string_view sData;
+        if (!mFile->GetBytes(sData, sErrorMsg))
+        {
+            mFile.reset();
+            if (IsLogEnabled(CLogger::LogLevel::Warning))
+                LogWarn(__FUNCTION__, __LINE__, L"Row cache file can't be read - it's ignored. " + sErrorMsg);
+            return;
+        }
+        if (sData.size() < FILE_HEADER_SIZE || sData.substr(0, FILE_MAGIC_SIZE) != FileMagic)
+        {
+            mFile.reset();
+            LogWarn(__FUNCTION__, __LINE__, L"Row cache file has unknown format - it's ignored");
+            return;
+        }
+        if (ReadInteger<uint64_t>(sData.data() + FILE_MAGIC_SIZE) != GetStylesheetFingerprint())
+        {
+            // Rows were rendered by a different style sheet
+            mFile.reset();
+            return;
+        }
+        uint32_t rowCount = ReadInteger<uint32_t>(sData.data() + FILE_MAGIC_SIZE + sizeof(uint64_t));
+        uint32_t slotCount = ReadInteger<uint32_t>(sData.data() + FILE_MAGIC_SIZE + sizeof(uint64_t) + sizeof(uint32_t));
+        uint64_t dataOffset = FILE_HEADER_SIZE + static_cast<uint64_t>(rowCount) * (INDEX_ENTRY_SIZE + sizeof(uint32_t)) +
+            static_cast<uint64_t>(slotCount) * sizeof(uint32_t);
+        // Index and rank order are checked here (it reads a small part of the file), slots
+        // are checked when they're used
+        bool isValid = rowCount != NO_ROW && slotCount > rowCount && (slotCount & (slotCount - 1)) == 0 &&
+            dataOffset <= sData.size();
+        const char* index = sData.data() + FILE_HEADER_SIZE;
+        for (uint32_t i = 0; isValid && i < rowCount; ++i)
+        {
+            const char* entry = index + static_cast<size_t>(i) * INDEX_ENTRY_SIZE;
+            uint64_t keyRank = ReadInteger<uint64_t>(entry + INDEX_KEY_RANK);
+            uint64_t rowOffset = ReadInteger<uint64_t>(entry + INDEX_DATA_OFFSET);
+            uint64_t rowSize = static_cast<uint64_t>(ReadInteger<uint32_t>(entry + INDEX_KEY_SIZE)) +
+                ReadInteger<uint32_t>(entry + INDEX_ROW_SIZE);
+            isValid = keyRank != 0 && (keyRank & 1) == 0 && rowOffset >= dataOffset &&
+                rowOffset <= sData.size() && rowSize <= sData.size() - rowOffset;
+        }
+        const char* rankOrder = index + static_cast<size_t>(rowCount) * INDEX_ENTRY_SIZE;
+        uint64_t previousKeyRank = 0;
+        for (uint32_t i = 0; isValid && i < rowCount; ++i)
+        {
+            uint32_t position = ReadInteger<uint32_t>(rankOrder + i * sizeof(uint32_t));
+            isValid = position < rowCount;
+            if (isValid)
+            {
+                uint64_t keyRank = ReadInteger<uint64_t>(index + static_cast<size_t>(position) * INDEX_ENTRY_SIZE + INDEX_KEY_RANK);
+                isValid = keyRank >= previousKeyRank;
+                previousKeyRank = keyRank;
+            }
+        }
+        if (!isValid)
+        {
+            mFile.reset();
+            LogWarn(__FUNCTION__, __LINE__, L"Row cache file is corrupt - it's ignored");
+            return;
+        }
+        msFileData = sData;
+        mIndex = index;
+        mRankOrder = rankOrder;
+        mSlots = rankOrder + static_cast<size_t>(rowCount) * sizeof(uint32_t);
+        mSlotCount = slotCount;
+        mLoadedCount = rowCount;
+        mIsLoadedUsed.assign(rowCount, false);
+        mDocumentOrder.reserve(rowCount);
+    }
+
+    void CCatalogRowCache::GetLoadedRow(uint32_t index, CCatalogCachedRow& o_row) const noexcept
+    {
+        const char* entry = mIndex + static_cast<size_t>(index) * INDEX_ENTRY_SIZE;
+        size_t dataOffset = static_cast<size_t>(ReadInteger<uint64_t>(entry + INDEX_DATA_OFFSET));
+        uint32_t keySize = ReadInteger<uint32_t>(entry + INDEX_KEY_SIZE);
+        o_row.mKey = msFileData.substr(dataOffset, keySize);
+        o_row.mRow = msFileData.substr(dataOffset + keySize, ReadInteger<uint32_t>(entry + INDEX_ROW_SIZE));
+        o_row.mKeyRank = ReadInteger<uint64_t>(entry + INDEX_KEY_RANK);
+        o_row.mId = index;
+    }
+
+    bool CCatalogRowCache::IsLoadedElement(uint32_t index, uint64_t hash, uint64_t size) const noexcept
+    {
+        const char* entry = mIndex + static_cast<size_t>(index) * INDEX_ENTRY_SIZE;
+        return ReadInteger<uint64_t>(entry + INDEX_HASH) == hash && ReadInteger<uint64_t>(entry + INDEX_SIZE) == size;
+    }
+
+    uint32_t CCatalogRowCache::FindLoaded(uint64_t hash, uint64_t size) const noexcept
+    {
+        uint32_t mask = mSlotCount - 1;
+        uint32_t slot = static_cast<uint32_t>(hash) & mask;
+        // Number of probes is limited in case the file is corrupt
+        for (uint32_t probe = 0; probe < mSlotCount; ++probe, slot = (slot + 1) & mask)
+        {
+            uint32_t index = ReadInteger<uint32_t>(mSlots + static_cast<size_t>(slot) * sizeof(uint32_t));
+            if (index >= mLoadedCount)
+                return NO_ROW;
+            if (IsLoadedElement(index, hash, size))
+                return index;
+        }
+        return NO_ROW;
+    }
+
+    uint64_t CCatalogRowCache::GetKeyRank(std::string_view sKey) const noexcept
+    {
+        // Binary search of the first loaded key that isn't less than sKey
+        CCatalogCachedRow row;
+        uint32_t first = 0;
+        uint32_t count = mLoadedCount;
+        while (count > 0)
+        {
+            uint32_t step = count / 2;
+            GetLoadedRow(ReadInteger<uint32_t>(mRankOrder + (first + step) * sizeof(uint32_t)), row);
+            if (CompareSortKeys(row.mKey, sKey) < 0)
+            {
+                first += step + 1;
+                count -= step + 1;
+            }
+            else
+            {
+                count = step;
+            }
+        }
+        if (first == mLoadedCount)
+        {
+            if (mLoadedCount == 0)
+                return 1;
+            GetLoadedRow(ReadInteger<uint32_t>(mRankOrder + (mLoadedCount - 1) * sizeof(uint32_t)), row);
+            return row.mKeyRank + 1;
+        }
+        GetLoadedRow(ReadInteger<uint32_t>(mRankOrder + first * sizeof(uint32_t)), row);
+        return CompareSortKeys(row.mKey, sKey) == 0 ? row.mKeyRank : row.mKeyRank - 1;
+    }
+
+    void CCatalogRowCache::UseRow(uint32_t rowId)
+    {
+        if (!mIsLoadedUsed[rowId])
+        {
+            mIsLoadedUsed[rowId] = true;
+            mDocumentOrder.push_back(rowId);
+        }
+    }
+
+    uint64_t CCatalogRowCache::GetStylesheetFingerprint()
+    {
+        CCatalogRecord record;
+        for (size_t i = 0; i < static_cast<size_t>(ECatalogField::Count); ++i)
+        {
+            // Odd fields are missing, so that rendering of missing fields is covered too
+            if (i % 2 != 0)
+                continue;
+            record.mFields[i] = "<&>\"'";
+            record.mFields[i].push_back(static_cast<char>('0' + i));
+            record.mPresentFields |= 1u << i;
+        }
+        std::pmr::string sHtml;
+        sHtml.push_back(static_cast<char>('0' + static_cast<int>(CatItemsStylesheet::SortField)));
+        CCatalogHtmlRenderer::WriteHeader(sHtml);
+        CCatalogHtmlRenderer::WriteRow(record, sHtml);
+        CCatalogHtmlRenderer::WriteFooter(sHtml);
+        return Hash(sHtml);
+    }
+}
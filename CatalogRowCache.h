@@ -0,0 +1,127 @@
+// Contains declaration of OS-independent cache of rendered CATALOG/CD rows that's kept in
+// a file between conversions (incremental re-conversion).
+#ifndef OT_CATALOGROWCACHE_H__
+#define OT_CATALOGROWCACHE_H__
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <stdint.h>
+
+namespace OTInterviewExercise1
+{
+    class CTextFileReader;
+
+    // Rendered row of one CD element
+    struct CCatalogCachedRow
+    {
+        // Value of the sort field of the record
+        std::string_view mKey;
+        // HTML of the row (<tr> element)
+        std::string_view mRow;
+        // Rows are ordered by key rank first: rows loaded from the file have even ranks
+        // (equal for equal keys, growing with keys). Rows added by current conversion get
+        // the rank of an equal loaded key or the odd rank between loaded keys around it -
+        // keys of rows with the same odd rank have to be compared.
+        uint64_t mKeyRank;
+        // Identifies row in the cache (see SetKeyOrder())
+        uint32_t mId;
+    };
+
+    // Maps hash of bytes of CD element (from '<' of start tag to '>' of end tag) to its
+    // rendered row and sort key. The cache file is memory-mapped and contains its own
+    // hash table, so loading it doesn't depend on its size and rows that didn't change
+    // are never copied. Rows are kept in document order - elements of a document that
+    // didn't move are found without hash table lookups.
+    // The file is ignored if it's missing, corrupt or was written by a build with a
+    // different style sheet (rows are re-rendered then).
+    // Bytes of elements aren't kept - elements are identified by 64-bit hash and size.
+    // Not thread-safe. Errors are reported by throwing CException.
+    class CCatalogRowCache
+    {
+    public:
+        explicit CCatalogRowCache(const wchar_t* sFilePathName);
+        ~CCatalogRowCache();
+
+        CCatalogRowCache(const CCatalogRowCache&) = delete;
+        CCatalogRowCache& operator=(const CCatalogRowCache&) = delete;
+
+        // Elements are looked up (or added) in document order. Returns false if the
+        // element isn't cached.
+        bool Find(std::string_view sRecordBytes, CCatalogCachedRow& o_row);
+        // Data is copied. Rows stay valid until Save() is called.
+        void Add(std::string_view sRecordBytes, std::string_view sKey, std::string_view sRow,
+            CCatalogCachedRow& o_row);
+        // Ids of rows of the document in output order (ids of duplicate elements repeat)
+        void SetKeyOrder(std::vector<uint32_t>&& rowIds) noexcept
+        {
+            mKeyOrder = std::move(rowIds);
+        }
+        // Replaces the cache file with rows of current document (rows of elements that
+        // were removed from the document are dropped). The file isn't written if the
+        // document didn't change. Rows can't be used after it.
+        void Save();
+
+        size_t GetHitCount() const noexcept
+        {
+            return mHitCount;
+        }
+        size_t GetMissCount() const noexcept
+        {
+            return mMissCount;
+        }
+
+        // Fast non-cryptographic 64-bit hash
+        static uint64_t Hash(std::string_view sData) noexcept;
+    private:
+        struct CAddedRow
+        {
+            uint64_t mHash;
+            uint64_t mSize;
+            std::string mData;
+            CCatalogCachedRow mRow;
+        };
+
+        void Load();
+        // Row of loaded element (index is row id)
+        void GetLoadedRow(uint32_t index, CCatalogCachedRow& o_row) const noexcept;
+        bool IsLoadedElement(uint32_t index, uint64_t hash, uint64_t size) const noexcept;
+        // Returns NO_ROW if element wasn't loaded
+        uint32_t FindLoaded(uint64_t hash, uint64_t size) const noexcept;
+        uint64_t GetKeyRank(std::string_view sKey) const noexcept;
+        void UseRow(uint32_t rowId);
+        // Hash of output of the renderer for a fixed document - it changes whenever the
+        // style sheet (or its generated renderer) changes
+        static uint64_t GetStylesheetFingerprint();
+
+        static constexpr uint32_t NO_ROW = UINT32_MAX;
+
+        std::wstring msFilePathName;
+        std::unique_ptr<CTextFileReader> mFile;
+        // Parts of mapped file (see CatalogRowCache.cpp)
+        std::string_view msFileData;
+        const char* mIndex;
+        const char* mRankOrder;
+        const char* mSlots;
+        uint32_t mSlotCount;
+        uint32_t mLoadedCount;
+        // Loaded row that's expected to be found next (the one after the last found)
+        uint32_t mNextLoaded;
+        // Rows found or added by current conversion
+        std::vector<bool> mIsLoadedUsed;
+        std::deque<CAddedRow> mAddedRows;
+        // Hash of added element -> index in mAddedRows
+        std::unordered_multimap<uint64_t, uint32_t> mAddedIndex;
+        // Ids of rows in document order (duplicate elements are listed once)
+        std::vector<uint32_t> mDocumentOrder;
+        std::vector<uint32_t> mKeyOrder;
+        // True while loaded rows are found in the order they were loaded
+        bool mIsUnchanged;
+        size_t mHitCount;
+        size_t mMissCount;
+    };
+}
+#endif
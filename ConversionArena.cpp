@@ -0,0 +1,33 @@
+// Contains OS-independent implementation of memory arena of a conversion.
+
+#include "ConversionArena.h"
+#include <algorithm>
+#include <new>
+
+namespace OTInterviewExercise1
+{
+    CConversionArena::CConversionArena() :
+        mBuffer(new char[INITIAL_BUFFER_SIZE]),
+        mBufferSize(INITIAL_BUFFER_SIZE)
+    {
+        mArena.emplace(mBuffer.get(), mBufferSize, &mUpstream);
+    }
+
+    void CConversionArena::Reset() noexcept
+    {
+        mArena.reset();
+        if (mUpstream.mAllocatedSize != 0 && mBufferSize < MAX_BUFFER_SIZE)
+        {
+            // Next conversion will fit into initial buffer if it's like this one
+            size_t bufferSize = std::min(mBufferSize + mUpstream.mAllocatedSize, MAX_BUFFER_SIZE);
+            char* buffer = new (std::nothrow) char[bufferSize];
+            if (buffer != nullptr)
+            {
+                mBuffer.reset(buffer);
+                mBufferSize = bufferSize;
+            }
+        }
+        mUpstream.mAllocatedSize = 0;
+        mArena.emplace(mBuffer.get(), mBufferSize, &mUpstream);
+    }
+}
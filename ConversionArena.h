@@ -0,0 +1,65 @@
+// Contains declaration of OS-independent memory arena that's used by one conversion
+// at a time.
+#ifndef OT_CONVERSIONARENA_H__
+#define OT_CONVERSIONARENA_H__
+
+#include <memory_resource>
+#include <optional>
+#include <memory>
+
+namespace OTInterviewExercise1
+{
+    // Monotonic (bump) allocator that's reset after every conversion - all memory of a
+    // conversion is freed at once. Its initial buffer grows to the size that previous
+    // conversions needed (up to MAX_BUFFER_SIZE), so that repeated conversions of similar
+    // documents don't use the heap at all. Not thread-safe.
+    class CConversionArena
+    {
+    public:
+        CConversionArena();
+
+        CConversionArena(const CConversionArena&) = delete;
+        CConversionArena& operator=(const CConversionArena&) = delete;
+
+        std::pmr::memory_resource* GetResource() noexcept
+        {
+            return &*mArena;
+        }
+        // Frees everything that was allocated from the arena
+        void Reset() noexcept;
+
+        static constexpr size_t INITIAL_BUFFER_SIZE = 64 * 1024;
+        static constexpr size_t MAX_BUFFER_SIZE = 64 * 1024 * 1024;
+    private:
+        // Heap allocations made by arena when its initial buffer is exhausted
+        class CUpstreamResource : public std::pmr::memory_resource
+        {
+        public:
+            CUpstreamResource() :
+                mAllocatedSize(0)
+            {}
+            size_t mAllocatedSize;
+        private:
+            void* do_allocate(size_t bytes, size_t alignment) override
+            {
+                void* p = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+                mAllocatedSize += bytes;
+                return p;
+            }
+            void do_deallocate(void* p, size_t bytes, size_t alignment) override
+            {
+                std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+            }
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+            {
+                return this == &other;
+            }
+        };
+
+        std::unique_ptr<char[]> mBuffer;
+        size_t mBufferSize;
+        CUpstreamResource mUpstream;
+        std::optional<std::pmr::monotonic_buffer_resource> mArena;
+    };
+}
+#endif
@@ -0,0 +1,90 @@
+// Contains OS-independent implementation of per-phase metrics of conversions.
+
+#include "ConversionMetrics.h"
+#include <sstream>
+
+namespace OTInterviewExercise1
+{
+    namespace
+    {
+        const char* const PhaseNames[] = {
+            "read",
+            "decode",
+            "load",
+            "transform",
+            "output"
+        };
+        static_assert(sizeof(PhaseNames) / sizeof(PhaseNames[0]) ==
+            static_cast<size_t>(CConversionMetrics::EMPhase::Count), "Phase names don't match EMPhase");
+    }
+
+    CConversionMetrics::CConversionMetrics() noexcept
+    {
+        Reset();
+    }
+
+    CConversionMetrics::CPhaseTotals CConversionMetrics::GetPhase(EMPhase phase) const noexcept
+    {
+        const CPhase& totals = mPhases[static_cast<size_t>(phase)];
+        return CPhaseTotals{
+            totals.mCount.load(std::memory_order_relaxed),
+            totals.mNanoseconds.load(std::memory_order_relaxed),
+            totals.mBytes.load(std::memory_order_relaxed) };
+    }
+
+    uint64_t CConversionMetrics::GetTotalNanoseconds() const noexcept
+    {
+        uint64_t nanoseconds = 0;
+        for (const auto& totals : mPhases)
+        {
+            nanoseconds += totals.mNanoseconds.load(std::memory_order_relaxed);
+        }
+        return nanoseconds;
+    }
+
+    void CConversionMetrics::Merge(const CConversionMetrics& other) noexcept
+    {
+        for (size_t i = 0; i < static_cast<size_t>(EMPhase::Count); ++i)
+        {
+            CPhaseTotals totals = other.GetPhase(static_cast<EMPhase>(i));
+            mPhases[i].mCount.fetch_add(totals.mCount, std::memory_order_relaxed);
+            mPhases[i].mNanoseconds.fetch_add(totals.mNanoseconds, std::memory_order_relaxed);
+            mPhases[i].mBytes.fetch_add(totals.mBytes, std::memory_order_relaxed);
+        }
+        mConversions.fetch_add(other.GetConversionCount(), std::memory_order_relaxed);
+        mFailures.fetch_add(other.GetFailureCount(), std::memory_order_relaxed);
+    }
+
+    void CConversionMetrics::Reset() noexcept
+    {
+        for (auto& totals : mPhases)
+        {
+            totals.mCount.store(0, std::memory_order_relaxed);
+            totals.mNanoseconds.store(0, std::memory_order_relaxed);
+            totals.mBytes.store(0, std::memory_order_relaxed);
+        }
+        mConversions.store(0, std::memory_order_relaxed);
+        mFailures.store(0, std::memory_order_relaxed);
+    }
+
+    std::string CConversionMetrics::ToJson() const
+    {
+        std::ostringstream ss;
+        ss << "{\"conversions\":" << GetConversionCount() << ",\"failures\":" << GetFailureCount()
+            << ",\"phases\":{";
+        for (size_t i = 0; i < static_cast<size_t>(EMPhase::Count); ++i)
+        {
+            CPhaseTotals totals = GetPhase(static_cast<EMPhase>(i));
+            ss << (i == 0 ? "" : ",") << "\"" << PhaseNames[i] << "\":{\"count\":" << totals.mCount
+                << ",\"seconds\":" << totals.mNanoseconds / 1e9 << ",\"bytes\":" << totals.mBytes << "}";
+        }
+        ss << "}}";
+        return ss.str();
+    }
+
+    const char* CConversionMetrics::GetPhaseName(EMPhase phase) noexcept
+    {
+        size_t index = static_cast<size_t>(phase);
+        return index < static_cast<size_t>(EMPhase::Count) ? PhaseNames[index] : "";
+    }
+}
@@ -0,0 +1,205 @@
+// Contains declaration of OS-independent per-phase metrics of conversions (timings and
+// byte counters). They're collected only when enabled (see CXmlParserWrapper::EnableMetrics).
+#ifndef OT_CONVERSIONMETRICS_H__
+#define OT_CONVERSIONMETRICS_H__
+
+#include "OutputSink.h"
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
+namespace OTInterviewExercise1
+{
+    // Counters are updated with relaxed atomic operations - metrics can be read (or
+    // merged) by another thread while conversions are running.
+    class CConversionMetrics
+    {
+    public:
+        enum class EMPhase
+        {
+            Read, // Reading of XML file (CTextFileReader)
+            Decode, // UTF8 validation/transcoding of input and output
+            Load, // Parsing of document (native engine: records are pulled into the sorter)
+            Transform, // Style sheet transformation (without output)
+            Output, // Passing of HTML to output sink
+            Count
+        };
+
+        // Totals of a phase
+        struct CPhaseTotals
+        {
+            uint64_t mCount;
+            uint64_t mNanoseconds;
+            uint64_t mBytes;
+        };
+
+        CConversionMetrics() noexcept;
+        CConversionMetrics(const CConversionMetrics&) = delete;
+        CConversionMetrics& operator=(const CConversionMetrics&) = delete;
+
+        void Add(EMPhase phase, uint64_t nanoseconds, uint64_t bytes) noexcept
+        {
+            CPhase& totals = mPhases[static_cast<size_t>(phase)];
+            totals.mCount.fetch_add(1, std::memory_order_relaxed);
+            totals.mNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+            totals.mBytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+        void AddConversion(bool isSuccessful) noexcept
+        {
+            (isSuccessful ? mConversions : mFailures).fetch_add(1, std::memory_order_relaxed);
+        }
+
+        CPhaseTotals GetPhase(EMPhase phase) const noexcept;
+        // Time of all phases
+        uint64_t GetTotalNanoseconds() const noexcept;
+        // Number of successful/failed conversions
+        uint64_t GetConversionCount() const noexcept
+        {
+            return mConversions.load(std::memory_order_relaxed);
+        }
+        uint64_t GetFailureCount() const noexcept
+        {
+            return mFailures.load(std::memory_order_relaxed);
+        }
+        // Adds totals of other metrics (e.g. of parsers of other threads)
+        void Merge(const CConversionMetrics& other) noexcept;
+        void Reset() noexcept;
+        // Single-line JSON object:
+        // {"conversions":N,"failures":N,"phases":{"read":{"count":N,"seconds":S,"bytes":N},...}}
+        std::string ToJson() const;
+
+        static const char* GetPhaseName(EMPhase phase) noexcept;
+    private:
+        struct CPhase
+        {
+            std::atomic<uint64_t> mCount;
+            std::atomic<uint64_t> mNanoseconds;
+            std::atomic<uint64_t> mBytes;
+        };
+
+        CPhase mPhases[static_cast<size_t>(EMPhase::Count)];
+        std::atomic<uint64_t> mConversions;
+        std::atomic<uint64_t> mFailures;
+    };
+
+    // Adds time of its scope to a phase. Does nothing (doesn't even read the clock) if
+    // metrics is nullptr, i.e. if collection is disabled.
+    class CMetricsTimer
+    {
+    public:
+        CMetricsTimer(CConversionMetrics* metrics, CConversionMetrics::EMPhase phase, uint64_t bytes = 0) noexcept :
+            mMetrics(metrics),
+            mPhase(phase),
+            mBytes(bytes)
+        {
+            if (mMetrics != nullptr)
+                mStartTime = std::chrono::steady_clock::now();
+        }
+        ~CMetricsTimer()
+        {
+            if (mMetrics != nullptr)
+            {
+                auto duration = std::chrono::steady_clock::now() - mStartTime;
+                mMetrics->Add(mPhase,
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), mBytes);
+            }
+        }
+
+        CMetricsTimer(const CMetricsTimer&) = delete;
+        CMetricsTimer& operator=(const CMetricsTimer&) = delete;
+
+        void SetBytes(uint64_t bytes) noexcept
+        {
+            mBytes = bytes;
+        }
+        // Adds time so far (the scope isn't timed any more)
+        void Stop() noexcept
+        {
+            if (mMetrics != nullptr)
+            {
+                auto duration = std::chrono::steady_clock::now() - mStartTime;
+                mMetrics->Add(mPhase,
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), mBytes);
+                mMetrics = nullptr;
+            }
+        }
+    private:
+        CConversionMetrics* mMetrics;
+        CConversionMetrics::EMPhase mPhase;
+        uint64_t mBytes;
+        std::chrono::steady_clock::time_point mStartTime;
+    };
+
+    // Same as CMetricsTimer, but time of other phases that were added meanwhile is
+    // subtracted (e.g. Transform excludes writes to output that it makes). Metrics must
+    // be used by one conversion at a time.
+    class CExclusiveMetricsTimer
+    {
+    public:
+        CExclusiveMetricsTimer(CConversionMetrics* metrics, CConversionMetrics::EMPhase phase, uint64_t bytes = 0) noexcept :
+            mMetrics(metrics),
+            mPhase(phase),
+            mBytes(bytes),
+            mStartNanoseconds(0)
+        {
+            if (mMetrics != nullptr)
+            {
+                mStartNanoseconds = mMetrics->GetTotalNanoseconds();
+                mStartTime = std::chrono::steady_clock::now();
+            }
+        }
+        ~CExclusiveMetricsTimer()
+        {
+            if (mMetrics != nullptr)
+            {
+                auto duration = std::chrono::steady_clock::now() - mStartTime;
+                uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+                uint64_t otherNanoseconds = mMetrics->GetTotalNanoseconds() - mStartNanoseconds;
+                mMetrics->Add(mPhase, nanoseconds > otherNanoseconds ? nanoseconds - otherNanoseconds : 0, mBytes);
+            }
+        }
+
+        CExclusiveMetricsTimer(const CExclusiveMetricsTimer&) = delete;
+        CExclusiveMetricsTimer& operator=(const CExclusiveMetricsTimer&) = delete;
+
+        void SetBytes(uint64_t bytes) noexcept
+        {
+            mBytes = bytes;
+        }
+    private:
+        CConversionMetrics* mMetrics;
+        CConversionMetrics::EMPhase mPhase;
+        uint64_t mBytes;
+        uint64_t mStartNanoseconds;
+        std::chrono::steady_clock::time_point mStartTime;
+    };
+
+    // Passes output to another sink adding time of writes to Output phase
+    class CMetricsOutputSink : public COutputSink
+    {
+    public:
+        CMetricsOutputSink(COutputSink& o_output, CConversionMetrics& metrics) :
+            mOutput(o_output),
+            mMetrics(metrics)
+        {}
+        void Write(const char* data, size_t size) override
+        {
+            CMetricsTimer timer(&mMetrics, CConversionMetrics::EMPhase::Output, size);
+            mOutput.Write(data, size);
+        }
+        void WriteGather(const std::string_view* buffers, size_t count) override
+        {
+            uint64_t size = 0;
+            for (size_t i = 0; i < count; ++i)
+                size += buffers[i].size();
+            CMetricsTimer timer(&mMetrics, CConversionMetrics::EMPhase::Output, size);
+            mOutput.WriteGather(buffers, count);
+        }
+    private:
+        COutputSink& mOutput;
+        CConversionMetrics& mMetrics;
+    };
+}
+#endif
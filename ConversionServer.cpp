@@ -0,0 +1,437 @@
+// Contains OS-independent implementation of conversion daemon and its client.
+
+#include "ConversionServer.h"
+#include "BatchConverter.h"
+#include "XmlParserWrapper.h"
+#include "LocalSocket.h"
+#include "OutputSink.h"
+#include "Util.h"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <unordered_map>
+#include <string.h>
+
+namespace OTInterviewExercise1
+{
+    namespace
+    {
+        const char REQUEST_MAGIC[4] = { 'O', 'T', 'R', 'Q' };
+        const char RESPONSE_MAGIC[4] = { 'O', 'T', 'R', 'S' };
+        const size_t REQUEST_HEADER_SIZE = 20;
+        const size_t RESPONSE_HEADER_SIZE = 16;
+        const size_t PAYLOAD_CHUNK_SIZE = 1024 * 1024;
+
+        void PutLE(char* p, uint64_t value, size_t size) noexcept
+        {
+            for (size_t i = 0; i < size; ++i)
+                p[i] = static_cast<char>(value >> (8 * i));
+        }
+
+        uint64_t GetLE(const char* p, size_t size) noexcept
+        {
+            uint64_t value = 0;
+            for (size_t i = 0; i < size; ++i)
+                value |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+            return value;
+        }
+
+        void WriteResponse(CLocalSocket& connection, OTInterviewExercise1ExitCode exitCode,
+            std::string_view sPayload)
+        {
+            char header[RESPONSE_HEADER_SIZE];
+            memcpy(header, RESPONSE_MAGIC, sizeof(RESPONSE_MAGIC));
+            PutLE(header + 4, static_cast<uint32_t>(exitCode), 4);
+            PutLE(header + 8, sPayload.size(), 8);
+            std::string_view buffers[] = { std::string_view(header, sizeof(header)), sPayload };
+            connection.Write(buffers, 2);
+        }
+
+        // Reads size bytes of payload. Buffer grows as data arrives rather than being
+        // allocated up front: the size is only declared by client.
+        void ReadPayload(CLocalSocket& connection, uint64_t size, std::string& o_sData)
+        {
+            o_sData.clear();
+            while (o_sData.size() < size)
+            {
+                size_t offset = o_sData.size();
+                size_t chunkSize = static_cast<size_t>(std::min<uint64_t>(size - offset, PAYLOAD_CHUNK_SIZE));
+                o_sData.resize(offset + chunkSize);
+                if (!connection.Read(&o_sData[offset], chunkSize))
+                {
+                    THROW_ERROR(L"Connection was closed in the middle of a message");
+                }
+            }
+        }
+    }
+
+    // State of a worker thread that's kept between requests
+    class CConversionServer::CWorker
+    {
+    public:
+        CWorker(unsigned int parserThreadCount) :
+            mParserThreadCount(parserThreadCount)
+        {}
+
+        // Returns warm parser of style sheet (sStylesheetPathName is empty for built-in one)
+        CXmlParserWrapper& GetParser(const std::string& sStylesheetPathName)
+        {
+            auto it = mParsers.find(sStylesheetPathName);
+            if (it != mParsers.end())
+                return *it->second;
+            std::wstring sWideStylesheetPathName;
+            if (!sStylesheetPathName.empty() &&
+                !Utf8ToWide(sStylesheetPathName.data(), sStylesheetPathName.size(), sWideStylesheetPathName))
+            {
+                THROW_ERROR(L"Style sheet path name isn't valid UTF8");
+            }
+            if (mParsers.size() >= MAX_PARSERS_PER_WORKER)
+            {
+                mParsers.erase(mParsers.begin());
+            }
+            auto parser = std::make_unique<CXmlParserWrapper>(
+                sStylesheetPathName.empty() ? CXmlParserWrapper::EMXSLTFile::CatalogResources : CXmlParserWrapper::EMXSLTFile::File,
+                sStylesheetPathName.empty() ? nullptr : sWideStylesheetPathName.c_str());
+            parser->SetThreadCount(mParserThreadCount);
+            return *mParsers.emplace(sStylesheetPathName, std::move(parser)).first->second;
+        }
+
+        // Request that's being served
+        CConversionRequest mRequest;
+        // HTML of the request (its capacity is reused)
+        std::string mHtml;
+    private:
+        unsigned int mParserThreadCount;
+        std::unordered_map<std::string, std::unique_ptr<CXmlParserWrapper>> mParsers;
+    };
+
+    CConversionServer::CConversionServer(const std::wstring& sSocketPathName, unsigned int threadCount) :
+        msSocketPathName(sSocketPathName),
+        mThreadCount(threadCount),
+        mIsStopping(false),
+        mRequestCount(0)
+    {
+        if (mThreadCount == 0)
+        {
+            mThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+    }
+
+    CConversionServer::~CConversionServer()
+    {
+        Stop();
+    }
+
+    bool CConversionServer::Start(std::wstring& o_sError) noexcept
+    {
+        std::string functionName;
+        unsigned int lineNo = 0;
+        try
+        {
+            o_sError.clear();
+            mIsStopping = false;
+            mListener = std::make_unique<CLocalSocketListener>(msSocketPathName.c_str());
+            mWorkers.reserve(mThreadCount);
+            for (unsigned int i = 0; i < mThreadCount; ++i)
+            {
+                mWorkers.emplace_back(&CConversionServer::Serve, this);
+            }
+            return true;
+        }
+        catch (const CException& ex)
+        {
+            std::wostringstream ss;
+            ss << L"Exception caught. ";
+            if (!ex.mErrorDescription.empty())
+            {
+                ss << L"System error: " << ex.mErrorDescription;
+            }
+            o_sError = ss.str();
+            functionName = ex.mFunctionName;
+            lineNo = ex.mLineNo;
+        }
+        catch (const std::bad_alloc& /*ex*/)
+        {
+            o_sError = L"Memory allocation error.";
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+        }
+        catch (const std::exception& ex)
+        {
+            std::wostringstream ss;
+            ss << L"C++ exception caught. ";
+            std::wstring what;
+            if (ex.what() && Utf8ToWide(ex.what(), strlen(ex.what()), what))
+            {
+                ss << what;
+            }
+            o_sError = ss.str();
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+        }
+        catch (...)
+        {
+            o_sError = L"Unknown exception caught.";
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+        }
+        LogError(functionName.c_str(), lineNo, o_sError);
+
+        Stop();
+        return false;
+    }
+
+    void CConversionServer::Stop() noexcept
+    {
+        if (mListener == nullptr)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mConnectionsMutex);
+            mIsStopping = true;
+            for (CLocalSocket* connection : mConnections)
+            {
+                connection->Shutdown();
+            }
+        }
+        mListener->Shutdown();
+        for (auto& worker : mWorkers)
+        {
+            worker.join();
+        }
+        mWorkers.clear();
+        mListener.reset();
+    }
+
+    void CConversionServer::Serve() noexcept
+    {
+        // OS-specific initialization is per thread (e.g. COM apartment)
+        COsInitialization init;
+        std::wstring sInitError;
+        bool isInitialized = init.IsOk(sInitError);
+        try
+        {
+            // Requests are already served in parallel - so hardware threads are shared by workers
+            CWorker worker(std::max(std::thread::hardware_concurrency() / mThreadCount, 1u));
+            if (!isInitialized)
+            {
+                LogError(__FUNCTION__, __LINE__, L"Initialization error encountered. " + sInitError);
+            }
+            for (;;)
+            {
+                std::unique_ptr<CLocalSocket> connection;
+                try
+                {
+                    connection = mListener->Accept();
+                }
+                catch (const CException& ex)
+                {
+                    // E.g. out of file descriptors - connections that are being served
+                    // will release some
+                    LogError(ex.mFunctionName.c_str(), ex.mLineNo, ex.mErrorDescription);
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    continue;
+                }
+                if (connection == nullptr)
+                    break;
+                {
+                    std::lock_guard<std::mutex> lock(mConnectionsMutex);
+                    if (mIsStopping)
+                        break;
+                    mConnections.insert(connection.get());
+                }
+                bool isKept = false;
+                {
+                    auto unregister = MakeRAIICleanup([this, &connection]() {
+                        std::lock_guard<std::mutex> lock(mConnectionsMutex);
+                        mConnections.erase(connection.get());
+                    });
+                    try
+                    {
+                        if (isInitialized)
+                        {
+                            isKept = ServeRequest(*connection, worker);
+                        }
+                        else
+                        {
+                            std::string sError;
+                            WideToUtf8(sInitError.data(), sInitError.size(), sError);
+                            WriteResponse(*connection, OTInterviewExercise1ExitCode::INIT_ERROR, sError);
+                        }
+                    }
+                    catch (const CException& ex)
+                    {
+                        // Client went away - other connections are served as usual
+                        LogWarn(ex.mFunctionName.c_str(), ex.mLineNo, ex.mErrorDescription);
+                    }
+                    catch (const std::exception& /*ex*/)
+                    {
+                        // Only this connection is closed - worker keeps serving others
+                        LogError(__FUNCTION__, __LINE__, L"C++ exception caught while serving connection.");
+                    }
+                }
+                if (isKept)
+                {
+                    // Connection waits for its next request in listener, so worker isn't
+                    // occupied by a client that stays connected
+                    try
+                    {
+                        mListener->AddIdleConnection(std::move(connection));
+                    }
+                    catch (const std::exception& /*ex*/)
+                    {
+                        LogError(__FUNCTION__, __LINE__, L"Memory allocation error. Connection was closed.");
+                    }
+                }
+            }
+        }
+        catch (...)
+        {
+            LogError(__FUNCTION__, __LINE__, L"Memory allocation error.");
+        }
+    }
+
+    bool CConversionServer::ServeRequest(CLocalSocket& connection, CWorker& worker)
+    {
+        CConversionRequest& request = worker.mRequest;
+        std::string& sHtml = worker.mHtml;
+        // Buffers keep their capacity for the next requests - unless a large request made
+        // them grow
+        auto shrinkBuffers = MakeRAIICleanup([&request, &sHtml]() {
+            if (request.mInput.capacity() > MAX_KEPT_BUFFER_SIZE)
+            {
+                std::string().swap(request.mInput);
+            }
+            if (sHtml.capacity() > MAX_KEPT_BUFFER_SIZE)
+            {
+                std::string().swap(sHtml);
+            }
+        });
+        char header[REQUEST_HEADER_SIZE];
+        if (!connection.Read(header, sizeof(header)))
+            return false;
+        uint64_t inputType = GetLE(header + 4, 1);
+        uint64_t stylesheetId = GetLE(header + 5, 1);
+        uint64_t stylesheetSize = GetLE(header + 8, 4);
+        uint64_t inputSize = GetLE(header + 12, 8);
+        if (memcmp(header, REQUEST_MAGIC, sizeof(REQUEST_MAGIC)) != 0 ||
+            inputType > static_cast<uint8_t>(CConversionRequest::EMInput::Inline) ||
+            stylesheetId > static_cast<uint8_t>(CConversionRequest::EMStylesheet::File) ||
+            GetLE(header + 6, 2) != 0 ||
+            inputSize > MAX_REQUEST_SIZE || stylesheetSize > MAX_REQUEST_SIZE - inputSize ||
+            (stylesheetId == static_cast<uint8_t>(CConversionRequest::EMStylesheet::File)) != (stylesheetSize != 0))
+        {
+            // Rest of the stream can't be interpreted
+            WriteResponse(connection, OTInterviewExercise1ExitCode::INVALID_CMD_LINE, "Malformed request.");
+            return false;
+        }
+        request.mInputType = static_cast<CConversionRequest::EMInput>(inputType);
+        request.mStylesheetId = static_cast<CConversionRequest::EMStylesheet>(stylesheetId);
+        try
+        {
+            ReadPayload(connection, stylesheetSize, request.mStylesheetPathName);
+            ReadPayload(connection, inputSize, request.mInput);
+        }
+        catch (const std::bad_alloc& /*ex*/)
+        {
+            // Rest of the request isn't read - so connection is closed
+            std::string().swap(request.mInput);
+            WriteResponse(connection, OTInterviewExercise1ExitCode::INVALID_CMD_LINE,
+                "Memory allocation error. Request is too large.");
+            return false;
+        }
+
+        sHtml.clear();
+        CStringOutputSink htmlSink(sHtml);
+        OTInterviewExercise1ExitCode exitCode = OTInterviewExercise1ExitCode::SUCCESS;
+        std::wstring sErrorMsg;
+        std::wstring sXmlFilePathName;
+        try
+        {
+            CXmlParserWrapper& parser = worker.GetParser(request.mStylesheetPathName);
+            if (request.mInputType == CConversionRequest::EMInput::FilePathName)
+            {
+                uint64_t xmlSize = 0;
+                if (!Utf8ToWide(request.mInput.data(), request.mInput.size(), sXmlFilePathName))
+                {
+                    exitCode = OTInterviewExercise1ExitCode::INVALID_CMD_LINE;
+                    sErrorMsg = L"XML file path name isn't valid UTF8.";
+                }
+                else
+                {
+                    exitCode = ConvertXmlFile(parser, sXmlFilePathName.c_str(), htmlSink, xmlSize, sErrorMsg);
+                }
+            }
+            else if (request.mInput.empty())
+            {
+                exitCode = OTInterviewExercise1ExitCode::XML_FILE_IS_EMPTY;
+                sErrorMsg = L"Request doesn't contain any XML.";
+            }
+            else if (!parser.Parse(request.mInput, htmlSink, sErrorMsg))
+            {
+                exitCode = OTInterviewExercise1ExitCode::XML_PARSER_ERROR;
+                sErrorMsg = L"Xml parser error encountered. " + sErrorMsg;
+            }
+        }
+        catch (const CException& ex)
+        {
+            exitCode = OTInterviewExercise1ExitCode::INVALID_CMD_LINE;
+            sErrorMsg = ex.mErrorDescription;
+        }
+        catch (const std::exception& /*ex*/)
+        {
+            // Parser couldn't be created
+            exitCode = OTInterviewExercise1ExitCode::INIT_ERROR;
+            sErrorMsg = L"Memory allocation error.";
+        }
+        mRequestCount++;
+        if (exitCode == OTInterviewExercise1ExitCode::SUCCESS)
+        {
+            WriteResponse(connection, exitCode, sHtml);
+        }
+        else
+        {
+            std::string sErrorPayload;
+            WideToUtf8(sErrorMsg.data(), sErrorMsg.size(), sErrorPayload);
+            WriteResponse(connection, exitCode, sErrorPayload);
+        }
+        return true;
+    }
+
+    CConversionClient::CConversionClient(const wchar_t* sSocketPathName) :
+        mConnection(std::make_unique<CLocalSocket>(sSocketPathName))
+    {}
+
+    CConversionClient::~CConversionClient()
+    {}
+
+    void CConversionClient::Convert(const CConversionRequest& request, CConversionResponse& o_response)
+    {
+        char header[REQUEST_HEADER_SIZE];
+        memcpy(header, REQUEST_MAGIC, sizeof(REQUEST_MAGIC));
+        PutLE(header + 4, static_cast<uint8_t>(request.mInputType), 1);
+        PutLE(header + 5, static_cast<uint8_t>(request.mStylesheetId), 1);
+        PutLE(header + 6, 0, 2);
+        PutLE(header + 8, request.mStylesheetPathName.size(), 4);
+        PutLE(header + 12, request.mInput.size(), 8);
+        std::string_view buffers[] = { std::string_view(header, sizeof(header)),
+            request.mStylesheetPathName, request.mInput };
+        mConnection->Write(buffers, 3);
+
+        char responseHeader[RESPONSE_HEADER_SIZE];
+        if (!mConnection->Read(responseHeader, sizeof(responseHeader)))
+        {
+            THROW_ERROR(L"Connection was closed by the daemon");
+        }
+        uint64_t payloadSize = GetLE(responseHeader + 8, 8);
+        if (memcmp(responseHeader, RESPONSE_MAGIC, sizeof(RESPONSE_MAGIC)) != 0 || payloadSize > SIZE_MAX / 2)
+        {
+            THROW_ERROR(L"Malformed response");
+        }
+        o_response.mExitCode = static_cast<OTInterviewExercise1ExitCode>(GetLE(responseHeader + 4, 4));
+        o_response.mPayload.resize(payloadSize);
+        if (payloadSize != 0 && !mConnection->Read(&o_response.mPayload[0], payloadSize))
+        {
+            THROW_ERROR(L"Connection was closed in the middle of a message");
+        }
+    }
+}
@@ -0,0 +1,137 @@
+// Contains declaration of OS-independent conversion daemon: it keeps warm parsers and
+// compiled style sheets between requests and converts XML received over a local socket.
+#ifndef OT_CONVERSIONSERVER_H__
+#define OT_CONVERSIONSERVER_H__
+
+#include "ExitCode.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <unordered_set>
+#include <stdint.h>
+
+namespace OTInterviewExercise1
+{
+    class CLocalSocket;
+    class CLocalSocketListener;
+
+    // Request of the daemon. Wire format (integers are little-endian):
+    //   "OTRQ", u8 input type, u8 style sheet id, u16 reserved (0),
+    //   u32 size of style sheet path name, u64 size of input,
+    //   style sheet path name (UTF8), input (UTF8 path name of XML file or XML itself)
+    struct CConversionRequest
+    {
+        enum class EMInput : uint8_t
+        {
+            FilePathName = 0, // Input is path name of XML file (as seen by the daemon)
+            Inline = 1 // Input is XML document
+        };
+        enum class EMStylesheet : uint8_t
+        {
+            CatalogResources = 0, // Built-in catalog style sheet
+            File = 1 // Style sheet file (mStylesheetPathName)
+        };
+        CConversionRequest() :
+            mInputType(EMInput::Inline),
+            mStylesheetId(EMStylesheet::CatalogResources)
+        {}
+        EMInput mInputType;
+        EMStylesheet mStylesheetId;
+        std::string mStylesheetPathName;
+        std::string mInput;
+    };
+
+    // Response of the daemon. Wire format (integers are little-endian):
+    //   "OTRS", u32 exit code, u64 size of payload,
+    //   payload (HTML if exit code is SUCCESS, UTF8 error message otherwise)
+    struct CConversionResponse
+    {
+        CConversionResponse() :
+            mExitCode(OTInterviewExercise1ExitCode::SUCCESS)
+        {}
+        OTInterviewExercise1ExitCode mExitCode;
+        std::string mPayload;
+    };
+
+    // Serves conversion requests on Unix domain socket. Every worker thread performs
+    // OS-specific initialization once and keeps its parsers (one per style sheet) warm
+    // between requests - compiled style sheets are shared by all of them (see
+    // CStylesheetCache). Any number of requests can be sent over a connection. Worker
+    // serves one request at a time, and connection waits for its next request in the
+    // listener (see CLocalSocketListener::AddIdleConnection()) - so number of workers
+    // limits number of requests that are converted at once rather than number of clients.
+    // Malformed request gets INVALID_CMD_LINE response and its connection is closed.
+    class CConversionServer
+    {
+    public:
+        // threadCount - number of workers (0 means number of hardware threads)
+        CConversionServer(const std::wstring& sSocketPathName, unsigned int threadCount);
+        ~CConversionServer();
+
+        CConversionServer(const CConversionServer&) = delete;
+        CConversionServer& operator=(const CConversionServer&) = delete;
+
+        // Creates socket and starts workers. Returns false if socket couldn't be created
+        // (o_sError contains error message).
+        bool Start(std::wstring& o_sError) noexcept;
+        // Closes socket and connections (requests that are being converted are finished)
+        // and waits for workers
+        void Stop() noexcept;
+
+        unsigned int GetThreadCount() const noexcept
+        {
+            return mThreadCount;
+        }
+        // Number of requests served so far
+        uint64_t GetRequestCount() const noexcept
+        {
+            return mRequestCount;
+        }
+
+        // Largest request that's accepted (header excluded)
+        static constexpr uint64_t MAX_REQUEST_SIZE = 1ull << 30;
+        // Parsers (style sheets) kept by one worker
+        static constexpr size_t MAX_PARSERS_PER_WORKER = 16;
+        // Request and HTML buffers of a worker that grew larger are freed after request
+        static constexpr size_t MAX_KEPT_BUFFER_SIZE = 16 * 1024 * 1024;
+    private:
+        class CWorker;
+
+        // Worker thread: serves requests until server is stopped
+        void Serve() noexcept;
+        // Reads and answers one request. Returns false if connection has to be closed
+        // (it was closed by client or request was malformed).
+        bool ServeRequest(CLocalSocket& connection, CWorker& worker);
+
+        std::wstring msSocketPathName;
+        unsigned int mThreadCount;
+        std::unique_ptr<CLocalSocketListener> mListener;
+        std::vector<std::thread> mWorkers;
+        // Connections that are being served (they are shut down by Stop())
+        std::mutex mConnectionsMutex;
+        std::unordered_set<CLocalSocket*> mConnections;
+        bool mIsStopping;
+        std::atomic<uint64_t> mRequestCount;
+    };
+
+    // Client of the daemon. Errors are reported by throwing CException.
+    class CConversionClient
+    {
+    public:
+        explicit CConversionClient(const wchar_t* sSocketPathName);
+        ~CConversionClient();
+
+        CConversionClient(const CConversionClient&) = delete;
+        CConversionClient& operator=(const CConversionClient&) = delete;
+
+        // Sends request and waits for its response (requests are sent over one connection)
+        void Convert(const CConversionRequest& request, CConversionResponse& o_response);
+    private:
+        std::unique_ptr<CLocalSocket> mConnection;
+    };
+}
+#endif
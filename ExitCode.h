@@ -0,0 +1,21 @@
+// Contains exit codes of OTInterviewExercise1 application. The same codes describe
+// result of conversion of a single file in batch mode.
+#ifndef OT_EXITCODE_H__
+#define OT_EXITCODE_H__
+
+// Possible exit codes (of this application) - with 0 for success - and specific
+// non-0 codes for errors.
+enum class OTInterviewExercise1ExitCode
+{
+    SUCCESS = 0,
+    INVALID_CMD_LINE,
+    XML_FILE_NOT_FOUND,
+    COULDNT_READ_XML_FILE,
+    XML_FILE_IS_EMPTY,
+    INIT_ERROR,
+    XML_PARSER_ERROR,
+    COULDNT_WRITE_HTML_FILE,
+    // Batch mode: conversion of at least one file failed
+    BATCH_HAD_ERRORS
+};
+#endif
@@ -0,0 +1,445 @@
+// Contains implementation of OS-independent escaping of HTML special characters.
+
+#include "HtmlEscaper.h"
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define OT_X86_KERNELS 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC allows intrinsics of any instruction set without compiler flags
+#define OT_TARGET_AVX2
+#else
+#define OT_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace OTInterviewExercise1
+{
+    namespace
+    {
+        inline bool IsSpecial(char c, bool isAttribute) noexcept
+        {
+            return c == '&' || c == '<' || c == '>' || (c == '"' && isAttribute);
+        }
+
+        // Number of bytes entity of special character adds to the text
+        inline size_t GetEntityExtraSize(char c) noexcept
+        {
+            switch (c)
+            {
+            case '&':
+                return sizeof("&amp;") - 2;
+            case '<':
+            case '>':
+                return sizeof("&lt;") - 2;
+            default:
+                return sizeof("&quot;") - 2;
+            }
+        }
+
+        // Writes entity of special character. Returns end of the entity.
+        inline char* WriteEntity(char c, char* o) noexcept
+        {
+            switch (c)
+            {
+            case '&':
+                memcpy(o, "&amp;", 5);
+                return o + 5;
+            case '<':
+                memcpy(o, "&lt;", 4);
+                return o + 4;
+            case '>':
+                memcpy(o, "&gt;", 4);
+                return o + 4;
+            default:
+                memcpy(o, "&quot;", 6);
+                return o + 6;
+            }
+        }
+
+        // Returns true if any of 8 bytes of word is a special character. Bytes are compared
+        // by the "has zero byte" trick; < and > differ only in bit 1.
+        inline bool HasSpecialByte(uint64_t word, bool isAttribute) noexcept
+        {
+            const uint64_t ONES = 0x0101010101010101ull;
+            const uint64_t HIGH_BITS = 0x8080808080808080ull;
+            auto hasZeroByte = [](uint64_t value) {
+                return ((value - ONES) & ~value & HIGH_BITS) != 0;
+            };
+            return hasZeroByte(word ^ (ONES * '&')) || hasZeroByte((word | (ONES * 2)) ^ (ONES * '>')) ||
+                (isAttribute && hasZeroByte(word ^ (ONES * '"')));
+        }
+
+        // Scalar kernel (vector kernels process their tails with it, too) - it skips 8
+        // bytes at a time. Functions return offset of the first special character (size if
+        // there is none), number of bytes escaping adds and number of bytes written.
+        inline size_t FindSpecialScalar(const char* p, size_t size, bool isAttribute) noexcept
+        {
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                uint64_t word;
+                memcpy(&word, p + i, sizeof(word));
+                if (HasSpecialByte(word, isAttribute))
+                    break;
+            }
+            while (i < size && !IsSpecial(p[i], isAttribute))
+                i++;
+            return i;
+        }
+
+        inline size_t GetExtraSizeScalar(const char* p, size_t size, bool isAttribute) noexcept
+        {
+            size_t extraSize = 0;
+            for (size_t i = FindSpecialScalar(p, size, isAttribute); i < size; ++i)
+            {
+                if (IsSpecial(p[i], isAttribute))
+                    extraSize += GetEntityExtraSize(p[i]);
+            }
+            return extraSize;
+        }
+
+        inline size_t EscapeScalar(const char* p, size_t size, char* out, bool isAttribute) noexcept
+        {
+            char* o = out;
+            size_t runStart = 0;
+            for (size_t i = FindSpecialScalar(p, size, isAttribute); i < size;
+                i = runStart + FindSpecialScalar(p + runStart, size - runStart, isAttribute))
+            {
+                memcpy(o, p + runStart, i - runStart);
+                o += i - runStart;
+                o = WriteEntity(p[i], o);
+                runStart = i + 1;
+            }
+            memcpy(o, p + runStart, size - runStart);
+            return static_cast<size_t>(o - out) + size - runStart;
+        }
+
+#ifdef OT_X86_KERNELS
+        inline unsigned int CountTrailingZeros(unsigned int mask) noexcept
+        {
+#ifdef _MSC_VER
+            unsigned long index = 0;
+            _BitScanForward(&index, mask);
+            return static_cast<unsigned int>(index);
+#else
+            return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+        }
+
+        // Writes clean runs and entities of a block whose special characters are marked by
+        // bits of mask. Returns end of the output.
+        inline char* EscapeBlock(const char* p, size_t blockSize, unsigned int mask, char* o) noexcept
+        {
+            size_t runStart = 0;
+            do
+            {
+                size_t special = CountTrailingZeros(mask);
+                memcpy(o, p + runStart, special - runStart);
+                o += special - runStart;
+                o = WriteEntity(p[special], o);
+                runStart = special + 1;
+                mask &= mask - 1;
+            } while (mask != 0);
+            memcpy(o, p + runStart, blockSize - runStart);
+            return o + blockSize - runStart;
+        }
+
+        // Bytes of v that are special characters are set to 0xFF. < and > differ only in
+        // bit 1 - so they're found by one comparison. quot is '&' in element content.
+        inline __m128i FindSpecialBytesSse2(__m128i v, __m128i quot) noexcept
+        {
+            __m128i isAmp = _mm_cmpeq_epi8(v, _mm_set1_epi8('&'));
+            __m128i isAngle = _mm_cmpeq_epi8(_mm_or_si128(v, _mm_set1_epi8(2)), _mm_set1_epi8('>'));
+            return _mm_or_si128(_mm_or_si128(isAmp, isAngle), _mm_cmpeq_epi8(v, quot));
+        }
+
+        size_t FindSpecialSse2(const char* p, size_t size, bool isAttribute) noexcept
+        {
+            const __m128i quot = _mm_set1_epi8(isAttribute ? '"' : '&');
+            size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+                unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(FindSpecialBytesSse2(v, quot)));
+                if (mask != 0)
+                    return i + CountTrailingZeros(mask);
+            }
+            return i + FindSpecialScalar(p + i, size - i, isAttribute);
+        }
+
+        size_t GetExtraSizeSse2(const char* p, size_t size, bool isAttribute) noexcept
+        {
+            // Extra sizes of bytes are summed by SAD (into two 64-bit lanes)
+            const __m128i quotExtraSize = _mm_set1_epi8(isAttribute ? 5 : 0);
+            __m128i sums = _mm_setzero_si128();
+            size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+                __m128i isAmp = _mm_cmpeq_epi8(v, _mm_set1_epi8('&'));
+                __m128i isAngle = _mm_cmpeq_epi8(_mm_or_si128(v, _mm_set1_epi8(2)), _mm_set1_epi8('>'));
+                __m128i isQuot = _mm_cmpeq_epi8(v, _mm_set1_epi8('"'));
+                __m128i extraSizes = _mm_or_si128(
+                    _mm_or_si128(_mm_and_si128(isAmp, _mm_set1_epi8(4)), _mm_and_si128(isAngle, _mm_set1_epi8(3))),
+                    _mm_and_si128(isQuot, quotExtraSize));
+                sums = _mm_add_epi64(sums, _mm_sad_epu8(extraSizes, _mm_setzero_si128()));
+            }
+            uint64_t lanes[2];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), sums);
+            return static_cast<size_t>(lanes[0] + lanes[1]) + GetExtraSizeScalar(p + i, size - i, isAttribute);
+        }
+
+        size_t EscapeSse2(const char* p, size_t size, char* out, bool isAttribute) noexcept
+        {
+            const __m128i quot = _mm_set1_epi8(isAttribute ? '"' : '&');
+            char* o = out;
+            size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+                unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(FindSpecialBytesSse2(v, quot)));
+                if (mask == 0)
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(o), v);
+                    o += 16;
+                    continue;
+                }
+                o = EscapeBlock(p + i, 16, mask, o);
+            }
+            return static_cast<size_t>(o - out) + EscapeScalar(p + i, size - i, o, isAttribute);
+        }
+
+        // AVX2 kernel processes the last 16-byte block by VEX-encoded SSE2 instructions
+        // (mixing legacy SSE instructions with AVX ones stalls some CPUs)
+        OT_TARGET_AVX2 inline __m256i FindSpecialBytesAvx2(__m256i v, __m256i quot) noexcept
+        {
+            __m256i isAmp = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('&'));
+            __m256i isAngle = _mm256_cmpeq_epi8(_mm256_or_si256(v, _mm256_set1_epi8(2)), _mm256_set1_epi8('>'));
+            return _mm256_or_si256(_mm256_or_si256(isAmp, isAngle), _mm256_cmpeq_epi8(v, quot));
+        }
+
+        OT_TARGET_AVX2 size_t FindSpecialAvx2(const char* p, size_t size, bool isAttribute) noexcept
+        {
+            const __m256i quot = _mm256_set1_epi8(isAttribute ? '"' : '&');
+            size_t i = 0;
+            for (; i + 32 <= size; i += 32)
+            {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+                unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(FindSpecialBytesAvx2(v, quot)));
+                if (mask != 0)
+                    return i + CountTrailingZeros(mask);
+            }
+            if (i + 16 <= size)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+                unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(
+                    FindSpecialBytesSse2(v, _mm256_castsi256_si128(quot))));
+                if (mask != 0)
+                    return i + CountTrailingZeros(mask);
+                i += 16;
+            }
+            return i + FindSpecialScalar(p + i, size - i, isAttribute);
+        }
+
+        OT_TARGET_AVX2 size_t GetExtraSizeAvx2(const char* p, size_t size, bool isAttribute) noexcept
+        {
+            const __m256i quotExtraSize = _mm256_set1_epi8(isAttribute ? 5 : 0);
+            __m256i sums = _mm256_setzero_si256();
+            size_t i = 0;
+            for (; i + 32 <= size; i += 32)
+            {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+                __m256i isAmp = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('&'));
+                __m256i isAngle = _mm256_cmpeq_epi8(_mm256_or_si256(v, _mm256_set1_epi8(2)), _mm256_set1_epi8('>'));
+                __m256i isQuot = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'));
+                __m256i extraSizes = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_and_si256(isAmp, _mm256_set1_epi8(4)),
+                        _mm256_and_si256(isAngle, _mm256_set1_epi8(3))),
+                    _mm256_and_si256(isQuot, quotExtraSize));
+                sums = _mm256_add_epi64(sums, _mm256_sad_epu8(extraSizes, _mm256_setzero_si256()));
+            }
+            uint64_t lanes[4];
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), sums);
+            return static_cast<size_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3]) +
+                GetExtraSizeScalar(p + i, size - i, isAttribute);
+        }
+
+        OT_TARGET_AVX2 size_t EscapeAvx2(const char* p, size_t size, char* out, bool isAttribute) noexcept
+        {
+            const __m256i quot = _mm256_set1_epi8(isAttribute ? '"' : '&');
+            char* o = out;
+            size_t i = 0;
+            for (; i + 32 <= size; i += 32)
+            {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+                unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(FindSpecialBytesAvx2(v, quot)));
+                if (mask == 0)
+                {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(o), v);
+                    o += 32;
+                    continue;
+                }
+                o = EscapeBlock(p + i, 32, mask, o);
+            }
+            if (i + 16 <= size)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+                unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(
+                    FindSpecialBytesSse2(v, _mm256_castsi256_si128(quot))));
+                if (mask == 0)
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(o), v);
+                    o += 16;
+                }
+                else
+                {
+                    o = EscapeBlock(p + i, 16, mask, o);
+                }
+                i += 16;
+            }
+            return static_cast<size_t>(o - out) + EscapeScalar(p + i, size - i, o, isAttribute);
+        }
+
+        bool CpuSupportsAvx2() noexcept
+        {
+#ifdef _MSC_VER
+            int regs[4] = { 0 };
+            __cpuid(regs, 0);
+            if (regs[0] < 7)
+                return false;
+            // OS must save YMM registers (OSXSAVE + XCR0 bits 1,2)
+            __cpuid(regs, 1);
+            if ((regs[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6)
+                return false;
+            __cpuidex(regs, 7, 0);
+            return (regs[1] & (1 << 5)) != 0;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") != 0;
+#endif
+        }
+#endif
+
+        CHtmlEscaper::EMKernel DetectBestKernel() noexcept
+        {
+#ifdef OT_X86_KERNELS
+            // SSE2 is part of every x86 CPU we support
+            return CpuSupportsAvx2() ? CHtmlEscaper::EMKernel::AVX2 : CHtmlEscaper::EMKernel::SSE2;
+#else
+            return CHtmlEscaper::EMKernel::Scalar;
+#endif
+        }
+
+        CHtmlEscaper::EMKernel ResolveKernel(CHtmlEscaper::EMKernel kernel, size_t size) noexcept
+        {
+            if (kernel == CHtmlEscaper::EMKernel::Auto && size < CHtmlEscaper::SHORT_TEXT_SIZE)
+                return CHtmlEscaper::EMKernel::Scalar;
+            if (kernel == CHtmlEscaper::EMKernel::Auto || !CHtmlEscaper::IsKernelSupported(kernel))
+                return CHtmlEscaper::GetBestKernel();
+            return kernel;
+        }
+
+        size_t RunFindSpecial(CHtmlEscaper::EMKernel kernel, const char* p, size_t size, bool isAttribute) noexcept
+        {
+            switch (kernel)
+            {
+#ifdef OT_X86_KERNELS
+            case CHtmlEscaper::EMKernel::AVX2:
+                return FindSpecialAvx2(p, size, isAttribute);
+            case CHtmlEscaper::EMKernel::SSE2:
+                return FindSpecialSse2(p, size, isAttribute);
+#endif
+            default:
+                return FindSpecialScalar(p, size, isAttribute);
+            }
+        }
+
+        size_t RunGetExtraSize(CHtmlEscaper::EMKernel kernel, const char* p, size_t size, bool isAttribute) noexcept
+        {
+            switch (kernel)
+            {
+#ifdef OT_X86_KERNELS
+            case CHtmlEscaper::EMKernel::AVX2:
+                return GetExtraSizeAvx2(p, size, isAttribute);
+            case CHtmlEscaper::EMKernel::SSE2:
+                return GetExtraSizeSse2(p, size, isAttribute);
+#endif
+            default:
+                return GetExtraSizeScalar(p, size, isAttribute);
+            }
+        }
+
+        size_t RunEscape(CHtmlEscaper::EMKernel kernel, const char* p, size_t size, char* out, bool isAttribute) noexcept
+        {
+            switch (kernel)
+            {
+#ifdef OT_X86_KERNELS
+            case CHtmlEscaper::EMKernel::AVX2:
+                return EscapeAvx2(p, size, out, isAttribute);
+            case CHtmlEscaper::EMKernel::SSE2:
+                return EscapeSse2(p, size, out, isAttribute);
+#endif
+            default:
+                return EscapeScalar(p, size, out, isAttribute);
+            }
+        }
+    }
+
+    CHtmlEscaper::EMKernel CHtmlEscaper::GetBestKernel() noexcept
+    {
+        static const EMKernel bestKernel = DetectBestKernel();
+        return bestKernel;
+    }
+
+    bool CHtmlEscaper::IsKernelSupported(EMKernel kernel) noexcept
+    {
+        switch (kernel)
+        {
+        case EMKernel::Auto:
+        case EMKernel::Scalar:
+            return true;
+        case EMKernel::SSE2:
+            return GetBestKernel() == EMKernel::SSE2 || GetBestKernel() == EMKernel::AVX2;
+        case EMKernel::AVX2:
+            return GetBestKernel() == EMKernel::AVX2;
+        }
+        return false;
+    }
+
+    size_t CHtmlEscaper::GetEscapedSize(std::string_view sText, EMContext context, EMKernel kernel) noexcept
+    {
+        return sText.size() + RunGetExtraSize(ResolveKernel(kernel, sText.size()), sText.data(), sText.size(),
+            context == EMContext::Attribute);
+    }
+
+    size_t CHtmlEscaper::Escape(std::string_view sText, char* o_buffer, EMContext context, EMKernel kernel) noexcept
+    {
+        return RunEscape(ResolveKernel(kernel, sText.size()), sText.data(), sText.size(), o_buffer,
+            context == EMContext::Attribute);
+    }
+
+    void CHtmlEscaper::AppendTwoPass(std::string_view sText, std::pmr::string& o_sHtml, EMContext context, EMKernel kernel)
+    {
+        const bool isAttribute = context == EMContext::Attribute;
+        const char* p = sText.data();
+        kernel = ResolveKernel(kernel, sText.size());
+        size_t firstSpecial = RunFindSpecial(kernel, p, sText.size(), isAttribute);
+        if (firstSpecial == sText.size())
+        {
+            o_sHtml.append(p, sText.size());
+            return;
+        }
+        // Clean prefix isn't scanned again
+        size_t restSize = sText.size() - firstSpecial;
+        size_t escapedRestSize = restSize + RunGetExtraSize(kernel, p + firstSpecial, restSize, isAttribute);
+        size_t oldSize = o_sHtml.size();
+        o_sHtml.resize(oldSize + firstSpecial + escapedRestSize);
+        char* o = &o_sHtml[oldSize];
+        memcpy(o, p, firstSpecial);
+        RunEscape(kernel, p + firstSpecial, restSize, o + firstSpecial, isAttribute);
+    }
+}
@@ -0,0 +1,90 @@
+// Contains declaration of OS-independent escaping of HTML special characters.
+#ifndef OT_HTMLESCAPER_H__
+#define OT_HTMLESCAPER_H__
+
+#include <string>
+#include <string_view>
+#include <memory_resource>
+
+namespace OTInterviewExercise1
+{
+    // Escapes & < > (and " in attribute values) of UTF8 text as entities. Text is scanned
+    // 16 (SSE2) or 32 (AVX2) bytes at a time and runs of characters that don't need
+    // escaping are copied in bulk; kernel is chosen at runtime according to CPU features.
+    class CHtmlEscaper
+    {
+    public:
+        enum class EMKernel
+        {
+            Auto, // Best kernel supported by the CPU (scalar one for short text)
+            Scalar,
+            SSE2,
+            AVX2
+        };
+        enum class EMContext
+        {
+            Text, // Element content
+            Attribute // Attribute value in double quotes
+        };
+
+        // Returns kernel that's used for EMKernel::Auto
+        static EMKernel GetBestKernel() noexcept;
+        static bool IsKernelSupported(EMKernel kernel) noexcept;
+
+        // Exact-size escaping is done in two passes: the first one returns size of escaped
+        // text, the second one writes escaped text into o_buffer that has room for that
+        // many bytes (returns number of bytes written). Unsupported kernel is replaced by
+        // the best supported one.
+        static size_t GetEscapedSize(std::string_view sText, EMContext context = EMContext::Text,
+            EMKernel kernel = EMKernel::Auto) noexcept;
+        static size_t Escape(std::string_view sText, char* o_buffer, EMContext context = EMContext::Text,
+            EMKernel kernel = EMKernel::Auto) noexcept;
+        // Appends escaped text. Text that needs escaping is escaped in two passes, so the
+        // string grows once - except short text (a typical field value) that's escaped inline
+        // run by run if kernel isn't given.
+        static void Append(std::string_view sText, std::pmr::string& o_sHtml, EMContext context = EMContext::Text,
+            EMKernel kernel = EMKernel::Auto)
+        {
+            if (sText.size() >= SHORT_TEXT_SIZE || kernel != EMKernel::Auto)
+            {
+                AppendTwoPass(sText, o_sHtml, context, kernel);
+                return;
+            }
+            const bool isAttribute = context == EMContext::Attribute;
+            const char* p = sText.data();
+            const char* end = p + sText.size();
+            for (;;)
+            {
+                const char* run = p;
+                while (p != end && *p != '&' && *p != '<' && *p != '>' && (*p != '"' || !isAttribute))
+                    p++;
+                o_sHtml.append(run, static_cast<size_t>(p - run));
+                if (p == end)
+                    return;
+                switch (*p++)
+                {
+                case '&':
+                    o_sHtml.append("&amp;", 5);
+                    break;
+                case '<':
+                    o_sHtml.append("&lt;", 4);
+                    break;
+                case '>':
+                    o_sHtml.append("&gt;", 4);
+                    break;
+                default:
+                    o_sHtml.append("&quot;", 6);
+                    break;
+                }
+            }
+        }
+
+        // EMKernel::Auto uses vector kernels only for text of at least that many bytes:
+        // setting up their registers (and the second pass of Append) costs more than scalar
+        // scan of a short text
+        static constexpr size_t SHORT_TEXT_SIZE = 64;
+    private:
+        static void AppendTwoPass(std::string_view sText, std::pmr::string& o_sHtml, EMContext context, EMKernel kernel);
+    };
+}
+#endif
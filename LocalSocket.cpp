@@ -0,0 +1,63 @@
+// Contains OS-independent part of implementation of local (Unix domain) sockets.
+
+#include "LocalSocket.h"
+#include "Util.h"
+#ifdef _WIN32
+#include "win/WinUtil.h"
+#else
+#include "linux/LinuxUtil.h"
+#endif
+
+namespace OTInterviewExercise1
+{
+    CLocalSocket::CLocalSocket(const wchar_t* sSocketPathName) :
+        mImpl(std::make_unique<CLocalSocketImpl>(sSocketPathName))
+    {}
+
+    CLocalSocket::CLocalSocket(std::unique_ptr<CLocalSocketImpl> impl) :
+        mImpl(std::move(impl))
+    {}
+
+    CLocalSocket::~CLocalSocket()
+    {}
+
+    bool CLocalSocket::Read(char* data, size_t size)
+    {
+        return mImpl->Read(data, size);
+    }
+
+    void CLocalSocket::Write(const std::string_view* buffers, size_t count)
+    {
+        mImpl->Write(buffers, count);
+    }
+
+    void CLocalSocket::Shutdown() noexcept
+    {
+        mImpl->Shutdown();
+    }
+
+    CLocalSocketListener::CLocalSocketListener(const wchar_t* sSocketPathName) :
+        mImpl(std::make_unique<CLocalSocketListenerImpl>(sSocketPathName))
+    {}
+
+    CLocalSocketListener::~CLocalSocketListener()
+    {}
+
+    std::unique_ptr<CLocalSocket> CLocalSocketListener::Accept()
+    {
+        std::unique_ptr<CLocalSocket::CLocalSocketImpl> connection = mImpl->Accept();
+        if (connection == nullptr)
+            return nullptr;
+        return std::make_unique<CLocalSocket>(std::move(connection));
+    }
+
+    void CLocalSocketListener::AddIdleConnection(std::unique_ptr<CLocalSocket> connection)
+    {
+        mImpl->AddIdleConnection(std::move(connection->mImpl));
+    }
+
+    void CLocalSocketListener::Shutdown() noexcept
+    {
+        mImpl->Shutdown();
+    }
+}
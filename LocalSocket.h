@@ -0,0 +1,74 @@
+// Contains declaration of OS-independent local (Unix domain) socket classes. They're
+// used by conversion daemon and its clients (AF_UNIX is available on Windows 10 too).
+#ifndef OT_LOCALSOCKET_H__
+#define OT_LOCALSOCKET_H__
+
+#include <string>
+#include <string_view>
+#include <memory>
+
+namespace OTInterviewExercise1
+{
+    // Connected stream socket. Errors are reported by throwing CException.
+    class CLocalSocket
+    {
+    public:
+        // Connects to listening socket
+        explicit CLocalSocket(const wchar_t* sSocketPathName);
+        ~CLocalSocket();
+
+        CLocalSocket(const CLocalSocket&) = delete;
+        CLocalSocket& operator=(const CLocalSocket&) = delete;
+
+        // Reads exactly size bytes. Returns false if connection was closed by peer before
+        // the first byte (closing it in the middle is an error).
+        bool Read(char* data, size_t size);
+        // Writes all buffers (gather write)
+        void Write(const std::string_view* buffers, size_t count);
+        // Wakes up threads blocked in Read() (they get an error). Can be called by any thread.
+        void Shutdown() noexcept;
+
+        // OS-specific socket (see LinuxUtil.h, WinUtil.h)
+        class CLocalSocketImpl;
+        explicit CLocalSocket(std::unique_ptr<CLocalSocketImpl> impl);
+    private:
+        friend class CLocalSocketListener;
+        std::unique_ptr<CLocalSocketImpl> mImpl;
+    };
+
+    // Listening socket. Socket file is created by ctor and deleted by dtor. Errors are
+    // reported by throwing CException.
+    // Only the user that owns the process (and root) can connect: on Linux socket file is
+    // accessible by its owner only, and connections of other users are closed as soon as
+    // they're accepted (peer credentials are checked). On Windows access is controlled by
+    // ACL of the directory of socket file.
+    // Listener also keeps idle connections (see AddIdleConnection()) - so threads that
+    // serve connections are occupied by requests rather than by clients that stay connected.
+    class CLocalSocketListener
+    {
+    public:
+        // Socket file that's left behind by a process that exited is replaced, socket of a
+        // running process isn't
+        explicit CLocalSocketListener(const wchar_t* sSocketPathName);
+        ~CLocalSocketListener();
+
+        CLocalSocketListener(const CLocalSocketListener&) = delete;
+        CLocalSocketListener& operator=(const CLocalSocketListener&) = delete;
+
+        // Waits for connection that has data to read: a new one or an idle one that received
+        // data (or was closed by peer). Can be called by several threads at once. Returns
+        // nullptr after Shutdown() was called.
+        std::unique_ptr<CLocalSocket> Accept();
+        // Keeps connection until it has data to read - then it's returned by Accept() again.
+        // Connection is closed if listener was shut down. Can be called by any thread.
+        void AddIdleConnection(std::unique_ptr<CLocalSocket> connection);
+        // Wakes up threads blocked in Accept(). Can be called by any thread.
+        void Shutdown() noexcept;
+
+        // OS-specific socket (see LinuxUtil.h, WinUtil.h)
+        class CLocalSocketListenerImpl;
+    private:
+        std::unique_ptr<CLocalSocketListenerImpl> mImpl;
+    };
+}
+#endif
@@ -0,0 +1,117 @@
+// Contains declaration of OS-independent bounded lock-free queue of log messages that
+// CLogger passes from logging threads to its writer thread.
+#ifndef OT_LOGQUEUE_H__
+#define OT_LOGQUEUE_H__
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace OTInterviewExercise1
+{
+    // Formatted UTF8 log message (it ends with new line). Longer messages are truncated.
+    struct CLogRecord
+    {
+        static constexpr size_t MAX_SIZE = 1024 - sizeof(uint32_t);
+
+        uint32_t mSize;
+        char mText[MAX_SIZE];
+    };
+
+    // Bounded multi-producer single-consumer queue (D. Vyukov's bounded queue): every cell
+    // has a sequence number that tells producers and consumer whose turn it is. Producers
+    // never wait - Push() fails if the queue is full. Memory is allocated by ctor only.
+    class CLogQueue
+    {
+    public:
+        // capacity is rounded up to power of 2
+        explicit CLogQueue(size_t capacity) :
+            mMask(0),
+            mPushPos(0),
+            mPopPos(0)
+        {
+            size_t cellCount = 2;
+            while (cellCount < capacity)
+                cellCount *= 2;
+            mCells = std::make_unique<CCell[]>(cellCount);
+            for (size_t i = 0; i < cellCount; ++i)
+            {
+                mCells[i].mSequence.store(i, std::memory_order_relaxed);
+            }
+            mMask = cellCount - 1;
+        }
+
+        CLogQueue(const CLogQueue&) = delete;
+        CLogQueue& operator=(const CLogQueue&) = delete;
+
+        // Reserves a record, calls fill(record) and publishes the record. Returns false
+        // (without calling fill) if the queue is full. Can be called by any thread.
+        template<typename T> bool Push(T fill) noexcept
+        {
+            size_t pos = mPushPos.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                CCell& cell = mCells[pos & mMask];
+                size_t sequence = cell.mSequence.load(std::memory_order_acquire);
+                intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+                if (difference == 0)
+                {
+                    if (mPushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        fill(cell.mRecord);
+                        cell.mSequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    // Consumer hasn't taken the record that was pushed one lap ago
+                    return false;
+                }
+                else
+                {
+                    pos = mPushPos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Calls consume(record) for the oldest record and removes it. Returns false if no
+        // record is published yet. Must be called by one thread at a time.
+        template<typename T> bool Pop(T consume) noexcept
+        {
+            size_t pos = mPopPos.load(std::memory_order_relaxed);
+            CCell& cell = mCells[pos & mMask];
+            if (cell.mSequence.load(std::memory_order_acquire) != pos + 1)
+                return false;
+            consume(static_cast<const CLogRecord&>(cell.mRecord));
+            cell.mSequence.store(pos + mMask + 1, std::memory_order_release);
+            mPopPos.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Records that were reserved/removed so far (reserved record might not be
+        // published yet)
+        uint64_t GetPushedCount() const noexcept
+        {
+            return mPushPos.load(std::memory_order_acquire);
+        }
+        uint64_t GetPoppedCount() const noexcept
+        {
+            return mPopPos.load(std::memory_order_acquire);
+        }
+    private:
+        struct CCell
+        {
+            std::atomic<size_t> mSequence;
+            CLogRecord mRecord;
+        };
+
+        std::unique_ptr<CCell[]> mCells;
+        size_t mMask;
+        // Producers and consumer update their positions on separate cache lines
+        alignas(64) std::atomic<size_t> mPushPos;
+        alignas(64) std::atomic<size_t> mPopPos;
+    };
+}
+#endif
@@ -1,37 +1,51 @@
 #include <iostream>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "ExitCode.h"
+#include "BatchConverter.h"
+#include "ConversionServer.h"
 #include "XmlParserWrapper.h"
+#include "ConversionMetrics.h"
+#include "Trace.h"
+#include "OutputSink.h"
 #include "Util.h"
+#ifndef _WIN32
+#include <clocale>
+#include <locale>
+#include <string.h>
+#include <stdexcept>
+#endif
 
-// Possible exit codes (of this application) - with 0 for success - and specific
-// non-0 codes for errors.
-enum class OTInterviewExercise1ExitCode
+namespace
 {
-    SUCCESS = 0,
-    INVALID_CMD_LINE,
-    XML_FILE_NOT_FOUND,
-    COULDNT_READ_XML_FILE,
-    XML_FILE_IS_EMPTY,
-    INIT_ERROR,
-    XML_PARSER_ERROR
-};
-
-int wmain(int argc, wchar_t **argv)
-{
-    if (argc > 2)
+    void PrintUsage()
     {
-        std::wcerr << L"Invalid command-line params.\n"
-            L"The only cmd-line parameter should be pathname of input XML file.\n"
+        std::wcerr << L"Usage: {EXE-path-name} [-o {output-html-file} [-p {rows-per-page}]] [-c {row-cache-file}] [--stats] [--pipelined|--index] {input-xml-file-pathname}\n"
             L"E.g. OTInterviewExercise1.exe c:\\temp\\catalog.xml\n"
-            L"Or invoke without parameters to see help page\n";
-        
-        return (int)OTInterviewExercise1ExitCode::INVALID_CMD_LINE;
-    }
-    if (argc == 1 || wcslen(argv[1]) >= 2 && argv[1][0] == L'-' && towlower(argv[1][1]) == L'h')
-    {
-        std::wcerr << L"Usage: {EXE-path-name} {input-xml-file-pathname}\n"
-            L"E.g. OTInterviewExercise1.exe c:\\temp\\catalog.xml\n"
-            L"Output HTML will be written to stdout\n"
+            L"Output HTML will be written to {output-html-file} or to stdout (as it's produced)\n"
+            L"Rendered rows are kept in {row-cache-file}, so that only changed CD elements are converted next time\n"
+            L"-p splits rows into pages {output-html-file-name}-1.html ... rendered in parallel, while {output-html-file}\n"
+            L"receives index page that links to them (it can't be combined with -c)\n"
+            L"--stats writes time and bytes of every phase of conversion (read, decode, load, transform, output) to stderr as JSON\n"
+            L"--pipelined reads XML file in chunks while it's converted (io_uring on Linux, overlapped I/O on Windows)\n"
+            L"--index renders rows from {input-xml-file}.catidx - XML is parsed (and the index is written) only if it changed\n"
+            L"Batch mode: {EXE-path-name} --batch [-j {threads}] [-d {output-dir}] [-x {xslt-file}] [-m {sort-memory-MB}] [-c|-p {rows-per-page}] [--stats] [--pipelined|--index] {xml-file|directory|-}...\n"
+            L"E.g. OTInterviewExercise1.exe --batch -j 4 -d c:\\temp\\html c:\\temp\\xml\n"
+            L"Every *.xml file of a directory is converted. \"-\" reads list of files from stdin (one per line).\n"
+            L"HTML is written to {output-dir} (or next to XML file) with .html extension.\n"
+            L"{xslt-file} replaces built-in style sheet. It's reloaded when the file changes.\n"
+            L"Rows that don't fit into {sort-memory-MB} (default 256) are sorted in temporary files.\n"
+            L"-c keeps rendered rows of every HTML file in {html-file}.rowcache (incremental conversion).\n"
+            L"-p writes rows of every HTML file to pages {html-file-name}-1.html ... (HTML file is index page).\n"
+            L"Exit code of every file is written to stdout, throughput summary - to stderr\n"
+            L"Daemon mode: {EXE-path-name} --daemon [-j {threads}] {socket-pathname}\n"
+            L"Requests are served over Unix domain socket by {threads} workers (see ConversionServer.h) until Ctrl+C\n"
             L"Any error messages will be written to stderr\n"
+            L"Any mode can be preceded by --log {log-file}: log messages are appended to {log-file} (rotated to\n"
+            L"{log-file}.1 ... when it exceeds 16 MB) instead of debug console (Windows) or stderr\n"
+            L"and by --trace {trace-file} (or OT_TRACE={trace-file} environment variable): spans of conversion\n"
+            L"internals of all threads are written to {trace-file} in Chrome trace-event format (chrome://tracing, Perfetto)\n"
             L"Exit codes are:\n"
             L"\t0 - success\n"
             L"\t1 - invalid command line\n"
@@ -39,33 +53,335 @@ int wmain(int argc, wchar_t **argv)
             L"\t3 - Couldn't read XML file\n"
             L"\t4 - XML file is empty\n"
             L"\t5 - initialization error\n"
-            L"\t6 - parsing error\n";
+            L"\t6 - parsing error\n"
+            L"\t7 - Couldn't write HTML file\n"
+            L"\t8 - batch mode: conversion of some files failed\n";
+    }
 
-        return (int)OTInterviewExercise1ExitCode::SUCCESS;
+    // Metrics are written as one line of JSON (it's ASCII)
+    void PrintMetrics(const OTInterviewExercise1::CConversionMetrics& metrics)
+    {
+        std::string sJson = metrics.ToJson();
+        std::wcerr << std::wstring(sJson.begin(), sJson.end()) << std::endl;
     }
 
-    std::wstring sXml;
-    std::wstring sErrorMsg;
-    wchar_t* xmlFilePathName = argv[1];
+    int InvalidCmdLine(const wchar_t* sReason)
+    {
+        std::wcerr << L"Invalid command-line params. " << sReason << L"\n"
+            L"Invoke without parameters to see help page\n";
+        return (int)OTInterviewExercise1ExitCode::INVALID_CMD_LINE;
+    }
 
-    auto xmlFileReader = std::make_unique<OTInterviewExercise1::CTextFileReader>(xmlFilePathName);
-    if (!xmlFileReader->Exists(sErrorMsg))
+    // Parses value of -p option
+    bool ParsePageSize(const wchar_t* sValue, size_t& o_pageSize)
     {
-        std::wcerr << L"File: " << xmlFilePathName << L" couldn't be opened. " << sErrorMsg << std::endl;
-        return (int)OTInterviewExercise1ExitCode::XML_FILE_NOT_FOUND;
+        wchar_t* end = nullptr;
+        unsigned long value = wcstoul(sValue, &end, 10);
+        if (*end != L'\0' || value == 0 || value > 100000000)
+        {
+            return false;
+        }
+        o_pageSize = (size_t)value;
+        return true;
     }
-    else if (!xmlFileReader->GetContents(sXml, sErrorMsg))
+
+    // Converts files listed in command-line (arguments after --batch)
+    int RunBatch(int argc, wchar_t** argv)
     {
-        std::wcerr << L"Error reading contents of file: " << xmlFilePathName << L" " << sErrorMsg << std::endl;
-        return (int)OTInterviewExercise1ExitCode::COULDNT_READ_XML_FILE;
+        unsigned int threadCount = 0;
+        std::wstring sOutputDir;
+        std::wstring sXSLTFilePathName;
+        size_t sortMemoryBudget = 0;
+        size_t pageSize = 0;
+        bool useRowCache = false;
+        bool collectMetrics = false;
+        OTInterviewExercise1::EMXmlFileInput xmlFileInput = OTInterviewExercise1::EMXmlFileInput::Mapped;
+        std::vector<std::wstring> args;
+        for (int i = 0; i < argc; ++i)
+        {
+            std::wstring arg = argv[i];
+            if ((arg == L"-j" || arg == L"-d" || arg == L"-x" || arg == L"-m" || arg == L"-p") && i + 1 >= argc)
+            {
+                return InvalidCmdLine(L"Option value is missing.");
+            }
+            if (arg == L"-j")
+            {
+                wchar_t* end = nullptr;
+                unsigned long value = wcstoul(argv[++i], &end, 10);
+                if (*end != L'\0' || value == 0 || value > 1024)
+                {
+                    return InvalidCmdLine(L"Number of threads should be in range 1..1024.");
+                }
+                threadCount = (unsigned int)value;
+            }
+            else if (arg == L"-d")
+            {
+                sOutputDir = argv[++i];
+            }
+            else if (arg == L"-x")
+            {
+                sXSLTFilePathName = argv[++i];
+            }
+            else if (arg == L"-m")
+            {
+                wchar_t* end = nullptr;
+                unsigned long value = wcstoul(argv[++i], &end, 10);
+                if (*end != L'\0' || value == 0 || value > 1024 * 1024)
+                {
+                    return InvalidCmdLine(L"Sort memory budget should be in range 1..1048576 MB.");
+                }
+                sortMemoryBudget = (size_t)value * 1024 * 1024;
+            }
+            else if (arg == L"-p")
+            {
+                if (!ParsePageSize(argv[++i], pageSize))
+                {
+                    return InvalidCmdLine(L"Number of rows per page should be in range 1..100000000.");
+                }
+            }
+            else if (arg == L"-c")
+            {
+                useRowCache = true;
+            }
+            else if (arg == L"--stats")
+            {
+                collectMetrics = true;
+            }
+            else if (arg == L"--pipelined")
+            {
+                xmlFileInput = OTInterviewExercise1::EMXmlFileInput::Pipelined;
+            }
+            else if (arg == L"--index")
+            {
+                xmlFileInput = OTInterviewExercise1::EMXmlFileInput::Indexed;
+            }
+            else
+            {
+                args.push_back(arg);
+            }
+        }
+        if (args.empty())
+        {
+            return InvalidCmdLine(L"Batch mode requires list of XML files, a directory or \"-\".");
+        }
+        if (useRowCache && pageSize != 0)
+        {
+            return InvalidCmdLine(L"-c can't be combined with -p.");
+        }
+
+        std::wstring sErrorMsg;
+        std::vector<std::wstring> xmlFiles;
+        if (!OTInterviewExercise1::CBatchConverter::CollectXmlFiles(args, std::cin, xmlFiles, sErrorMsg))
+        {
+            std::wcerr << L"Couldn't build list of XML files. " << sErrorMsg << std::endl;
+            return (int)OTInterviewExercise1ExitCode::XML_FILE_NOT_FOUND;
+        }
+
+        OTInterviewExercise1::CBatchConverter converter(threadCount, sOutputDir, sXSLTFilePathName);
+        if (sortMemoryBudget != 0)
+        {
+            converter.SetSortMemoryBudget(sortMemoryBudget);
+        }
+        converter.SetUseRowCache(useRowCache);
+        converter.SetPageSize(pageSize);
+        converter.SetCollectMetrics(collectMetrics);
+        converter.SetXmlFileInput(xmlFileInput);
+        std::vector<OTInterviewExercise1::CBatchConverter::CFileResult> results;
+        double seconds = 0;
+        if (!converter.Run(xmlFiles, results, seconds, sErrorMsg))
+        {
+            std::wcerr << L"Initialization error encountered. " << sErrorMsg << std::endl;
+            return (int)OTInterviewExercise1ExitCode::INIT_ERROR;
+        }
+
+        // Per-file status: {exit code}<TAB>{XML file}<TAB>{HTML file or error message}
+        size_t numFailed = 0;
+        uint64_t xmlBytes = 0;
+        uint64_t htmlBytes = 0;
+        for (const auto& result : results)
+        {
+            std::wcout << (int)result.mExitCode << L'\t' << result.mXmlFilePathName << L'\t';
+            if (result.mExitCode == OTInterviewExercise1ExitCode::SUCCESS)
+            {
+                std::wcout << result.mHtmlFilePathName << L'\n';
+            }
+            else
+            {
+                std::wcout << result.mError << L'\n';
+                numFailed++;
+            }
+            xmlBytes += result.mXmlSize;
+            htmlBytes += result.mHtmlSize;
+        }
+        std::wcout.flush();
+
+        double rateSeconds = seconds > 0 ? seconds : 1e-9;
+        std::wcerr << L"Converted " << results.size() - numFailed << L" of " << results.size()
+            << L" files (" << numFailed << L" failed) in " << seconds << L" s using "
+            << std::min<size_t>(converter.GetThreadCount(), results.size()) << L" threads. "
+            << results.size() / rateSeconds << L" files/s, "
+            << xmlBytes / rateSeconds / (1024 * 1024) << L" MB/s of XML ("
+            << xmlBytes << L" bytes of XML, " << htmlBytes << L" bytes of HTML)" << std::endl;
+        if (collectMetrics)
+        {
+            PrintMetrics(converter.GetMetrics());
+        }
+
+        return numFailed == 0 ? (int)OTInterviewExercise1ExitCode::SUCCESS :
+            (int)OTInterviewExercise1ExitCode::BATCH_HAD_ERRORS;
     }
-    else if (sXml.empty())
+
+    // Serves conversion requests (arguments after --daemon) until termination signal
+    int RunDaemon(int argc, wchar_t** argv)
     {
-        std::wcerr << L"File: " << xmlFilePathName << L" doesn't contain any XML." << std::endl;
-        return (int)OTInterviewExercise1ExitCode::XML_FILE_IS_EMPTY;
+        unsigned int threadCount = 0;
+        if (argc >= 1 && wcscmp(argv[0], L"-j") == 0)
+        {
+            wchar_t* end = nullptr;
+            unsigned long value = argc >= 2 ? wcstoul(argv[1], &end, 10) : 0;
+            if (argc < 2 || *end != L'\0' || value == 0 || value > 1024)
+            {
+                return InvalidCmdLine(L"Number of threads should be in range 1..1024.");
+            }
+            threadCount = (unsigned int)value;
+            argc -= 2;
+            argv += 2;
+        }
+        if (argc != 1)
+        {
+            return InvalidCmdLine(L"Daemon mode requires socket pathname.");
+        }
+
+        // Signals are blocked before workers are started - so that they are received by Wait()
+        OTInterviewExercise1::CTerminationSignal terminationSignal;
+        OTInterviewExercise1::CConversionServer server(argv[0], threadCount);
+        std::wstring sErrorMsg;
+        if (!server.Start(sErrorMsg))
+        {
+            std::wcerr << L"Initialization error encountered. " << sErrorMsg << std::endl;
+            return (int)OTInterviewExercise1ExitCode::INIT_ERROR;
+        }
+        std::wcerr << L"Serving requests on " << argv[0] << L" using " << server.GetThreadCount()
+            << L" threads" << std::endl;
+        if (!terminationSignal.Wait(sErrorMsg))
+        {
+            std::wcerr << sErrorMsg << std::endl;
+        }
+        server.Stop();
+        std::wcerr << L"Served " << server.GetRequestCount() << L" requests" << std::endl;
+        return (int)OTInterviewExercise1ExitCode::SUCCESS;
     }
-    // Close XML reader - it's not needed anymore
-    xmlFileReader.reset();
+}
+
+int wmain(int argc, wchar_t **argv)
+{
+    std::wstring sTraceFilePathName;
+    OTInterviewExercise1::GetEnvironmentValue(L"OT_TRACE", sTraceFilePathName);
+    while (argc >= 2 && (wcscmp(argv[1], L"--log") == 0 || wcscmp(argv[1], L"--trace") == 0))
+    {
+        if (argc < 3)
+        {
+            return InvalidCmdLine(L"--log and --trace require file pathname.");
+        }
+        if (wcscmp(argv[1], L"--trace") == 0)
+        {
+            sTraceFilePathName = argv[2];
+        }
+        else
+        {
+            std::wstring sLogError;
+            if (!OTInterviewExercise1::GetDefaultLogger().SetLogFile(argv[2],
+                OTInterviewExercise1::CLogger::DEFAULT_MAX_FILE_SIZE,
+                OTInterviewExercise1::CLogger::DEFAULT_MAX_FILE_COUNT, sLogError))
+            {
+                std::wcerr << L"Couldn't open log file. " << sLogError << std::endl;
+                return (int)OTInterviewExercise1ExitCode::INVALID_CMD_LINE;
+            }
+        }
+        argc -= 2;
+        argv += 2;
+    }
+    // Spans recorded by all threads are written when the process is about to exit
+    OTInterviewExercise1::CTracer::Instance().Enable(!sTraceFilePathName.empty());
+    auto writeTrace = OTInterviewExercise1::MakeRAIICleanup([&sTraceFilePathName]() {
+        std::wstring sTraceError;
+        if (!sTraceFilePathName.empty() &&
+            !OTInterviewExercise1::CTracer::Instance().WriteJson(sTraceFilePathName.c_str(), sTraceError))
+        {
+            std::wcerr << L"Couldn't write trace file. " << sTraceError << std::endl;
+        }
+    });
+    if (argc >= 2 && wcscmp(argv[1], L"--batch") == 0)
+    {
+        return RunBatch(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && wcscmp(argv[1], L"--daemon") == 0)
+    {
+        return RunDaemon(argc - 2, argv + 2);
+    }
+    const wchar_t* htmlFilePathName = nullptr;
+    const wchar_t* rowCacheFilePathName = nullptr;
+    size_t pageSize = 0;
+    bool collectMetrics = false;
+    OTInterviewExercise1::EMXmlFileInput xmlFileInput = OTInterviewExercise1::EMXmlFileInput::Mapped;
+    while (argc >= 2 && (wcscmp(argv[1], L"-o") == 0 || wcscmp(argv[1], L"-c") == 0 || wcscmp(argv[1], L"-p") == 0 ||
+        wcscmp(argv[1], L"--stats") == 0 || wcscmp(argv[1], L"--pipelined") == 0 || wcscmp(argv[1], L"--index") == 0))
+    {
+        if (wcscmp(argv[1], L"--stats") == 0 || wcscmp(argv[1], L"--pipelined") == 0 || wcscmp(argv[1], L"--index") == 0)
+        {
+            if (wcscmp(argv[1], L"--stats") == 0)
+                collectMetrics = true;
+            else if (wcscmp(argv[1], L"--pipelined") == 0)
+                xmlFileInput = OTInterviewExercise1::EMXmlFileInput::Pipelined;
+            else
+                xmlFileInput = OTInterviewExercise1::EMXmlFileInput::Indexed;
+            argc--;
+            argv++;
+            continue;
+        }
+        if (argc < 4)
+        {
+            return InvalidCmdLine(L"-o, -c and -p require value followed by input XML file pathname.");
+        }
+        if (wcscmp(argv[1], L"-o") == 0)
+        {
+            htmlFilePathName = argv[2];
+        }
+        else if (wcscmp(argv[1], L"-p") == 0)
+        {
+            if (!ParsePageSize(argv[2], pageSize))
+            {
+                return InvalidCmdLine(L"Number of rows per page should be in range 1..100000000.");
+            }
+        }
+        else
+        {
+            rowCacheFilePathName = argv[2];
+        }
+        argc -= 2;
+        argv += 2;
+    }
+    if (argc > 2)
+    {
+        std::wcerr << L"Invalid command-line params.\n"
+            L"The only cmd-line parameter should be pathname of input XML file.\n"
+            L"E.g. OTInterviewExercise1.exe c:\\temp\\catalog.xml\n"
+            L"Or invoke without parameters to see help page\n";
+        
+        return (int)OTInterviewExercise1ExitCode::INVALID_CMD_LINE;
+    }
+    if (argc == 1 || wcslen(argv[1]) >= 2 && argv[1][0] == L'-' && towlower(argv[1][1]) == L'h')
+    {
+        PrintUsage();
+        return (int)OTInterviewExercise1ExitCode::SUCCESS;
+    }
+    if (pageSize != 0 && (htmlFilePathName == nullptr || rowCacheFilePathName != nullptr))
+    {
+        return InvalidCmdLine(L"-p requires -o and can't be combined with -c.");
+    }
+
+    std::wstring sErrorMsg;
+    wchar_t* xmlFilePathName = argv[1];
 
     // Perform OS-specific initialization. Dtor will perform cleanup (if necessary).
     OTInterviewExercise1::COsInitialization init;
@@ -77,19 +393,114 @@ int wmain(int argc, wchar_t **argv)
 
     // Create XML parser object using XSLT style-sheet in resources (stored in our EXE)
     OTInterviewExercise1::CXmlParserWrapper xmlParser(OTInterviewExercise1::CXmlParserWrapper::EMXSLTFile::CatalogResources);
-
-    // Call XML parser to produce HTML output
-    std::wstring sHtml;
-    if (!xmlParser.Parse(
-        sXml,
-        sHtml,
-        sErrorMsg))
+    xmlParser.SetRowCacheFile(rowCacheFilePathName);
+    xmlParser.EnableMetrics(collectMetrics);
+    // Pages are written next to the output file, which receives index page
+    std::unique_ptr<OTInterviewExercise1::CFilePageOutput> pageOutput;
+    if (pageSize != 0)
     {
-        std::wcerr << L"Xml parser error encountered. " << sErrorMsg << std::endl;
-        return (int)OTInterviewExercise1ExitCode::XML_PARSER_ERROR;
+        pageOutput = std::make_unique<OTInterviewExercise1::CFilePageOutput>(htmlFilePathName);
+        xmlParser.SetPageOutput(pageOutput.get(), pageSize);
     }
 
-    // Write HTML to stdout
-    std::wcout << sHtml << std::endl;
+    // Read XML file and call XML parser. UTF8 HTML is written to output as it's produced.
+    std::unique_ptr<OTInterviewExercise1::CFileOutputSink> htmlSink;
+    try
+    {
+        if (htmlFilePathName != nullptr)
+        {
+            // HTML is about as large as XML - so that much space is preallocated (unless rows go to pages)
+            uint64_t preallocatedSize = 0;
+            OTInterviewExercise1::CFileVersion xmlFileVersion;
+            if (pageOutput == nullptr && OTInterviewExercise1::GetFileVersion(xmlFilePathName, xmlFileVersion, sErrorMsg))
+            {
+                preallocatedSize = xmlFileVersion.mSize;
+            }
+            htmlSink = std::make_unique<OTInterviewExercise1::CFileOutputSink>(htmlFilePathName, preallocatedSize);
+        }
+        else
+        {
+            htmlSink = std::make_unique<OTInterviewExercise1::CFileOutputSink>();
+        }
+    }
+    catch (const OTInterviewExercise1::CException& ex)
+    {
+        std::wcerr << L"Couldn't create output file. " << ex.mErrorDescription << std::endl;
+        return (int)OTInterviewExercise1ExitCode::COULDNT_WRITE_HTML_FILE;
+    }
+    uint64_t xmlSize = 0;
+    OTInterviewExercise1ExitCode exitCode = OTInterviewExercise1::ConvertXmlFile(
+        xmlParser, xmlFilePathName, *htmlSink, xmlSize, sErrorMsg, xmlFileInput);
+    if (exitCode == OTInterviewExercise1ExitCode::SUCCESS)
+    {
+        try
+        {
+            // Standard output ends with new line (as it did when HTML was written by wcout)
+            if (htmlFilePathName == nullptr)
+            {
+                htmlSink->Write("\n", 1);
+            }
+            // Buffered HTML is written by Close()
+            OTInterviewExercise1::CMetricsTimer outputTimer(xmlParser.GetMetrics(),
+                OTInterviewExercise1::CConversionMetrics::EMPhase::Output);
+            htmlSink->Close();
+        }
+        catch (const OTInterviewExercise1::CException& ex)
+        {
+            sErrorMsg = ex.mErrorDescription;
+        }
+    }
+    if (htmlSink->HasWriteError())
+    {
+        exitCode = OTInterviewExercise1ExitCode::COULDNT_WRITE_HTML_FILE;
+        sErrorMsg = L"Couldn't write HTML. " + sErrorMsg;
+    }
+    if (xmlParser.GetMetrics() != nullptr)
+    {
+        PrintMetrics(*xmlParser.GetMetrics());
+    }
+    if (exitCode != OTInterviewExercise1ExitCode::SUCCESS)
+    {
+        // Partial HTML file isn't left behind (nor pages of it)
+        htmlSink->Discard();
+        if (pageOutput != nullptr)
+        {
+            pageOutput->Discard();
+        }
+        std::wcerr << sErrorMsg << std::endl;
+        return (int)exitCode;
+    }
     return 0;
-}
\ No newline at end of file
+}
+
+#ifndef _WIN32
+// There is no wmain() outside of Windows - so convert command-line parameters
+// (assumed to be UTF8) to wchar_t strings and call wmain()
+int main(int argc, char** argv)
+{
+    // Use environment's locale so that wide streams can output non-ASCII characters
+    std::setlocale(LC_ALL, "");
+    try
+    {
+        std::wcout.imbue(std::locale(""));
+        std::wcerr.imbue(std::locale(""));
+    }
+    catch (const std::runtime_error& /*ex*/)
+    {
+        // Unknown locale name in environment - keep default "C" locale
+    }
+
+    std::vector<std::wstring> args(argc);
+    std::vector<wchar_t*> wargv(argc + 1, nullptr);
+    for (int i = 0; i < argc; ++i)
+    {
+        if (!OTInterviewExercise1::Utf8ToWide(argv[i], strlen(argv[i]), args[i]))
+        {
+            std::wcerr << L"Invalid command-line params. Parameters must be UTF8 strings.\n";
+            return (int)OTInterviewExercise1ExitCode::INVALID_CMD_LINE;
+        }
+        wargv[i] = &args[i][0];
+    }
+    return wmain(argc, wargv.data());
+}
+#endif
@@ -0,0 +1,230 @@
+// Contains OS-independent implementation of output sinks.
+
+#include "OutputSink.h"
+#include "Util.h"
+#include "Trace.h"
+#ifdef _WIN32
+#include "win/WinUtil.h"
+#else
+#include "linux/LinuxUtil.h"
+#endif
+#include <vector>
+
+namespace OTInterviewExercise1
+{
+    CFileOutputSink::CFileOutputSink() :
+        mImpl(std::make_unique<CFileOutputSinkImpl>()),
+        mSize(0),
+        mHasWriteError(false)
+    {
+        mBuffer.reserve(BUFFER_SIZE);
+    }
+
+    CFileOutputSink::CFileOutputSink(const wchar_t* sFilePathName, uint64_t preallocatedSize) :
+        mImpl(std::make_unique<CFileOutputSinkImpl>(sFilePathName, preallocatedSize)),
+        mSize(0),
+        mHasWriteError(false)
+    {
+        mBuffer.reserve(BUFFER_SIZE);
+    }
+
+    CFileOutputSink::~CFileOutputSink()
+    {
+        try
+        {
+            Flush();
+        }
+        catch (...)
+        {
+            // Caller should have called Close() to get the error
+        }
+    }
+
+    void CFileOutputSink::Write(const char* data, size_t size)
+    {
+        mSize += size;
+        if (mBuffer.size() + size <= BUFFER_SIZE)
+        {
+            mBuffer.append(data, size);
+            return;
+        }
+        const std::string_view buffers[] = { mBuffer, std::string_view(data, size) };
+        WriteToFile(buffers, 2);
+        mBuffer.clear();
+    }
+
+    void CFileOutputSink::WriteGather(const std::string_view* buffers, size_t count)
+    {
+        size_t size = 0;
+        for (size_t i = 0; i < count; ++i)
+            size += buffers[i].size();
+        mSize += size;
+        if (mBuffer.size() + size <= BUFFER_SIZE)
+        {
+            for (size_t i = 0; i < count; ++i)
+                mBuffer.append(buffers[i]);
+            return;
+        }
+        std::vector<std::string_view> allBuffers;
+        allBuffers.reserve(count + 1);
+        allBuffers.push_back(mBuffer);
+        allBuffers.insert(allBuffers.end(), buffers, buffers + count);
+        WriteToFile(allBuffers.data(), allBuffers.size());
+        mBuffer.clear();
+    }
+
+    void CFileOutputSink::Flush()
+    {
+        if (mBuffer.empty())
+            return;
+        std::string_view buffer = mBuffer;
+        WriteToFile(&buffer, 1);
+        mBuffer.clear();
+    }
+
+    void CFileOutputSink::Close()
+    {
+        CTraceSpan closeSpan("close");
+        Flush();
+        try
+        {
+            mImpl->Close(mSize);
+        }
+        catch (...)
+        {
+            mHasWriteError = true;
+            throw;
+        }
+    }
+
+    void CFileOutputSink::Discard() noexcept
+    {
+        mBuffer.clear();
+        mImpl->Discard();
+    }
+
+    void CFileOutputSink::WriteToFile(const std::string_view* buffers, size_t count)
+    {
+        CTraceSpan writeSpan("write");
+        try
+        {
+            mImpl->Write(buffers, count);
+        }
+        catch (...)
+        {
+            mHasWriteError = true;
+            throw;
+        }
+    }
+
+    CFilePageOutput::CFilePageOutput(const std::wstring& sIndexFilePathName) :
+        mSize(0)
+    {
+        size_t nameStart = sIndexFilePathName.find_last_of(L"/\\");
+        nameStart = nameStart == std::wstring::npos ? 0 : nameStart + 1;
+        size_t extensionStart = sIndexFilePathName.rfind(L'.');
+        if (extensionStart == std::wstring::npos || extensionStart <= nameStart)
+        {
+            extensionStart = sIndexFilePathName.size();
+        }
+        msPathNameStem = sIndexFilePathName.substr(0, extensionStart);
+        msExtension = sIndexFilePathName.substr(extensionStart);
+    }
+
+    std::string CFilePageOutput::GetPageLink(size_t page) const
+    {
+        // Page file is next to the index page - so link is its file name. Bytes of UTF8 that
+        // aren't unreserved URL characters are percent-encoded.
+        std::wstring sPathName = GetPageFilePathName(page);
+        size_t nameStart = sPathName.find_last_of(L"/\\");
+        nameStart = nameStart == std::wstring::npos ? 0 : nameStart + 1;
+        std::string sName;
+        if (!WideToUtf8(sPathName.data() + nameStart, sPathName.size() - nameStart, sName))
+        {
+            THROW_ERROR(L"Failed to convert page file name to UTF8");
+        }
+        const char hexDigits[] = "0123456789ABCDEF";
+        std::string sLink;
+        sLink.reserve(sName.size());
+        for (char ch : sName)
+        {
+            unsigned char byte = static_cast<unsigned char>(ch);
+            if ((byte >= 'A' && byte <= 'Z') || (byte >= 'a' && byte <= 'z') || (byte >= '0' && byte <= '9') ||
+                byte == '-' || byte == '.' || byte == '_' || byte == '~')
+            {
+                sLink += ch;
+            }
+            else
+            {
+                sLink += '%';
+                sLink += hexDigits[byte >> 4];
+                sLink += hexDigits[byte & 0xF];
+            }
+        }
+        return sLink;
+    }
+
+    void CFilePageOutput::WritePage(size_t page, std::string_view sHtml)
+    {
+        std::wstring sPathName = GetPageFilePathName(page);
+        std::wstring sTempPathName = sPathName + L".tmp";
+        {
+            CFileOutputSink file(sTempPathName.c_str(), sHtml.size());
+            try
+            {
+                file.Write(sHtml.data(), sHtml.size());
+                file.Close();
+            }
+            catch (...)
+            {
+                file.Discard();
+                throw;
+            }
+        }
+        std::wstring sErrorMsg;
+        if (!RenameFile(sTempPathName.c_str(), sPathName.c_str(), sErrorMsg))
+        {
+            RemoveFile(sTempPathName.c_str(), sErrorMsg);
+            THROW_ERROR((L"File: " + sPathName + L" couldn't be written. " + sErrorMsg).c_str());
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        mWrittenPages.push_back(page);
+        mSize += sHtml.size();
+    }
+
+    void CFilePageOutput::Discard() noexcept
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (size_t page : mWrittenPages)
+        {
+            try
+            {
+                std::wstring sErrorMsg;
+                RemoveFile(GetPageFilePathName(page).c_str(), sErrorMsg);
+            }
+            catch (...)
+            {
+                LogError(__FUNCTION__, __LINE__, L"Memory allocation error.");
+            }
+        }
+        mWrittenPages.clear();
+        mSize = 0;
+    }
+
+    std::wstring CFilePageOutput::GetPageFilePathName(size_t page) const
+    {
+        return msPathNameStem + L"-" + std::to_wstring(page + 1) + msExtension;
+    }
+
+    size_t CFilePageOutput::GetPageCount() const noexcept
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mWrittenPages.size();
+    }
+
+    uint64_t CFilePageOutput::GetSize() const noexcept
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mSize;
+    }
+}
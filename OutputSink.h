@@ -0,0 +1,150 @@
+// Contains declaration of OS-independent output sinks. Sinks receive UTF8 output
+// of CXmlParserWrapper as it's produced.
+#ifndef OT_OUTPUTSINK_H__
+#define OT_OUTPUTSINK_H__
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+
+namespace OTInterviewExercise1
+{
+    class COutputSink
+    {
+    public:
+        virtual ~COutputSink() = default;
+        // Appends data to the output. Throws CException on failure.
+        virtual void Write(const char* data, size_t size) = 0;
+        // Appends buffers in order (gather write). Throws CException on failure.
+        virtual void WriteGather(const std::string_view* buffers, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+                Write(buffers[i].data(), buffers[i].size());
+        }
+    };
+
+    // Appends output to a string
+    class CStringOutputSink : public COutputSink
+    {
+    public:
+        explicit CStringOutputSink(std::string& o_sOutput) :
+            mOutput(o_sOutput)
+        {}
+        void Write(const char* data, size_t size) override
+        {
+            mOutput.append(data, size);
+        }
+        void WriteGather(const std::string_view* buffers, size_t count) override
+        {
+            size_t size = mOutput.size();
+            for (size_t i = 0; i < count; ++i)
+                size += buffers[i].size();
+            mOutput.reserve(size);
+            for (size_t i = 0; i < count; ++i)
+                mOutput.append(buffers[i]);
+        }
+    private:
+        std::string& mOutput;
+    };
+
+    // Writes output to a file (or to standard output) through a buffer, so output reaches
+    // the file while it's being produced and memory use doesn't depend on its size.
+    // Errors are reported by throwing CException.
+    class CFileOutputSink : public COutputSink
+    {
+    public:
+        // Writes to standard output
+        CFileOutputSink();
+        // Creates (or truncates) file. If preallocatedSize isn't 0 that much disk space is
+        // allocated up front (fallocate on Linux) - space that isn't used is released by Close().
+        explicit CFileOutputSink(const wchar_t* sFilePathName, uint64_t preallocatedSize = 0);
+        // Writes buffered data ignoring errors (Close() reports them)
+        ~CFileOutputSink();
+
+        CFileOutputSink(const CFileOutputSink&) = delete;
+        CFileOutputSink& operator=(const CFileOutputSink&) = delete;
+
+        void Write(const char* data, size_t size) override;
+        // Buffers that don't fit into internal buffer are written by one system call
+        // (writev on Linux) without being copied
+        void WriteGather(const std::string_view* buffers, size_t count) override;
+        void Flush();
+        // Writes buffered data and closes file (standard output isn't closed)
+        void Close();
+        // Closes and deletes file (e.g. when conversion failed). Buffered data is dropped.
+        void Discard() noexcept;
+
+        // Number of bytes written so far (including buffered ones)
+        uint64_t GetSize() const noexcept
+        {
+            return mSize;
+        }
+        // True if writing to the file failed (as opposed to failures of the producer)
+        bool HasWriteError() const noexcept
+        {
+            return mHasWriteError;
+        }
+
+        static const size_t BUFFER_SIZE = 64 * 1024;
+
+        // OS-specific file (see LinuxUtil.h, WinUtil.h)
+        class CFileOutputSinkImpl;
+    private:
+        void WriteToFile(const std::string_view* buffers, size_t count);
+
+        std::unique_ptr<CFileOutputSinkImpl> mImpl;
+        std::string mBuffer;
+        uint64_t mSize;
+        bool mHasWriteError;
+    };
+
+    // Receives pages of paginated output (see CTransformOptions::mPageOutput). Pages are
+    // passed by rendering threads as soon as each of them is rendered - concurrently and
+    // in any order.
+    class CPageOutput
+    {
+    public:
+        virtual ~CPageOutput() = default;
+        // Returns URL of page (numbered from 0) that index page links to (UTF8)
+        virtual std::string GetPageLink(size_t page) const = 0;
+        // Stores complete HTML of page. Throws CException on failure.
+        virtual void WritePage(size_t page, std::string_view sHtml) = 0;
+    };
+
+    // Writes pages into files next to the index page: page N of {name}.html is written to
+    // {name}-N.html (numbered from 1). Page file is written under temporary name and
+    // renamed when it's complete - so it can be served as soon as it appears.
+    // Errors are reported by throwing CException.
+    class CFilePageOutput : public CPageOutput
+    {
+    public:
+        explicit CFilePageOutput(const std::wstring& sIndexFilePathName);
+
+        CFilePageOutput(const CFilePageOutput&) = delete;
+        CFilePageOutput& operator=(const CFilePageOutput&) = delete;
+
+        std::string GetPageLink(size_t page) const override;
+        void WritePage(size_t page, std::string_view sHtml) override;
+        // Deletes page files written so far (e.g. when conversion failed)
+        void Discard() noexcept;
+
+        std::wstring GetPageFilePathName(size_t page) const;
+        // Number of pages written so far
+        size_t GetPageCount() const noexcept;
+        // Number of bytes of pages written so far
+        uint64_t GetSize() const noexcept;
+    private:
+        // Index page file path name without extension, and its extension
+        std::wstring msPathNameStem;
+        std::wstring msExtension;
+
+        // Guards members below
+        mutable std::mutex mMutex;
+        std::vector<size_t> mWrittenPages;
+        uint64_t mSize;
+    };
+}
+#endif
@@ -0,0 +1,108 @@
+// Contains OS-independent implementation of process-wide cache of compiled XSLT style sheets.
+
+#include "StylesheetCache.h"
+#include "Util.h"
+#include "Trace.h"
+
+namespace OTInterviewExercise1
+{
+    CStylesheetCache& CStylesheetCache::Instance()
+    {
+        static CStylesheetCache cache;
+        return cache;
+    }
+
+    CStylesheetCache::CompiledStylesheetPtr CStylesheetCache::Get(
+        std::string_view sEngine,
+        std::string_view sStylesheet,
+        const CompileFunction& compile)
+    {
+        uint64_t hash = Hash(sStylesheet);
+        std::shared_ptr<CEntry> entry;
+        std::promise<CompiledStylesheetPtr> compiledPromise;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto range = mEntries.equal_range(hash);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                if (it->second->msEngine == sEngine && it->second->msStylesheet == sStylesheet)
+                {
+                    entry = it->second;
+                    break;
+                }
+            }
+            if (entry != nullptr)
+            {
+                ++mHits;
+            }
+            else
+            {
+                entry = std::make_shared<CEntry>();
+                entry->msEngine = sEngine;
+                entry->msStylesheet = sStylesheet;
+                entry->mCompiled = compiledPromise.get_future().share();
+                mEntries.emplace(hash, entry);
+                ++mMisses;
+                // This thread compiles - others will wait for the result
+                entry.reset();
+            }
+        }
+        if (entry != nullptr)
+        {
+            // Rethrows exception if compilation (by another thread) failed
+            return entry->mCompiled.get();
+        }
+
+        try
+        {
+            CTraceSpan compileSpan("compile");
+            CompiledStylesheetPtr compiled = compile(sStylesheet);
+            if (compiled == nullptr)
+            {
+                THROW_ERROR(L"Style sheet compilation returned no result");
+            }
+            compiledPromise.set_value(compiled);
+            return compiled;
+        }
+        catch (...)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                auto range = mEntries.equal_range(hash);
+                for (auto it = range.first; it != range.second; ++it)
+                {
+                    if (it->second->msEngine == sEngine && it->second->msStylesheet == sStylesheet)
+                    {
+                        mEntries.erase(it);
+                        break;
+                    }
+                }
+            }
+            compiledPromise.set_exception(std::current_exception());
+            throw;
+        }
+    }
+
+    size_t CStylesheetCache::GetSize() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mEntries.size();
+    }
+
+    void CStylesheetCache::Clear()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEntries.clear();
+    }
+
+    uint64_t CStylesheetCache::Hash(std::string_view sData) noexcept
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (char c : sData)
+        {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+}
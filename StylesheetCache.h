@@ -0,0 +1,77 @@
+// Contains declaration of OS-independent process-wide cache of compiled XSLT style
+// sheets. Engines compile a style sheet once and share the compiled (immutable) form
+// between all parser instances and threads.
+#ifndef OT_STYLESHEETCACHE_H__
+#define OT_STYLESHEETCACHE_H__
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <functional>
+#include <unordered_map>
+#include <atomic>
+#include <stdint.h>
+
+namespace OTInterviewExercise1
+{
+    // Compiled form of a style sheet. It's engine-specific and immutable: any thread
+    // can use it (e.g. to create per-conversion processor) without locking.
+    class CCompiledStylesheet
+    {
+    public:
+        virtual ~CCompiledStylesheet() = default;
+    };
+
+    class CStylesheetCache
+    {
+    public:
+        using CompiledStylesheetPtr = std::shared_ptr<const CCompiledStylesheet>;
+        // Compiles UTF8 style sheet. Throws CException on failure.
+        using CompileFunction = std::function<CompiledStylesheetPtr(std::string_view sStylesheet)>;
+
+        // Cache used by engines
+        static CStylesheetCache& Instance();
+
+        CStylesheetCache() = default;
+        CStylesheetCache(const CStylesheetCache&) = delete;
+        CStylesheetCache& operator=(const CStylesheetCache&) = delete;
+
+        // Returns compiled form of style sheet (UTF8). Style sheets are identified by
+        // engine name and content hash. compile is called on miss (outside of lock;
+        // concurrent requests for the same style sheet wait for the first compilation).
+        // Failed compilations aren't cached. Throws CException on failure.
+        CompiledStylesheetPtr Get(std::string_view sEngine, std::string_view sStylesheet,
+            const CompileFunction& compile);
+
+        uint64_t GetHits() const noexcept
+        {
+            return mHits;
+        }
+        uint64_t GetMisses() const noexcept
+        {
+            return mMisses;
+        }
+        size_t GetSize() const;
+        // Removes all style sheets (they are released when last user releases them)
+        void Clear();
+
+        // 64 bit FNV-1a hash
+        static uint64_t Hash(std::string_view sData) noexcept;
+    private:
+        struct CEntry
+        {
+            std::string msEngine;
+            // Kept to resolve hash collisions
+            std::string msStylesheet;
+            std::shared_future<CompiledStylesheetPtr> mCompiled;
+        };
+
+        mutable std::mutex mMutex;
+        std::unordered_multimap<uint64_t, std::shared_ptr<CEntry>> mEntries;
+        std::atomic<uint64_t> mHits{ 0 };
+        std::atomic<uint64_t> mMisses{ 0 };
+    };
+}
+#endif
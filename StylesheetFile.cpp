@@ -0,0 +1,125 @@
+// Contains OS-independent implementation of compiled XSLT style sheet file with reloading.
+
+#include "StylesheetFile.h"
+#include <sstream>
+
+namespace OTInterviewExercise1
+{
+    CStylesheetFile::CStylesheetFile(const wchar_t* sPathName, std::string_view sEngine,
+        CStylesheetCache::CompileFunction compile) :
+        msPathName(sPathName ? sPathName : L""),
+        msEngine(sEngine),
+        mCompile(std::move(compile)),
+        mIsReloading(false),
+        mReloadCount(0)
+    {
+        std::wstring sErrorMsg;
+        if (!GetFileVersion(msPathName.c_str(), mLoadedVersion, sErrorMsg))
+        {
+            std::wostringstream ss;
+            ss << L"Style sheet file: " << msPathName << L" couldn't be opened. " << sErrorMsg;
+            THROW_ERROR(ss.str().c_str());
+        }
+        mCompiled = Load();
+    }
+
+    CStylesheetFile::~CStylesheetFile()
+    {
+        WaitForReload();
+    }
+
+    CStylesheetCache::CompiledStylesheetPtr CStylesheetFile::Get()
+    {
+        CFileVersion version;
+        std::wstring sErrorMsg;
+        // File can be missing for a moment while it's being replaced - previous
+        // version is used then
+        bool hasVersion = GetFileVersion(msPathName.c_str(), version, sErrorMsg);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (hasVersion && version != mLoadedVersion && !mIsReloading)
+        {
+            // Previous reload thread (if any) has already finished
+            if (mReloadThread.joinable())
+                mReloadThread.join();
+            // Version is remembered even if reload fails - so broken file isn't
+            // recompiled before every use
+            mLoadedVersion = version;
+            mIsReloading = true;
+            try
+            {
+                mReloadThread = std::thread(&CStylesheetFile::Reload, this);
+            }
+            catch (const std::exception& /*ex*/)
+            {
+                mIsReloading = false;
+                LogError(__FUNCTION__, __LINE__, L"Failed to start style sheet reload thread");
+            }
+        }
+        return mCompiled;
+    }
+
+    void CStylesheetFile::WaitForReload()
+    {
+        std::thread reloadThread;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            reloadThread = std::move(mReloadThread);
+        }
+        if (reloadThread.joinable())
+            reloadThread.join();
+    }
+
+    CStylesheetCache::CompiledStylesheetPtr CStylesheetFile::Load()
+    {
+        std::wstring sErrorMsg;
+        std::string_view sStylesheet;
+        CTextFileReader reader(msPathName.c_str());
+        if (!reader.GetBytes(sStylesheet, sErrorMsg))
+        {
+            std::wostringstream ss;
+            ss << L"Error reading contents of style sheet file: " << msPathName << L" " << sErrorMsg;
+            THROW_ERROR(ss.str().c_str());
+        }
+        return CStylesheetCache::Instance().Get(msEngine, sStylesheet, mCompile);
+    }
+
+    void CStylesheetFile::Reload() noexcept
+    {
+        std::string functionName;
+        unsigned int lineNo = 0;
+        std::wstring sError;
+        try
+        {
+            CStylesheetCache::CompiledStylesheetPtr compiled = Load();
+            std::lock_guard<std::mutex> lock(mMutex);
+            mCompiled = compiled;
+            mIsReloading = false;
+            ++mReloadCount;
+            return;
+        }
+        catch (const CException& ex)
+        {
+            std::wostringstream ss;
+            ss << L"Style sheet reload failed (previous version is kept). ";
+            if (!ex.mErrorDescription.empty())
+            {
+                ss << L"System error: " << ex.mErrorDescription;
+            }
+            sError = ss.str();
+            functionName = ex.mFunctionName;
+            lineNo = ex.mLineNo;
+        }
+        catch (...)
+        {
+            sError = L"Style sheet reload failed (previous version is kept). Unknown exception caught.";
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mIsReloading = false;
+        }
+        LogError(functionName.c_str(), lineNo, sError);
+    }
+}
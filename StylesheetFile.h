@@ -0,0 +1,62 @@
+// Contains declaration of OS-independent class that keeps compiled XSLT style sheet
+// of a disk file up to date with the file.
+#ifndef OT_STYLESHEETFILE_H__
+#define OT_STYLESHEETFILE_H__
+
+#include "StylesheetCache.h"
+#include "Util.h"
+#include <string>
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+namespace OTInterviewExercise1
+{
+    // Style sheet file is compiled once (through CStylesheetCache) and reused. Before
+    // every use the file version (device, file id, modification time, size) is checked;
+    // if it changed the file is recompiled in background while callers keep getting the
+    // previous version. Conversions that already got a style sheet keep using it.
+    class CStylesheetFile
+    {
+    public:
+        // Reads and compiles style sheet synchronously. Throws CException on failure.
+        CStylesheetFile(const wchar_t* sPathName, std::string_view sEngine,
+            CStylesheetCache::CompileFunction compile);
+        // Waits for background recompilation (if any)
+        ~CStylesheetFile();
+
+        CStylesheetFile(const CStylesheetFile&) = delete;
+        CStylesheetFile& operator=(const CStylesheetFile&) = delete;
+
+        // Returns current compiled style sheet. Starts background recompilation if file
+        // changed since it was loaded last time.
+        CStylesheetCache::CompiledStylesheetPtr Get();
+        // Waits until background recompilation (if any) is finished
+        void WaitForReload();
+        // Number of successful recompilations (initial compilation isn't counted)
+        uint64_t GetReloadCount() const noexcept
+        {
+            return mReloadCount;
+        }
+    private:
+        // Reads and compiles the file. Throws CException on failure.
+        CStylesheetCache::CompiledStylesheetPtr Load();
+        // Background thread
+        void Reload() noexcept;
+
+        std::wstring msPathName;
+        std::string msEngine;
+        CStylesheetCache::CompileFunction mCompile;
+
+        // Guards members below
+        std::mutex mMutex;
+        CStylesheetCache::CompiledStylesheetPtr mCompiled;
+        // Version of file that was loaded (or failed to load) last time
+        CFileVersion mLoadedVersion;
+        std::thread mReloadThread;
+        bool mIsReloading;
+
+        std::atomic<uint64_t> mReloadCount;
+    };
+}
+#endif
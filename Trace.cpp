@@ -0,0 +1,201 @@
+// Contains OS-independent implementation of tracing of conversion internals.
+
+#include "Trace.h"
+#include "OutputSink.h"
+#include "Util.h"
+#include <sstream>
+#include <iomanip>
+#include <wchar.h>
+
+namespace OTInterviewExercise1
+{
+    namespace
+    {
+        void AppendJsonString(std::ostringstream& ss, std::string_view sText)
+        {
+            ss << '"';
+            for (char c : sText)
+            {
+                switch (c)
+                {
+                case '"':
+                    ss << "\\\"";
+                    break;
+                case '\\':
+                    ss << "\\\\";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20)
+                    {
+                        ss << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                            << static_cast<unsigned int>(static_cast<unsigned char>(c)) << std::dec;
+                    }
+                    else
+                    {
+                        ss << c;
+                    }
+                }
+            }
+            ss << '"';
+        }
+    }
+
+    CTracer& CTracer::Instance() noexcept
+    {
+        static CTracer Tracer;
+        return Tracer;
+    }
+
+    CTracer::CTracer() :
+        mIsEnabled(false),
+        mStartTime(std::chrono::steady_clock::now())
+    {}
+
+    CTracer::CThreadBuffer& CTracer::GetThreadBuffer()
+    {
+        thread_local CThreadBuffer* Buffer = nullptr;
+        if (Buffer == nullptr)
+        {
+            auto buffer = std::make_shared<CThreadBuffer>();
+            buffer->mDroppedCount = 0;
+            std::lock_guard<std::mutex> lock(mMutex);
+            buffer->mThreadId = static_cast<unsigned int>(mBuffers.size()) + 1;
+            mBuffers.push_back(buffer);
+            Buffer = buffer.get();
+        }
+        return *Buffer;
+    }
+
+    void CTracer::AddSpan(const char* name, const char* category, std::chrono::steady_clock::time_point startTime,
+        std::chrono::steady_clock::time_point endTime, std::string_view sDetail) noexcept
+    {
+        try
+        {
+            CThreadBuffer& buffer = GetThreadBuffer();
+            std::lock_guard<std::mutex> lock(buffer.mMutex);
+            if (buffer.mEvents.size() >= MAX_EVENTS_PER_THREAD)
+            {
+                buffer.mDroppedCount++;
+                return;
+            }
+            uint64_t start = std::chrono::duration_cast<std::chrono::nanoseconds>(startTime - mStartTime).count();
+            uint64_t duration = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
+            buffer.mEvents.push_back(CEvent{ name, category, start, duration, std::string(sDetail) });
+        }
+        catch (...)
+        {
+            // Span is lost - tracing mustn't fail conversion
+        }
+    }
+
+    std::string CTracer::ToJson() const
+    {
+        std::vector<std::shared_ptr<CThreadBuffer>> buffers;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            buffers = mBuffers;
+        }
+        // Timestamps and durations are in microseconds
+        std::ostringstream ss;
+        ss << std::fixed << std::setprecision(3);
+        ss << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool isFirst = true;
+        for (const auto& buffer : buffers)
+        {
+            std::lock_guard<std::mutex> lock(buffer->mMutex);
+            if (buffer->mEvents.empty())
+                continue;
+            ss << (isFirst ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+                << buffer->mThreadId << ",\"args\":{\"name\":\"thread " << buffer->mThreadId << "\"}}";
+            isFirst = false;
+            for (const CEvent& event : buffer->mEvents)
+            {
+                ss << ",\n{\"name\":";
+                AppendJsonString(ss, event.mName);
+                ss << ",\"cat\":";
+                AppendJsonString(ss, event.mCategory);
+                ss << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->mThreadId
+                    << ",\"ts\":" << event.mStart / 1000.0 << ",\"dur\":" << event.mDuration / 1000.0;
+                if (!event.mDetail.empty())
+                {
+                    ss << ",\"args\":{\"detail\":";
+                    AppendJsonString(ss, event.mDetail);
+                    ss << "}";
+                }
+                ss << "}";
+            }
+        }
+        ss << "\n]}\n";
+        return ss.str();
+    }
+
+    bool CTracer::WriteJson(const wchar_t* sFilePathName, std::wstring& o_sErrorMsg) const noexcept
+    {
+        try
+        {
+            o_sErrorMsg.clear();
+            std::string sJson = ToJson();
+            CFileOutputSink file(sFilePathName);
+            file.Write(sJson.data(), sJson.size());
+            file.Close();
+            return true;
+        }
+        catch (const CException& ex)
+        {
+            o_sErrorMsg = ex.mErrorDescription;
+        }
+        catch (...)
+        {
+            o_sErrorMsg = L"Memory allocation error.";
+        }
+        return false;
+    }
+
+    void CTracer::Clear() noexcept
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const auto& buffer : mBuffers)
+        {
+            std::lock_guard<std::mutex> bufferLock(buffer->mMutex);
+            buffer->mEvents.clear();
+            buffer->mDroppedCount = 0;
+        }
+    }
+
+    uint64_t CTracer::GetDroppedCount() const noexcept
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        uint64_t droppedCount = 0;
+        for (const auto& buffer : mBuffers)
+        {
+            std::lock_guard<std::mutex> bufferLock(buffer->mMutex);
+            droppedCount += buffer->mDroppedCount;
+        }
+        return droppedCount;
+    }
+
+    void CTraceSpan::SetDetail(std::string_view sDetail) noexcept
+    {
+        if (!mIsEnabled)
+            return;
+        try
+        {
+            msDetail = sDetail;
+        }
+        catch (...)
+        {}
+    }
+
+    void CTraceSpan::SetDetail(const wchar_t* sDetail) noexcept
+    {
+        if (!mIsEnabled || sDetail == nullptr)
+            return;
+        try
+        {
+            if (!WideToUtf8(sDetail, wcslen(sDetail), msDetail))
+                msDetail.clear();
+        }
+        catch (...)
+        {}
+    }
+}
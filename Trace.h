@@ -0,0 +1,127 @@
+// Contains declaration of OS-independent tracing of conversion internals: spans are
+// recorded into per-thread buffers and written in Chrome trace-event JSON format (it's
+// opened by chrome://tracing and Perfetto UI), so that timeline of one conversion can be
+// seen across worker threads.
+#ifndef OT_TRACE_H__
+#define OT_TRACE_H__
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
+namespace OTInterviewExercise1
+{
+    // Process-wide collector of spans. Tracing is disabled by default - spans then only
+    // check a flag.
+    class CTracer
+    {
+    public:
+        static CTracer& Instance() noexcept;
+
+        CTracer(const CTracer&) = delete;
+        CTracer& operator=(const CTracer&) = delete;
+
+        // Spans are recorded while tracing is enabled (recorded ones are kept when it's disabled)
+        void Enable(bool isEnabled) noexcept
+        {
+            mIsEnabled.store(isEnabled, std::memory_order_relaxed);
+        }
+        bool IsEnabled() const noexcept
+        {
+            return mIsEnabled.load(std::memory_order_relaxed);
+        }
+        // Appends complete event to the buffer of the calling thread. Name and category
+        // must be string literals (only pointers are kept).
+        void AddSpan(const char* name, const char* category, std::chrono::steady_clock::time_point startTime,
+            std::chrono::steady_clock::time_point endTime, std::string_view sDetail) noexcept;
+        // Chrome trace-event JSON of events recorded so far by all threads
+        std::string ToJson() const;
+        // Writes ToJson() to file. Returns false if the file couldn't be written
+        // (o_sErrorMsg contains error message).
+        bool WriteJson(const wchar_t* sFilePathName, std::wstring& o_sErrorMsg) const noexcept;
+        // Drops recorded events
+        void Clear() noexcept;
+        // Number of events that didn't fit into buffers of threads
+        uint64_t GetDroppedCount() const noexcept;
+
+        // Events kept per thread (the rest are dropped and counted)
+        static constexpr size_t MAX_EVENTS_PER_THREAD = 1024 * 1024;
+    private:
+        struct CEvent
+        {
+            const char* mName;
+            const char* mCategory;
+            // Nanoseconds since tracer was created
+            uint64_t mStart;
+            uint64_t mDuration;
+            std::string mDetail;
+        };
+        // Events of one thread. Its mutex is taken by other threads only when events are
+        // written or cleared - so it's uncontended while conversions run.
+        struct CThreadBuffer
+        {
+            unsigned int mThreadId;
+            mutable std::mutex mMutex;
+            std::vector<CEvent> mEvents;
+            uint64_t mDroppedCount;
+        };
+
+        CTracer();
+        // Buffer of the calling thread (it's registered by the first span of the thread)
+        CThreadBuffer& GetThreadBuffer();
+
+        std::atomic<bool> mIsEnabled;
+        std::chrono::steady_clock::time_point mStartTime;
+        // Buffers outlive their threads (events of finished workers are written, too)
+        mutable std::mutex mMutex;
+        std::vector<std::shared_ptr<CThreadBuffer>> mBuffers;
+    };
+
+    // Records span of its scope (in the spirit of CRAIICleanup) if tracing is enabled.
+    // Name and category must be string literals.
+    class CTraceSpan
+    {
+    public:
+        explicit CTraceSpan(const char* name, const char* category = "conversion") noexcept :
+            mName(name),
+            mCategory(category),
+            mIsEnabled(CTracer::Instance().IsEnabled())
+        {
+            if (mIsEnabled)
+                mStartTime = std::chrono::steady_clock::now();
+        }
+        ~CTraceSpan()
+        {
+            Stop();
+        }
+
+        CTraceSpan(const CTraceSpan&) = delete;
+        CTraceSpan& operator=(const CTraceSpan&) = delete;
+
+        // Detail (e.g. path name of file) is shown in arguments of the span. It's copied
+        // only if tracing is enabled.
+        void SetDetail(std::string_view sDetail) noexcept;
+        void SetDetail(const wchar_t* sDetail) noexcept;
+        // Ends the span before the end of the scope
+        void Stop() noexcept
+        {
+            if (mIsEnabled)
+            {
+                CTracer::Instance().AddSpan(mName, mCategory, mStartTime, std::chrono::steady_clock::now(), msDetail);
+                mIsEnabled = false;
+            }
+        }
+    private:
+        const char* mName;
+        const char* mCategory;
+        bool mIsEnabled;
+        std::chrono::steady_clock::time_point mStartTime;
+        std::string msDetail;
+    };
+}
+#endif
@@ -0,0 +1,475 @@
+// Contains implementation of OS-independent UTF8 validation/transcoding functions.
+
+#include "Utf8Transcoder.h"
+#include <string.h>
+#include <stdint.h>
+#include <type_traits>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define OT_X86_KERNELS 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC allows intrinsics of any instruction set without compiler flags
+#define OT_TARGET_AVX2
+#else
+#define OT_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace OTInterviewExercise1
+{
+    namespace
+    {
+        // Output "character" type of kernels that only validate input
+        struct CNoOutput
+        {};
+
+        // Decodes sequence that starts with non-ASCII byte. Returns length of the
+        // sequence or 0 if it's invalid.
+        inline size_t DecodeMultiByte(const unsigned char* p, const unsigned char* end, char32_t& o_codePoint) noexcept
+        {
+            unsigned int c = p[0];
+            size_t available = static_cast<size_t>(end - p);
+            if (c >= 0xC2 && c <= 0xDF)
+            {
+                if (available < 2 || (p[1] & 0xC0) != 0x80)
+                    return 0;
+                o_codePoint = ((c & 0x1F) << 6) | (p[1] & 0x3F);
+                return 2;
+            }
+            if (c >= 0xE0 && c <= 0xEF)
+            {
+                // Ranges of 2nd byte exclude overlong forms (E0) and surrogates (ED)
+                unsigned int low = (c == 0xE0) ? 0xA0 : 0x80;
+                unsigned int high = (c == 0xED) ? 0x9F : 0xBF;
+                if (available < 3 || p[1] < low || p[1] > high || (p[2] & 0xC0) != 0x80)
+                    return 0;
+                o_codePoint = ((c & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+                return 3;
+            }
+            if (c >= 0xF0 && c <= 0xF4)
+            {
+                // Ranges of 2nd byte exclude overlong forms (F0) and values above U+10FFFF (F4)
+                unsigned int low = (c == 0xF0) ? 0x90 : 0x80;
+                unsigned int high = (c == 0xF4) ? 0x8F : 0xBF;
+                if (available < 4 || p[1] < low || p[1] > high ||
+                    (p[2] & 0xC0) != 0x80 || (p[3] & 0xC0) != 0x80)
+                    return 0;
+                o_codePoint = ((c & 0x07) << 18) | ((p[1] & 0x3F) << 12) | ((p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+                return 4;
+            }
+            return 0;
+        }
+
+        template<typename CharT> inline CharT* PutCodePoint(char32_t codePoint, CharT* out) noexcept
+        {
+            if constexpr (std::is_same_v<CharT, CNoOutput>)
+            {
+                return out;
+            }
+            else
+            {
+                if constexpr (sizeof(CharT) == 2)
+                {
+                    if (codePoint >= 0x10000)
+                    {
+                        codePoint -= 0x10000;
+                        *out++ = static_cast<CharT>(0xD800 + (codePoint >> 10));
+                        *out++ = static_cast<CharT>(0xDC00 + (codePoint & 0x3FF));
+                        return out;
+                    }
+                }
+                *out++ = static_cast<CharT>(codePoint);
+                return out;
+            }
+        }
+
+        template<typename CharT> inline CharT* Advance(CharT* out, size_t count) noexcept
+        {
+            if constexpr (std::is_same_v<CharT, CNoOutput>)
+                return out;
+            else
+                return out + count;
+        }
+
+        // Decodes non-ASCII sequences starting at p until next ASCII byte.
+        template<typename CharT> inline bool DecodeNonAsciiRun(const unsigned char*& p, const unsigned char* end,
+            CharT*& out) noexcept
+        {
+            do
+            {
+                char32_t codePoint = 0;
+                size_t len = DecodeMultiByte(p, end, codePoint);
+                if (len == 0)
+                    return false;
+                p += len;
+                out = PutCodePoint(codePoint, out);
+            } while (p < end && *p >= 0x80);
+            return true;
+        }
+
+        // Output buffer of every kernel must hold at least `size` characters: each
+        // input byte produces at most one UTF16/UTF32 character. SIMD kernels rely on
+        // that to store whole blocks before checking them.
+        template<typename CharT> bool DecodeScalar(const unsigned char* in, size_t size, CharT* out,
+            size_t& o_numWritten, size_t& o_errorOffset) noexcept
+        {
+            const unsigned char* p = in;
+            const unsigned char* end = in + size;
+            CharT* o = out;
+            while (p < end)
+            {
+                // ASCII fast path - 8 bytes at a time
+                uint64_t block = 0;
+                if (end - p >= 8 && (memcpy(&block, p, 8), (block & 0x8080808080808080ull) == 0))
+                {
+                    if constexpr (!std::is_same_v<CharT, CNoOutput>)
+                    {
+                        for (int i = 0; i < 8; ++i)
+                            o[i] = static_cast<CharT>(p[i]);
+                    }
+                    p += 8;
+                    o = Advance(o, 8);
+                    continue;
+                }
+                if (*p < 0x80)
+                {
+                    o = PutCodePoint(*p, o);
+                    ++p;
+                    continue;
+                }
+                if (!DecodeNonAsciiRun(p, end, o))
+                {
+                    o_errorOffset = static_cast<size_t>(p - in);
+                    return false;
+                }
+            }
+            if constexpr (!std::is_same_v<CharT, CNoOutput>)
+                o_numWritten = static_cast<size_t>(o - out);
+            return true;
+        }
+
+        // Finishes decoding with scalar kernel after SIMD kernel processed [in, p)
+        template<typename CharT> bool DecodeTail(const unsigned char* in, const unsigned char* p, size_t size,
+            CharT* out, CharT* o, size_t& o_numWritten, size_t& o_errorOffset) noexcept
+        {
+            size_t numWritten = 0;
+            size_t errorOffset = 0;
+            size_t processed = static_cast<size_t>(p - in);
+            if (!DecodeScalar(p, size - processed, o, numWritten, errorOffset))
+            {
+                o_errorOffset = processed + errorOffset;
+                return false;
+            }
+            if constexpr (!std::is_same_v<CharT, CNoOutput>)
+                o_numWritten = static_cast<size_t>(o - out) + numWritten;
+            return true;
+        }
+
+#ifdef OT_X86_KERNELS
+        inline unsigned int CountTrailingZeros(unsigned int mask) noexcept
+        {
+#ifdef _MSC_VER
+            unsigned long index = 0;
+            _BitScanForward(&index, mask);
+            return static_cast<unsigned int>(index);
+#else
+            return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+        }
+
+        template<typename CharT> bool DecodeSse2(const unsigned char* in, size_t size, CharT* out,
+            size_t& o_numWritten, size_t& o_errorOffset) noexcept
+        {
+            const unsigned char* p = in;
+            const unsigned char* end = in + size;
+            CharT* o = out;
+            const __m128i zero = _mm_setzero_si128();
+            while (end - p >= 16)
+            {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(block));
+                // Widen the whole block - ASCII prefix of it will be kept
+                if constexpr (!std::is_same_v<CharT, CNoOutput>)
+                {
+                    __m128i low16 = _mm_unpacklo_epi8(block, zero);
+                    __m128i high16 = _mm_unpackhi_epi8(block, zero);
+                    if constexpr (sizeof(CharT) == 2)
+                    {
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(o), low16);
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(o + 8), high16);
+                    }
+                    else
+                    {
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(o), _mm_unpacklo_epi16(low16, zero));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(o + 4), _mm_unpackhi_epi16(low16, zero));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(o + 8), _mm_unpacklo_epi16(high16, zero));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(o + 12), _mm_unpackhi_epi16(high16, zero));
+                    }
+                }
+                if (mask == 0)
+                {
+                    p += 16;
+                    o = Advance(o, 16);
+                    continue;
+                }
+                unsigned int numAscii = CountTrailingZeros(mask);
+                p += numAscii;
+                o = Advance(o, numAscii);
+                if (!DecodeNonAsciiRun(p, end, o))
+                {
+                    o_errorOffset = static_cast<size_t>(p - in);
+                    return false;
+                }
+            }
+            return DecodeTail(in, p, size, out, o, o_numWritten, o_errorOffset);
+        }
+
+        template<typename CharT> OT_TARGET_AVX2 bool DecodeAvx2(const unsigned char* in, size_t size, CharT* out,
+            size_t& o_numWritten, size_t& o_errorOffset) noexcept
+        {
+            const unsigned char* p = in;
+            const unsigned char* end = in + size;
+            CharT* o = out;
+            while (end - p >= 32)
+            {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(block));
+                // Widen the whole block - ASCII prefix of it will be kept
+                if constexpr (!std::is_same_v<CharT, CNoOutput>)
+                {
+                    if constexpr (sizeof(CharT) == 2)
+                    {
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(o),
+                            _mm256_cvtepu8_epi16(_mm256_castsi256_si128(block)));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(o + 16),
+                            _mm256_cvtepu8_epi16(_mm256_extracti128_si256(block, 1)));
+                    }
+                    else
+                    {
+                        for (int i = 0; i < 4; ++i)
+                        {
+                            __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + i * 8));
+                            _mm256_storeu_si256(reinterpret_cast<__m256i*>(o + i * 8), _mm256_cvtepu8_epi32(bytes));
+                        }
+                    }
+                }
+                if (mask == 0)
+                {
+                    p += 32;
+                    o = Advance(o, 32);
+                    continue;
+                }
+                unsigned int numAscii = CountTrailingZeros(mask);
+                p += numAscii;
+                o = Advance(o, numAscii);
+                if (!DecodeNonAsciiRun(p, end, o))
+                {
+                    o_errorOffset = static_cast<size_t>(p - in);
+                    return false;
+                }
+            }
+            return DecodeTail(in, p, size, out, o, o_numWritten, o_errorOffset);
+        }
+
+        bool CpuSupportsAvx2() noexcept
+        {
+#ifdef _MSC_VER
+            int regs[4] = { 0 };
+            __cpuid(regs, 0);
+            if (regs[0] < 7)
+                return false;
+            // OS must save YMM registers (OSXSAVE + XCR0 bits 1,2)
+            __cpuid(regs, 1);
+            if ((regs[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6)
+                return false;
+            __cpuidex(regs, 7, 0);
+            return (regs[1] & (1 << 5)) != 0;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") != 0;
+#endif
+        }
+#endif
+
+        CUtf8Transcoder::EMKernel DetectBestKernel() noexcept
+        {
+#ifdef OT_X86_KERNELS
+            // SSE2 is part of every x86 CPU we support
+            return CpuSupportsAvx2() ? CUtf8Transcoder::EMKernel::AVX2 : CUtf8Transcoder::EMKernel::SSE2;
+#else
+            return CUtf8Transcoder::EMKernel::Scalar;
+#endif
+        }
+
+        CUtf8Transcoder::EMKernel ResolveKernel(CUtf8Transcoder::EMKernel kernel) noexcept
+        {
+            if (kernel == CUtf8Transcoder::EMKernel::Auto || !CUtf8Transcoder::IsKernelSupported(kernel))
+                return CUtf8Transcoder::GetBestKernel();
+            return kernel;
+        }
+
+        template<typename CharT> bool RunKernel(CUtf8Transcoder::EMKernel kernel, const unsigned char* in,
+            size_t size, CharT* out, size_t& o_numWritten, size_t& o_errorOffset) noexcept
+        {
+            switch (ResolveKernel(kernel))
+            {
+#ifdef OT_X86_KERNELS
+            case CUtf8Transcoder::EMKernel::AVX2:
+                return DecodeAvx2(in, size, out, o_numWritten, o_errorOffset);
+            case CUtf8Transcoder::EMKernel::SSE2:
+                return DecodeSse2(in, size, out, o_numWritten, o_errorOffset);
+#endif
+            default:
+                return DecodeScalar(in, size, out, o_numWritten, o_errorOffset);
+            }
+        }
+
+        template<typename StringT> bool Decode(std::string_view sUtf8, StringT& o_sOut, size_t* o_errorOffset,
+            CUtf8Transcoder::EMKernel kernel)
+        {
+            o_sOut.resize(sUtf8.size());
+            size_t numWritten = 0;
+            size_t errorOffset = 0;
+            if (!RunKernel(kernel, reinterpret_cast<const unsigned char*>(sUtf8.data()), sUtf8.size(),
+                &o_sOut[0], numWritten, errorOffset))
+            {
+                o_sOut.clear();
+                if (o_errorOffset != nullptr)
+                    *o_errorOffset = errorOffset;
+                return false;
+            }
+            o_sOut.resize(numWritten);
+            return true;
+        }
+    }
+
+    CUtf8Transcoder::EMKernel CUtf8Transcoder::GetBestKernel() noexcept
+    {
+        static const EMKernel bestKernel = DetectBestKernel();
+        return bestKernel;
+    }
+
+    bool CUtf8Transcoder::IsKernelSupported(EMKernel kernel) noexcept
+    {
+        switch (kernel)
+        {
+        case EMKernel::Auto:
+        case EMKernel::Scalar:
+            return true;
+        case EMKernel::SSE2:
+            return GetBestKernel() == EMKernel::SSE2 || GetBestKernel() == EMKernel::AVX2;
+        case EMKernel::AVX2:
+            return GetBestKernel() == EMKernel::AVX2;
+        }
+        return false;
+    }
+
+    bool CUtf8Transcoder::Validate(std::string_view sUtf8, size_t* o_errorOffset, EMKernel kernel) noexcept
+    {
+        size_t numWritten = 0;
+        size_t errorOffset = 0;
+        CNoOutput* noOutput = nullptr;
+        if (!RunKernel(kernel, reinterpret_cast<const unsigned char*>(sUtf8.data()), sUtf8.size(),
+            noOutput, numWritten, errorOffset))
+        {
+            if (o_errorOffset != nullptr)
+                *o_errorOffset = errorOffset;
+            return false;
+        }
+        return true;
+    }
+
+    bool CUtf8Transcoder::ToUtf16(std::string_view sUtf8, std::u16string& o_sUtf16, size_t* o_errorOffset,
+        EMKernel kernel)
+    {
+        return Decode(sUtf8, o_sUtf16, o_errorOffset, kernel);
+    }
+
+    bool CUtf8Transcoder::ToUtf32(std::string_view sUtf8, std::u32string& o_sUtf32, size_t* o_errorOffset,
+        EMKernel kernel)
+    {
+        return Decode(sUtf8, o_sUtf32, o_errorOffset, kernel);
+    }
+
+    bool CUtf8Transcoder::ToWide(std::string_view sUtf8, std::wstring& o_sWide, size_t* o_errorOffset,
+        EMKernel kernel)
+    {
+        return Decode(sUtf8, o_sWide, o_errorOffset, kernel);
+    }
+
+    namespace
+    {
+        // Length of sequence that starts with lead byte (1 for bytes that can't start
+        // a multi-byte sequence - they're reported by Validate())
+        size_t SequenceLength(unsigned char leadByte) noexcept
+        {
+            if (leadByte >= 0xC0 && leadByte <= 0xDF)
+                return 2;
+            if (leadByte >= 0xE0 && leadByte <= 0xEF)
+                return 3;
+            if (leadByte >= 0xF0 && leadByte <= 0xF7)
+                return 4;
+            return 1;
+        }
+    }
+
+    bool CUtf8StreamValidator::Validate(std::string_view sChunk, uint64_t* o_errorOffset) noexcept
+    {
+        size_t errorOffset = 0;
+        uint64_t chunkOffset = mOffset;
+        mOffset += sChunk.size();
+        if (mPendingSize != 0)
+        {
+            // Sequence is completed with bytes of this chunk and validated separately
+            uint64_t pendingOffset = chunkOffset - mPendingSize;
+            size_t sequenceLength = SequenceLength(static_cast<unsigned char>(mPending[0]));
+            size_t numTaken = std::min(sequenceLength - mPendingSize, sChunk.size());
+            memcpy(mPending + mPendingSize, sChunk.data(), numTaken);
+            mPendingSize += numTaken;
+            sChunk.remove_prefix(numTaken);
+            chunkOffset += numTaken;
+            if (mPendingSize < sequenceLength)
+                return true;
+            mPendingSize = 0;
+            if (!CUtf8Transcoder::Validate(std::string_view(mPending, sequenceLength), &errorOffset))
+            {
+                if (o_errorOffset != nullptr)
+                    *o_errorOffset = pendingOffset + errorOffset;
+                return false;
+            }
+        }
+        // Incomplete sequence at the end is kept until the next chunk
+        size_t tailSize = 0;
+        for (size_t i = 1; i <= std::min<size_t>(3, sChunk.size()); ++i)
+        {
+            unsigned char c = static_cast<unsigned char>(sChunk[sChunk.size() - i]);
+            if ((c & 0xC0) != 0x80)
+            {
+                if (SequenceLength(c) > i)
+                    tailSize = i;
+                break;
+            }
+        }
+        if (!CUtf8Transcoder::Validate(sChunk.substr(0, sChunk.size() - tailSize), &errorOffset))
+        {
+            if (o_errorOffset != nullptr)
+                *o_errorOffset = chunkOffset + errorOffset;
+            return false;
+        }
+        memcpy(mPending, sChunk.data() + sChunk.size() - tailSize, tailSize);
+        mPendingSize = tailSize;
+        return true;
+    }
+
+    bool CUtf8StreamValidator::Finish(uint64_t* o_errorOffset) const noexcept
+    {
+        if (mPendingSize == 0)
+            return true;
+        if (o_errorOffset != nullptr)
+            *o_errorOffset = mOffset - mPendingSize;
+        return false;
+    }
+}
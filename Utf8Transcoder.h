@@ -0,0 +1,68 @@
+// Contains declaration of OS-independent UTF8 validation/transcoding functions.
+// Unlike mbstowcs_s they don't depend on the current locale.
+#ifndef OT_UTF8TRANSCODER_H__
+#define OT_UTF8TRANSCODER_H__
+
+#include <string>
+#include <string_view>
+#include <stdint.h>
+
+namespace OTInterviewExercise1
+{
+    // Validates and decodes UTF8 (strictly: overlong forms, surrogates and code points
+    // above U+10FFFF are rejected). Runs of ASCII characters are processed 16 (SSE2) or
+    // 32 (AVX2) bytes at a time; kernel is chosen at runtime according to CPU features.
+    class CUtf8Transcoder
+    {
+    public:
+        enum class EMKernel
+        {
+            Auto, // Best kernel supported by the CPU
+            Scalar,
+            SSE2,
+            AVX2
+        };
+
+        // Returns kernel that's used for EMKernel::Auto
+        static EMKernel GetBestKernel() noexcept;
+        static bool IsKernelSupported(EMKernel kernel) noexcept;
+
+        // All functions return false if input isn't valid UTF8. In that case
+        // o_errorOffset (if not null) receives byte offset of the first invalid
+        // sequence and output string is cleared. Unsupported kernel is replaced by
+        // the best supported one.
+        static bool Validate(std::string_view sUtf8, size_t* o_errorOffset = nullptr,
+            EMKernel kernel = EMKernel::Auto) noexcept;
+        static bool ToUtf16(std::string_view sUtf8, std::u16string& o_sUtf16, size_t* o_errorOffset = nullptr,
+            EMKernel kernel = EMKernel::Auto);
+        static bool ToUtf32(std::string_view sUtf8, std::u32string& o_sUtf32, size_t* o_errorOffset = nullptr,
+            EMKernel kernel = EMKernel::Auto);
+        // Produces UTF16 on Windows, UTF32 elsewhere
+        static bool ToWide(std::string_view sUtf8, std::wstring& o_sWide, size_t* o_errorOffset = nullptr,
+            EMKernel kernel = EMKernel::Auto);
+    };
+
+    // Validates UTF8 text that arrives in chunks: sequence split between chunks is
+    // completed when the next chunk arrives.
+    class CUtf8StreamValidator
+    {
+    public:
+        CUtf8StreamValidator() noexcept :
+            mOffset(0),
+            mPendingSize(0),
+            mPending()
+        {}
+        // Returns false if text isn't valid UTF8. o_errorOffset (if not null) receives
+        // offset of the first invalid sequence from beginning of the text.
+        bool Validate(std::string_view sChunk, uint64_t* o_errorOffset = nullptr) noexcept;
+        // Must be called after the last chunk: returns false if text ends inside a sequence
+        bool Finish(uint64_t* o_errorOffset = nullptr) const noexcept;
+    private:
+        // Offset of the next chunk in the text
+        uint64_t mOffset;
+        // Beginning of sequence that's split between chunks
+        size_t mPendingSize;
+        char mPending[4];
+    };
+}
+#endif
@@ -1,14 +1,17 @@
 // Contains implementations of OS-independent classes, functions.
 #include "Util.h"
+#include "Utf8Transcoder.h"
+#include "LogQueue.h"
 #ifdef _WIN32
 #include "win/WinUtil.h"
 #else
-// todo: add support for other oses: Mac, Linux, etc.
+#include "linux/LinuxUtil.h"
 #endif
 #include <assert.h>
 #include <sstream>
 #include <functional>
 #include <algorithm>
+#include <string.h>
 
 namespace OTInterviewExercise1
 {
@@ -22,9 +25,19 @@ namespace OTInterviewExercise1
         return mImpl->IsOk(o_errorMsg);
     }
 
-    CTextFileReader::CTextFileReader(const wchar_t* filePathName) noexcept
+    CTerminationSignal::CTerminationSignal() noexcept :
+        mImpl(std::make_unique<CTerminationSignalImpl>())
+    {}
+    CTerminationSignal::~CTerminationSignal()
+    {}
+    bool CTerminationSignal::Wait(std::wstring& o_sErrorMsg) noexcept
+    {
+        return mImpl->Wait(o_sErrorMsg);
+    }
+
+    CTextFileReader::CTextFileReader(const wchar_t* filePathName, ReadMode readMode) noexcept
     {
-        mImpl = std::make_unique<CTextFileReaderImpl>(filePathName);
+        mImpl = std::make_unique<CTextFileReaderImpl>(filePathName, readMode);
     }
 
     CTextFileReader::~CTextFileReader() noexcept
@@ -51,21 +64,17 @@ namespace OTInterviewExercise1
         {
             o_fileData.clear();
             o_sErrorMsg.clear();
-            std::vector<BYTE> contents;
-            if (mImpl->GetContents(contents) && !contents.empty())
+            std::string_view contents;
+            if (mImpl->GetBytes(contents) && !contents.empty())
             {
-                std::vector<wchar_t> buf(contents.size() + 1, 0);
-                size_t numConverted = 0;
-
-                mbstowcs_s(&numConverted, buf.data(), buf.size(),
-                    reinterpret_cast<char*>(contents.data()), contents.size());
-                assert(numConverted);
-                if (numConverted != contents.size() + 1)
-                {
-                    THROW_ERROR(L"Failed to convert UTF8 string to wchar_t");
-                }
-                o_fileData.assign(buf.data(), wcslen(buf.data()));
-                return true;
+                size_t errorOffset = 0;
+                if (CUtf8Transcoder::ToWide(contents, o_fileData, &errorOffset))
+                    return true;
+                o_fileData.clear();
+                o_sErrorMsg = L"Failed to convert UTF8 string to wchar_t. Invalid UTF8 sequence at offset " +
+                    std::to_wstring(errorOffset);
+                LogError(__FUNCTION__, __LINE__, o_sErrorMsg);
+                return false;
             }
             else
             {
@@ -73,118 +82,456 @@ namespace OTInterviewExercise1
             }
             return false;
         }
-        catch (const CException& ex)
+        catch (const std::bad_alloc& /*ex*/)
         {
-            std::wostringstream ss;
-            ss << L"Exception caught. ";
-            if (!ex.mErrorDescription.empty())
-            {
-                ss << L"System error: " << ex.mErrorDescription;
-            }
-            o_sErrorMsg = ss.str();
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+            o_sErrorMsg = L"Memory allocation error";
             o_fileData.clear();
+        }
+        LogError(functionName.c_str(), lineNo, o_sErrorMsg);
+        return false;
+    }
+
+    bool CTextFileReader::GetBytes(std::string_view& o_fileData, std::wstring& o_sErrorMsg) const noexcept
+    {
+        o_sErrorMsg.clear();
+        if (mImpl->GetBytes(o_fileData))
+            return true;
+        o_fileData = std::string_view();
+        mImpl->GetStatus(o_sErrorMsg);
+        return false;
+    }
+
+    CChunkedFileReader::CChunkedFileReader(const wchar_t* filePathName, size_t chunkSize, unsigned int chunkCount) noexcept
+    {
+        mImpl = std::make_unique<CChunkedFileReaderImpl>(filePathName, chunkSize, chunkCount);
+    }
+
+    CChunkedFileReader::~CChunkedFileReader() noexcept
+    {}
+
+    bool CChunkedFileReader::Exists(std::wstring& o_sErrorMsg) const noexcept
+    {
+        return mImpl->Exists(o_sErrorMsg);
+    }
+
+    bool CChunkedFileReader::NextChunk(std::string_view& o_chunk, std::wstring& o_sErrorMsg) noexcept
+    {
+        std::string functionName;
+        unsigned int lineNo = 0;
+        o_chunk = std::string_view();
+        try
+        {
+            o_sErrorMsg.clear();
+            mImpl->NextChunk(o_chunk);
+            return true;
+        }
+        catch (const CException& ex)
+        {
+            o_sErrorMsg = ex.mErrorDescription;
             functionName = ex.mFunctionName;
             lineNo = ex.mLineNo;
         }
-        catch (const std::bad_alloc& /*ex*/)
+        catch (...)
         {
+            o_sErrorMsg = L"Memory allocation error.";
             functionName = __FUNCTION__;
             lineNo = __LINE__;
-            o_sErrorMsg = L"Memory allocation error";
-            o_fileData.clear();
         }
+        o_chunk = std::string_view();
         LogError(functionName.c_str(), lineNo, o_sErrorMsg);
         return false;
     }
 
+    bool CChunkedFileReader::IsQueued() const noexcept
+    {
+        return mImpl->IsQueued();
+    }
+
+    bool Utf8ToWide(const char* data, size_t size, std::wstring& o_sWide)
+    {
+        return CUtf8Transcoder::ToWide(std::string_view(data, size), o_sWide);
+    }
+
+    bool WideToUtf8(const wchar_t* data, size_t size, std::string& o_sUtf8)
+    {
+        o_sUtf8.clear();
+        o_sUtf8.reserve(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            unsigned int c = static_cast<unsigned int>(data[i]);
+            if (sizeof(wchar_t) == 2)
+            {
+                c &= 0xFFFF;
+                if (c >= 0xD800 && c <= 0xDBFF)
+                {
+                    if (i + 1 >= size)
+                        return false;
+                    unsigned int low = static_cast<unsigned int>(data[i + 1]) & 0xFFFF;
+                    if (low < 0xDC00 || low > 0xDFFF)
+                        return false;
+                    c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                    ++i;
+                }
+            }
+            if (c < 0x80)
+            {
+                o_sUtf8.push_back(static_cast<char>(c));
+            }
+            else if (c < 0x800)
+            {
+                o_sUtf8.push_back(static_cast<char>(0xC0 | (c >> 6)));
+                o_sUtf8.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+            }
+            else if (c < 0x10000)
+            {
+                if (c >= 0xD800 && c <= 0xDFFF)
+                    return false;
+                o_sUtf8.push_back(static_cast<char>(0xE0 | (c >> 12)));
+                o_sUtf8.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+                o_sUtf8.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+            }
+            else if (c <= 0x10FFFF)
+            {
+                o_sUtf8.push_back(static_cast<char>(0xF0 | (c >> 18)));
+                o_sUtf8.push_back(static_cast<char>(0x80 | ((c >> 12) & 0x3F)));
+                o_sUtf8.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+                o_sUtf8.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    namespace
+    {
+        // Writer writes messages in batches of about that size
+        constexpr size_t LOG_BATCH_SIZE = 64 * 1024;
+
+        // Formats message into fixed-size record without allocating memory. What doesn't
+        // fit is cut off (at character boundary) - the last byte is kept for new line.
+        class CLogRecordWriter
+        {
+        public:
+            explicit CLogRecordWriter(CLogRecord& o_record) :
+                mRecord(o_record),
+                mSize(0)
+            {}
+            void Append(const char* text)
+            {
+                while (*text != '\0' && mSize < CLogRecord::MAX_SIZE - 1)
+                    mRecord.mText[mSize++] = *text++;
+            }
+            void Append(unsigned int number)
+            {
+                char digits[16];
+                size_t count = 0;
+                do
+                {
+                    digits[count++] = static_cast<char>('0' + number % 10);
+                    number /= 10;
+                } while (number != 0);
+                while (count > 0 && mSize < CLogRecord::MAX_SIZE - 1)
+                    mRecord.mText[mSize++] = digits[--count];
+            }
+            // Invalid code points (e.g. unpaired surrogates) are replaced with '?'
+            void Append(std::wstring_view sText)
+            {
+                for (size_t i = 0; i < sText.size(); ++i)
+                {
+                    uint32_t codePoint = static_cast<uint32_t>(sText[i]);
+                    if (sizeof(wchar_t) == 2 && codePoint >= 0xD800 && codePoint < 0xDC00 && i + 1 < sText.size() &&
+                        static_cast<uint32_t>(sText[i + 1]) >= 0xDC00 && static_cast<uint32_t>(sText[i + 1]) < 0xE000)
+                    {
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (static_cast<uint32_t>(sText[++i]) - 0xDC00);
+                    }
+                    else if ((codePoint >= 0xD800 && codePoint < 0xE000) || codePoint > 0x10FFFF)
+                    {
+                        codePoint = '?';
+                    }
+                    char bytes[4];
+                    size_t count = 0;
+                    if (codePoint < 0x80)
+                    {
+                        bytes[count++] = static_cast<char>(codePoint);
+                    }
+                    else if (codePoint < 0x800)
+                    {
+                        bytes[count++] = static_cast<char>(0xC0 | (codePoint >> 6));
+                        bytes[count++] = static_cast<char>(0x80 | (codePoint & 0x3F));
+                    }
+                    else if (codePoint < 0x10000)
+                    {
+                        bytes[count++] = static_cast<char>(0xE0 | (codePoint >> 12));
+                        bytes[count++] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                        bytes[count++] = static_cast<char>(0x80 | (codePoint & 0x3F));
+                    }
+                    else
+                    {
+                        bytes[count++] = static_cast<char>(0xF0 | (codePoint >> 18));
+                        bytes[count++] = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+                        bytes[count++] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                        bytes[count++] = static_cast<char>(0x80 | (codePoint & 0x3F));
+                    }
+                    if (mSize + count > CLogRecord::MAX_SIZE - 1)
+                        return;
+                    memcpy(mRecord.mText + mSize, bytes, count);
+                    mSize += count;
+                }
+            }
+            void Finish()
+            {
+                mRecord.mText[mSize++] = '\n';
+                mRecord.mSize = static_cast<uint32_t>(mSize);
+            }
+        private:
+            CLogRecord& mRecord;
+            size_t mSize;
+        };
+
+        void FormatLogRecord(CLogRecord& o_record, CLogger::LogLevel logLevel, const char* functionName,
+            unsigned int lineNo, std::wstring_view sError)
+        {
+            CLogRecordWriter writer(o_record);
+            switch (logLevel)
+            {
+            case CLogger::LogLevel::Critical:
+                writer.Append("Critical. ");
+                break;
+            case CLogger::LogLevel::Error:
+                writer.Append("Error. ");
+                break;
+            case CLogger::LogLevel::Warning:
+                writer.Append("Warn. ");
+                break;
+            case CLogger::LogLevel::Info:
+                writer.Append("Info. ");
+                break;
+            case CLogger::LogLevel::All:
+                writer.Append("All. ");
+                break;
+            };
+
+            if (functionName != nullptr && *functionName != '\0')
+            {
+                writer.Append("Func: ");
+                writer.Append(functionName);
+                writer.Append(", ");
+            }
+            if (lineNo != 0)
+            {
+                writer.Append("Lineno: ");
+                writer.Append(lineNo);
+                writer.Append(" ");
+            }
+            if (!sError.empty())
+            {
+                writer.Append(" Msg: ");
+                writer.Append(sError);
+            }
+            writer.Finish();
+        }
+    }
+
     CLogger::CLogger(CLogger::LogLevel logLevel) :
         mCurrentLogLevel(logLevel),
+        mDroppedCount(0),
+        mIsStarted(false),
+        mIsWriterWaiting(false),
+        mIsStopping(false),
+        mWrittenCount(0),
         mImpl(std::make_unique<CLogger::CLoggerImpl>())
     {}
 
     CLogger::~CLogger()
-    {}
+    {
+        if (!mIsStarted)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mIsStopping = true;
+        }
+        mWakeUp.notify_one();
+        mWriter.join();
+    }
 
-    void CLogger::SetLogLevel(CLogger::LogLevel logLevel)
+    void CLogger::SetLogLevel(CLogger::LogLevel logLevel) noexcept
     {
-        std::lock_guard<std::mutex> lock(mMutex);
-        mCurrentLogLevel = logLevel;
+        mCurrentLogLevel.store(logLevel, std::memory_order_relaxed);
     }
     
-    CLogger::LogLevel CLogger::GetLogLevel() const
+    CLogger::LogLevel CLogger::GetLogLevel() const noexcept
     {
-        std::lock_guard<std::mutex> lock(mMutex);
-        return mCurrentLogLevel;
+        return mCurrentLogLevel.load(std::memory_order_relaxed);
     }
 
-    void CLogger::Log(LogLevel logLevel, const char* functionName, unsigned int lineNo, const std::wstring& sError)
+    void CLogger::Log(LogLevel logLevel, const char* functionName, unsigned int lineNo, std::wstring_view sError) noexcept
     {
-        std::unique_lock<std::mutex> lock(mMutex);
-        if (mCurrentLogLevel < logLevel)
+        if (!IsEnabled(logLevel))
             return;
-        lock.unlock();
-        std::wstring functionNameWideStr;
-        if (functionName != nullptr)
-        {
-            std::transform(functionName, functionName + strlen(functionName),
-                std::back_inserter(functionNameWideStr),
-                [](char c) {return static_cast<wchar_t>(c); });
-        }
-        std::wostringstream oss;
-        switch (logLevel)
-        {
-        case LogLevel::Critical:
-            oss << L"Critical. ";
-            break;
-        case LogLevel::Error:
-            oss << L"Error. ";
-            break;
-        case LogLevel::Warning:
-            oss << L"Warn. ";
-            break;
-        case LogLevel::Info:
-            oss << L"Info. ";
-            break;
-        case LogLevel::All:
-            oss << L"All. ";
-            break;
-        };
+        if (!mIsStarted.load(std::memory_order_acquire) && !Start())
+        {
+            mDroppedCount.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (!mQueue->Push([&](CLogRecord& o_record) { FormatLogRecord(o_record, logLevel, functionName, lineNo, sError); }))
+        {
+            mDroppedCount.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        // Pairs with the fence of the writer: either it sees the message or we see that
+        // it's going to wait (and wake it up)
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mIsWriterWaiting.load(std::memory_order_relaxed))
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mWakeUp.notify_one();
+        }
+    }
 
-        if (!functionNameWideStr.empty())
-            oss << L"Func: " << functionNameWideStr << L", ";
-        if (lineNo != 0)
-            oss << L"Lineno: " << lineNo << " ";
-        if (!sError.empty())
-            oss << " Msg: " << sError;
+    bool CLogger::SetLogFile(const wchar_t* sFilePathName, uint64_t maxFileSize, unsigned int maxFileCount,
+        std::wstring& o_sErrorMsg) noexcept
+    {
+        try
+        {
+            o_sErrorMsg.clear();
+            // Messages that were logged before are written to the old output
+            Flush();
+            std::lock_guard<std::mutex> lock(mOutputMutex);
+            mImpl->Open(sFilePathName, maxFileSize, maxFileCount);
+            return true;
+        }
+        catch (const CException& ex)
+        {
+            o_sErrorMsg = ex.mErrorDescription;
+        }
+        catch (...)
+        {
+            o_sErrorMsg = L"Memory allocation error.";
+        }
+        return false;
+    }
 
-        mImpl->Log(oss.str().c_str());
+    void CLogger::Flush() noexcept
+    {
+        if (!mIsStarted.load(std::memory_order_acquire))
+            return;
+        std::unique_lock<std::mutex> lock(mMutex);
+        uint64_t pushedCount = mQueue->GetPushedCount();
+        mWakeUp.notify_one();
+        mWritten.wait(lock, [this, pushedCount]() { return mWrittenCount >= pushedCount || mIsStopping; });
     }
 
-    static CLogger DefaultLogger;
+    bool CLogger::Start() noexcept
+    {
+        try
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mIsStarted.load(std::memory_order_relaxed))
+                return true;
+            mQueue = std::make_unique<CLogQueue>(QUEUE_CAPACITY);
+            mWriter = std::thread(&CLogger::WriteMessages, this);
+            mIsStarted.store(true, std::memory_order_release);
+            return true;
+        }
+        catch (...)
+        {
+            mQueue.reset();
+            return false;
+        }
+    }
+
+    void CLogger::WriteMessages() noexcept
+    {
+        std::string sBatch;
+        uint64_t reportedDroppedCount = 0;
+        auto writeBatch = [this, &sBatch]() {
+            if (sBatch.empty())
+                return;
+            std::lock_guard<std::mutex> lock(mOutputMutex);
+            mImpl->Write(sBatch.data(), sBatch.size());
+            sBatch.clear();
+        };
+        std::unique_lock<std::mutex> lock(mMutex);
+        for (;;)
+        {
+            lock.unlock();
+            uint64_t writtenCount = 0;
+            try
+            {
+                sBatch.reserve(LOG_BATCH_SIZE + CLogRecord::MAX_SIZE);
+                while (mQueue->Pop([&sBatch](const CLogRecord& record) { sBatch.append(record.mText, record.mSize); }))
+                {
+                    writtenCount++;
+                    if (sBatch.size() >= LOG_BATCH_SIZE)
+                        writeBatch();
+                }
+                uint64_t droppedCount = GetDroppedCount();
+                if (droppedCount != reportedDroppedCount)
+                {
+                    std::ostringstream ss;
+                    ss << "Warn. " << droppedCount - reportedDroppedCount << " log messages were dropped (log queue was full)\n";
+                    sBatch += ss.str();
+                    reportedDroppedCount = droppedCount;
+                }
+                writeBatch();
+            }
+            catch (...)
+            {
+                // Messages that didn't fit into the batch are lost - the queue has to be drained anyway
+                while (mQueue->Pop([](const CLogRecord&) {}))
+                    writtenCount++;
+                sBatch.clear();
+            }
+            lock.lock();
+            mWrittenCount += writtenCount;
+            mWritten.notify_all();
+            if (mQueue->GetPushedCount() != mQueue->GetPoppedCount())
+                continue;
+            if (mIsStopping)
+                break;
+            mIsWriterWaiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            mWakeUp.wait(lock, [this]() {
+                return mIsStopping || mQueue->GetPushedCount() != mQueue->GetPoppedCount();
+            });
+            mIsWriterWaiting.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    CLogger& GetDefaultLogger() noexcept
+    {
+        static CLogger DefaultLogger;
+        return DefaultLogger;
+    }
 
-    void LogCritical(const char* functionName, unsigned int lineNo, const std::wstring& sError)
+    void LogCritical(const char* functionName, unsigned int lineNo, std::wstring_view sError)
     {
-        DefaultLogger.Log(CLogger::LogLevel::Critical, functionName, lineNo, sError);
+        GetDefaultLogger().Log(CLogger::LogLevel::Critical, functionName, lineNo, sError);
     }
 
-    void LogError(const char* functionName, unsigned int lineNo, const std::wstring& sError)
+    void LogError(const char* functionName, unsigned int lineNo, std::wstring_view sError)
     {
-        DefaultLogger.Log(CLogger::LogLevel::Error, functionName, lineNo, sError);
+        GetDefaultLogger().Log(CLogger::LogLevel::Error, functionName, lineNo, sError);
     }
 
-    void LogWarn(const char* functionName, unsigned int lineNo, const std::wstring& sError)
+    void LogWarn(const char* functionName, unsigned int lineNo, std::wstring_view sError)
     {
-        DefaultLogger.Log(CLogger::LogLevel::Warning, functionName, lineNo, sError);
+        GetDefaultLogger().Log(CLogger::LogLevel::Warning, functionName, lineNo, sError);
     }
 
-    void LogInfo(const char* functionName, unsigned int lineNo, const std::wstring& sError)
+    void LogInfo(const char* functionName, unsigned int lineNo, std::wstring_view sError)
     {
-        DefaultLogger.Log(CLogger::LogLevel::Info, functionName, lineNo, sError);
+        GetDefaultLogger().Log(CLogger::LogLevel::Info, functionName, lineNo, sError);
     }
 
-    void LogAll(const char* functionName, unsigned int lineNo, const std::wstring& sError)
+    void LogAll(const char* functionName, unsigned int lineNo, std::wstring_view sError)
     {
-        DefaultLogger.Log(CLogger::LogLevel::All, functionName, lineNo, sError);
+        GetDefaultLogger().Log(CLogger::LogLevel::All, functionName, lineNo, sError);
     }
 };
 
@@ -4,10 +4,16 @@
 #define OT_UTIL_H__
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <optional>
 #include <assert.h>
+#include <stdint.h>
 
 namespace OTInterviewExercise1
 {
@@ -43,6 +49,106 @@ namespace OTInterviewExercise1
         std::wstring mErrorDescription;
     };
 
+    // Error of an operation whose failure is an ordinary outcome (missing file, empty file,
+    // malformed document, etc.). Unlike CException it doesn't allocate: description is a
+    // string literal and error of a system call is kept as its code - message is formatted
+    // by FormatError() (FormatParseError() for documents) only when it's needed.
+    struct CError
+    {
+        CError(unsigned int internalErrorCode = 0, const wchar_t* errorDescription = L"",
+            const wchar_t* systemCallName = nullptr, int systemErrorCode = 0, uint64_t offset = 0) noexcept :
+            mInternalErrorCode(internalErrorCode),
+            mErrorDescription(errorDescription),
+            mSystemCallName(systemCallName),
+            mSystemErrorCode(systemErrorCode),
+            mOffset(offset)
+        {}
+        // Placeholder for custom data (e.g. status of the operation)
+        unsigned int mInternalErrorCode;
+        // String literal
+        const wchar_t* mErrorDescription;
+        // Name of system call that failed (nullptr if it's not a system error) and its
+        // error code (errno on Linux, GetLastError() on Windows)
+        const wchar_t* mSystemCallName;
+        int mSystemErrorCode;
+        // Byte offset of malformed input in the document (errors of parsers)
+        uint64_t mOffset;
+    };
+
+    // Formats message of error: its description or "{call} failed. Error code: ..." with
+    // OS-specific description of the system error
+    std::wstring FormatError(const CError& error);
+
+    // Value of an operation or its CError (like std::expected of C++23). It's returned by
+    // functions whose failures are expected; CException is left for truly exceptional
+    // conditions (e.g. memory allocation errors).
+    template<typename T> class CResult
+    {
+    public:
+        CResult(T value) :
+            mValue(std::move(value))
+        {}
+        CResult(const CError& error) noexcept :
+            mError(error)
+        {}
+        bool HasValue() const noexcept
+        {
+            return mValue.has_value();
+        }
+        explicit operator bool() const noexcept
+        {
+            return mValue.has_value();
+        }
+        T& GetValue() noexcept
+        {
+            assert(mValue.has_value());
+            return *mValue;
+        }
+        const T& GetValue() const noexcept
+        {
+            assert(mValue.has_value());
+            return *mValue;
+        }
+        const CError& GetError() const noexcept
+        {
+            assert(!mValue.has_value());
+            return mError;
+        }
+    private:
+        std::optional<T> mValue;
+        CError mError;
+    };
+
+    // Result of an operation that doesn't return a value
+    template<> class CResult<void>
+    {
+    public:
+        CResult() noexcept :
+            mIsOk(true)
+        {}
+        CResult(const CError& error) noexcept :
+            mError(error),
+            mIsOk(false)
+        {}
+        bool HasValue() const noexcept
+        {
+            return mIsOk;
+        }
+        explicit operator bool() const noexcept
+        {
+            return mIsOk;
+        }
+        const CError& GetError() const noexcept
+        {
+            assert(!mIsOk);
+            return mError;
+        }
+    private:
+        CError mError;
+        bool mIsOk;
+    };
+    using CStatus = CResult<void>;
+
     // Performs OS-specific (un)initialization
     class COsInitialization
     {
@@ -61,11 +167,19 @@ namespace OTInterviewExercise1
     };
 
     // Retrieve contents of text file (file can be ASCII or UTF8)
-    // Returned data is wchar_t string
+    // Returned data is wchar_t string or read-only view of file bytes
     class CTextFileReader
     {
     public:
-        CTextFileReader(const wchar_t* filePathName) noexcept;
+        enum class ReadMode
+        {
+            // File is read into memory buffer
+            Read,
+            // File is memory-mapped (read-only). Files that can't be mapped (pipes,
+            // devices, etc.) are read into memory buffer.
+            Map
+        };
+        CTextFileReader(const wchar_t* filePathName, ReadMode readMode = ReadMode::Read) noexcept;
         ~CTextFileReader() noexcept;
         // Returns boolean to indicate if file was found.
         // o_sErrorMsg contains error message if false was returned.
@@ -74,6 +188,11 @@ namespace OTInterviewExercise1
         // o_fileData contains file contents converted to wchar_t string.
         // o_sErrorMsg contains error message if false was returned.
         bool GetContents(std::wstring& o_fileData, std::wstring& o_sErrorMsg) const noexcept;
+        // Returns boolean to indicate success or failure.
+        // o_fileData is a view of file bytes (no copy is made). It stays valid while
+        // this object exists.
+        // o_sErrorMsg contains error message if false was returned.
+        bool GetBytes(std::string_view& o_fileData, std::wstring& o_sErrorMsg) const noexcept;
     private:
         enum class Status
         {
@@ -88,6 +207,101 @@ namespace OTInterviewExercise1
         std::unique_ptr<CTextFileReaderImpl> mImpl;
     };
 
+    // Reads file sequentially in chunks. Reads of the following chunks are queued while
+    // the caller processes the current one (io_uring on Linux, overlapped I/O on Windows),
+    // so reading overlaps processing. Memory is bounded: chunkCount page-aligned buffers
+    // of chunkSize bytes are allocated whatever the size of the file is. If reads can't be
+    // queued (e.g. io_uring isn't permitted, pipe is read) chunks are read on demand.
+    class CChunkedFileReader
+    {
+    public:
+        CChunkedFileReader(const wchar_t* filePathName, size_t chunkSize = DEFAULT_CHUNK_SIZE,
+            unsigned int chunkCount = DEFAULT_CHUNK_COUNT) noexcept;
+        ~CChunkedFileReader() noexcept;
+        // Returns boolean to indicate if file was found.
+        // o_sErrorMsg contains error message if false was returned.
+        bool Exists(std::wstring& o_sErrorMsg) const noexcept;
+        // Returns boolean to indicate success or failure.
+        // o_chunk receives next chunk of the file (it's empty at end of file). It stays
+        // valid until the following call.
+        // o_sErrorMsg contains error message if false was returned.
+        bool NextChunk(std::string_view& o_chunk, std::wstring& o_sErrorMsg) noexcept;
+        // True if reads are queued ahead (false if chunks are read on demand)
+        bool IsQueued() const noexcept;
+
+        static constexpr size_t DEFAULT_CHUNK_SIZE = 1024 * 1024;
+        static constexpr unsigned int DEFAULT_CHUNK_COUNT = 4;
+    private:
+        class CChunkedFileReaderImpl;
+        std::unique_ptr<CChunkedFileReaderImpl> mImpl;
+    };
+
+    // Identifies version of a file. If any field changes then file was modified or replaced.
+    struct CFileVersion
+    {
+        CFileVersion() :
+            mDevice(0),
+            mFileId(0),
+            mModificationTime(0),
+            mSize(0)
+        {}
+        bool operator==(const CFileVersion& other) const noexcept
+        {
+            return mDevice == other.mDevice && mFileId == other.mFileId &&
+                mModificationTime == other.mModificationTime && mSize == other.mSize;
+        }
+        bool operator!=(const CFileVersion& other) const noexcept
+        {
+            return !(*this == other);
+        }
+        // Device/volume and file id on it (inode or file index)
+        uint64_t mDevice;
+        uint64_t mFileId;
+        // Last modification time in OS-specific units
+        int64_t mModificationTime;
+        uint64_t mSize;
+    };
+
+    // Retrieves version of file without reading it (cheap enough to be called before
+    // every use of the file). Returns false if file can't be queried.
+    // o_sErrorMsg contains error message if false was returned.
+    bool GetFileVersion(const wchar_t* filePathName, CFileVersion& o_version, std::wstring& o_sErrorMsg) noexcept;
+
+    // Renames file replacing existing one atomically (readers see either old or new file).
+    // o_sErrorMsg contains error message if false was returned.
+    bool RenameFile(const wchar_t* sFromPathName, const wchar_t* sToPathName, std::wstring& o_sErrorMsg) noexcept;
+
+    // Deletes file. o_sErrorMsg contains error message if false was returned.
+    bool RemoveFile(const wchar_t* sPathName, std::wstring& o_sErrorMsg) noexcept;
+
+    // Retrieves the largest amount of physical memory used by the process so far (peak
+    // resident set size / peak working set). o_sErrorMsg contains error message if false
+    // was returned.
+    bool GetPeakMemoryUsage(uint64_t& o_bytes, std::wstring& o_sErrorMsg) noexcept;
+
+    // Retrieves value of environment variable. Returns false if it isn't set.
+    bool GetEnvironmentValue(const wchar_t* sName, std::wstring& o_sValue) noexcept;
+
+    // Delivers requests to terminate the process (Ctrl+C, SIGTERM) to a waiting thread
+    // instead of terminating the process. The object must be created before any other
+    // thread is started (threads inherit the signal mask on Linux).
+    class CTerminationSignal
+    {
+    public:
+        CTerminationSignal() noexcept;
+        ~CTerminationSignal();
+
+        CTerminationSignal(const CTerminationSignal&) = delete;
+        CTerminationSignal& operator=(const CTerminationSignal&) = delete;
+
+        // Waits for termination request. Returns false if it can't be waited for.
+        // o_sErrorMsg contains error message if false was returned.
+        bool Wait(std::wstring& o_sErrorMsg) noexcept;
+    private:
+        class CTerminationSignalImpl;
+        std::unique_ptr<CTerminationSignalImpl> mImpl;
+    };
+
     // Takes a closure (e.g. lambda) as parameter. That closure is executed
     // when object goes out of scope. Mostly useful for cleanup of resources
     // that aren't smart pointers.
@@ -118,7 +332,23 @@ namespace OTInterviewExercise1
         return CRAIICleanup<T>(closure);
     }
 
-    // Logs error/warning/etc. messages (current implementation logs to debug console only).
+    // Converts UTF8 string to wchar_t string (UTF16 on Windows, UTF32 elsewhere).
+    // Returns false if input isn't valid UTF8.
+    bool Utf8ToWide(const char* data, size_t size, std::wstring& o_sWide);
+    // Converts wchar_t string (UTF16 on Windows, UTF32 elsewhere) to UTF8 string.
+    // Returns false if input contains invalid code points (e.g. unpaired surrogates).
+    bool WideToUtf8(const wchar_t* data, size_t size, std::string& o_sUtf8);
+
+    class CLogQueue;
+
+    // Logs error/warning/etc. messages to debug console (Windows), stderr (elsewhere) or
+    // to a rotating log file. Logging thread only checks level (an atomic) and formats
+    // message into a lock-free queue (see LogQueue.h). Message is taken as a view - so
+    // a literal isn't copied; message that has to be built is built only if IsEnabled()
+    // (IsLogEnabled()) returns true, so that a filtered message costs nothing.
+    // writer thread (started by the first message) writes queued messages in batches.
+    // Logging never waits for the writer: if the queue is full, message is dropped and
+    // counted (writer reports number of dropped messages in the log).
     class CLogger
     {
     public:
@@ -131,6 +361,7 @@ namespace OTInterviewExercise1
             All
         };
         CLogger(LogLevel logLevel = LogLevel::Error);
+        // Writes queued messages and stops writer thread
         ~CLogger();
 
         CLogger(const CLogger&) = delete;
@@ -138,25 +369,72 @@ namespace OTInterviewExercise1
         CLogger(CLogger&&) = delete;
         CLogger& operator=(CLogger&&) = delete;
 
-        void SetLogLevel(LogLevel logLevel);
-        LogLevel GetLogLevel() const;
-        void Log(LogLevel logLevel, const char* functionName, unsigned int lineNo, const std::wstring& sMessage);
+        void SetLogLevel(LogLevel logLevel) noexcept;
+        LogLevel GetLogLevel() const noexcept;
+        // True if messages of that level aren't filtered out
+        bool IsEnabled(LogLevel logLevel) const noexcept
+        {
+            return mCurrentLogLevel.load(std::memory_order_relaxed) >= logLevel;
+        }
+        void Log(LogLevel logLevel, const char* functionName, unsigned int lineNo, std::wstring_view sMessage) noexcept;
+        // Messages are appended to the file instead of default output. When the file exceeds
+        // maxFileSize it's renamed to {file}.1 ({file}.1 to {file}.2, etc.), so that at most
+        // maxFileCount files are kept. nullptr restores default output. Returns false if
+        // the file couldn't be opened (o_sErrorMsg contains error message).
+        bool SetLogFile(const wchar_t* sFilePathName, uint64_t maxFileSize, unsigned int maxFileCount,
+            std::wstring& o_sErrorMsg) noexcept;
+        // Waits until messages that were logged so far are written
+        void Flush() noexcept;
+        // Number of messages dropped because the queue was full
+        uint64_t GetDroppedCount() const noexcept
+        {
+            return mDroppedCount.load(std::memory_order_relaxed);
+        }
+
+        static constexpr size_t QUEUE_CAPACITY = 1024;
+        static constexpr uint64_t DEFAULT_MAX_FILE_SIZE = 16 * 1024 * 1024;
+        static constexpr unsigned int DEFAULT_MAX_FILE_COUNT = 4;
     private:
-        LogLevel mCurrentLogLevel;
-        mutable std::mutex mMutex;
+        // Starts writer thread (once). Returns false if it couldn't be started.
+        bool Start() noexcept;
+        // Writer thread: writes queued messages until logger is destroyed
+        void WriteMessages() noexcept;
+
+        std::atomic<LogLevel> mCurrentLogLevel;
+        std::atomic<uint64_t> mDroppedCount;
+        std::atomic<bool> mIsStarted;
+        std::unique_ptr<CLogQueue> mQueue;
+        std::thread mWriter;
+        // Guards the flags below; writer waits on mWakeUp, Flush() - on mWritten
+        std::mutex mMutex;
+        std::condition_variable mWakeUp;
+        std::condition_variable mWritten;
+        std::atomic<bool> mIsWriterWaiting;
+        bool mIsStopping;
+        uint64_t mWrittenCount;
+        // Output is changed by SetLogFile() while writer might be using it
+        std::mutex mOutputMutex;
         class CLoggerImpl;
         std::unique_ptr<CLoggerImpl> mImpl;
     };
+    // Default logger (used by LogError() etc.)
+    CLogger& GetDefaultLogger() noexcept;
+    // True if default logger doesn't filter out messages of that level - message that
+    // has to be built (e.g. concatenated) is built only then
+    inline bool IsLogEnabled(CLogger::LogLevel logLevel) noexcept
+    {
+        return GetDefaultLogger().IsEnabled(logLevel);
+    }
     // Log critical error message using default logger
-    void LogCritical(const char* functionName, unsigned int lineNo, const std::wstring& sError);
+    void LogCritical(const char* functionName, unsigned int lineNo, std::wstring_view sError);
     // Log error message using default logger
-    void LogError(const char* functionName, unsigned int lineNo, const std::wstring& sError);
+    void LogError(const char* functionName, unsigned int lineNo, std::wstring_view sError);
     // Log warning message using default logger
-    void LogWarn(const char* functionName, unsigned int lineNo, const std::wstring& sError);
+    void LogWarn(const char* functionName, unsigned int lineNo, std::wstring_view sError);
     // Log info message using default logger
-    void LogInfo(const char* functionName, unsigned int lineNo, const std::wstring& sError);
+    void LogInfo(const char* functionName, unsigned int lineNo, std::wstring_view sError);
     // Log all message using default logger
-    void LogAll(const char* functionName, unsigned int lineNo, const std::wstring& sError);
+    void LogAll(const char* functionName, unsigned int lineNo, std::wstring_view sError);
 }
 
 // Used by other macros. Shouldn't be called directly by client code.
@@ -0,0 +1,252 @@
+// Contains OS-independent implementation of pool of parsers.
+
+#include "XmlParserPool.h"
+#include "BatchConverter.h"
+#include "OutputSink.h"
+#include "Util.h"
+#include <algorithm>
+
+namespace OTInterviewExercise1
+{
+    namespace
+    {
+        struct CJobSizeLess
+        {
+            template<typename T> bool operator()(const T& job1, const T& job2) const noexcept
+            {
+                return job1.mSize < job2.mSize;
+            }
+        };
+    }
+
+    CXmlParserPool::CXmlParserPool(unsigned int threadCount, CXmlParserWrapper::EMXSLTFile xsltFileId,
+        const wchar_t* sXSLTFilePathName, CXmlParserWrapper::EMEngine engine) :
+        mXsltFileId(xsltFileId),
+        msXSLTFilePathName(sXSLTFilePathName != nullptr ? sXSLTFilePathName : L""),
+        mHasXSLTFilePathName(sXSLTFilePathName != nullptr),
+        mEngine(engine),
+        mNextQueue(0),
+        mPendingCount(0),
+        mIsStopping(false),
+        mStolenCount(0),
+        mStartedCount(0)
+    {
+        if (threadCount == 0)
+        {
+            threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+        mQueues.reserve(threadCount);
+        for (unsigned int i = 0; i < threadCount; ++i)
+        {
+            mQueues.push_back(std::make_unique<CQueue>());
+        }
+        try
+        {
+            mWorkers.reserve(threadCount);
+            for (unsigned int i = 0; i < threadCount; ++i)
+            {
+                mWorkers.emplace_back(&CXmlParserPool::Run, this, i);
+            }
+        }
+        catch (...)
+        {
+            // Destructor isn't called - workers that were started have to be stopped here
+            Stop();
+            throw;
+        }
+    }
+
+    CXmlParserPool::~CXmlParserPool()
+    {
+        Stop();
+    }
+
+    std::future<CXmlParserPool::CConversion> CXmlParserPool::Submit(std::string sXml)
+    {
+        CJob job;
+        job.mSize = sXml.size();
+        job.mIsFile = false;
+        job.msXml = std::move(sXml);
+        return Push(std::move(job));
+    }
+
+    std::future<CXmlParserPool::CConversion> CXmlParserPool::SubmitFile(const std::wstring& sXmlFilePathName)
+    {
+        CJob job;
+        // File that can't be queried is queued as an empty one - worker reports the error
+        CFileVersion version;
+        std::wstring sErrorMsg;
+        job.mSize = GetFileVersion(sXmlFilePathName.c_str(), version, sErrorMsg) ? version.mSize : 0;
+        job.mIsFile = true;
+        job.msXmlFilePathName = sXmlFilePathName;
+        return Push(std::move(job));
+    }
+
+    std::future<CXmlParserPool::CConversion> CXmlParserPool::Push(CJob job)
+    {
+        std::future<CConversion> future = job.mPromise.get_future();
+        CQueue& queue = *mQueues[mNextQueue++ % mQueues.size()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mMutex);
+            queue.mJobs.push_back(std::move(job));
+            std::push_heap(queue.mJobs.begin(), queue.mJobs.end(), CJobSizeLess());
+        }
+        {
+            std::lock_guard<std::mutex> lock(mWaitMutex);
+            mPendingCount++;
+        }
+        mJobQueued.notify_one();
+        return future;
+    }
+
+    bool CXmlParserPool::PopLargest(CQueue& queue, CJob& o_job)
+    {
+        std::lock_guard<std::mutex> lock(queue.mMutex);
+        if (queue.mJobs.empty())
+            return false;
+        std::pop_heap(queue.mJobs.begin(), queue.mJobs.end(), CJobSizeLess());
+        o_job = std::move(queue.mJobs.back());
+        queue.mJobs.pop_back();
+        return true;
+    }
+
+    bool CXmlParserPool::Pop(size_t workerIndex, CJob& o_job)
+    {
+        for (;;)
+        {
+            // Queues are searched from worker's own one, so it wins a tie. Chosen job might
+            // be taken by another worker before it's popped - then queues are searched again.
+            size_t chosenIndex = mQueues.size();
+            uint64_t largestSize = 0;
+            for (size_t n = 0; n < mQueues.size(); ++n)
+            {
+                size_t i = (workerIndex + n) % mQueues.size();
+                CQueue& queue = *mQueues[i];
+                std::lock_guard<std::mutex> lock(queue.mMutex);
+                if (!queue.mJobs.empty() && (chosenIndex == mQueues.size() || queue.mJobs.front().mSize > largestSize))
+                {
+                    chosenIndex = i;
+                    largestSize = queue.mJobs.front().mSize;
+                }
+            }
+            if (chosenIndex == mQueues.size())
+                return false;
+            if (PopLargest(*mQueues[chosenIndex], o_job))
+            {
+                if (chosenIndex != workerIndex)
+                {
+                    mStolenCount++;
+                }
+                return true;
+            }
+        }
+    }
+
+    void CXmlParserPool::Run(size_t workerIndex) noexcept
+    {
+        // OS-specific initialization is per thread (e.g. COM apartment), and parser is
+        // created by the thread that uses it
+        COsInitialization init;
+        std::wstring sInitError;
+        bool isInitialized = init.IsOk(sInitError);
+        std::unique_ptr<CXmlParserWrapper> parser;
+        if (isInitialized)
+        {
+            try
+            {
+                parser = std::make_unique<CXmlParserWrapper>(mXsltFileId,
+                    mHasXSLTFilePathName ? msXSLTFilePathName.c_str() : nullptr, mEngine);
+                // Documents are already converted in parallel - so hardware threads are
+                // shared by workers
+                parser->SetThreadCount(std::max(std::thread::hardware_concurrency() / GetThreadCount(), 1u));
+            }
+            catch (...)
+            {
+                isInitialized = false;
+                sInitError = L"Memory allocation error.";
+            }
+        }
+        if (!isInitialized)
+        {
+            LogError(__FUNCTION__, __LINE__, L"Initialization error encountered. " + sInitError);
+        }
+
+        for (;;)
+        {
+            CJob job;
+            if (!Pop(workerIndex, job))
+            {
+                std::unique_lock<std::mutex> lock(mWaitMutex);
+                if (mIsStopping && mPendingCount <= 0)
+                    return;
+                mJobQueued.wait(lock, [this]() {
+                    return mPendingCount > 0 || mIsStopping;
+                    });
+                continue;
+            }
+            mPendingCount--;
+
+            try
+            {
+                CConversion conversion;
+                conversion.mStartIndex = mStartedCount++;
+                if (!isInitialized)
+                {
+                    conversion.mExitCode = OTInterviewExercise1ExitCode::INIT_ERROR;
+                    conversion.mError = L"Initialization error encountered. " + sInitError;
+                }
+                else
+                {
+                    CStringOutputSink htmlSink(conversion.mHtml);
+                    if (job.mIsFile)
+                    {
+                        uint64_t xmlSize = 0;
+                        conversion.mExitCode = ConvertXmlFile(*parser, job.msXmlFilePathName.c_str(), htmlSink,
+                            xmlSize, conversion.mError);
+                    }
+                    else if (job.msXml.empty())
+                    {
+                        conversion.mExitCode = OTInterviewExercise1ExitCode::XML_FILE_IS_EMPTY;
+                        conversion.mError = L"Document doesn't contain any XML.";
+                    }
+                    else if (!parser->Parse(job.msXml, htmlSink, conversion.mError))
+                    {
+                        conversion.mExitCode = OTInterviewExercise1ExitCode::XML_PARSER_ERROR;
+                        conversion.mError = L"Xml parser error encountered. " + conversion.mError;
+                    }
+                    if (conversion.mExitCode != OTInterviewExercise1ExitCode::SUCCESS)
+                    {
+                        // Partial output isn't returned
+                        conversion.mHtml.clear();
+                    }
+                }
+                job.mPromise.set_value(std::move(conversion));
+            }
+            catch (...)
+            {
+                // Memory allocation error - it's reported by the future
+                try
+                {
+                    job.mPromise.set_exception(std::current_exception());
+                }
+                catch (...)
+                {
+                }
+            }
+        }
+    }
+
+    void CXmlParserPool::Stop() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(mWaitMutex);
+            mIsStopping = true;
+        }
+        mJobQueued.notify_all();
+        for (auto& worker : mWorkers)
+        {
+            worker.join();
+        }
+        mWorkers.clear();
+    }
+}
@@ -0,0 +1,121 @@
+// Contains declaration of OS-independent pool of parsers that converts XML documents
+// submitted by any number of threads.
+#ifndef OT_XMLPARSERPOOL_H__
+#define OT_XMLPARSERPOOL_H__
+
+#include "ExitCode.h"
+#include "XmlParserWrapper.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <atomic>
+#include <stdint.h>
+
+namespace OTInterviewExercise1
+{
+    // Converts XML documents submitted by any number of threads. CXmlParserWrapper can't be
+    // shared by threads (and on Windows it belongs to COM apartment of the thread that
+    // created it), so every worker thread performs OS-specific initialization and creates
+    // its own parser once.
+    // Every worker has its own queue of jobs ordered by size, and submitted jobs are spread
+    // over the queues (so submitting threads don't contend for one lock). Worker takes the
+    // largest job at the head of any queue - it steals it from another worker's queue if
+    // that one is larger than its own largest job. So large documents are started first
+    // rather than finishing last behind many small ones.
+    class CXmlParserPool
+    {
+    public:
+        // Result of conversion of one document
+        struct CConversion
+        {
+            CConversion() :
+                mExitCode(OTInterviewExercise1ExitCode::SUCCESS),
+                mStartIndex(0)
+            {}
+            OTInterviewExercise1ExitCode mExitCode;
+            // Number of conversions the pool started before this one (shows how jobs were
+            // scheduled)
+            uint64_t mStartIndex;
+            // UTF8 HTML (empty if conversion failed)
+            std::string mHtml;
+            // Error message if conversion failed
+            std::wstring mError;
+        };
+
+        // threadCount - number of workers (0 means number of hardware threads)
+        CXmlParserPool(unsigned int threadCount, CXmlParserWrapper::EMXSLTFile xsltFileId,
+            const wchar_t* sXSLTFilePathName = nullptr,
+            CXmlParserWrapper::EMEngine engine = CXmlParserWrapper::EMEngine::Default);
+        // Converts jobs that were submitted and waits for workers
+        ~CXmlParserPool();
+
+        CXmlParserPool(const CXmlParserPool&) = delete;
+        CXmlParserPool& operator=(const CXmlParserPool&) = delete;
+
+        // Queues conversion of UTF8 XML. Failure of conversion is reported by result of
+        // the future.
+        std::future<CConversion> Submit(std::string sXml);
+        // Queues conversion of XML file (it's read by worker). Size of the file (it's queried
+        // now) determines order of the job.
+        std::future<CConversion> SubmitFile(const std::wstring& sXmlFilePathName);
+
+        unsigned int GetThreadCount() const noexcept
+        {
+            return static_cast<unsigned int>(mQueues.size());
+        }
+        // Number of jobs that were taken from queue of another worker
+        uint64_t GetStolenCount() const noexcept
+        {
+            return mStolenCount;
+        }
+    private:
+        struct CJob
+        {
+            // Order of jobs in queue (the largest one is taken first)
+            uint64_t mSize;
+            // Job converts XML file (msXmlFilePathName) rather than msXml
+            bool mIsFile;
+            std::string msXml;
+            std::wstring msXmlFilePathName;
+            std::promise<CConversion> mPromise;
+        };
+        // Queue of one worker: binary max-heap of jobs by size
+        struct CQueue
+        {
+            std::mutex mMutex;
+            std::vector<CJob> mJobs;
+        };
+
+        std::future<CConversion> Push(CJob job);
+        // Takes the largest job at the head of all queues (worker's own queue wins a tie).
+        // Returns false if all queues are empty.
+        bool Pop(size_t workerIndex, CJob& o_job);
+        static bool PopLargest(CQueue& queue, CJob& o_job);
+        // Worker thread: converts jobs until pool is destroyed and queues are empty
+        void Run(size_t workerIndex) noexcept;
+        void Stop() noexcept;
+
+        CXmlParserWrapper::EMXSLTFile mXsltFileId;
+        std::wstring msXSLTFilePathName;
+        bool mHasXSLTFilePathName;
+        CXmlParserWrapper::EMEngine mEngine;
+        std::vector<std::unique_ptr<CQueue>> mQueues;
+        std::vector<std::thread> mWorkers;
+        // Queue that receives the next submitted job
+        std::atomic<size_t> mNextQueue;
+        // Idle workers wait for jobs. mPendingCount is increased under mWaitMutex (so that
+        // wakeup isn't lost) and decreased when a job is taken (it might briefly go below
+        // zero if job is taken before it's counted).
+        std::mutex mWaitMutex;
+        std::condition_variable mJobQueued;
+        std::atomic<int64_t> mPendingCount;
+        bool mIsStopping;
+        std::atomic<uint64_t> mStolenCount;
+        std::atomic<uint64_t> mStartedCount;
+    };
+}
+#endif
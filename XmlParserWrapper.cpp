@@ -0,0 +1,413 @@
+// Contains OS-independent implementation of XML parser class that converts an XML file
+// into HTML format. Actual transformation is done by one of the engines declared in
+// XmlParserWrapperImpl.h.
+
+#include "XmlParserWrapper.h"
+#include "XmlParserWrapperImpl.h"
+#include "CatalogEngine.h"
+#include "CatalogRowCache.h"
+#include "XmlPullParser.h"
+#include "OutputSink.h"
+#include "ConversionMetrics.h"
+#include "Trace.h"
+#include "Util.h"
+#include <string.h>
+
+namespace OTInterviewExercise1
+{
+    namespace
+    {
+        // Messages of caught exceptions are built without streams
+        std::wstring FormatExceptionError(const CException& ex)
+        {
+            std::wstring sError = L"Exception caught. ";
+            if (!ex.mErrorDescription.empty())
+            {
+                sError += L"System error: ";
+                sError += ex.mErrorDescription;
+            }
+            return sError;
+        }
+
+        std::wstring FormatExceptionError(const std::exception& ex)
+        {
+            std::wstring sError = L"C++ exception caught. ";
+            std::wstring sWhat;
+            if (ex.what() && Utf8ToWide(ex.what(), strlen(ex.what()), sWhat))
+            {
+                sError += sWhat;
+            }
+            return sError;
+        }
+
+        // Creates engine. Invalid configuration is an expected failure - engine's own
+        // failures (e.g. style sheet can't be loaded) are thrown.
+        CResult<std::unique_ptr<CXmlParserWrapper::CXmlParserWrapperImpl>> CreateImpl(
+            CXmlParserWrapper::EMXSLTFile xsltFileId, const wchar_t* sXSLTFilePathName,
+            CXmlParserWrapper::EMEngine engine)
+        {
+            if (xsltFileId == CXmlParserWrapper::EMXSLTFile::None ||
+                (xsltFileId == CXmlParserWrapper::EMXSLTFile::CatalogResources && sXSLTFilePathName != nullptr) ||
+                (xsltFileId == CXmlParserWrapper::EMXSLTFile::File && sXSLTFilePathName == nullptr))
+            {
+                return CError(0, L"Invalid combination of command-line parameters");
+            }
+            // Built-in style sheet is compiled into native engine - so it doesn't need
+            // to be loaded and parsed at all
+            if (engine == CXmlParserWrapper::EMEngine::Default)
+            {
+                engine = xsltFileId == CXmlParserWrapper::EMXSLTFile::CatalogResources ?
+                    CXmlParserWrapper::EMEngine::Native : CXmlParserWrapper::EMEngine::MSXML;
+            }
+            // Ctor of engine will read XSLT stylesheet (if engine uses one)
+            switch (engine)
+            {
+            case CXmlParserWrapper::EMEngine::Native:
+                if (xsltFileId != CXmlParserWrapper::EMXSLTFile::CatalogResources)
+                    return CError(0, L"Native engine supports only built-in catalog style sheet");
+                return std::unique_ptr<CXmlParserWrapper::CXmlParserWrapperImpl>(
+                    std::make_unique<CNativeXmlParserImpl>(xsltFileId, sXSLTFilePathName));
+            case CXmlParserWrapper::EMEngine::MSXML:
+#ifdef _WIN32
+                return CreateMsXmlParserImpl(xsltFileId, sXSLTFilePathName);
+#else
+                return CError(0, L"MSXML engine is available on Windows only");
+#endif
+            default:
+                return CError(0, L"Unrecognized engine");
+            }
+        }
+    }
+
+    CXmlParserWrapper::CXmlParserWrapper(EMXSLTFile xsltFileId, const wchar_t* sXSLTFilePathName, EMEngine engine)
+    {
+        std::string functionName;
+        unsigned int lineNo = 0;
+        try
+        {
+            auto impl = CreateImpl(xsltFileId, sXSLTFilePathName, engine);
+            if (impl)
+            {
+                mImpl = std::move(impl.GetValue());
+                return;
+            }
+            mError = FormatError(impl.GetError());
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+        }
+        catch (const CException& ex)
+        {
+            functionName = ex.mFunctionName;
+            lineNo = ex.mLineNo;
+            mError = FormatExceptionError(ex);
+        }
+        catch (const std::bad_alloc& /*ex*/)
+        {
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+            mError = L"Memory allocation error.";
+        }
+        catch (const std::exception& ex)
+        {
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+            mError = FormatExceptionError(ex);
+        }
+        catch (...)
+        {
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+            mError = L"Unknown exception caught.";
+        }
+        LogError(functionName.c_str(), lineNo, mError);;
+    }
+
+    CXmlParserWrapper::~CXmlParserWrapper()
+    {}
+
+    template<typename TConvert> bool CXmlParserWrapper::Convert(const TConvert& convert, std::wstring& o_sError) noexcept
+    {
+        std::string functionName;
+        unsigned int lineNo = 0;
+        try
+        {
+            o_sError.clear();
+            // Object wasn't initialized properly - so copy init error descr into o_sError and return false
+            if (mImpl == nullptr)
+            {
+                o_sError = mError;
+                return false;
+            }
+            CStatus status = convert();
+            if (status)
+            {
+                if (mMetrics != nullptr)
+                    mMetrics->AddConversion(true);
+                return true;
+            }
+            // Malformed document isn't thrown - its message is formatted only now
+            o_sError = FormatParseError(status.GetError());
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+        }
+        catch (const CException& ex)
+        {
+            o_sError = FormatExceptionError(ex);
+            functionName = ex.mFunctionName;
+            lineNo = ex.mLineNo;
+        }
+        catch (const std::bad_alloc& /*ex*/)
+        {
+            o_sError = L"Memory allocation error.";
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+        }
+        catch (const std::exception& ex)
+        {
+            o_sError = FormatExceptionError(ex);
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+        }
+        catch (...)
+        {
+            o_sError = L"Unknown exception caught.";
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+        }
+        if (mMetrics != nullptr)
+            mMetrics->AddConversion(false);
+        LogError(functionName.c_str(), lineNo, o_sError);
+
+        return false;
+    }
+
+    bool CXmlParserWrapper::Parse(const std::wstring& sXML, std::wstring& o_sHTML, std::wstring& o_sError) noexcept
+    {
+        bool isConverted = Convert([this, &sXML, &o_sHTML]() {
+            return mImpl->Parse(sXML, o_sHTML);
+        }, o_sError);
+        if (!isConverted)
+            o_sHTML.clear();
+        return isConverted;
+    }
+
+    bool CXmlParserWrapper::Parse(std::string_view sXML, COutputSink& o_html, std::wstring& o_sError) noexcept
+    {
+        return Convert([this, sXML, &o_html]() {
+            if (mMetrics == nullptr)
+                return mImpl->Parse(sXML, o_html);
+            CMetricsOutputSink htmlSink(o_html, *mMetrics);
+            return mImpl->Parse(sXML, htmlSink);
+        }, o_sError);
+    }
+
+    bool CXmlParserWrapper::Parse(CXmlInputSource& xml, COutputSink& o_html, std::wstring& o_sError) noexcept
+    {
+        return Convert([this, &xml, &o_html]() {
+            if (mMetrics == nullptr)
+                return mImpl->Parse(xml, o_html);
+            CMetricsOutputSink htmlSink(o_html, *mMetrics);
+            return mImpl->Parse(xml, htmlSink);
+        }, o_sError);
+    }
+
+    bool CXmlParserWrapper::Parse(const CCatalogIndex& index, COutputSink& o_html, std::wstring& o_sError) noexcept
+    {
+        // Engine that doesn't support catalog index throws
+        return Convert([this, &index, &o_html]() {
+            if (mMetrics == nullptr)
+            {
+                mImpl->Parse(index, o_html);
+                return CStatus();
+            }
+            CMetricsOutputSink htmlSink(o_html, *mMetrics);
+            mImpl->Parse(index, htmlSink);
+            return CStatus();
+        }, o_sError);
+    }
+
+    bool CXmlParserWrapper::SupportsCatalogIndex() const noexcept
+    {
+        return mImpl != nullptr && mImpl->SupportsCatalogIndex();
+    }
+
+    void CXmlParserWrapper::SetSortMemoryBudget(size_t memoryBudget) noexcept
+    {
+        if (mImpl != nullptr)
+            mImpl->SetSortMemoryBudget(memoryBudget);
+    }
+
+    void CXmlParserWrapper::SetThreadCount(unsigned int threadCount) noexcept
+    {
+        if (mImpl != nullptr)
+            mImpl->SetThreadCount(threadCount);
+    }
+
+    void CXmlParserWrapper::SetMemoryResource(std::pmr::memory_resource* memoryResource) noexcept
+    {
+        if (mImpl != nullptr)
+            mImpl->SetMemoryResource(memoryResource);
+    }
+
+    void CXmlParserWrapper::SetRowCacheFile(const wchar_t* sFilePathName) noexcept
+    {
+        try
+        {
+            if (mImpl != nullptr)
+                mImpl->SetRowCacheFile(sFilePathName != nullptr ? sFilePathName : L"");
+        }
+        catch (...)
+        {
+            LogError(__FUNCTION__, __LINE__, L"Memory allocation error.");
+        }
+    }
+
+    void CXmlParserWrapper::SetPageOutput(CPageOutput* pageOutput, size_t pageSize) noexcept
+    {
+        if (mImpl != nullptr)
+            mImpl->SetPageOutput(pageOutput, pageSize);
+    }
+
+    void CXmlParserWrapper::EnableMetrics(bool isEnabled) noexcept
+    {
+        try
+        {
+            if (isEnabled && mMetrics == nullptr)
+                mMetrics = std::make_unique<CConversionMetrics>();
+            else if (!isEnabled)
+                mMetrics.reset();
+            if (mImpl != nullptr)
+                mImpl->SetMetrics(mMetrics.get());
+        }
+        catch (...)
+        {
+            LogError(__FUNCTION__, __LINE__, L"Memory allocation error.");
+        }
+    }
+
+    CNativeXmlParserImpl::CNativeXmlParserImpl(
+        CXmlParserWrapper::EMXSLTFile xsltFileId,
+        const wchar_t* /*sXSLTFilePathName*/) :
+        mMemoryResource(nullptr)
+    {
+        // Native engine implements cat_items.xslt stylesheet only
+        if (xsltFileId != CXmlParserWrapper::EMXSLTFile::CatalogResources)
+        {
+            THROW_ERROR(L"Native engine supports only built-in catalog style sheet");
+        }
+    }
+
+    CStatus CXmlParserWrapper::CXmlParserWrapperImpl::Parse(const std::wstring& sXML, std::wstring& o_sHTML)
+    {
+        o_sHTML.clear();
+        std::string sXmlUtf8;
+        CTraceSpan encodeSpan("encode");
+        CMetricsTimer encodeTimer(mMetrics, CConversionMetrics::EMPhase::Decode, sXML.size() * sizeof(wchar_t));
+        if (!WideToUtf8(sXML.data(), sXML.size(), sXmlUtf8))
+        {
+            THROW_ERROR(L"Failed to convert wchar_t string to UTF8");
+        }
+        encodeTimer.Stop();
+        encodeSpan.Stop();
+        std::string sHtmlUtf8;
+        CStringOutputSink htmlSink(sHtmlUtf8);
+        CStatus status = Parse(std::string_view(sXmlUtf8), htmlSink);
+        if (!status)
+            return status;
+        // Input isn't needed anymore - release it before allocating output
+        std::string().swap(sXmlUtf8);
+        CTraceSpan decodeSpan("decode");
+        CMetricsTimer decodeTimer(mMetrics, CConversionMetrics::EMPhase::Decode, sHtmlUtf8.size());
+        if (!Utf8ToWide(sHtmlUtf8.data(), sHtmlUtf8.size(), o_sHTML))
+        {
+            THROW_ERROR(L"Failed to convert UTF8 string to wchar_t");
+        }
+        return status;
+    }
+
+    CStatus CXmlParserWrapper::CXmlParserWrapperImpl::Parse(CXmlInputSource& xml, COutputSink& o_html)
+    {
+        std::string sXML;
+        for (std::string_view sChunk = xml.NextChunk(); !sChunk.empty(); sChunk = xml.NextChunk())
+        {
+            sXML.append(sChunk);
+        }
+        return Parse(std::string_view(sXML), o_html);
+    }
+
+    CStatus CNativeXmlParserImpl::Parse(std::string_view sXML, COutputSink& o_html)
+    {
+        mOptions.mMetrics = mMetrics;
+        if (mMemoryResource != nullptr)
+        {
+            mOptions.mMemoryResource = mMemoryResource;
+            return Transform(sXML, o_html);
+        }
+        // All memory of the conversion is freed at once when it's finished
+        auto resetArena = MakeRAIICleanup([this]() { mArena.Reset(); });
+        mOptions.mMemoryResource = mArena.GetResource();
+        return Transform(sXML, o_html);
+    }
+
+    CStatus CNativeXmlParserImpl::Parse(CXmlInputSource& xml, COutputSink& o_html)
+    {
+        // Cached rows are looked up in whole document
+        if (!msRowCacheFile.empty())
+        {
+            return CXmlParserWrapperImpl::Parse(xml, o_html);
+        }
+        mOptions.mMetrics = mMetrics;
+        if (mMemoryResource != nullptr)
+        {
+            mOptions.mMemoryResource = mMemoryResource;
+            return CCatalogEngine::Transform(xml, o_html, mOptions);
+        }
+        auto resetArena = MakeRAIICleanup([this]() { mArena.Reset(); });
+        mOptions.mMemoryResource = mArena.GetResource();
+        return CCatalogEngine::Transform(xml, o_html, mOptions);
+    }
+
+    void CXmlParserWrapper::CXmlParserWrapperImpl::Parse(const CCatalogIndex& /*index*/, COutputSink& /*o_html*/)
+    {
+        THROW_ERROR(L"Engine doesn't support catalog index");
+    }
+
+    void CNativeXmlParserImpl::Parse(const CCatalogIndex& index, COutputSink& o_html)
+    {
+        mOptions.mMetrics = mMetrics;
+        if (mMemoryResource != nullptr)
+        {
+            mOptions.mMemoryResource = mMemoryResource;
+            CCatalogEngine::Transform(index, o_html, mOptions);
+            return;
+        }
+        auto resetArena = MakeRAIICleanup([this]() { mArena.Reset(); });
+        mOptions.mMemoryResource = mArena.GetResource();
+        CCatalogEngine::Transform(index, o_html, mOptions);
+    }
+
+    CStatus CNativeXmlParserImpl::Transform(std::string_view sXML, COutputSink& o_html)
+    {
+        if (msRowCacheFile.empty())
+        {
+            return CCatalogEngine::Transform(sXML, o_html, mOptions);
+        }
+        CCatalogRowCache rowCache(msRowCacheFile.c_str());
+        mOptions.mRowCache = &rowCache;
+        auto resetRowCache = MakeRAIICleanup([this]() { mOptions.mRowCache = nullptr; });
+        CStatus status = CCatalogEngine::Transform(sXML, o_html, mOptions);
+        // Rows of malformed document aren't kept
+        if (!status)
+            return status;
+        try
+        {
+            rowCache.Save();
+        }
+        catch (const CException& ex)
+        {
+            // Output is complete - next conversion just won't be incremental
+            LogError(ex.mFunctionName.c_str(), ex.mLineNo, L"Row cache file wasn't saved. " + ex.mErrorDescription);
+        }
+        return status;
+    }
+}
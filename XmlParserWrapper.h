@@ -4,10 +4,18 @@
 #define OT_PARSERWRAPPER_H__
 
 #include <string>
+#include <string_view>
 #include <memory>
+#include <memory_resource>
 
 namespace OTInterviewExercise1
 {
+    class COutputSink;
+    class CPageOutput;
+    class CConversionMetrics;
+    class CXmlInputSource;
+    class CCatalogIndex;
+
     class CXmlParserWrapper
     {
     public:
@@ -20,15 +28,70 @@ namespace OTInterviewExercise1
             CatalogResources, // Our XSLT style sheet is contained inside our EXE (as resource)
             File // Our XSLT style sheet is contained in a separate file
         };
+        // Engine that performs XML->HTML transformation
+        enum class EMEngine
+        {
+            Default, // Native for CatalogResources style sheet, MSXML for style sheet file
+            MSXML, // MSXML6 XSLT engine (Windows only)
+            Native // Built-in streaming engine (supports CatalogResources style sheet only,
+                   // its renderer is generated from the style sheet at build time)
+        };
         // Methods
-        CXmlParserWrapper(EMXSLTFile xsltFileId, const wchar_t *sXSLTFilePathName = nullptr);
+        CXmlParserWrapper(EMXSLTFile xsltFileId, const wchar_t *sXSLTFilePathName = nullptr,
+            EMEngine engine = EMEngine::Default);
 
         ~CXmlParserWrapper();
 
         bool Parse(const std::wstring& sXML, std::wstring& o_sHTML, std::wstring& o_sError) noexcept;
-    private:
+        // Converts UTF8 XML and writes UTF8 HTML into o_html as it's produced. Input isn't
+        // copied by the native engine. On failure o_html might have received partial output.
+        bool Parse(std::string_view sXML, COutputSink& o_html, std::wstring& o_sError) noexcept;
+        // Same as above, but UTF8 XML is pulled from input while it's converted by the
+        // native engine (other engines and incremental conversion read whole input first).
+        bool Parse(CXmlInputSource& xml, COutputSink& o_html, std::wstring& o_sError) noexcept;
+        // Renders records of catalog index (see CatalogIndex.h) without parsing XML. Only
+        // the native engine supports it.
+        bool Parse(const CCatalogIndex& index, COutputSink& o_html, std::wstring& o_sError) noexcept;
+        bool SupportsCatalogIndex() const noexcept;
+        // Limits memory used for sorting of rows by the native engine (the rest is sorted
+        // in temporary files). Other engines ignore it.
+        void SetSortMemoryBudget(size_t memoryBudget) noexcept;
+        // Number of threads rendering rows of one document in the native engine (0 means
+        // number of hardware threads). Other engines ignore it.
+        void SetThreadCount(unsigned int threadCount) noexcept;
+        // Memory resource that native engine allocates memory of a conversion from (it's
+        // used by one thread at a time). By default (nullptr) every parser has monotonic
+        // arena that's reset after each conversion. Other engines ignore it.
+        void SetMemoryResource(std::pmr::memory_resource* memoryResource) noexcept;
+        // Enables incremental conversion by the native engine: rendered rows are kept in
+        // that file, and only CD elements that changed since previous conversion (with the
+        // same file) are parsed and rendered. nullptr disables it. Other engines ignore it.
+        void SetRowCacheFile(const wchar_t* sFilePathName) noexcept;
+        // Enables paginated output of the native engine: sorted rows are split into pages of
+        // pageSize rows that are rendered in parallel and passed to pageOutput, while
+        // o_html of Parse() receives index page. nullptr disables it. It can't be combined
+        // with incremental conversion. Other engines ignore it.
+        void SetPageOutput(CPageOutput* pageOutput, size_t pageSize) noexcept;
+        // Enables collection of per-phase metrics of conversions (see ConversionMetrics.h).
+        // It's disabled by default: timers then don't even read the clock.
+        void EnableMetrics(bool isEnabled) noexcept;
+        // Metrics collected since they were enabled (nullptr if they're disabled). It can
+        // be read by another thread while this parser converts.
+        CConversionMetrics* GetMetrics() noexcept
+        {
+            return mMetrics.get();
+        }
+
+        // Base class of engines (see XmlParserWrapperImpl.h)
         class CXmlParserWrapperImpl;
+    private:
+        // Runs conversion (convert returns status of malformed document). Its failure -
+        // malformed document, thrown error or failed initialization of this object - is
+        // reported by o_sError and logged.
+        template<typename TConvert> bool Convert(const TConvert& convert, std::wstring& o_sError) noexcept;
+
         std::unique_ptr<CXmlParserWrapperImpl> mImpl;
+        std::unique_ptr<CConversionMetrics> mMetrics;
         std::wstring mError;
     };
 }
@@ -0,0 +1,109 @@
+// Contains OS-independent declaration of low-level XML parser classes (engines) that are
+// used by CXmlParserWrapper.
+#ifndef OT_PARSERWRAPPERIMPL_H__
+#define OT_PARSERWRAPPERIMPL_H__
+
+#include "XmlParserWrapper.h"
+#include "OutputSink.h"
+#include "CatalogEngine.h"
+#include "ConversionArena.h"
+#include "ConversionMetrics.h"
+#include <string>
+#include <string_view>
+#include <memory>
+
+namespace OTInterviewExercise1
+{
+    // Base class of XML->HTML engines. Malformed document is reported by returned status
+    // (see FormatParseError()) if engine detects it by itself; other errors are reported
+    // by throwing CException.
+    class CXmlParserWrapper::CXmlParserWrapperImpl
+    {
+    public:
+        CXmlParserWrapperImpl() :
+            mMetrics(nullptr)
+        {}
+        virtual ~CXmlParserWrapperImpl() = default;
+        // By default converts input to UTF8 and calls UTF8 version
+        virtual CStatus Parse(const std::wstring& sXML, std::wstring& o_sHTML);
+        virtual CStatus Parse(std::string_view sXML, COutputSink& o_html) = 0;
+        // By default reads whole input and calls string_view version
+        virtual CStatus Parse(CXmlInputSource& xml, COutputSink& o_html);
+        // Engines that support catalog index render it (others throw)
+        virtual bool SupportsCatalogIndex() const noexcept
+        {
+            return false;
+        }
+        virtual void Parse(const CCatalogIndex& index, COutputSink& o_html);
+        // Engines that don't sort rows themselves ignore it
+        virtual void SetSortMemoryBudget(size_t /*memoryBudget*/) noexcept
+        {}
+        virtual void SetThreadCount(unsigned int /*threadCount*/) noexcept
+        {}
+        virtual void SetMemoryResource(std::pmr::memory_resource* /*memoryResource*/) noexcept
+        {}
+        virtual void SetRowCacheFile(const std::wstring& /*sFilePathName*/)
+        {}
+        virtual void SetPageOutput(CPageOutput* /*pageOutput*/, size_t /*pageSize*/) noexcept
+        {}
+        // Engine adds time of its phases to it (nullptr disables collection)
+        void SetMetrics(CConversionMetrics* metrics) noexcept
+        {
+            mMetrics = metrics;
+        }
+    protected:
+        CConversionMetrics* mMetrics;
+    };
+
+    // Built-in streaming engine (see CatalogEngine.h)
+    class CNativeXmlParserImpl : public CXmlParserWrapper::CXmlParserWrapperImpl
+    {
+    public:
+        CNativeXmlParserImpl(CXmlParserWrapper::EMXSLTFile xsltFileId, const wchar_t* sXSLTFilePathName);
+        using CXmlParserWrapperImpl::Parse;
+        CStatus Parse(std::string_view sXML, COutputSink& o_html) override;
+        CStatus Parse(CXmlInputSource& xml, COutputSink& o_html) override;
+        bool SupportsCatalogIndex() const noexcept override
+        {
+            return true;
+        }
+        void Parse(const CCatalogIndex& index, COutputSink& o_html) override;
+        void SetSortMemoryBudget(size_t memoryBudget) noexcept override
+        {
+            mOptions.mSortMemoryBudget = memoryBudget;
+        }
+        void SetThreadCount(unsigned int threadCount) noexcept override
+        {
+            mOptions.mThreadCount = threadCount;
+        }
+        void SetMemoryResource(std::pmr::memory_resource* memoryResource) noexcept override
+        {
+            mMemoryResource = memoryResource;
+        }
+        void SetRowCacheFile(const std::wstring& sFilePathName) override
+        {
+            msRowCacheFile = sFilePathName;
+        }
+        void SetPageOutput(CPageOutput* pageOutput, size_t pageSize) noexcept override
+        {
+            mOptions.mPageOutput = pageOutput;
+            mOptions.mPageSize = pageSize;
+        }
+    private:
+        CStatus Transform(std::string_view sXML, COutputSink& o_html);
+
+        CTransformOptions mOptions;
+        // Caller's memory resource (arena is used if it's nullptr)
+        std::pmr::memory_resource* mMemoryResource;
+        CConversionArena mArena;
+        // Rows are cached in that file between conversions if it isn't empty
+        std::wstring msRowCacheFile;
+    };
+
+#ifdef _WIN32
+    // Creates MSXML6 based engine (see win/MsXmlParserImpl.cpp)
+    std::unique_ptr<CXmlParserWrapper::CXmlParserWrapperImpl> CreateMsXmlParserImpl(
+        CXmlParserWrapper::EMXSLTFile xsltFileId, const wchar_t* sXSLTFilePathName);
+#endif
+}
+#endif
@@ -0,0 +1,652 @@
+// Contains implementation of OS-independent pull (streaming) XML tokenizer.
+
+#include "XmlPullParser.h"
+#include "Util.h"
+#include <sstream>
+#include <algorithm>
+#include <string.h>
+
+namespace OTInterviewExercise1
+{
+    namespace
+    {
+        enum CharClass : unsigned char
+        {
+            // Character stops text run ('<', '&', '\r')
+            CC_TEXT_STOP = 1,
+            // Character can start a name
+            CC_NAME_START = 2,
+            // Character can be used inside a name
+            CC_NAME = 4,
+            CC_WHITESPACE = 8
+        };
+
+        struct CCharClassTable
+        {
+            CCharClassTable() noexcept
+            {
+                memset(mClasses, 0, sizeof(mClasses));
+                mClasses[static_cast<unsigned char>('<')] |= CC_TEXT_STOP;
+                mClasses[static_cast<unsigned char>('&')] |= CC_TEXT_STOP;
+                mClasses[static_cast<unsigned char>('\r')] |= CC_TEXT_STOP;
+                for (int c = 'a'; c <= 'z'; ++c)
+                    mClasses[c] |= CC_NAME_START | CC_NAME;
+                for (int c = 'A'; c <= 'Z'; ++c)
+                    mClasses[c] |= CC_NAME_START | CC_NAME;
+                for (int c = '0'; c <= '9'; ++c)
+                    mClasses[c] |= CC_NAME;
+                // Non-ASCII UTF8 bytes are accepted as name characters
+                for (int c = 0x80; c <= 0xFF; ++c)
+                    mClasses[c] |= CC_NAME_START | CC_NAME;
+                mClasses[static_cast<unsigned char>('_')] |= CC_NAME_START | CC_NAME;
+                mClasses[static_cast<unsigned char>(':')] |= CC_NAME_START | CC_NAME;
+                mClasses[static_cast<unsigned char>('-')] |= CC_NAME;
+                mClasses[static_cast<unsigned char>('.')] |= CC_NAME;
+                mClasses[static_cast<unsigned char>(' ')] |= CC_WHITESPACE;
+                mClasses[static_cast<unsigned char>('\t')] |= CC_WHITESPACE;
+                mClasses[static_cast<unsigned char>('\r')] |= CC_WHITESPACE;
+                mClasses[static_cast<unsigned char>('\n')] |= CC_WHITESPACE;
+            }
+            bool Is(char c, CharClass cc) const noexcept
+            {
+                return (mClasses[static_cast<unsigned char>(c)] & cc) != 0;
+            }
+            unsigned char mClasses[256];
+        };
+
+        const CCharClassTable CharClasses;
+
+        // Encodes code point as UTF8. Returns number of bytes written.
+        size_t EncodeUtf8(unsigned int c, char* o_buf) noexcept
+        {
+            if (c < 0x80)
+            {
+                o_buf[0] = static_cast<char>(c);
+                return 1;
+            }
+            if (c < 0x800)
+            {
+                o_buf[0] = static_cast<char>(0xC0 | (c >> 6));
+                o_buf[1] = static_cast<char>(0x80 | (c & 0x3F));
+                return 2;
+            }
+            if (c < 0x10000)
+            {
+                o_buf[0] = static_cast<char>(0xE0 | (c >> 12));
+                o_buf[1] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+                o_buf[2] = static_cast<char>(0x80 | (c & 0x3F));
+                return 3;
+            }
+            o_buf[0] = static_cast<char>(0xF0 | (c >> 18));
+            o_buf[1] = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+            o_buf[2] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            o_buf[3] = static_cast<char>(0x80 | (c & 0x3F));
+            return 4;
+        }
+    }
+
+    CXmlPullParser::CXmlPullParser(std::string_view sXml, std::pmr::memory_resource* memoryResource) :
+        mXml(sXml),
+        mPos(0),
+        mInput(nullptr),
+        mWindow(memoryResource),
+        mWindowOffset(0),
+        mIsInputEnd(false),
+        mDepth(0),
+        mOpenElementNames(memoryResource),
+        mOpenElementStarts(memoryResource),
+        mAttributes(memoryResource),
+        mStartTagOffset(0),
+        mCDataEnd(0),
+        mCDataOffset(0),
+        mIsInCData(false),
+        mIsCDataEndFound(false),
+        mPendingEndElement(false),
+        mPendingDepthDecrement(false),
+        mRootClosed(false),
+        mRefBuf(),
+        mIsFailed(false)
+    {
+        // Skip UTF8 byte order mark
+        if (StartsWith("\xEF\xBB\xBF", 3))
+            mPos = 3;
+    }
+
+    CXmlPullParser::CXmlPullParser(CXmlInputSource& input, std::pmr::memory_resource* memoryResource) :
+        CXmlPullParser(std::string_view(), memoryResource)
+    {
+        mInput = &input;
+        EnsureLookahead();
+        if (StartsWith("\xEF\xBB\xBF", 3))
+            mPos = 3;
+    }
+
+    CXmlPullParser::Token CXmlPullParser::Next()
+    {
+        mText = std::string_view();
+        if (mIsFailed)
+            return Token::Error;
+        if (mPendingDepthDecrement)
+        {
+            mPendingDepthDecrement = false;
+            CloseElement();
+        }
+        if (mPendingEndElement)
+        {
+            mPendingEndElement = false;
+            mName = LastOpenElement();
+            mPendingDepthDecrement = true;
+            return Token::EndElement;
+        }
+        if (mIsInCData)
+            return ReadCDataText();
+
+        for (;;)
+        {
+            EnsureLookahead();
+            if (mPos >= mXml.size())
+            {
+                if (mDepth != 0)
+                    return Fail(L"Unexpected end of document. Not all elements are closed.");
+                if (!mRootClosed)
+                    return Fail(L"Document doesn't have root element.");
+                return Token::EndOfDocument;
+            }
+            char c = mXml[mPos];
+            if (c == '<')
+            {
+                if (StartsWith("</", 2))
+                    return ReadEndElement();
+                if (StartsWith("<?", 2))
+                {
+                    // XML declaration or processing instruction
+                    if (!SkipPast("?>", 2))
+                        return Token::Error;
+                    continue;
+                }
+                if (StartsWith("<!--", 4))
+                {
+                    mPos += 4;
+                    if (!SkipPast("-->", 3))
+                        return Token::Error;
+                    continue;
+                }
+                if (StartsWith("<![CDATA[", 9))
+                {
+                    if (mDepth == 0)
+                        return Fail(L"CDATA section isn't allowed outside of root element.");
+                    mPos += 9;
+                    mIsInCData = true;
+                    mIsCDataEndFound = false;
+                    mCDataEnd = mPos;
+                    mCDataOffset = Offset();
+                    return ReadCDataText();
+                }
+                if (StartsWith("<!DOCTYPE", 9))
+                {
+                    if (mDepth != 0 || mRootClosed)
+                        return Fail(L"DOCTYPE declaration must precede root element.");
+                    if (!SkipDoctype())
+                        return Token::Error;
+                    continue;
+                }
+                if (StartsWith("<!", 2))
+                    return Fail(L"Invalid markup declaration.");
+                return ReadStartElement();
+            }
+            if (mDepth == 0)
+            {
+                if (!CharClasses.Is(c, CC_WHITESPACE))
+                    return Fail(L"Text isn't allowed outside of root element.");
+                SkipWhitespace();
+                continue;
+            }
+            return ReadText();
+        }
+    }
+
+    CXmlPullParser::Token CXmlPullParser::Fail(const wchar_t* sError) noexcept
+    {
+        return Fail(Offset(), sError);
+    }
+
+    CXmlPullParser::Token CXmlPullParser::Fail(uint64_t offset, const wchar_t* sError) noexcept
+    {
+        mIsFailed = true;
+        mError = CError(0, sError, nullptr, 0, offset);
+        mText = std::string_view();
+        return Token::Error;
+    }
+
+    bool CXmlPullParser::StartsWith(const char* sPrefix, size_t prefixLen) const noexcept
+    {
+        return mXml.size() - mPos >= prefixLen && memcmp(mXml.data() + mPos, sPrefix, prefixLen) == 0;
+    }
+
+    bool CXmlPullParser::SkipPast(const char* sTerminator, size_t terminatorLen)
+    {
+        // Errors are reported at offset of the skipped markup (as by whole document)
+        uint64_t offset = Offset();
+        for (;;)
+        {
+            size_t pos = mXml.find(std::string_view(sTerminator, terminatorLen), mPos);
+            if (pos != std::string_view::npos)
+            {
+                mPos = pos + terminatorLen;
+                return true;
+            }
+            // Searched bytes are discarded by Refill(), so that long comment doesn't grow
+            // the window. Terminator might be split between chunks - so its possible
+            // beginning is kept.
+            mPos = std::max(mPos, mXml.size() - std::min(mXml.size(), terminatorLen - 1));
+            if (!Refill())
+            {
+                Fail(offset, L"Unexpected end of document. Markup isn't terminated.");
+                return false;
+            }
+        }
+    }
+
+    bool CXmlPullParser::Refill()
+    {
+        if (mInput == nullptr || mIsInputEnd)
+            return false;
+        std::string_view sChunk = mInput->NextChunk();
+        if (sChunk.empty())
+        {
+            mIsInputEnd = true;
+            return false;
+        }
+        // Tokens before the current one aren't referenced anymore. They're discarded
+        // once they take half of the window, so bytes are moved once on average.
+        if (mPos != 0 && mPos >= mWindow.size() / 2)
+        {
+            mWindow.erase(mWindow.begin(), mWindow.begin() + mPos);
+            mWindowOffset += mPos;
+            mPos = 0;
+        }
+        mWindow.insert(mWindow.end(), sChunk.begin(), sChunk.end());
+        mXml = std::string_view(mWindow.data(), mWindow.size());
+        return true;
+    }
+
+    void CXmlPullParser::EnsureLookahead()
+    {
+        while (mXml.size() - mPos < MIN_LOOKAHEAD && Refill())
+        {}
+    }
+
+    void CXmlPullParser::LoadStartTag()
+    {
+        // Attribute values might contain '>' characters
+        char quote = 0;
+        size_t pos = mPos + 1;
+        for (;;)
+        {
+            for (; pos < mXml.size(); ++pos)
+            {
+                char c = mXml[pos];
+                if (quote != 0)
+                {
+                    if (c == quote)
+                        quote = 0;
+                }
+                else if (c == '"' || c == '\'')
+                {
+                    quote = c;
+                }
+                else if (c == '>')
+                {
+                    return;
+                }
+            }
+            uint64_t resumeOffset = mWindowOffset + pos;
+            // Unterminated tag is reported by ReadStartElement()
+            if (!Refill())
+                return;
+            pos = static_cast<size_t>(resumeOffset - mWindowOffset);
+        }
+    }
+
+    void CXmlPullParser::LoadEndTag()
+    {
+        size_t pos = mPos + 2;
+        for (;;)
+        {
+            pos = mXml.find('>', pos);
+            if (pos != std::string_view::npos)
+                return;
+            uint64_t resumeOffset = mWindowOffset + mXml.size();
+            // Unterminated tag is reported by ReadEndElement()
+            if (!Refill())
+                return;
+            pos = static_cast<size_t>(resumeOffset - mWindowOffset);
+        }
+    }
+
+    bool CXmlPullParser::ReadName(std::string_view& o_name)
+    {
+        size_t start = mPos;
+        if (mPos >= mXml.size() || !CharClasses.Is(mXml[mPos], CC_NAME_START))
+        {
+            Fail(L"Invalid name.");
+            return false;
+        }
+        ++mPos;
+        while (mPos < mXml.size() && CharClasses.Is(mXml[mPos], CC_NAME))
+            ++mPos;
+        o_name = mXml.substr(start, mPos - start);
+        return true;
+    }
+
+    void CXmlPullParser::SkipWhitespace() noexcept
+    {
+        while (mPos < mXml.size() && CharClasses.Is(mXml[mPos], CC_WHITESPACE))
+            ++mPos;
+    }
+
+    bool CXmlPullParser::SkipDoctype()
+    {
+        // Internal subset (in square brackets) might contain '>' characters, as well as
+        // quoted literals.
+        size_t bracketDepth = 0;
+        char quote = 0;
+        size_t pos = mPos + 9;
+        for (;; ++pos)
+        {
+            if (pos >= mXml.size())
+            {
+                uint64_t resumeOffset = mWindowOffset + pos;
+                if (!Refill())
+                    break;
+                pos = static_cast<size_t>(resumeOffset - mWindowOffset);
+            }
+            char c = mXml[pos];
+            if (quote != 0)
+            {
+                if (c == quote)
+                    quote = 0;
+            }
+            else if (c == '"' || c == '\'')
+            {
+                quote = c;
+            }
+            else if (c == '[')
+            {
+                ++bracketDepth;
+            }
+            else if (c == ']' && bracketDepth != 0)
+            {
+                --bracketDepth;
+            }
+            else if (c == '>' && bracketDepth == 0)
+            {
+                mPos = pos + 1;
+                return true;
+            }
+        }
+        Fail(L"Unexpected end of document. DOCTYPE declaration isn't terminated.");
+        return false;
+    }
+
+    CXmlPullParser::Token CXmlPullParser::ReadStartElement()
+    {
+        if (mDepth == 0 && mRootClosed)
+            return Fail(L"Document can contain only one root element.");
+        if (mInput != nullptr)
+            LoadStartTag();
+        mStartTagOffset = Offset();
+        ++mPos;
+        std::string_view name;
+        if (!ReadName(name))
+            return Token::Error;
+        mAttributes.clear();
+        for (;;)
+        {
+            bool hadWhitespace = mPos < mXml.size() && CharClasses.Is(mXml[mPos], CC_WHITESPACE);
+            SkipWhitespace();
+            if (mPos >= mXml.size())
+                return Fail(L"Unexpected end of document inside start tag.");
+            char c = mXml[mPos];
+            if (c == '>')
+            {
+                ++mPos;
+                break;
+            }
+            if (c == '/')
+            {
+                if (!StartsWith("/>", 2))
+                    return Fail(L"Invalid empty element tag.");
+                mPos += 2;
+                mPendingEndElement = true;
+                break;
+            }
+            if (!hadWhitespace)
+                return Fail(L"Whitespace is required between attributes.");
+            std::string_view attributeName;
+            if (!ReadName(attributeName))
+                return Token::Error;
+            SkipWhitespace();
+            if (mPos >= mXml.size() || mXml[mPos] != '=')
+                return Fail(L"Attribute value is missing.");
+            ++mPos;
+            SkipWhitespace();
+            if (mPos >= mXml.size() || (mXml[mPos] != '"' && mXml[mPos] != '\''))
+                return Fail(L"Attribute value must be quoted.");
+            char quote = mXml[mPos];
+            size_t valueEnd = mXml.find(quote, mPos + 1);
+            if (valueEnd == std::string_view::npos)
+                return Fail(L"Unexpected end of document inside attribute value.");
+            if (mXml.substr(mPos + 1, valueEnd - mPos - 1).find('<') != std::string_view::npos)
+                return Fail(L"Character '<' isn't allowed in attribute value.");
+            mAttributes.push_back({ attributeName, mXml.substr(mPos + 1, valueEnd - mPos - 1) });
+            mPos = valueEnd + 1;
+        }
+        mOpenElementStarts.push_back(mOpenElementNames.size());
+        mOpenElementNames.append(name);
+        ++mDepth;
+        mName = name;
+        return Token::StartElement;
+    }
+
+    CXmlPullParser::Token CXmlPullParser::ReadEndElement()
+    {
+        if (mInput != nullptr)
+            LoadEndTag();
+        mPos += 2;
+        std::string_view name;
+        if (!ReadName(name))
+            return Token::Error;
+        SkipWhitespace();
+        if (mPos >= mXml.size() || mXml[mPos] != '>')
+            return Fail(L"Invalid end tag.");
+        if (mDepth == 0 || LastOpenElement() != name)
+            return Fail(L"End tag doesn't match start tag.");
+        ++mPos;
+        mName = name;
+        mPendingDepthDecrement = true;
+        return Token::EndElement;
+    }
+
+    CXmlPullParser::Token CXmlPullParser::ReadText()
+    {
+        char c = mXml[mPos];
+        if (c == '&')
+            return ReadReference() ? Token::Text : Token::Error;
+        if (c == '\r')
+        {
+            // Line ends are normalized to '\n'
+            ++mPos;
+            if (mPos < mXml.size() && mXml[mPos] == '\n')
+                ++mPos;
+            mText = std::string_view("\n", 1);
+            return Token::Text;
+        }
+        size_t start = mPos;
+        while (mPos < mXml.size() && !CharClasses.Is(mXml[mPos], CC_TEXT_STOP))
+            ++mPos;
+        mText = mXml.substr(start, mPos - start);
+        return Token::Text;
+    }
+
+    CXmlPullParser::Token CXmlPullParser::ReadCDataText()
+    {
+        while (mPos >= mCDataEnd)
+        {
+            if (mIsCDataEndFound)
+            {
+                mPos = mCDataEnd + 3;
+                mIsInCData = false;
+                return Next();
+            }
+            if (!FindCDataEnd())
+                return Token::Error;
+        }
+        if (mXml[mPos] == '\r')
+        {
+            // Byte after '\r' is in the window (terminator isn't split)
+            ++mPos;
+            if (mXml[mPos] == '\n')
+                ++mPos;
+            mText = std::string_view("\n", 1);
+            return Token::Text;
+        }
+        size_t start = mPos;
+        while (mPos < mCDataEnd && mXml[mPos] != '\r')
+            ++mPos;
+        mText = mXml.substr(start, mPos - start);
+        return Token::Text;
+    }
+
+    bool CXmlPullParser::FindCDataEnd()
+    {
+        for (;;)
+        {
+            size_t pos = mXml.find("]]>", mPos);
+            if (pos != std::string_view::npos)
+            {
+                mCDataEnd = pos;
+                mIsCDataEndFound = true;
+                return true;
+            }
+            // Text before possible beginning of split terminator is returned before more
+            // input is pulled (returned text is discarded by Refill()) - so long CDATA
+            // section doesn't grow the window
+            mCDataEnd = std::max(mPos, mXml.size() - std::min<size_t>(mXml.size(), 2));
+            if (mCDataEnd > mPos)
+                return true;
+            if (!Refill())
+            {
+                Fail(mCDataOffset, L"Unexpected end of document. Markup isn't terminated.");
+                return false;
+            }
+        }
+    }
+
+    bool CXmlPullParser::ReadReference()
+    {
+        // Longest valid reference is "&#x10FFFF;"
+        const size_t maxRefLen = 10;
+        size_t semicolon = mXml.find(';', mPos + 1);
+        if (semicolon == std::string_view::npos || semicolon - mPos > maxRefLen || semicolon == mPos + 1)
+        {
+            Fail(L"Invalid reference.");
+            return false;
+        }
+        std::string_view ref = mXml.substr(mPos + 1, semicolon - mPos - 1);
+        size_t len = 1;
+        if (ref == "amp")
+            mRefBuf[0] = '&';
+        else if (ref == "lt")
+            mRefBuf[0] = '<';
+        else if (ref == "gt")
+            mRefBuf[0] = '>';
+        else if (ref == "quot")
+            mRefBuf[0] = '"';
+        else if (ref == "apos")
+            mRefBuf[0] = '\'';
+        else if (ref[0] == '#')
+        {
+            bool isHex = ref.size() > 1 && ref[1] == 'x';
+            size_t i = isHex ? 2 : 1;
+            if (i >= ref.size())
+            {
+                Fail(L"Invalid character reference.");
+                return false;
+            }
+            unsigned int codePoint = 0;
+            for (; i < ref.size(); ++i)
+            {
+                char c = ref[i];
+                unsigned int digit = 0;
+                if (c >= '0' && c <= '9')
+                    digit = c - '0';
+                else if (isHex && c >= 'a' && c <= 'f')
+                    digit = c - 'a' + 10;
+                else if (isHex && c >= 'A' && c <= 'F')
+                    digit = c - 'A' + 10;
+                else
+                {
+                    Fail(L"Invalid character reference.");
+                    return false;
+                }
+                codePoint = codePoint * (isHex ? 16 : 10) + digit;
+                if (codePoint > 0x10FFFF)
+                {
+                    Fail(L"Character reference is out of range.");
+                    return false;
+                }
+            }
+            bool isValidChar = codePoint == 0x9 || codePoint == 0xA || codePoint == 0xD ||
+                (codePoint >= 0x20 && codePoint <= 0xD7FF) ||
+                (codePoint >= 0xE000 && codePoint <= 0xFFFD) ||
+                codePoint >= 0x10000;
+            if (!isValidChar)
+            {
+                Fail(L"Character reference refers to invalid character.");
+                return false;
+            }
+            len = EncodeUtf8(codePoint, mRefBuf);
+        }
+        else
+        {
+            Fail(L"Reference to undefined entity.");
+            return false;
+        }
+        mText = std::string_view(mRefBuf, len);
+        mPos = semicolon + 1;
+        return true;
+    }
+
+    void CXmlPullParser::SkipElement(size_t endOffset)
+    {
+        if (mInput != nullptr || mDepth == 0 || mPendingEndElement || mPendingDepthDecrement || mIsInCData ||
+            endOffset < mPos || endOffset > mXml.size())
+        {
+            THROW_ERROR(L"Element can't be skipped.");
+        }
+        mPos = endOffset;
+        CloseElement();
+    }
+
+    std::string_view CXmlPullParser::LastOpenElement() const noexcept
+    {
+        return std::string_view(mOpenElementNames).substr(mOpenElementStarts.back());
+    }
+
+    void CXmlPullParser::CloseElement()
+    {
+        mOpenElementNames.resize(mOpenElementStarts.back());
+        mOpenElementStarts.pop_back();
+        --mDepth;
+        if (mDepth == 0)
+            mRootClosed = true;
+    }
+
+    std::wstring FormatParseError(const CError& error)
+    {
+        std::wostringstream ss;
+        ss << L"XML parse error at offset " << error.mOffset << L". " << error.mErrorDescription;
+        return ss.str();
+    }
+}
@@ -0,0 +1,166 @@
+// Contains declaration of OS-independent pull (streaming) XML tokenizer. It's used by
+// the native conversion engine instead of building a DOM.
+#ifndef OT_XMLPULLPARSER_H__
+#define OT_XMLPULLPARSER_H__
+
+#include "Util.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory_resource>
+#include <stdint.h>
+
+namespace OTInterviewExercise1
+{
+    // Supplies document to CXmlPullParser in chunks (e.g. as they're read from file)
+    class CXmlInputSource
+    {
+    public:
+        virtual ~CXmlInputSource() = default;
+        // Returns next chunk of the document (empty one at end of document). Chunk must
+        // stay valid until the following call. Errors are reported by throwing CException.
+        virtual std::string_view NextChunk() = 0;
+    };
+
+    // Tokenizes UTF8 XML document in a single pass. Each call to Next() returns the next
+    // token; names and text returned by Name()/Text() stay valid until the following call
+    // to Next(). Document well-formedness (tag nesting, single root element, references)
+    // is verified while tokenizing. Malformed document is an expected failure: Next()
+    // returns Error token and GetStatus() tells what's wrong (nothing is allocated). Failures
+    // of input source and memory allocation errors are thrown.
+    // DTD contents are skipped, so only predefined and character references are supported.
+    class CXmlPullParser
+    {
+    public:
+        enum class Token
+        {
+            StartElement,
+            EndElement,
+            // Piece of element text (character data, CDATA section or decoded reference).
+            // Text of a single text node might be returned as several consecutive pieces.
+            Text,
+            EndOfDocument,
+            // Document is malformed (see GetStatus()). It's returned by all following calls.
+            Error
+        };
+
+        // Attribute of element. Value is raw: references in it aren't decoded.
+        struct CAttribute
+        {
+            std::string_view mName;
+            std::string_view mValue;
+        };
+
+        // sXml must stay valid during lifetime of the parser. Element stack and attributes
+        // are allocated from memoryResource.
+        explicit CXmlPullParser(std::string_view sXml,
+            std::pmr::memory_resource* memoryResource = std::pmr::get_default_resource());
+        // Document is pulled from input as it's tokenized. Chunks are copied into a window
+        // that holds the current token (it grows only for markup that's longer than a
+        // chunk, e.g. a large CDATA section) - so memory doesn't depend on document size.
+        explicit CXmlPullParser(CXmlInputSource& input,
+            std::pmr::memory_resource* memoryResource = std::pmr::get_default_resource());
+        ~CXmlPullParser() = default;
+
+        CXmlPullParser(const CXmlPullParser&) = delete;
+        CXmlPullParser& operator=(const CXmlPullParser&) = delete;
+
+        Token Next();
+        // Error of malformed document (its offset is CError::mOffset) or success if Error
+        // token wasn't returned
+        CStatus GetStatus() const noexcept
+        {
+            return mIsFailed ? CStatus(mError) : CStatus();
+        }
+        // Element name of StartElement/EndElement token
+        std::string_view Name() const noexcept { return mName; }
+        // Contents of Text token
+        std::string_view Text() const noexcept { return mText; }
+        // Attributes of StartElement token (in document order)
+        const std::pmr::vector<CAttribute>& Attributes() const noexcept { return mAttributes; }
+        // Number of open elements. For EndElement token it includes the closed element.
+        size_t Depth() const noexcept { return mDepth; }
+        // Byte offset of parser in the document (64-bit: streamed documents may exceed
+        // address space)
+        uint64_t Offset() const noexcept { return mWindowOffset + mPos; }
+        // Byte offset of '<' of the last StartElement token
+        uint64_t StartTagOffset() const noexcept { return mStartTagOffset; }
+        // True if the last StartElement token was an empty element tag (e.g. <CD/>)
+        bool IsEmptyElement() const noexcept { return mPendingEndElement; }
+        // Whole document (parser that pulls input source returns its current window)
+        std::string_view Document() const noexcept { return mXml; }
+        // True if parser pulls input source (Document() and SkipElement() aren't available)
+        bool IsStreaming() const noexcept { return mInput != nullptr; }
+        // Skips contents and end tag of the element that was just started (no EndElement
+        // token is returned for it). Caller must know that the element is well-formed and
+        // ends at endOffset (e.g. its bytes are identical to an element parsed before) -
+        // misuse is thrown.
+        void SkipElement(size_t endOffset);
+
+        // Tokens are started only when at least that many bytes of the document (or its
+        // rest) are in the window
+        static constexpr size_t MIN_LOOKAHEAD = 64 * 1024;
+    private:
+        // Records error of malformed document (sError is a string literal) and returns
+        // Error token. Functions that return bool return false after it.
+        Token Fail(const wchar_t* sError) noexcept;
+        Token Fail(uint64_t offset, const wchar_t* sError) noexcept;
+        bool StartsWith(const char* sPrefix, size_t prefixLen) const noexcept;
+        // Moves mPos past terminator (input is pulled until it's found)
+        bool SkipPast(const char* sTerminator, size_t terminatorLen);
+        // Appends next chunk of input to the window discarding bytes before mPos.
+        // Returns false at end of input (or if parser doesn't have input source).
+        bool Refill();
+        void EnsureLookahead();
+        // Pull input until '>' that ends start/end tag at mPos is in the window
+        void LoadStartTag();
+        void LoadEndTag();
+        std::string_view LastOpenElement() const noexcept;
+        bool ReadName(std::string_view& o_name);
+        void SkipWhitespace() noexcept;
+        bool SkipDoctype();
+        Token ReadStartElement();
+        Token ReadEndElement();
+        Token ReadText();
+        Token ReadCDataText();
+        // Sets mCDataEnd to the end of CDATA section or of its part in the window
+        bool FindCDataEnd();
+        bool ReadReference();
+        void CloseElement();
+
+        // Whole document or the window that input source is copied into
+        std::string_view mXml;
+        size_t mPos;
+        CXmlInputSource* mInput;
+        std::pmr::vector<char> mWindow;
+        // Offset of the window in the document
+        uint64_t mWindowOffset;
+        bool mIsInputEnd;
+        size_t mDepth;
+        std::string_view mName;
+        std::string_view mText;
+        // Names of open elements are copied (window is overwritten): mOpenElementNames
+        // contains them one after another, mOpenElementStarts - their offsets in it
+        std::pmr::string mOpenElementNames;
+        std::pmr::vector<size_t> mOpenElementStarts;
+        std::pmr::vector<CAttribute> mAttributes;
+        uint64_t mStartTagOffset;
+        // End of current CDATA section in the window (if mIsCDataEndFound), otherwise end
+        // of its part that can be returned
+        size_t mCDataEnd;
+        // Document offset of CDATA contents (for errors)
+        uint64_t mCDataOffset;
+        bool mIsInCData;
+        bool mIsCDataEndFound;
+        bool mPendingEndElement;
+        bool mPendingDepthDecrement;
+        bool mRootClosed;
+        char mRefBuf[4];
+        bool mIsFailed;
+        CError mError;
+    };
+
+    // Formats message of error of malformed document ("XML parse error at offset ...")
+    std::wstring FormatParseError(const CError& error);
+}
+#endif
@@ -0,0 +1,755 @@
+// Benchmark of conversion phases. Synthetic CATALOG/CD documents of given sizes are
+// generated into a work directory, then every phase (read, decode, parse, sort, render,
+// write) is timed separately through the public classes of the converter, as well as
+// whole conversion through CXmlParserWrapper. HTML escaping kernels are benchmarked on
+// their own (on generated field texts). Results are written as JSON, so that runs of
+// different releases can be compared.
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <filesystem>
+#include <algorithm>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include "../XmlParserWrapper.h"
+#include "../XmlPullParser.h"
+#include "../CatalogEngine.h"
+#include "../CatalogRecordSorter.h"
+#include "../Utf8Transcoder.h"
+#include "../HtmlEscaper.h"
+#include "../OutputSink.h"
+#include "../Util.h"
+
+using namespace OTInterviewExercise1;
+
+// Every allocation of the process is counted (phases report the difference). All global
+// allocation functions are replaced, so that every form of new and delete (array,
+// nothrow, aligned, sized) goes to the same allocator.
+static std::atomic<uint64_t> allocationCount(0);
+
+static void* AllocateMemory(size_t size, size_t alignment) noexcept
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (alignment < __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+    {
+        alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+    }
+    // Size of aligned_alloc() has to be a non-zero multiple of alignment
+    size = size != 0 ? (size + alignment - 1) / alignment * alignment : alignment;
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    return aligned_alloc(alignment, size);
+#endif
+}
+
+static void FreeMemory(void* p) noexcept
+{
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+static void* AllocateMemoryOrThrow(size_t size, size_t alignment)
+{
+    void* p = AllocateMemory(size, alignment);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size)
+{
+    return AllocateMemoryOrThrow(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new[](size_t size)
+{
+    return AllocateMemoryOrThrow(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    return AllocateMemoryOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    return AllocateMemoryOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return AllocateMemory(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return AllocateMemory(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return AllocateMemory(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return AllocateMemory(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* p) noexcept
+{
+    FreeMemory(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    FreeMemory(p);
+}
+
+void operator delete(void* p, size_t /*size*/) noexcept
+{
+    FreeMemory(p);
+}
+
+void operator delete[](void* p, size_t /*size*/) noexcept
+{
+    FreeMemory(p);
+}
+
+void operator delete(void* p, std::align_val_t /*alignment*/) noexcept
+{
+    FreeMemory(p);
+}
+
+void operator delete[](void* p, std::align_val_t /*alignment*/) noexcept
+{
+    FreeMemory(p);
+}
+
+void operator delete(void* p, size_t /*size*/, std::align_val_t /*alignment*/) noexcept
+{
+    FreeMemory(p);
+}
+
+void operator delete[](void* p, size_t /*size*/, std::align_val_t /*alignment*/) noexcept
+{
+    FreeMemory(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    FreeMemory(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    FreeMemory(p);
+}
+
+void operator delete(void* p, std::align_val_t /*alignment*/, const std::nothrow_t&) noexcept
+{
+    FreeMemory(p);
+}
+
+void operator delete[](void* p, std::align_val_t /*alignment*/, const std::nothrow_t&) noexcept
+{
+    FreeMemory(p);
+}
+
+namespace
+{
+    // Parameters of generated documents
+    struct CGeneratorOptions
+    {
+        CGeneratorOptions() :
+            mMinFieldLength(4),
+            mMaxFieldLength(24),
+            mUnicodeRatio(0.05),
+            mMissingRatio(0.02),
+            mArtistCount(1000),
+            mSeed(1)
+        {}
+        // Length of text fields (in characters)
+        size_t mMinFieldLength;
+        size_t mMaxFieldLength;
+        // Fraction of characters of text fields that are non-ASCII (2, 3 and 4 byte UTF8)
+        double mUnicodeRatio;
+        // Probability of a field element being omitted
+        double mMissingRatio;
+        // Number of distinct artists (records share artists when there are more records)
+        size_t mArtistCount;
+        uint64_t mSeed;
+    };
+
+    // xorshift64* - generated documents depend on the seed only
+    class CRandom
+    {
+    public:
+        explicit CRandom(uint64_t seed) :
+            mState(seed != 0 ? seed : 0x9E3779B97F4A7C15ull)
+        {}
+        uint64_t Next() noexcept
+        {
+            mState ^= mState >> 12;
+            mState ^= mState << 25;
+            mState ^= mState >> 27;
+            return mState * 0x2545F4914F6CDD1Dull;
+        }
+        // Uniform in [0, count)
+        size_t Below(size_t count) noexcept
+        {
+            return static_cast<size_t>(Next() % count);
+        }
+        // Uniform in [0, 1)
+        double Fraction() noexcept
+        {
+            return (Next() >> 11) * (1.0 / 9007199254740992.0);
+        }
+    private:
+        uint64_t mState;
+    };
+
+    // Generates UTF8 text of a field (XML-escaped)
+    void AppendText(const CGeneratorOptions& options, CRandom& random, std::string& o_sXml)
+    {
+        static const char* const NON_ASCII[] = { "\xC3\xA9", "\xC3\x9F", "\xD0\x96", "\xE2\x82\xAC", "\xE4\xB8\xAD",
+            "\xE6\x97\xA5", "\xF0\x9F\x8E\xB5" };
+        static const char ASCII[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789     ";
+        size_t length = options.mMinFieldLength +
+            random.Below(options.mMaxFieldLength - options.mMinFieldLength + 1);
+        for (size_t i = 0; i < length; ++i)
+        {
+            if (random.Fraction() < options.mUnicodeRatio)
+            {
+                o_sXml += NON_ASCII[random.Below(sizeof(NON_ASCII) / sizeof(NON_ASCII[0]))];
+            }
+            else if (random.Below(100) == 0)
+            {
+                // Characters that have to be escaped in HTML, too
+                o_sXml += random.Below(2) == 0 ? "&amp;" : "&lt;";
+            }
+            else
+            {
+                o_sXml += ASCII[random.Below(sizeof(ASCII) - 1)];
+            }
+        }
+    }
+
+    // Writes document of about size bytes. Returns number of CD elements.
+    uint64_t GenerateCatalog(const CGeneratorOptions& options, uint64_t size, const std::wstring& sFilePathName)
+    {
+        CRandom random(options.mSeed);
+        std::vector<std::string> artists(std::max<size_t>(options.mArtistCount, 1));
+        for (auto& sArtist : artists)
+        {
+            AppendText(options, random, sArtist);
+        }
+        CFileOutputSink file(sFilePathName.c_str(), size);
+        std::string sXml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<CATALOG>\n";
+        const std::string sEnd = "</CATALOG>\n";
+        uint64_t numRecords = 0;
+        auto appendField = [&](const char* sName, const std::string& sValue) {
+            if (random.Fraction() < options.mMissingRatio)
+                return;
+            sXml += "<";
+            sXml += sName;
+            sXml += ">";
+            sXml += sValue;
+            sXml += "</";
+            sXml += sName;
+            sXml += ">";
+        };
+        std::string sValue;
+        while (file.GetSize() + sXml.size() + sEnd.size() < size || numRecords == 0)
+        {
+            sXml += "<CD>";
+            sValue.clear();
+            AppendText(options, random, sValue);
+            appendField("TITLE", sValue);
+            appendField("ARTIST", artists[random.Below(artists.size())]);
+            sValue.clear();
+            AppendText(options, random, sValue);
+            appendField("COUNTRY", sValue);
+            sValue.clear();
+            AppendText(options, random, sValue);
+            appendField("COMPANY", sValue);
+            appendField("PRICE", std::to_string(random.Below(30)) + "." + std::to_string(10 + random.Below(90)));
+            appendField("YEAR", std::to_string(1950 + random.Below(75)));
+            sXml += "</CD>\n";
+            numRecords++;
+            if (sXml.size() >= 1024 * 1024)
+            {
+                file.Write(sXml.data(), sXml.size());
+                sXml.clear();
+            }
+        }
+        sXml += sEnd;
+        file.Write(sXml.data(), sXml.size());
+        file.Close();
+        return numRecords;
+    }
+
+    enum class EMPhase
+    {
+        Read, // Mapping of XML file by CTextFileReader (every page is touched)
+        Decode, // UTF8 validation
+        Parse, // Pulling CD records
+        Sort, // Sorting of records by ARTIST (external sort above its memory budget)
+        Render, // Rendering of HTML
+        Write, // Writing of HTML file
+        Convert, // Whole conversion of mapped document by CXmlParserWrapper (parse, transform, write)
+        Count
+    };
+
+    const char* const PHASE_NAMES[] = { "read", "decode", "parse", "sort", "render", "write", "convert" };
+
+    struct CPhaseResult
+    {
+        CPhaseResult() :
+            mSeconds(0),
+            mAllocations(0)
+        {}
+        double mSeconds;
+        uint64_t mAllocations;
+    };
+
+    // Accumulates time and allocations of a phase while it's alive
+    class CPhaseTimer
+    {
+    public:
+        explicit CPhaseTimer(CPhaseResult& o_result) :
+            mResult(o_result),
+            mStartTime(std::chrono::steady_clock::now()),
+            mStartAllocations(allocationCount.load(std::memory_order_relaxed))
+        {}
+        ~CPhaseTimer()
+        {
+            mResult.mSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - mStartTime).count();
+            mResult.mAllocations += allocationCount.load(std::memory_order_relaxed) - mStartAllocations;
+        }
+    private:
+        CPhaseResult& mResult;
+        std::chrono::steady_clock::time_point mStartTime;
+        uint64_t mStartAllocations;
+    };
+
+    // Runs all phases once. Records are moved between phases in batches, so memory use
+    // doesn't depend on size of the document (the sorter keeps records within its budget).
+    void RunPhases(const std::wstring& sXmlFilePathName, const std::wstring& sHtmlFilePathName,
+        CPhaseResult (&o_phases)[static_cast<size_t>(EMPhase::Count)], uint64_t& o_numRecords)
+    {
+        const size_t BATCH_SIZE = 1024;
+        const size_t WRITE_SIZE = 1024 * 1024;
+        auto phase = [&o_phases](EMPhase phaseId) -> CPhaseResult& {
+            return o_phases[static_cast<size_t>(phaseId)];
+        };
+        std::wstring sErrorMsg;
+        std::string_view sXml;
+        std::unique_ptr<CTextFileReader> xmlFile;
+        {
+            CPhaseTimer timer(phase(EMPhase::Read));
+            xmlFile = std::make_unique<CTextFileReader>(sXmlFilePathName.c_str(), CTextFileReader::ReadMode::Map);
+            if (!xmlFile->GetBytes(sXml, sErrorMsg))
+            {
+                THROW_ERROR(sErrorMsg.c_str());
+            }
+            volatile unsigned char sum = 0;
+            for (size_t i = 0; i < sXml.size(); i += 4096)
+            {
+                sum += static_cast<unsigned char>(sXml[i]);
+            }
+        }
+        {
+            CPhaseTimer timer(phase(EMPhase::Decode));
+            if (!CUtf8Transcoder::Validate(sXml))
+            {
+                THROW_ERROR(L"Generated document isn't valid UTF8");
+            }
+        }
+
+        std::vector<CCatalogRecord> records(BATCH_SIZE);
+        CCatalogRecordSorter sorter(ECatalogField::Artist, CTransformOptions::DEFAULT_SORT_MEMORY_BUDGET);
+        CXmlPullParser parser(sXml);
+        CCatalogReader reader(parser);
+        o_numRecords = 0;
+        for (bool isEnd = false; !isEnd;)
+        {
+            size_t count = 0;
+            {
+                CPhaseTimer timer(phase(EMPhase::Parse));
+                while (count < records.size() && reader.Next(records[count]))
+                    count++;
+            }
+            isEnd = count < records.size();
+            o_numRecords += count;
+            CPhaseTimer timer(phase(EMPhase::Sort));
+            for (size_t i = 0; i < count; ++i)
+            {
+                sorter.Add(records[i]);
+            }
+        }
+        CStatus status = reader.GetStatus();
+        if (!status)
+        {
+            THROW_ERROR(FormatParseError(status.GetError()).c_str());
+        }
+        {
+            CPhaseTimer timer(phase(EMPhase::Sort));
+            sorter.Sort();
+        }
+
+        std::pmr::string sHtml;
+        std::unique_ptr<CFileOutputSink> htmlFile;
+        {
+            CPhaseTimer timer(phase(EMPhase::Write));
+            htmlFile = std::make_unique<CFileOutputSink>(sHtmlFilePathName.c_str(), sXml.size());
+        }
+        {
+            CPhaseTimer timer(phase(EMPhase::Render));
+            sHtml.reserve(WRITE_SIZE + 64 * 1024);
+            CCatalogHtmlRenderer::WriteHeader(sHtml);
+        }
+        for (bool isEnd = false; !isEnd;)
+        {
+            size_t count = 0;
+            {
+                CPhaseTimer timer(phase(EMPhase::Sort));
+                while (count < records.size() && sorter.Next(records[count]))
+                    count++;
+            }
+            isEnd = count < records.size();
+            {
+                CPhaseTimer timer(phase(EMPhase::Render));
+                for (size_t i = 0; i < count; ++i)
+                {
+                    CCatalogHtmlRenderer::WriteRow(records[i], sHtml);
+                }
+                if (isEnd)
+                {
+                    CCatalogHtmlRenderer::WriteFooter(sHtml);
+                }
+            }
+            if (sHtml.size() >= WRITE_SIZE || isEnd)
+            {
+                CPhaseTimer timer(phase(EMPhase::Write));
+                htmlFile->Write(sHtml.data(), sHtml.size());
+                sHtml.clear();
+            }
+        }
+        {
+            CPhaseTimer timer(phase(EMPhase::Write));
+            htmlFile->Close();
+        }
+
+        CPhaseTimer timer(phase(EMPhase::Convert));
+        CXmlParserWrapper xmlParser(CXmlParserWrapper::EMXSLTFile::CatalogResources);
+        CFileOutputSink convertedFile(sHtmlFilePathName.c_str(), sXml.size());
+        if (!xmlParser.Parse(sXml, convertedFile, sErrorMsg))
+        {
+            THROW_ERROR(sErrorMsg.c_str());
+        }
+        convertedFile.Close();
+    }
+
+    // Times escaping of generated field texts by every supported kernel (and the automatic
+    // choice): field by field (as rows are rendered) and as one text. Writes JSON object of results.
+    void RunEscapeBenchmark(const CGeneratorOptions& options, unsigned int iterations, std::ostream& o_json)
+    {
+        const size_t TEXT_SIZE = 16 * 1024 * 1024;
+        const size_t FLUSH_SIZE = 1024 * 1024;
+        CRandom random(options.mSeed);
+        std::string sText;
+        std::vector<std::string_view> fields;
+        std::vector<size_t> fieldEnds;
+        while (sText.size() < TEXT_SIZE)
+        {
+            AppendText(options, random, sText);
+            fieldEnds.push_back(sText.size());
+        }
+        for (size_t i = 0, start = 0; i < fieldEnds.size(); start = fieldEnds[i++])
+        {
+            fields.push_back(std::string_view(sText).substr(start, fieldEnds[i] - start));
+        }
+
+        const CHtmlEscaper::EMKernel kernels[] = { CHtmlEscaper::EMKernel::Auto, CHtmlEscaper::EMKernel::Scalar,
+            CHtmlEscaper::EMKernel::SSE2, CHtmlEscaper::EMKernel::AVX2 };
+        const char* const KERNEL_NAMES[] = { "auto", "scalar", "sse2", "avx2" };
+        o_json << "{\"textBytes\": " << sText.size() << ", \"fields\": " << fields.size()
+            << ", \"escapedBytes\": " << CHtmlEscaper::GetEscapedSize(sText) << ", \"kernels\": {";
+        bool isFirst = true;
+        std::pmr::string sHtml;
+        sHtml.reserve(CHtmlEscaper::GetEscapedSize(sText));
+        for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k)
+        {
+            if (!CHtmlEscaper::IsKernelSupported(kernels[k]))
+                continue;
+            double bestFieldSeconds = 0;
+            double bestTextSeconds = 0;
+            for (unsigned int iteration = 0; iteration < iterations; ++iteration)
+            {
+                auto startTime = std::chrono::steady_clock::now();
+                sHtml.clear();
+                for (std::string_view sField : fields)
+                {
+                    CHtmlEscaper::Append(sField, sHtml, CHtmlEscaper::EMContext::Text, kernels[k]);
+                    if (sHtml.size() >= FLUSH_SIZE)
+                        sHtml.clear();
+                }
+                auto fieldsTime = std::chrono::steady_clock::now();
+                sHtml.clear();
+                CHtmlEscaper::Append(sText, sHtml, CHtmlEscaper::EMContext::Text, kernels[k]);
+                auto endTime = std::chrono::steady_clock::now();
+                double fieldSeconds = std::chrono::duration<double>(fieldsTime - startTime).count();
+                double textSeconds = std::chrono::duration<double>(endTime - fieldsTime).count();
+                if (iteration == 0 || fieldSeconds < bestFieldSeconds)
+                    bestFieldSeconds = fieldSeconds;
+                if (iteration == 0 || textSeconds < bestTextSeconds)
+                    bestTextSeconds = textSeconds;
+            }
+            o_json << (isFirst ? "" : ", ") << "\"" << KERNEL_NAMES[k] << "\": {\"fieldsMbPerSecond\": "
+                << sText.size() / std::max(bestFieldSeconds, 1e-9) / (1024 * 1024)
+                << ", \"textMbPerSecond\": " << sText.size() / std::max(bestTextSeconds, 1e-9) / (1024 * 1024) << "}";
+            isFirst = false;
+        }
+        o_json << "}}";
+    }
+
+    // Parses size with optional K, M or G suffix. Returns 0 if it isn't valid.
+    uint64_t ParseSize(const std::string& sValue)
+    {
+        char* end = nullptr;
+        uint64_t size = strtoull(sValue.c_str(), &end, 10);
+        switch (*end)
+        {
+        case 'K': case 'k': size <<= 10; end++; break;
+        case 'M': case 'm': size <<= 20; end++; break;
+        case 'G': case 'g': size <<= 30; end++; break;
+        }
+        return *end == '\0' ? size : 0;
+    }
+
+    std::string JsonString(const std::string& sValue)
+    {
+        std::string sJson = "\"";
+        for (char c : sValue)
+        {
+            if (c == '"' || c == '\\')
+            {
+                sJson += '\\';
+                sJson += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char sEscape[8];
+                snprintf(sEscape, sizeof(sEscape), "\\u%04x", c);
+                sJson += sEscape;
+            }
+            else
+            {
+                sJson += c;
+            }
+        }
+        return sJson + "\"";
+    }
+
+    void PrintUsage()
+    {
+        std::cerr << "Usage: Benchmark [-s {size}[K|M|G]]... [-i {iterations}] [-l {min}:{max}] [-u {unicode-ratio}]\n"
+            "    [-m {missing-ratio}] [-a {artists}] [-r {seed}] [-d {work-dir}] [-k] [-o {json-file}]\n"
+            "-s - size of generated document (can be repeated; default 1K, 1M and 64M)\n"
+            "-i - runs of every document (the fastest run of every phase is reported; default 3)\n"
+            "-l - length of text fields in characters (default 4:24)\n"
+            "-u - fraction of non-ASCII characters of text fields (default 0.05)\n"
+            "-m - probability of a field being omitted (default 0.02)\n"
+            "-a - number of distinct artists (default 1000)\n"
+            "-d - directory of generated files (default: temporary directory); -k keeps them\n"
+            "Results are written to {json-file} or to stdout as JSON\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    CGeneratorOptions options;
+    std::vector<uint64_t> sizes;
+    unsigned int iterations = 3;
+    std::filesystem::path workDir = std::filesystem::temp_directory_path() / "ot_benchmark";
+    bool keepFiles = false;
+    std::string sJsonFilePathName;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-k")
+        {
+            keepFiles = true;
+            continue;
+        }
+        if (arg.size() != 2 || arg[0] != '-' || i + 1 >= argc || strchr("silumardo", arg[1]) == nullptr)
+        {
+            PrintUsage();
+            return 1;
+        }
+        std::string sValue = argv[++i];
+        char* end = nullptr;
+        bool isValid = true;
+        switch (arg[1])
+        {
+        case 's':
+            sizes.push_back(ParseSize(sValue));
+            isValid = sizes.back() != 0;
+            break;
+        case 'i':
+            iterations = static_cast<unsigned int>(strtoul(sValue.c_str(), &end, 10));
+            isValid = *end == '\0' && iterations != 0;
+            break;
+        case 'l':
+            options.mMinFieldLength = strtoul(sValue.c_str(), &end, 10);
+            isValid = *end == ':';
+            if (isValid)
+            {
+                options.mMaxFieldLength = strtoul(end + 1, &end, 10);
+                isValid = *end == '\0' && options.mMinFieldLength <= options.mMaxFieldLength;
+            }
+            break;
+        case 'u':
+            options.mUnicodeRatio = strtod(sValue.c_str(), &end);
+            isValid = *end == '\0' && options.mUnicodeRatio >= 0 && options.mUnicodeRatio <= 1;
+            break;
+        case 'm':
+            options.mMissingRatio = strtod(sValue.c_str(), &end);
+            isValid = *end == '\0' && options.mMissingRatio >= 0 && options.mMissingRatio <= 1;
+            break;
+        case 'a':
+            options.mArtistCount = strtoul(sValue.c_str(), &end, 10);
+            isValid = *end == '\0' && options.mArtistCount != 0;
+            break;
+        case 'r':
+            options.mSeed = strtoull(sValue.c_str(), &end, 10);
+            isValid = *end == '\0';
+            break;
+        case 'd':
+            workDir = std::filesystem::u8path(sValue);
+            break;
+        case 'o':
+            sJsonFilePathName = sValue;
+            break;
+        }
+        if (!isValid)
+        {
+            std::cerr << "Invalid value of " << arg << ": " << sValue << "\n";
+            PrintUsage();
+            return 1;
+        }
+    }
+    if (sizes.empty())
+    {
+        sizes = { 1ull << 10, 1ull << 20, 64ull << 20 };
+    }
+
+    std::ostringstream json;
+    json.precision(6);
+    json << "{\n  \"generator\": {\"minFieldLength\": " << options.mMinFieldLength
+        << ", \"maxFieldLength\": " << options.mMaxFieldLength
+        << ", \"unicodeRatio\": " << options.mUnicodeRatio
+        << ", \"missingRatio\": " << options.mMissingRatio
+        << ", \"artists\": " << options.mArtistCount
+        << ", \"seed\": " << options.mSeed << "},\n"
+        << "  \"iterations\": " << iterations << ",\n  \"escape\": ";
+    RunEscapeBenchmark(options, iterations, json);
+    json << ",\n  \"results\": [";
+    std::error_code ec;
+    std::filesystem::create_directories(workDir, ec);
+    try
+    {
+        for (size_t sizeIndex = 0; sizeIndex < sizes.size(); ++sizeIndex)
+        {
+            std::filesystem::path xmlPath = workDir / ("catalog_" + std::to_string(sizes[sizeIndex]) + ".xml");
+            std::filesystem::path htmlPath = workDir / ("catalog_" + std::to_string(sizes[sizeIndex]) + ".html");
+            auto cleanup = MakeRAIICleanup([&]() {
+                if (!keepFiles)
+                {
+                    std::error_code ec;
+                    std::filesystem::remove(xmlPath, ec);
+                    std::filesystem::remove(htmlPath, ec);
+                }
+            });
+            auto startTime = std::chrono::steady_clock::now();
+            GenerateCatalog(options, sizes[sizeIndex], xmlPath.wstring());
+            double generateSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+            // The fastest run of every phase is reported (others were disturbed more)
+            CPhaseResult best[static_cast<size_t>(EMPhase::Count)];
+            uint64_t numRecords = 0;
+            for (unsigned int iteration = 0; iteration < iterations; ++iteration)
+            {
+                CPhaseResult phases[static_cast<size_t>(EMPhase::Count)];
+                RunPhases(xmlPath.wstring(), htmlPath.wstring(), phases, numRecords);
+                for (size_t i = 0; i < static_cast<size_t>(EMPhase::Count); ++i)
+                {
+                    if (iteration == 0 || phases[i].mSeconds < best[i].mSeconds)
+                        best[i] = phases[i];
+                }
+            }
+            uint64_t xmlSize = std::filesystem::file_size(xmlPath);
+            uint64_t htmlSize = std::filesystem::file_size(htmlPath);
+            uint64_t peakMemoryUsage = 0;
+            std::wstring sErrorMsg;
+            GetPeakMemoryUsage(peakMemoryUsage, sErrorMsg);
+
+            json << (sizeIndex == 0 ? "\n" : ",\n")
+                << "    {\"xmlBytes\": " << xmlSize << ", \"htmlBytes\": " << htmlSize
+                << ", \"records\": " << numRecords << ", \"generateSeconds\": " << generateSeconds
+                << ",\n     \"peakRssBytes\": " << peakMemoryUsage << ",\n     \"phases\": {";
+            for (size_t i = 0; i < static_cast<size_t>(EMPhase::Count); ++i)
+            {
+                double seconds = std::max(best[i].mSeconds, 1e-9);
+                json << (i == 0 ? "\n" : ",\n") << "       " << JsonString(PHASE_NAMES[i])
+                    << ": {\"seconds\": " << best[i].mSeconds
+                    << ", \"mbPerSecond\": " << xmlSize / seconds / (1024 * 1024)
+                    << ", \"recordsPerSecond\": " << numRecords / seconds
+                    << ", \"allocations\": " << best[i].mAllocations << "}";
+            }
+            json << "}}";
+            std::cerr << "Benchmarked " << xmlSize << " bytes (" << numRecords << " records)" << std::endl;
+        }
+    }
+    catch (const CException& ex)
+    {
+        std::string sError;
+        WideToUtf8(ex.mErrorDescription.data(), ex.mErrorDescription.size(), sError);
+        std::cerr << "Benchmark failed. " << sError << std::endl;
+        return 1;
+    }
+    if (!keepFiles)
+    {
+        std::filesystem::remove(workDir, ec);
+    }
+    json << "\n  ]\n}\n";
+
+    if (sJsonFilePathName.empty())
+    {
+        std::cout << json.str();
+    }
+    else
+    {
+        std::ofstream file(std::filesystem::u8path(sJsonFilePathName), std::ios::binary);
+        file << json.str();
+        if (!file)
+        {
+            std::cerr << "Couldn't write " << sJsonFilePathName << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,506 @@
+// Build-time tool that compiles CATALOG/CD XSLT style sheet (e.g. win/xslt/cat_items.xslt)
+// into C++ header used by the native engine: static parts of HTML become constexpr
+// strings and per-field xsl:if/xsl:value-of become straight-line code.
+//
+// Usage: XsltCodegen {input-xslt} {output-header} {Name}
+// Generated header declares namespace {Name}Stylesheet.
+//
+// Supported subset of XSLT 1.0 (anything else is reported as an error):
+//   xsl:stylesheet containing single xsl:template match="/"
+//   literal result elements, attributes and text
+//   single xsl:for-each select="CATALOG/CD" with optional xsl:sort select="{FIELD}"
+//   inside xsl:for-each: xsl:if test="{FIELD}" and xsl:value-of select="{FIELD}"
+// where {FIELD} is one of CATALOG/CD fields known to CCatalogReader.
+
+#include "../XmlPullParser.h"
+#include "../Util.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <ctype.h>
+
+using namespace OTInterviewExercise1;
+
+namespace
+{
+    const char XsltNamespace[] = "http://www.w3.org/1999/XSL/Transform";
+
+    // CATALOG/CD field elements and names of ECatalogField enumerators
+    const struct
+    {
+        const char* mElementName;
+        const char* mEnumeratorName;
+    } Fields[] = {
+        { "TITLE", "Title" },
+        { "ARTIST", "Artist" },
+        { "COUNTRY", "Country" },
+        { "COMPANY", "Company" },
+        { "PRICE", "Price" },
+        { "YEAR", "Year" }
+    };
+
+    // HTML elements that don't have end tag (HTML output method)
+    const char* VoidElements[] = {
+        "area", "base", "br", "col", "hr", "img", "input", "link", "meta", "param"
+    };
+
+    // Operation of row template
+    struct COperation
+    {
+        enum class Type
+        {
+            // Append mLiteral
+            Literal,
+            // Append escaped value of field
+            ValueOf,
+            // Perform mOperations if field is present
+            If
+        };
+        Type mType;
+        std::string mLiteral;
+        const char* mField;
+        std::vector<COperation> mOperations;
+    };
+
+    class CXsltCompiler
+    {
+    public:
+        explicit CXsltCompiler(std::string_view sXslt) :
+            mParser(sXslt),
+            mSortField(nullptr),
+            mHasForEach(false)
+        {}
+
+        void Compile();
+        void WriteHeader(std::ostream& out, const std::string& sName, const std::string& sSourceName) const;
+    private:
+        enum class Context
+        {
+            Template,
+            Row
+        };
+        [[noreturn]] void ThrowError(const std::string& sError) const;
+        // Returns next token of style sheet (malformed style sheet is thrown)
+        CXmlPullParser::Token Next();
+        std::string_view GetAttribute(std::string_view sName) const;
+        void CheckAttributes(std::initializer_list<std::string_view> allowedNames) const;
+        const char* GetField(std::string_view sExpression) const;
+        // Compiles children of current element until its end tag
+        void CompileContent(Context context, std::vector<COperation>& o_operations);
+        void AppendLiteral(std::vector<COperation>& o_operations, std::string_view sLiteral);
+        void FlushText(std::vector<COperation>& o_operations);
+        static std::string EscapeText(std::string_view sText);
+        static std::string EscapeAttribute(std::string_view sValue);
+        static std::string CppString(std::string_view sData);
+        static void WriteOperations(std::ostream& out, const std::vector<COperation>& operations,
+            const std::string& sIndent, std::vector<std::string>& io_literals);
+
+        CXmlPullParser mParser;
+        // Literal output before xsl:for-each, rows and after xsl:for-each
+        std::vector<COperation> mHeader;
+        std::vector<COperation> mRow;
+        std::vector<COperation> mFooter;
+        const char* mSortField;
+        bool mHasForEach;
+        // Text of current text node (it can be returned by parser as several pieces)
+        std::string msPendingText;
+    };
+
+    void CXsltCompiler::ThrowError(const std::string& sError) const
+    {
+        std::wstring sWideError;
+        Utf8ToWide(sError.data(), sError.size(), sWideError);
+        std::wostringstream ss;
+        ss << L"Unsupported style sheet at offset " << mParser.Offset() << L". " << sWideError;
+        THROW_ERROR(ss.str().c_str());
+    }
+
+    CXmlPullParser::Token CXsltCompiler::Next()
+    {
+        CXmlPullParser::Token token = mParser.Next();
+        if (token == CXmlPullParser::Token::Error)
+        {
+            THROW_ERROR(FormatParseError(mParser.GetStatus().GetError()).c_str());
+        }
+        return token;
+    }
+
+    std::string_view CXsltCompiler::GetAttribute(std::string_view sName) const
+    {
+        for (const auto& attribute : mParser.Attributes())
+        {
+            if (attribute.mName == sName)
+                return attribute.mValue;
+        }
+        ThrowError("Attribute " + std::string(sName) + " of " + std::string(mParser.Name()) + " is missing.");
+    }
+
+    void CXsltCompiler::CheckAttributes(std::initializer_list<std::string_view> allowedNames) const
+    {
+        for (const auto& attribute : mParser.Attributes())
+        {
+            bool isAllowed = false;
+            for (auto name : allowedNames)
+                isAllowed = isAllowed || attribute.mName == name;
+            if (!isAllowed)
+                ThrowError("Attribute " + std::string(attribute.mName) + " of " + std::string(mParser.Name()) + " isn't supported.");
+        }
+    }
+
+    const char* CXsltCompiler::GetField(std::string_view sExpression) const
+    {
+        for (const auto& field : Fields)
+        {
+            if (sExpression == field.mElementName)
+                return field.mEnumeratorName;
+        }
+        ThrowError("Expression \"" + std::string(sExpression) + "\" isn't supported. Only CATALOG/CD field names are.");
+    }
+
+    void CXsltCompiler::Compile()
+    {
+        if (Next() != CXmlPullParser::Token::StartElement || mParser.Name() != "xsl:stylesheet")
+            ThrowError("Root element must be xsl:stylesheet.");
+        if (GetAttribute("xmlns:xsl") != XsltNamespace || GetAttribute("version") != "1.0")
+            ThrowError("Only XSLT 1.0 style sheet with xsl prefix is supported.");
+        bool hasTemplate = false;
+        for (;;)
+        {
+            switch (Next())
+            {
+            case CXmlPullParser::Token::StartElement:
+                if (mParser.Name() != "xsl:template" || hasTemplate)
+                    ThrowError("Style sheet must contain single xsl:template.");
+                CheckAttributes({ "match" });
+                if (GetAttribute("match") != "/")
+                    ThrowError("Only template matching root (\"/\") is supported.");
+                hasTemplate = true;
+                CompileContent(Context::Template, mHeader);
+                break;
+            case CXmlPullParser::Token::Text:
+                if (mParser.Text().find_first_not_of(" \t\r\n") != std::string_view::npos)
+                    ThrowError("Text isn't allowed in xsl:stylesheet.");
+                break;
+            case CXmlPullParser::Token::EndElement:
+                if (Next() != CXmlPullParser::Token::EndOfDocument)
+                    ThrowError("Unexpected content after xsl:stylesheet.");
+                if (!hasTemplate)
+                    ThrowError("Style sheet doesn't contain xsl:template.");
+                if (!mHasForEach)
+                    ThrowError("Template doesn't contain xsl:for-each select=\"CATALOG/CD\".");
+                return;
+            case CXmlPullParser::Token::EndOfDocument:
+                ThrowError("Unexpected end of document.");
+            case CXmlPullParser::Token::Error:
+                // Next() throws it
+                break;
+            }
+        }
+    }
+
+    void CXsltCompiler::CompileContent(Context context, std::vector<COperation>& o_operations)
+    {
+        // Template output goes to header until xsl:for-each and to footer after it
+        auto output = [this, context, &o_operations]() -> std::vector<COperation>& {
+            if (context == Context::Row)
+                return o_operations;
+            return mHasForEach ? mFooter : mHeader;
+        };
+        for (;;)
+        {
+            CXmlPullParser::Token token = Next();
+            if (token == CXmlPullParser::Token::Text)
+            {
+                msPendingText.append(mParser.Text());
+                continue;
+            }
+            FlushText(output());
+            if (token == CXmlPullParser::Token::EndElement)
+                return;
+            if (token == CXmlPullParser::Token::EndOfDocument)
+                ThrowError("Unexpected end of document.");
+
+            std::string name(mParser.Name());
+            if (name == "xsl:for-each")
+            {
+                if (context != Context::Template || mHasForEach)
+                    ThrowError("Only single xsl:for-each (outside of rows) is supported.");
+                CheckAttributes({ "select" });
+                if (GetAttribute("select") != "CATALOG/CD")
+                    ThrowError("Only xsl:for-each select=\"CATALOG/CD\" is supported.");
+                CompileContent(Context::Row, mRow);
+                mHasForEach = true;
+            }
+            else if (name == "xsl:sort")
+            {
+                if (&o_operations != &mRow || !mRow.empty() || mSortField != nullptr)
+                    ThrowError("xsl:sort must be the first child of xsl:for-each.");
+                CheckAttributes({ "select" });
+                mSortField = GetField(GetAttribute("select"));
+                if (Next() != CXmlPullParser::Token::EndElement)
+                    ThrowError("xsl:sort must be empty.");
+            }
+            else if (name == "xsl:value-of" || name == "xsl:if")
+            {
+                if (context != Context::Row)
+                    ThrowError(name + " is supported only inside xsl:for-each.");
+                COperation operation;
+                if (name == "xsl:if")
+                {
+                    operation.mType = COperation::Type::If;
+                    CheckAttributes({ "test" });
+                    operation.mField = GetField(GetAttribute("test"));
+                    CompileContent(Context::Row, operation.mOperations);
+                }
+                else
+                {
+                    operation.mType = COperation::Type::ValueOf;
+                    CheckAttributes({ "select" });
+                    operation.mField = GetField(GetAttribute("select"));
+                    if (Next() != CXmlPullParser::Token::EndElement)
+                        ThrowError("xsl:value-of must be empty.");
+                }
+                o_operations.push_back(std::move(operation));
+            }
+            else if (name.compare(0, 4, "xsl:") == 0)
+            {
+                ThrowError(name + " isn't supported.");
+            }
+            else
+            {
+                // Literal result element
+                std::string sStartTag = "<" + name;
+                for (const auto& attribute : mParser.Attributes())
+                {
+                    if (attribute.mName.substr(0, 5) == "xmlns")
+                        continue;
+                    sStartTag += " " + std::string(attribute.mName) + "=\"" + EscapeAttribute(attribute.mValue) + "\"";
+                }
+                sStartTag += ">";
+                AppendLiteral(output(), sStartTag);
+                CompileContent(context, o_operations);
+                bool isVoid = false;
+                for (auto voidElement : VoidElements)
+                    isVoid = isVoid || name == voidElement;
+                if (!isVoid)
+                    AppendLiteral(output(), "</" + name + ">");
+            }
+        }
+    }
+
+    void CXsltCompiler::AppendLiteral(std::vector<COperation>& o_operations, std::string_view sLiteral)
+    {
+        if (o_operations.empty() || o_operations.back().mType != COperation::Type::Literal)
+        {
+            COperation operation;
+            operation.mType = COperation::Type::Literal;
+            operation.mField = nullptr;
+            o_operations.push_back(std::move(operation));
+        }
+        o_operations.back().mLiteral.append(sLiteral);
+    }
+
+    void CXsltCompiler::FlushText(std::vector<COperation>& o_operations)
+    {
+        // Whitespace-only text nodes are stripped from style sheet
+        if (msPendingText.find_first_not_of(" \t\r\n") != std::string::npos)
+            AppendLiteral(o_operations, EscapeText(msPendingText));
+        msPendingText.clear();
+    }
+
+    std::string CXsltCompiler::EscapeText(std::string_view sText)
+    {
+        std::string sEscaped;
+        for (char c : sText)
+        {
+            switch (c)
+            {
+            case '&':
+                sEscaped += "&amp;";
+                break;
+            case '<':
+                sEscaped += "&lt;";
+                break;
+            case '>':
+                sEscaped += "&gt;";
+                break;
+            default:
+                sEscaped += c;
+            }
+        }
+        return sEscaped;
+    }
+
+    std::string CXsltCompiler::EscapeAttribute(std::string_view sValue)
+    {
+        // Attribute values are raw (not decoded) - so references are kept as is
+        if (sValue.find('{') != std::string_view::npos)
+            THROW_ERROR(L"Attribute value templates aren't supported.");
+        std::string sEscaped;
+        for (char c : sValue)
+        {
+            if (c == '"')
+                sEscaped += "&quot;";
+            else
+                sEscaped += c;
+        }
+        return sEscaped;
+    }
+
+    std::string CXsltCompiler::CppString(std::string_view sData)
+    {
+        std::string sResult = "\"";
+        for (char c : sData)
+        {
+            unsigned char uc = static_cast<unsigned char>(c);
+            if (c == '"' || c == '\\')
+            {
+                sResult += '\\';
+                sResult += c;
+            }
+            else if (uc < 0x20 || uc >= 0x7F)
+            {
+                // Octal escape has at most 3 digits - so following characters can't extend it
+                const char digits[] = "01234567";
+                sResult += '\\';
+                sResult += digits[(uc >> 6) & 7];
+                sResult += digits[(uc >> 3) & 7];
+                sResult += digits[uc & 7];
+            }
+            else
+            {
+                sResult += c;
+            }
+        }
+        return sResult + "\"";
+    }
+
+    void CXsltCompiler::WriteOperations(std::ostream& out, const std::vector<COperation>& operations,
+        const std::string& sIndent, std::vector<std::string>& io_literals)
+    {
+        for (const auto& operation : operations)
+        {
+            switch (operation.mType)
+            {
+            case COperation::Type::Literal:
+            {
+                // Equal literals share one constant
+                size_t index = 0;
+                while (index < io_literals.size() && io_literals[index] != operation.mLiteral)
+                    ++index;
+                if (index == io_literals.size())
+                    io_literals.push_back(operation.mLiteral);
+                std::string sName = "RowLiteral" + std::to_string(index);
+                out << sIndent << "o_sHtml.append(" << sName << ", sizeof(" << sName << ") - 1);\n";
+                break;
+            }
+            case COperation::Type::ValueOf:
+                out << sIndent << "CCatalogHtmlRenderer::AppendEscaped(record.Get(ECatalogField::"
+                    << operation.mField << "), o_sHtml);\n";
+                break;
+            case COperation::Type::If:
+                out << sIndent << "if (record.Has(ECatalogField::" << operation.mField << "))\n"
+                    << sIndent << "{\n";
+                WriteOperations(out, operation.mOperations, sIndent + "    ", io_literals);
+                out << sIndent << "}\n";
+                break;
+            }
+        }
+    }
+
+    void CXsltCompiler::WriteHeader(std::ostream& out, const std::string& sName, const std::string& sSourceName) const
+    {
+        auto literalOf = [](const std::vector<COperation>& operations) {
+            std::string sLiteral;
+            for (const auto& operation : operations)
+                sLiteral += operation.mLiteral;
+            return sLiteral;
+        };
+        std::string sGuard;
+        for (char c : sName)
+            sGuard += static_cast<char>(toupper(static_cast<unsigned char>(c)));
+
+        std::ostringstream rowCode;
+        std::vector<std::string> rowLiterals;
+        WriteOperations(rowCode, mRow, "            ", rowLiterals);
+
+        out << "// Generated by codegen/XsltCodegen from " << sSourceName << ". Don't edit: run\n"
+            "// \"make -C linux codegen\" after changing the style sheet.\n"
+            "#ifndef OT_" << sGuard << "STYLESHEET_H__\n"
+            "#define OT_" << sGuard << "STYLESHEET_H__\n"
+            "\n"
+            "#include \"CatalogEngine.h\"\n"
+            "#include <string>\n"
+            "\n"
+            "namespace OTInterviewExercise1\n"
+            "{\n"
+            "    namespace " << sName << "Stylesheet\n"
+            "    {\n"
+            "        // Rows are sorted by this field (ECatalogField::Count if they aren't sorted)\n"
+            "        constexpr ECatalogField SortField = ECatalogField::" << (mSortField ? mSortField : "Count") << ";\n"
+            "\n"
+            "        // Output before rows\n"
+            "        constexpr char Header[] = " << CppString(literalOf(mHeader)) << ";\n"
+            "        // Output after rows\n"
+            "        constexpr char Footer[] = " << CppString(literalOf(mFooter)) << ";\n"
+            "\n";
+        for (size_t i = 0; i < rowLiterals.size(); ++i)
+            out << "        constexpr char RowLiteral" << i << "[] = " << CppString(rowLiterals[i]) << ";\n";
+        out << "\n"
+            "        // Output of one CATALOG/CD element\n"
+            "        inline void WriteRow(const CCatalogRecord& record, std::pmr::string& o_sHtml)\n"
+            "        {\n"
+            << rowCode.str() <<
+            "        }\n"
+            "    }\n"
+            "}\n"
+            "#endif\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 4)
+    {
+        std::cerr << "Usage: XsltCodegen {input-xslt} {output-header} {Name}\n";
+        return 1;
+    }
+    std::ifstream in(argv[1], std::ios::binary);
+    std::string sXslt((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (!in && !in.eof())
+    {
+        std::cerr << "Couldn't read " << argv[1] << "\n";
+        return 1;
+    }
+    std::string sSourceName = argv[1];
+    size_t slashPos = sSourceName.find_last_of("/\\");
+    if (slashPos != std::string::npos)
+        sSourceName.erase(0, slashPos + 1);
+
+    std::ostringstream header;
+    try
+    {
+        CXsltCompiler compiler(sXslt);
+        compiler.Compile();
+        compiler.WriteHeader(header, argv[3], sSourceName);
+    }
+    catch (const CException& ex)
+    {
+        std::string sError;
+        WideToUtf8(ex.mErrorDescription.data(), ex.mErrorDescription.size(), sError);
+        std::cerr << argv[1] << ": " << sError << "\n";
+        return 1;
+    }
+
+    std::ofstream out(argv[2], std::ios::binary | std::ios::trunc);
+    out << header.str();
+    out.close();
+    if (!out)
+    {
+        std::cerr << "Couldn't write " << argv[2] << "\n";
+        return 1;
+    }
+    return 0;
+}
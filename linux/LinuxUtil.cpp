@@ -0,0 +1,1378 @@
+// Contains implementations of OS-specific (Linux) classes, functions.
+
+#include "../Util.h"
+#include "LinuxUtil.h"
+#include <assert.h>
+#include <sstream>
+#include <functional>
+#include <algorithm>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <sys/eventfd.h>
+#include <pthread.h>
+#include <limits.h>
+
+namespace OTInterviewExercise1
+{
+    // Returns description of errno value as wchar_t string
+    static std::wstring ErrnoDescription(int errNo)
+    {
+        std::wstring sDescr;
+        const char* sErr = strerror(errNo);
+        if (sErr == nullptr || !Utf8ToWide(sErr, strlen(sErr), sDescr))
+            sDescr.clear();
+        return sDescr;
+    }
+
+    bool COsInitialization::COsInitializationImpl::IsOk(std::wstring& o_errorMsg) const noexcept
+    {
+        o_errorMsg.clear();
+        return true;
+    }
+
+    std::wstring FormatError(const CError& error)
+    {
+        if (error.mSystemCallName == nullptr)
+            return error.mErrorDescription;
+        std::wostringstream ss;
+        ss << error.mSystemCallName << L" failed. Error code: " << error.mSystemErrorCode << L" " <<
+            ErrnoDescription(error.mSystemErrorCode);
+        return ss.str();
+    }
+
+    CTextFileReader::CTextFileReaderImpl::CTextFileReaderImpl(const wchar_t* filePathName, ReadMode readMode) :
+        mMappedData(nullptr),
+        mMappedSize(0),
+        mStatus(Status::NotFound)
+    {
+        try
+        {
+            CStatus status = Open(filePathName, readMode);
+            if (status)
+            {
+                mStatus = Status::ValidContents;
+                return;
+            }
+            mError = status.GetError();
+            mStatus = static_cast<Status>(mError.mInternalErrorCode);
+            // Missing and empty files are ordinary outcomes - caller reports them
+            if (Status::NotFound == mStatus || Status::NoContents == mStatus)
+                return;
+            mErrMsg = FormatError(mError);
+        }
+        catch (const std::bad_alloc& /*ex*/)
+        {
+            mStatus = Status::ReadContentsError;
+            mErrMsg = L"Memory allocation error.";
+        }
+        catch (const std::exception& ex)
+        {
+            mStatus = Status::ReadContentsError;
+            std::wostringstream ss;
+            ss << L"C++ exception caught. ";
+            std::wstring sWhat;
+            if (ex.what() && Utf8ToWide(ex.what(), strlen(ex.what()), sWhat))
+            {
+                ss << sWhat;
+            }
+            mErrMsg = ss.str();
+        }
+        catch (...)
+        {
+            mStatus = Status::ReadContentsError;
+            mErrMsg = L"Unknown exception caught.";
+        }
+        LogError(__FUNCTION__, __LINE__, mErrMsg);
+    }
+
+    CStatus CTextFileReader::CTextFileReaderImpl::Open(const wchar_t* filePathName, ReadMode readMode)
+    {
+        int fd = -1;
+
+        // Cleanup resources before function returning
+        auto cleanup = MakeRAIICleanup([&fd]() {
+            if (fd != -1)
+            {
+                ::close(fd);
+                fd = -1;
+            }
+            });
+
+        std::string sPathName;
+        if (filePathName == nullptr || !WideToUtf8(filePathName, wcslen(filePathName), sPathName))
+        {
+            return CError(static_cast<unsigned int>(Status::FindError), L"Invalid file path name");
+        }
+
+        struct stat st = {};
+        if (::stat(sPathName.c_str(), &st) != 0)
+        {
+            int lastErr = errno;
+            if (ENOENT == lastErr || ENOTDIR == lastErr)
+            {
+                return CError(static_cast<unsigned int>(Status::NotFound), L"File not found");
+            }
+            return CError(static_cast<unsigned int>(Status::FindError), L"", L"stat", lastErr);
+        }
+
+        fd = ::open(sPathName.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+        {
+            return CError(static_cast<unsigned int>(Status::ReadContentsError), L"", L"open", errno);
+        }
+        if (::fstat(fd, &st) != 0)
+        {
+            return CError(static_cast<unsigned int>(Status::ReadContentsError), L"", L"fstat", errno);
+        }
+        else if (S_ISDIR(st.st_mode))
+        {
+            return CError(static_cast<unsigned int>(Status::ReadContentsError), L"Path is a directory");
+        }
+        else if (static_cast<uint64_t>(st.st_size) > SIZE_MAX)
+        {
+            // Only 32-bit builds get here - such files can be read in chunks
+            return CError(static_cast<unsigned int>(Status::ReadContentsError), L"File doesn't fit into address space");
+        }
+        // Files reporting 0 size (e.g. in /proc) and non-regular files (pipes,
+        // devices) can't be mapped - so they are read.
+        bool isMappable = S_ISREG(st.st_mode) && st.st_size > 0;
+        if (ReadMode::Map == readMode && isMappable && MapFile(fd, static_cast<size_t>(st.st_size)))
+        {
+            return CStatus();
+        }
+        return ReadFile(fd, S_ISREG(st.st_mode) ? static_cast<size_t>(st.st_size) : 0);
+    }
+
+    CTextFileReader::CTextFileReaderImpl::~CTextFileReaderImpl()
+    {
+        if (mMappedData != nullptr)
+            ::munmap(mMappedData, mMappedSize);
+    }
+
+    bool CTextFileReader::CTextFileReaderImpl::MapFile(int fd, size_t fileSize) noexcept
+    {
+        void* data = ::mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED == data)
+            return false;
+        // File is parsed front to back - so ask for aggressive read-ahead
+        ::madvise(data, fileSize, MADV_SEQUENTIAL);
+        mMappedData = data;
+        mMappedSize = fileSize;
+        return true;
+    }
+
+    CStatus CTextFileReader::CTextFileReaderImpl::ReadFile(int fd, size_t sizeHint)
+    {
+        if (sizeHint != 0)
+        {
+            // Read straight into final buffer. Size of the file might change while
+            // it's being read - so loop until end of file anyway.
+            mFileContents.resize(sizeHint);
+        }
+        size_t numTotal = 0;
+        std::vector<unsigned char> buf;
+        for (;;)
+        {
+            unsigned char* dest = nullptr;
+            size_t destSize = 0;
+            if (numTotal < mFileContents.size())
+            {
+                dest = mFileContents.data() + numTotal;
+                destSize = mFileContents.size() - numTotal;
+            }
+            else
+            {
+                buf.resize(INTERNAL_BUF_SIZE);
+                dest = buf.data();
+                destSize = buf.size();
+            }
+            ssize_t numRead = ::read(fd, dest, destSize);
+            if (numRead < 0)
+            {
+                int lastErr = errno;
+                if (EINTR == lastErr)
+                    continue;
+                mFileContents.clear();
+                return CError(static_cast<unsigned int>(Status::ReadContentsError), L"", L"read", lastErr);
+            }
+            else if (numRead == 0)
+            {
+                break;
+            }
+            if (dest == buf.data())
+                mFileContents.insert(end(mFileContents), buf.data(), buf.data() + numRead);
+            numTotal += static_cast<size_t>(numRead);
+        }
+        mFileContents.resize(numTotal);
+        if (mFileContents.empty())
+        {
+            return CError(static_cast<unsigned int>(Status::NoContents), L"File is empty");
+        }
+        return CStatus();
+    }
+
+    CTextFileReader::Status CTextFileReader::CTextFileReaderImpl::GetStatus(std::wstring& o_sErrorMsg) const noexcept
+    {
+        try
+        {
+            if (!mErrMsg.empty() || Status::ValidContents == mStatus)
+                o_sErrorMsg = mErrMsg;
+            else
+                o_sErrorMsg = FormatError(mError);
+        }
+        catch (...)
+        {
+            o_sErrorMsg.clear();
+        }
+        return mStatus;
+    }
+
+    bool CTextFileReader::CTextFileReaderImpl::GetBytes(std::string_view& o_fileData) const noexcept
+    {
+        if (Status::ValidContents == mStatus)
+        {
+            if (mMappedData != nullptr)
+                o_fileData = std::string_view(static_cast<const char*>(mMappedData), mMappedSize);
+            else
+                o_fileData = std::string_view(reinterpret_cast<const char*>(mFileContents.data()), mFileContents.size());
+            return true;
+        }
+        return false;
+    }
+
+    CChunkedFileReader::CChunkedFileReaderImpl::CChunkedFileReaderImpl(const wchar_t* filePathName,
+        size_t chunkSize, unsigned int chunkCount) :
+        mFd(-1),
+        mIsRegular(false),
+        mChunkSize(0),
+        mMemory(nullptr),
+        mNextChunk(0),
+        mNextOffset(0),
+        mIsEndOfFileSeen(false),
+        mIsEndOfFileReturned(false),
+        mInFlightCount(0),
+        mRingFd(-1),
+        mSqRing(nullptr),
+        mSqRingSize(0),
+        mCqRing(nullptr),
+        mCqRingSize(0),
+        mSqes(nullptr),
+        mSqesSize(0),
+        mSqTail(nullptr),
+        mSqMask(nullptr),
+        mSqArray(nullptr),
+        mCqHead(nullptr),
+        mCqTail(nullptr),
+        mCqMask(nullptr),
+        mCqes(nullptr),
+        mStatus(Status::NotFound)
+    {
+        std::string functionName;
+        unsigned int lineNo = 0;
+        try
+        {
+            // Buffers are page-aligned and their size is multiple of page size
+            const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+            mChunkSize = (std::max<size_t>(chunkSize, 1) + pageSize - 1) / pageSize * pageSize;
+            CStatus status = Open(filePathName, std::max(chunkCount, 1u));
+            if (status)
+            {
+                mStatus = Status::Open;
+                mErrMsg.clear();
+                return;
+            }
+            mError = status.GetError();
+            mStatus = static_cast<Status>(mError.mInternalErrorCode);
+            // Missing file is an ordinary outcome - caller reports it
+            if (Status::NotFound == mStatus)
+                return;
+            mErrMsg = FormatError(mError);
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+        }
+        catch (const CException& ex)
+        {
+            mStatus = static_cast<Status>(ex.mInternalErrorCode);
+            mErrMsg = ex.mErrorDescription;
+            // If it's not an error - don't log it - just return
+            if (ex.mCode == CException::ErrorCode::NoError)
+                return;
+            functionName = ex.mFunctionName;
+            lineNo = ex.mLineNo;
+        }
+        catch (const std::bad_alloc& /*ex*/)
+        {
+            mStatus = Status::ReadError;
+            mErrMsg = L"Memory allocation error.";
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+        }
+        catch (...)
+        {
+            mStatus = Status::ReadError;
+            mErrMsg = L"Unknown exception caught.";
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+        }
+        LogError(functionName.c_str(), lineNo, mErrMsg);
+    }
+
+    CChunkedFileReader::CChunkedFileReaderImpl::~CChunkedFileReaderImpl()
+    {
+        // Kernel writes into buffers until their reads complete
+        while (mInFlightCount != 0)
+        {
+            unsigned int inFlightCount = mInFlightCount;
+            try
+            {
+                Complete();
+            }
+            catch (...)
+            {
+                // Completions can't be waited for
+                if (mInFlightCount == inFlightCount)
+                    break;
+            }
+        }
+        CloseRing();
+        // Buffers are leaked rather than freed while kernel might still write into them
+        if (mInFlightCount == 0)
+            ::free(mMemory);
+        if (mFd != -1)
+            ::close(mFd);
+    }
+
+    CStatus CChunkedFileReader::CChunkedFileReaderImpl::Open(const wchar_t* filePathName, unsigned int chunkCount)
+    {
+        std::string sPathName;
+        if (filePathName == nullptr || !WideToUtf8(filePathName, wcslen(filePathName), sPathName))
+        {
+            return CError(static_cast<unsigned int>(Status::FindError), L"Invalid file path name");
+        }
+        mFd = ::open(sPathName.c_str(), O_RDONLY | O_CLOEXEC);
+        if (mFd == -1)
+        {
+            int lastErr = errno;
+            if (ENOENT == lastErr || ENOTDIR == lastErr)
+            {
+                return CError(static_cast<unsigned int>(Status::NotFound), L"File not found");
+            }
+            return CError(static_cast<unsigned int>(Status::ReadError), L"", L"open", lastErr);
+        }
+        struct stat st = {};
+        if (::fstat(mFd, &st) != 0)
+        {
+            return CError(static_cast<unsigned int>(Status::ReadError), L"", L"fstat", errno);
+        }
+        else if (S_ISDIR(st.st_mode))
+        {
+            return CError(static_cast<unsigned int>(Status::ReadError), L"Path is a directory");
+        }
+        mIsRegular = S_ISREG(st.st_mode);
+
+        const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        // Pipes and devices are read on demand - one buffer is enough
+        size_t bufferCount = mIsRegular ? chunkCount : 1;
+        if (mChunkSize > SIZE_MAX / bufferCount ||
+            ::posix_memalign(&mMemory, pageSize, mChunkSize * bufferCount) != 0)
+        {
+            mMemory = nullptr;
+            THROW_ERROR_CODE(static_cast<int>(Status::ReadError), L"Memory allocation error.");
+        }
+        mBuffers.resize(bufferCount);
+        for (size_t i = 0; i < bufferCount; ++i)
+        {
+            mBuffers[i] = CBuffer();
+            mBuffers[i].mData = static_cast<char*>(mMemory) + i * mChunkSize;
+            mBuffers[i].mOffset = mNextOffset;
+            mNextOffset += mChunkSize;
+        }
+        if (!mIsRegular)
+            return CStatus();
+        ::posix_fadvise(mFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        if (!SetupRing(static_cast<unsigned int>(bufferCount)))
+            return CStatus();
+        // Reads of all buffers are queued right away
+        for (size_t i = 0; i < bufferCount; ++i)
+        {
+            Submit(i);
+        }
+        return CStatus();
+    }
+
+    bool CChunkedFileReader::CChunkedFileReaderImpl::SetupRing(unsigned int entryCount) noexcept
+    {
+#ifdef __NR_io_uring_setup
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        int ringFd = static_cast<int>(::syscall(__NR_io_uring_setup, entryCount, &params));
+        if (ringFd < 0)
+            return false;
+        mRingFd = ringFd;
+        mSqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+        mCqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        // Both rings might be mapped by one call
+        bool isSingleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (isSingleMmap)
+            mSqRingSize = mCqRingSize = std::max(mSqRingSize, mCqRingSize);
+        void* sqRing = ::mmap(nullptr, mSqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ringFd, IORING_OFF_SQ_RING);
+        if (MAP_FAILED == sqRing)
+        {
+            CloseRing();
+            return false;
+        }
+        mSqRing = sqRing;
+        if (isSingleMmap)
+        {
+            mCqRing = mSqRing;
+        }
+        else
+        {
+            void* cqRing = ::mmap(nullptr, mCqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                ringFd, IORING_OFF_CQ_RING);
+            if (MAP_FAILED == cqRing)
+            {
+                CloseRing();
+                return false;
+            }
+            mCqRing = cqRing;
+        }
+        mSqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+        void* sqes = ::mmap(nullptr, mSqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ringFd, IORING_OFF_SQES);
+        if (MAP_FAILED == sqes)
+        {
+            CloseRing();
+            return false;
+        }
+        mSqes = static_cast<struct io_uring_sqe*>(sqes);
+        char* sqRingBytes = static_cast<char*>(mSqRing);
+        char* cqRingBytes = static_cast<char*>(mCqRing);
+        mSqTail = reinterpret_cast<unsigned int*>(sqRingBytes + params.sq_off.tail);
+        mSqMask = reinterpret_cast<unsigned int*>(sqRingBytes + params.sq_off.ring_mask);
+        mSqArray = reinterpret_cast<unsigned int*>(sqRingBytes + params.sq_off.array);
+        mCqHead = reinterpret_cast<unsigned int*>(cqRingBytes + params.cq_off.head);
+        mCqTail = reinterpret_cast<unsigned int*>(cqRingBytes + params.cq_off.tail);
+        mCqMask = reinterpret_cast<unsigned int*>(cqRingBytes + params.cq_off.ring_mask);
+        mCqes = reinterpret_cast<struct io_uring_cqe*>(cqRingBytes + params.cq_off.cqes);
+        return true;
+#else
+        (void)entryCount;
+        return false;
+#endif
+    }
+
+    void CChunkedFileReader::CChunkedFileReaderImpl::CloseRing() noexcept
+    {
+        if (mSqes != nullptr)
+            ::munmap(mSqes, mSqesSize);
+        if (mCqRing != nullptr && mCqRing != mSqRing)
+            ::munmap(mCqRing, mCqRingSize);
+        if (mSqRing != nullptr)
+            ::munmap(mSqRing, mSqRingSize);
+        if (mRingFd != -1)
+            ::close(mRingFd);
+        mSqes = nullptr;
+        mCqRing = nullptr;
+        mSqRing = nullptr;
+        mRingFd = -1;
+    }
+
+    void CChunkedFileReader::CChunkedFileReaderImpl::Submit(size_t bufferIndex)
+    {
+#ifdef __NR_io_uring_enter
+        CBuffer& buffer = mBuffers[bufferIndex];
+        buffer.mIovec.iov_base = buffer.mData + buffer.mSize;
+        buffer.mIovec.iov_len = mChunkSize - buffer.mSize;
+        // Only this thread produces entries - kernel reads the tail
+        unsigned int tail = *mSqTail;
+        unsigned int index = tail & *mSqMask;
+        struct io_uring_sqe& sqe = mSqes[index];
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READV;
+        sqe.fd = mFd;
+        sqe.off = buffer.mOffset + buffer.mSize;
+        sqe.addr = reinterpret_cast<uint64_t>(&buffer.mIovec);
+        sqe.len = 1;
+        sqe.user_data = bufferIndex;
+        mSqArray[index] = index;
+        __atomic_store_n(mSqTail, tail + 1, __ATOMIC_RELEASE);
+        for (;;)
+        {
+            if (::syscall(__NR_io_uring_enter, mRingFd, 1, 0, 0, nullptr, 0) >= 0)
+                break;
+            int lastErr = errno;
+            if (EINTR == lastErr)
+                continue;
+            std::wostringstream ss;
+            ss << L"io_uring_enter failed. Error code: " << lastErr << L" " << ErrnoDescription(lastErr);
+            THROW_ERROR_CODE(static_cast<int>(Status::ReadError), ss.str().c_str());
+        }
+        mInFlightCount++;
+#else
+        (void)bufferIndex;
+        THROW_ERROR_CODE(static_cast<int>(Status::ReadError), L"io_uring isn't supported");
+#endif
+    }
+
+    void CChunkedFileReader::CChunkedFileReaderImpl::Complete()
+    {
+#ifdef __NR_io_uring_enter
+        unsigned int head = *mCqHead;
+        while (head == __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE))
+        {
+            if (::syscall(__NR_io_uring_enter, mRingFd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) >= 0)
+                continue;
+            int lastErr = errno;
+            if (EINTR == lastErr)
+                continue;
+            std::wostringstream ss;
+            ss << L"io_uring_enter failed. Error code: " << lastErr << L" " << ErrnoDescription(lastErr);
+            THROW_ERROR_CODE(static_cast<int>(Status::ReadError), ss.str().c_str());
+        }
+        const struct io_uring_cqe& cqe = mCqes[head & *mCqMask];
+        size_t bufferIndex = static_cast<size_t>(cqe.user_data);
+        int result = cqe.res;
+        __atomic_store_n(mCqHead, head + 1, __ATOMIC_RELEASE);
+        mInFlightCount--;
+
+        CBuffer& buffer = mBuffers[bufferIndex];
+        if (result < 0)
+        {
+            if (-result == EINTR || -result == EAGAIN)
+            {
+                Submit(bufferIndex);
+                return;
+            }
+            std::wostringstream ss;
+            ss << L"io_uring read failed. Error code: " << -result << L" " << ErrnoDescription(-result);
+            THROW_ERROR_CODE(static_cast<int>(Status::ReadError), ss.str().c_str());
+        }
+        if (result == 0)
+        {
+            buffer.mIsComplete = true;
+            buffer.mIsEndOfFile = true;
+            mIsEndOfFileSeen = true;
+            return;
+        }
+        buffer.mSize += static_cast<size_t>(result);
+        if (buffer.mSize == mChunkSize)
+            buffer.mIsComplete = true;
+        else
+            Submit(bufferIndex); // Short read - rest of the chunk is read
+#else
+        THROW_ERROR_CODE(static_cast<int>(Status::ReadError), L"io_uring isn't supported");
+#endif
+    }
+
+    void CChunkedFileReader::CChunkedFileReaderImpl::Read(CBuffer& buffer)
+    {
+        while (buffer.mSize < mChunkSize)
+        {
+            ssize_t numRead = mIsRegular ?
+                ::pread(mFd, buffer.mData + buffer.mSize, mChunkSize - buffer.mSize,
+                    static_cast<off_t>(buffer.mOffset + buffer.mSize)) :
+                ::read(mFd, buffer.mData + buffer.mSize, mChunkSize - buffer.mSize);
+            if (numRead < 0)
+            {
+                int lastErr = errno;
+                if (EINTR == lastErr)
+                    continue;
+                std::wostringstream ss;
+                ss << (mIsRegular ? L"pread" : L"read") << L" failed. Error code: " << lastErr << L" "
+                    << ErrnoDescription(lastErr);
+                THROW_ERROR_CODE(static_cast<int>(Status::ReadError), ss.str().c_str());
+            }
+            if (numRead == 0)
+            {
+                buffer.mIsEndOfFile = true;
+                break;
+            }
+            buffer.mSize += static_cast<size_t>(numRead);
+        }
+        buffer.mIsComplete = true;
+    }
+
+    bool CChunkedFileReader::CChunkedFileReaderImpl::Exists(std::wstring& o_sErrorMsg) const noexcept
+    {
+        try
+        {
+            o_sErrorMsg = GetErrorMessage();
+        }
+        catch (...)
+        {
+            o_sErrorMsg.clear();
+        }
+        return mStatus != Status::NotFound && mStatus != Status::FindError;
+    }
+
+    std::wstring CChunkedFileReader::CChunkedFileReaderImpl::GetErrorMessage() const
+    {
+        if (!mErrMsg.empty() || Status::Open == mStatus)
+            return mErrMsg;
+        return FormatError(mError);
+    }
+
+    void CChunkedFileReader::CChunkedFileReaderImpl::NextChunk(std::string_view& o_chunk)
+    {
+        o_chunk = std::string_view();
+        if (mStatus != Status::Open)
+        {
+            THROW_ERROR_CODE(static_cast<int>(mStatus), GetErrorMessage().c_str());
+        }
+        if (mIsEndOfFileReturned)
+            return;
+        try
+        {
+            ReadNextChunk(o_chunk);
+        }
+        catch (const CException& ex)
+        {
+            // Reader can't be used anymore
+            mStatus = Status::ReadError;
+            mErrMsg = ex.mErrorDescription;
+            throw;
+        }
+    }
+
+    void CChunkedFileReader::CChunkedFileReaderImpl::ReadNextChunk(std::string_view& o_chunk)
+    {
+        const size_t bufferCount = mBuffers.size();
+        if (mNextChunk != 0)
+        {
+            // Caller is done with the previous chunk - its buffer reads the chunk that's
+            // bufferCount chunks ahead
+            size_t previousIndex = static_cast<size_t>((mNextChunk - 1) % bufferCount);
+            CBuffer& previous = mBuffers[previousIndex];
+            previous = CBuffer{ previous.mData, mNextOffset, 0, false, false, {} };
+            mNextOffset += mChunkSize;
+            if (IsQueued() && !mIsEndOfFileSeen)
+                Submit(previousIndex);
+        }
+        CBuffer& buffer = mBuffers[static_cast<size_t>(mNextChunk % bufferCount)];
+        if (IsQueued())
+        {
+            while (!buffer.mIsComplete)
+            {
+                if (mIsEndOfFileSeen && mInFlightCount == 0)
+                {
+                    // Chunk wasn't queued - it's past end of file
+                    buffer.mIsComplete = true;
+                    buffer.mIsEndOfFile = true;
+                    break;
+                }
+                Complete();
+            }
+        }
+        else
+        {
+            Read(buffer);
+            // Kernel reads following chunks while this one is processed
+            if (mIsRegular && !buffer.mIsEndOfFile)
+            {
+                ::posix_fadvise(mFd, static_cast<off_t>(buffer.mOffset + mChunkSize),
+                    static_cast<off_t>(mChunkSize * bufferCount), POSIX_FADV_WILLNEED);
+            }
+        }
+        mNextChunk++;
+        if (buffer.mIsEndOfFile)
+            mIsEndOfFileReturned = true;
+        o_chunk = std::string_view(buffer.mData, buffer.mSize);
+    }
+
+    bool GetFileVersion(const wchar_t* filePathName, CFileVersion& o_version, std::wstring& o_sErrorMsg) noexcept
+    {
+        try
+        {
+            o_version = CFileVersion();
+            o_sErrorMsg.clear();
+            std::string sPathName;
+            if (filePathName == nullptr || !WideToUtf8(filePathName, wcslen(filePathName), sPathName))
+            {
+                o_sErrorMsg = L"Invalid file path name";
+                return false;
+            }
+            struct stat st = {};
+            if (::stat(sPathName.c_str(), &st) != 0)
+            {
+                int lastErr = errno;
+                std::wostringstream ss;
+                ss << L"stat failed. Error code: " << lastErr << L" " << ErrnoDescription(lastErr);
+                o_sErrorMsg = ss.str();
+                return false;
+            }
+            o_version.mDevice = st.st_dev;
+            o_version.mFileId = st.st_ino;
+            o_version.mModificationTime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+            o_version.mSize = st.st_size;
+            return true;
+        }
+        catch (...)
+        {
+            o_sErrorMsg = L"Memory allocation error.";
+            return false;
+        }
+    }
+
+    bool RenameFile(const wchar_t* sFromPathName, const wchar_t* sToPathName, std::wstring& o_sErrorMsg) noexcept
+    {
+        try
+        {
+            o_sErrorMsg.clear();
+            std::string sFrom;
+            std::string sTo;
+            if (sFromPathName == nullptr || sToPathName == nullptr ||
+                !WideToUtf8(sFromPathName, wcslen(sFromPathName), sFrom) ||
+                !WideToUtf8(sToPathName, wcslen(sToPathName), sTo))
+            {
+                o_sErrorMsg = L"Invalid file path name";
+                return false;
+            }
+            if (::rename(sFrom.c_str(), sTo.c_str()) != 0)
+            {
+                int lastErr = errno;
+                std::wostringstream ss;
+                ss << L"rename failed. Error code: " << lastErr << L" " << ErrnoDescription(lastErr);
+                o_sErrorMsg = ss.str();
+                return false;
+            }
+            return true;
+        }
+        catch (...)
+        {
+            o_sErrorMsg = L"Memory allocation error.";
+            return false;
+        }
+    }
+
+    bool RemoveFile(const wchar_t* sPathName, std::wstring& o_sErrorMsg) noexcept
+    {
+        try
+        {
+            o_sErrorMsg.clear();
+            std::string sUtf8PathName;
+            if (sPathName == nullptr || !WideToUtf8(sPathName, wcslen(sPathName), sUtf8PathName))
+            {
+                o_sErrorMsg = L"Invalid file path name";
+                return false;
+            }
+            if (::unlink(sUtf8PathName.c_str()) != 0)
+            {
+                int lastErr = errno;
+                std::wostringstream ss;
+                ss << L"unlink failed. Error code: " << lastErr << L" " << ErrnoDescription(lastErr);
+                o_sErrorMsg = ss.str();
+                return false;
+            }
+            return true;
+        }
+        catch (...)
+        {
+            o_sErrorMsg = L"Memory allocation error.";
+            return false;
+        }
+    }
+
+    bool GetPeakMemoryUsage(uint64_t& o_bytes, std::wstring& o_sErrorMsg) noexcept
+    {
+        try
+        {
+            o_sErrorMsg.clear();
+            o_bytes = 0;
+            struct rusage usage = {};
+            if (::getrusage(RUSAGE_SELF, &usage) != 0)
+            {
+                int lastErr = errno;
+                std::wostringstream ss;
+                ss << L"getrusage failed. Error code: " << lastErr << L" " << ErrnoDescription(lastErr);
+                o_sErrorMsg = ss.str();
+                return false;
+            }
+            // ru_maxrss is in kilobytes on Linux
+            o_bytes = static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+            return true;
+        }
+        catch (...)
+        {
+            o_sErrorMsg = L"Memory allocation error.";
+            return false;
+        }
+    }
+
+    bool GetEnvironmentValue(const wchar_t* sName, std::wstring& o_sValue) noexcept
+    {
+        try
+        {
+            o_sValue.clear();
+            std::string sUtf8Name;
+            if (sName == nullptr || !WideToUtf8(sName, wcslen(sName), sUtf8Name))
+                return false;
+            const char* sValue = ::getenv(sUtf8Name.c_str());
+            return sValue != nullptr && Utf8ToWide(sValue, strlen(sValue), o_sValue);
+        }
+        catch (...)
+        {
+            return false;
+        }
+    }
+
+    CFileOutputSink::CFileOutputSinkImpl::CFileOutputSinkImpl() :
+        mFd(STDOUT_FILENO),
+        mOwnsFd(false),
+        mIsPreallocated(false)
+    {}
+
+    CFileOutputSink::CFileOutputSinkImpl::CFileOutputSinkImpl(const wchar_t* sFilePathName,
+        uint64_t preallocatedSize) :
+        mFd(-1),
+        mOwnsFd(true),
+        mIsPreallocated(false)
+    {
+        if (sFilePathName == nullptr || !WideToUtf8(sFilePathName, wcslen(sFilePathName), msPathName))
+        {
+            THROW_ERROR(L"Invalid file path name");
+        }
+        mFd = ::open(msPathName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if (mFd == -1)
+        {
+            int lastErr = errno;
+            std::wostringstream ss;
+            ss << L"open failed. Error code: " << lastErr << L" " << ErrnoDescription(lastErr);
+            THROW_ERROR(ss.str().c_str());
+        }
+        // Space is allocated at once, so file isn't fragmented by many small extensions.
+        // File systems that don't support it just grow the file as usual.
+        if (preallocatedSize != 0 && ::fallocate(mFd, 0, 0, static_cast<off_t>(preallocatedSize)) == 0)
+        {
+            mIsPreallocated = true;
+        }
+    }
+
+    CFileOutputSink::CFileOutputSinkImpl::~CFileOutputSinkImpl()
+    {
+        if (mOwnsFd && mFd != -1)
+        {
+            if (mIsPreallocated)
+            {
+                // File would otherwise keep zeros of unused preallocated space
+                int ret = ::ftruncate(mFd, ::lseek(mFd, 0, SEEK_CUR));
+                (void)ret;
+            }
+            ::close(mFd);
+        }
+    }
+
+    void CFileOutputSink::CFileOutputSinkImpl::Write(const std::string_view* buffers, size_t count)
+    {
+        if (mFd == -1)
+        {
+            THROW_ERROR(L"File is closed");
+        }
+        std::vector<struct iovec> iov;
+        iov.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (!buffers[i].empty())
+                iov.push_back({ const_cast<char*>(buffers[i].data()), buffers[i].size() });
+        }
+        size_t first = 0;
+        while (first < iov.size())
+        {
+            ssize_t numWritten = ::writev(mFd, &iov[first],
+                static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX)));
+            if (numWritten < 0)
+            {
+                int lastErr = errno;
+                if (lastErr == EINTR)
+                    continue;
+                std::wostringstream ss;
+                ss << L"writev failed. Error code: " << lastErr << L" " << ErrnoDescription(lastErr);
+                THROW_ERROR(ss.str().c_str());
+            }
+            // Skip buffers that were written and advance the partially written one
+            size_t written = static_cast<size_t>(numWritten);
+            while (first < iov.size() && written >= iov[first].iov_len)
+            {
+                written -= iov[first].iov_len;
+                first++;
+            }
+            if (first < iov.size())
+            {
+                iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + written;
+                iov[first].iov_len -= written;
+            }
+        }
+    }
+
+    void CFileOutputSink::CFileOutputSinkImpl::Close(uint64_t size)
+    {
+        if (!mOwnsFd || mFd == -1)
+            return;
+        int fd = mFd;
+        mFd = -1;
+        const char* sFunction = nullptr;
+        int lastErr = 0;
+        if (mIsPreallocated && ::ftruncate(fd, static_cast<off_t>(size)) != 0)
+        {
+            sFunction = "ftruncate";
+            lastErr = errno;
+        }
+        // Some file systems (e.g. NFS) report write errors on close only
+        if (::close(fd) != 0 && sFunction == nullptr)
+        {
+            sFunction = "close";
+            lastErr = errno;
+        }
+        if (sFunction != nullptr)
+        {
+            std::wostringstream ss;
+            ss << sFunction << L" failed. Error code: " << lastErr << L" " << ErrnoDescription(lastErr);
+            THROW_ERROR(ss.str().c_str());
+        }
+    }
+
+    void CFileOutputSink::CFileOutputSinkImpl::Discard() noexcept
+    {
+        if (!mOwnsFd)
+            return;
+        if (mFd != -1)
+        {
+            ::close(mFd);
+            mFd = -1;
+        }
+        ::unlink(msPathName.c_str());
+    }
+
+    CTerminationSignal::CTerminationSignalImpl::CTerminationSignalImpl() noexcept :
+        mError(0)
+    {
+        sigemptyset(&mSignals);
+        sigaddset(&mSignals, SIGINT);
+        sigaddset(&mSignals, SIGTERM);
+        mError = ::pthread_sigmask(SIG_BLOCK, &mSignals, &mPreviousMask);
+    }
+
+    CTerminationSignal::CTerminationSignalImpl::~CTerminationSignalImpl()
+    {
+        if (mError == 0)
+            ::pthread_sigmask(SIG_SETMASK, &mPreviousMask, nullptr);
+    }
+
+    bool CTerminationSignal::CTerminationSignalImpl::Wait(std::wstring& o_sErrorMsg) noexcept
+    {
+        try
+        {
+            o_sErrorMsg.clear();
+            int lastErr = mError;
+            if (lastErr == 0)
+            {
+                int signalNo = 0;
+                lastErr = ::sigwait(&mSignals, &signalNo);
+            }
+            if (lastErr != 0)
+            {
+                std::wostringstream ss;
+                ss << L"sigwait failed. Error code: " << lastErr << L" " << ErrnoDescription(lastErr);
+                o_sErrorMsg = ss.str();
+                return false;
+            }
+            return true;
+        }
+        catch (...)
+        {
+            o_sErrorMsg = L"Memory allocation error.";
+            return false;
+        }
+    }
+
+    // Fills address of Unix domain socket. Throws CException if path name doesn't fit.
+    static void MakeSocketAddress(const std::string& sPathName, struct sockaddr_un& o_address)
+    {
+        o_address = {};
+        o_address.sun_family = AF_UNIX;
+        if (sPathName.empty() || sPathName.size() >= sizeof(o_address.sun_path))
+        {
+            THROW_ERROR(L"Socket path name is empty or too long");
+        }
+        memcpy(o_address.sun_path, sPathName.c_str(), sPathName.size() + 1);
+    }
+
+    CLocalSocket::CLocalSocketImpl::CLocalSocketImpl(int fd) noexcept :
+        mFd(fd)
+    {}
+
+    CLocalSocket::CLocalSocketImpl::CLocalSocketImpl(const wchar_t* sSocketPathName) :
+        mFd(-1)
+    {
+        std::string sPathName;
+        if (sSocketPathName == nullptr || !WideToUtf8(sSocketPathName, wcslen(sSocketPathName), sPathName))
+        {
+            THROW_ERROR(L"Invalid socket path name");
+        }
+        struct sockaddr_un address;
+        MakeSocketAddress(sPathName, address);
+        mFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (mFd == -1 || ::connect(mFd, reinterpret_cast<const struct sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            int lastErr = errno;
+            if (mFd != -1)
+                ::close(mFd);
+            std::wostringstream ss;
+            ss << L"connect failed. Error code: " << lastErr << L" " << ErrnoDescription(lastErr);
+            THROW_ERROR(ss.str().c_str());
+        }
+    }
+
+    CLocalSocket::CLocalSocketImpl::~CLocalSocketImpl()
+    {
+        if (mFd != -1)
+            ::close(mFd);
+    }
+
+    bool CLocalSocket::CLocalSocketImpl::Read(char* data, size_t size)
+    {
+        size_t numRead = 0;
+        while (numRead < size)
+        {
+            ssize_t ret = ::recv(mFd, data + numRead, size - numRead, 0);
+            if (ret < 0)
+            {
+                int lastErr = errno;
+                if (lastErr == EINTR)
+                    continue;
+                std::wostringstream ss;
+                ss << L"recv failed. Error code: " << lastErr << L" " << ErrnoDescription(lastErr);
+                THROW_ERROR(ss.str().c_str());
+            }
+            if (ret == 0)
+            {
+                if (numRead == 0)
+                    return false;
+                THROW_ERROR(L"Connection was closed in the middle of a message");
+            }
+            numRead += static_cast<size_t>(ret);
+        }
+        return true;
+    }
+
+    void CLocalSocket::CLocalSocketImpl::Write(const std::string_view* buffers, size_t count)
+    {
+        std::vector<struct iovec> iov;
+        iov.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (!buffers[i].empty())
+                iov.push_back({ const_cast<char*>(buffers[i].data()), buffers[i].size() });
+        }
+        size_t first = 0;
+        while (first < iov.size())
+        {
+            // MSG_NOSIGNAL - peer that went away is reported by EPIPE rather than SIGPIPE
+            struct msghdr message = {};
+            message.msg_iov = &iov[first];
+            message.msg_iovlen = std::min<size_t>(iov.size() - first, IOV_MAX);
+            ssize_t numWritten = ::sendmsg(mFd, &message, MSG_NOSIGNAL);
+            if (numWritten < 0)
+            {
+                int lastErr = errno;
+                if (lastErr == EINTR)
+                    continue;
+                std::wostringstream ss;
+                ss << L"sendmsg failed. Error code: " << lastErr << L" " << ErrnoDescription(lastErr);
+                THROW_ERROR(ss.str().c_str());
+            }
+            size_t written = static_cast<size_t>(numWritten);
+            while (first < iov.size() && written >= iov[first].iov_len)
+            {
+                written -= iov[first].iov_len;
+                first++;
+            }
+            if (first < iov.size())
+            {
+                iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + written;
+                iov[first].iov_len -= written;
+            }
+        }
+    }
+
+    void CLocalSocket::CLocalSocketImpl::Shutdown() noexcept
+    {
+        ::shutdown(mFd, SHUT_RDWR);
+    }
+
+    CLocalSocketListener::CLocalSocketListenerImpl::CLocalSocketListenerImpl(const wchar_t* sSocketPathName) :
+        mFd(-1),
+        mWakeFd(-1),
+        mIsShutDown(false)
+    {
+        if (sSocketPathName == nullptr || !WideToUtf8(sSocketPathName, wcslen(sSocketPathName), msPathName))
+        {
+            THROW_ERROR(L"Invalid socket path name");
+        }
+        struct sockaddr_un address;
+        MakeSocketAddress(msPathName, address);
+        // Socket file of a process that exited refuses connections - so it can be replaced
+        struct stat st = {};
+        if (::stat(msPathName.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+        {
+            int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd != -1)
+            {
+                if (::connect(fd, reinterpret_cast<const struct sockaddr*>(&address), sizeof(address)) != 0 &&
+                    errno == ECONNREFUSED)
+                {
+                    ::unlink(msPathName.c_str());
+                }
+                ::close(fd);
+            }
+        }
+        // Listening socket is non-blocking: connection that poll() reported might be reset
+        // before it's accepted (and polling thread mustn't block in accept() then)
+        const char* sFunction = "eventfd";
+        mWakeFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (mWakeFd != -1)
+        {
+            sFunction = "socket";
+            mFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        }
+        if (mFd != -1)
+        {
+            sFunction = "bind";
+            if (::bind(mFd, reinterpret_cast<const struct sockaddr*>(&address), sizeof(address)) == 0)
+            {
+                // Connections are refused until listen() - so nobody connects before socket
+                // file is made accessible by its owner only
+                sFunction = "chmod";
+                if (::chmod(msPathName.c_str(), S_IRUSR | S_IWUSR) == 0)
+                {
+                    sFunction = "listen";
+                    if (::listen(mFd, SOMAXCONN) == 0)
+                        return;
+                }
+                ::unlink(msPathName.c_str());
+            }
+        }
+        int lastErr = errno;
+        if (mFd != -1)
+            ::close(mFd);
+        if (mWakeFd != -1)
+            ::close(mWakeFd);
+        std::wostringstream ss;
+        ss << sFunction << L" failed. Error code: " << lastErr << L" " << ErrnoDescription(lastErr);
+        THROW_ERROR(ss.str().c_str());
+    }
+
+    CLocalSocketListener::CLocalSocketListenerImpl::~CLocalSocketListenerImpl()
+    {
+        ::close(mFd);
+        ::close(mWakeFd);
+        ::unlink(msPathName.c_str());
+    }
+
+    bool CLocalSocketListener::CLocalSocketListenerImpl::IsPeerPermitted(int fd) noexcept
+    {
+        struct ucred credentials = {};
+        socklen_t size = sizeof(credentials);
+        if (::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &size) != 0)
+            return false;
+        return credentials.uid == ::geteuid() || credentials.uid == 0;
+    }
+
+    void CLocalSocketListener::CLocalSocketListenerImpl::Wake() noexcept
+    {
+        uint64_t value = 1;
+        // Counter can't overflow in practice - and thread is woken up even if it did
+        ssize_t ret = ::write(mWakeFd, &value, sizeof(value));
+        (void)ret;
+    }
+
+    std::unique_ptr<CLocalSocket::CLocalSocketImpl> CLocalSocketListener::CLocalSocketListenerImpl::Accept()
+    {
+        std::lock_guard<std::mutex> pollLock(mPollMutex);
+        for (;;)
+        {
+            if (mIsShutDown)
+                return nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mIdleMutex);
+                mPollFds.resize(2 + mIdleConnections.size());
+                for (size_t i = 0; i < mIdleConnections.size(); ++i)
+                {
+                    mPollFds[2 + i] = { mIdleConnections[i]->GetFd(), POLLIN, 0 };
+                }
+            }
+            mPollFds[0] = { mFd, POLLIN, 0 };
+            mPollFds[1] = { mWakeFd, POLLIN, 0 };
+            if (::poll(mPollFds.data(), mPollFds.size(), -1) < 0)
+            {
+                int lastErr = errno;
+                if (lastErr == EINTR)
+                    continue;
+                std::wostringstream ss;
+                ss << L"poll failed. Error code: " << lastErr << L" " << ErrnoDescription(lastErr);
+                THROW_ERROR(ss.str().c_str());
+            }
+            if (mIsShutDown)
+                return nullptr;
+            if (mPollFds[1].revents != 0)
+            {
+                uint64_t value = 0;
+                ssize_t ret = ::read(mWakeFd, &value, sizeof(value));
+                (void)ret;
+            }
+            // Connection that's returned goes to the end of the list when it becomes idle
+            // again - so ready connections are served in turn
+            for (size_t i = 2; i < mPollFds.size(); ++i)
+            {
+                if (mPollFds[i].revents != 0)
+                {
+                    std::lock_guard<std::mutex> lock(mIdleMutex);
+                    std::unique_ptr<CLocalSocket::CLocalSocketImpl> connection = std::move(mIdleConnections[i - 2]);
+                    mIdleConnections.erase(mIdleConnections.begin() + (i - 2));
+                    return connection;
+                }
+            }
+            if (mPollFds[0].revents == 0)
+                continue;
+            int fd = ::accept4(mFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd != -1)
+            {
+                if (IsPeerPermitted(fd))
+                    return std::make_unique<CLocalSocket::CLocalSocketImpl>(fd);
+                ::close(fd);
+                continue;
+            }
+            int lastErr = errno;
+            // Errors of connection that was being accepted aren't errors of the listener
+            if (lastErr == EAGAIN || lastErr == EWOULDBLOCK || lastErr == EINTR || lastErr == ECONNABORTED ||
+                lastErr == EPROTO)
+            {
+                continue;
+            }
+            std::wostringstream ss;
+            ss << L"accept failed. Error code: " << lastErr << L" " << ErrnoDescription(lastErr);
+            THROW_ERROR(ss.str().c_str());
+        }
+    }
+
+    void CLocalSocketListener::CLocalSocketListenerImpl::AddIdleConnection(
+        std::unique_ptr<CLocalSocket::CLocalSocketImpl> connection)
+    {
+        if (mIsShutDown)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mIdleMutex);
+            mIdleConnections.push_back(std::move(connection));
+        }
+        Wake();
+    }
+
+    void CLocalSocketListener::CLocalSocketListenerImpl::Shutdown() noexcept
+    {
+        mIsShutDown = true;
+        Wake();
+        // Threads that wait for mPollMutex see mIsShutDown when they get it
+        ::shutdown(mFd, SHUT_RDWR);
+    }
+
+    CLogger::CLoggerImpl::CLoggerImpl() noexcept :
+        mFd(-1),
+        mFileSize(0),
+        mMaxFileSize(0),
+        mMaxFileCount(0)
+    {}
+
+    CLogger::CLoggerImpl::~CLoggerImpl()
+    {
+        if (mFd != -1)
+            ::close(mFd);
+    }
+
+    void CLogger::CLoggerImpl::Open(const wchar_t* sFilePathName, uint64_t maxFileSize, unsigned int maxFileCount)
+    {
+        int fd = -1;
+        std::string sPathName;
+        uint64_t fileSize = 0;
+        if (sFilePathName != nullptr)
+        {
+            if (!WideToUtf8(sFilePathName, wcslen(sFilePathName), sPathName))
+            {
+                THROW_ERROR(L"Invalid file path name");
+            }
+            fd = ::open(sPathName.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+            if (fd == -1)
+            {
+                int lastErr = errno;
+                std::wostringstream ss;
+                ss << L"open failed. Error code: " << lastErr << L" " << ErrnoDescription(lastErr);
+                THROW_ERROR(ss.str().c_str());
+            }
+            struct stat fileStat;
+            if (::fstat(fd, &fileStat) == 0)
+                fileSize = static_cast<uint64_t>(fileStat.st_size);
+        }
+        if (mFd != -1)
+            ::close(mFd);
+        mFd = fd;
+        msPathName.swap(sPathName);
+        mFileSize = fileSize;
+        mMaxFileSize = maxFileSize;
+        mMaxFileCount = maxFileCount;
+    }
+
+    void CLogger::CLoggerImpl::Write(const char* data, size_t size) noexcept
+    {
+        if (mFd != -1 && mFileSize != 0 && mFileSize + size > mMaxFileSize)
+            Rotate();
+        // stderr is written directly - its stream might be in wide-oriented mode
+        int fd = mFd != -1 ? mFd : STDERR_FILENO;
+        while (size > 0)
+        {
+            ssize_t numWritten = ::write(fd, data, size);
+            if (numWritten < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return;
+            }
+            data += numWritten;
+            size -= static_cast<size_t>(numWritten);
+            if (fd == mFd)
+                mFileSize += static_cast<uint64_t>(numWritten);
+        }
+    }
+
+    void CLogger::CLoggerImpl::Rotate() noexcept
+    {
+        try
+        {
+            ::close(mFd);
+            mFd = -1;
+            for (unsigned int i = mMaxFileCount > 0 ? mMaxFileCount - 1 : 0; i >= 1; --i)
+            {
+                std::string sFrom = i == 1 ? msPathName : msPathName + "." + std::to_string(i - 1);
+                std::string sTo = msPathName + "." + std::to_string(i);
+                // Older files might not exist yet
+                ::rename(sFrom.c_str(), sTo.c_str());
+            }
+        }
+        catch (...)
+        {
+            // Current file is truncated if it couldn't be renamed
+        }
+        // Messages go to stderr if the new file couldn't be created
+        mFd = ::open(msPathName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0666);
+        mFileSize = 0;
+    }
+}
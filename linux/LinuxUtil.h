@@ -0,0 +1,252 @@
+// Contains declarations of OS-specific (Linux) classes, functions.
+#ifndef _LINUXUTIL_H__
+#define _LINUXUTIL_H__
+
+#include "../Util.h"
+#include "../OutputSink.h"
+#include "../LocalSocket.h"
+#include <atomic>
+#include <mutex>
+#include <signal.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include <vector>
+#include <string>
+
+namespace OTInterviewExercise1
+{
+    // Low-level class for Linux-specific (un)initialization. Nothing needs to be
+    // initialized on Linux (there is no COM) - so it always succeeds.
+    class COsInitialization::COsInitializationImpl
+    {
+    public:
+        COsInitializationImpl() = default;
+        ~COsInitializationImpl() = default;
+        bool IsOk(std::wstring& o_errorMsg) const noexcept;
+    };
+
+    // Low-level class for retrieving contents of text files (ASCII or UTF8)
+    class CTextFileReader::CTextFileReaderImpl
+    {
+    public:
+        CTextFileReaderImpl(const wchar_t* filePathName, ReadMode readMode);
+        ~CTextFileReaderImpl();
+        Status GetStatus(std::wstring& o_sErrorMsg) const noexcept;
+        bool GetBytes(std::string_view& o_fileData) const noexcept;
+    private:
+        enum
+        {
+            INTERNAL_BUF_SIZE = 65536
+        };
+        // Maps or reads file. Status of failure is code of returned error.
+        CStatus Open(const wchar_t* filePathName, ReadMode readMode);
+        // Maps regular file into memory. Returns false if file can't be mapped.
+        bool MapFile(int fd, size_t fileSize) noexcept;
+        CStatus ReadFile(int fd, size_t sizeHint);
+
+        std::vector<unsigned char> mFileContents;
+        // Memory-mapped file view (nullptr if file was read into mFileContents)
+        void* mMappedData;
+        size_t mMappedSize;
+        Status mStatus;
+        // Error of expected failure (its message is formatted when it's asked for)
+        CError mError;
+        // Message of exceptional failure (empty if there is none)
+        std::wstring mErrMsg;
+    };
+
+    // Low-level class for reading files in chunks. Reads of regular files are queued to
+    // io_uring (it's set up by system calls - liburing isn't needed): every buffer that's
+    // not being processed by the caller has a read in flight. If io_uring isn't available
+    // (old kernel, seccomp filter of container) or file isn't regular, chunks are read by
+    // pread()/read() on demand, and kernel is asked to read ahead.
+    class CChunkedFileReader::CChunkedFileReaderImpl
+    {
+    public:
+        CChunkedFileReaderImpl(const wchar_t* filePathName, size_t chunkSize, unsigned int chunkCount);
+        ~CChunkedFileReaderImpl();
+        bool Exists(std::wstring& o_sErrorMsg) const noexcept;
+        void NextChunk(std::string_view& o_chunk);
+        bool IsQueued() const noexcept
+        {
+            return mRingFd != -1;
+        }
+    private:
+        enum class Status
+        {
+            NotFound,
+            FindError,
+            Open,
+            ReadError
+        };
+        struct CBuffer
+        {
+            char* mData;
+            // Offset of the chunk in the file
+            uint64_t mOffset;
+            // Bytes read so far
+            size_t mSize;
+            // Buffer is full or end of file was reached
+            bool mIsComplete;
+            bool mIsEndOfFile;
+            struct iovec mIovec;
+        };
+
+        // Opens file and queues reads. Status of expected failure is code of returned
+        // error (exceptional ones are thrown).
+        CStatus Open(const wchar_t* filePathName, unsigned int chunkCount);
+        std::wstring GetErrorMessage() const;
+        // Returns false if io_uring can't be used
+        bool SetupRing(unsigned int entryCount) noexcept;
+        void CloseRing() noexcept;
+        // Queues read of the rest of buffer
+        void Submit(size_t bufferIndex);
+        // Waits for one completed read
+        void Complete();
+        // Reads chunk on demand (when reads can't be queued)
+        void Read(CBuffer& buffer);
+        void ReadNextChunk(std::string_view& o_chunk);
+
+        int mFd;
+        bool mIsRegular;
+        size_t mChunkSize;
+        // Page-aligned memory of all buffers
+        void* mMemory;
+        std::vector<CBuffer> mBuffers;
+        // Index of the chunk that will be returned by the next NextChunk() call
+        uint64_t mNextChunk;
+        // Offset of the next chunk that will be queued
+        uint64_t mNextOffset;
+        // Chunks past end of file aren't queued
+        bool mIsEndOfFileSeen;
+        bool mIsEndOfFileReturned;
+        unsigned int mInFlightCount;
+        int mRingFd;
+        void* mSqRing;
+        size_t mSqRingSize;
+        void* mCqRing;
+        size_t mCqRingSize;
+        struct io_uring_sqe* mSqes;
+        size_t mSqesSize;
+        // Fields of rings shared with kernel
+        unsigned int* mSqTail;
+        unsigned int* mSqMask;
+        unsigned int* mSqArray;
+        unsigned int* mCqHead;
+        unsigned int* mCqTail;
+        unsigned int* mCqMask;
+        struct io_uring_cqe* mCqes;
+        Status mStatus;
+        // Error of expected failure (its message is formatted when it's asked for)
+        CError mError;
+        // Message of exceptional failure (empty if there is none)
+        std::wstring mErrMsg;
+    };
+
+    // Low-level class for writing output files (or standard output)
+    class CFileOutputSink::CFileOutputSinkImpl
+    {
+    public:
+        CFileOutputSinkImpl();
+        CFileOutputSinkImpl(const wchar_t* sFilePathName, uint64_t preallocatedSize);
+        ~CFileOutputSinkImpl();
+        // Writes all buffers (retries partial writes)
+        void Write(const std::string_view* buffers, size_t count);
+        // size - number of bytes written (file is truncated to it if space was preallocated)
+        void Close(uint64_t size);
+        void Discard() noexcept;
+    private:
+        int mFd;
+        // Standard output isn't closed
+        bool mOwnsFd;
+        bool mIsPreallocated;
+        std::string msPathName;
+    };
+
+    // Blocks SIGINT and SIGTERM in calling thread (and threads it starts) and receives
+    // them by sigwait()
+    class CTerminationSignal::CTerminationSignalImpl
+    {
+    public:
+        CTerminationSignalImpl() noexcept;
+        ~CTerminationSignalImpl();
+        bool Wait(std::wstring& o_sErrorMsg) noexcept;
+    private:
+        sigset_t mSignals;
+        sigset_t mPreviousMask;
+        int mError;
+    };
+
+    // Low-level class for stream connections over Unix domain socket
+    class CLocalSocket::CLocalSocketImpl
+    {
+    public:
+        explicit CLocalSocketImpl(int fd) noexcept;
+        explicit CLocalSocketImpl(const wchar_t* sSocketPathName);
+        ~CLocalSocketImpl();
+        bool Read(char* data, size_t size);
+        void Write(const std::string_view* buffers, size_t count);
+        void Shutdown() noexcept;
+        int GetFd() const noexcept
+        {
+            return mFd;
+        }
+    private:
+        int mFd;
+    };
+
+    // Low-level class for listening Unix domain socket. Listening socket and idle
+    // connections are polled by one thread at a time (others wait for it in Accept()).
+    class CLocalSocketListener::CLocalSocketListenerImpl
+    {
+    public:
+        explicit CLocalSocketListenerImpl(const wchar_t* sSocketPathName);
+        ~CLocalSocketListenerImpl();
+        std::unique_ptr<CLocalSocket::CLocalSocketImpl> Accept();
+        void AddIdleConnection(std::unique_ptr<CLocalSocket::CLocalSocketImpl> connection);
+        void Shutdown() noexcept;
+    private:
+        // Returns false if peer isn't the owner of the process (or root)
+        static bool IsPeerPermitted(int fd) noexcept;
+        // Wakes up thread that polls
+        void Wake() noexcept;
+
+        int mFd;
+        // eventfd that wakes up poll() when idle connection is added or listener is shut down
+        int mWakeFd;
+        std::string msPathName;
+        std::atomic<bool> mIsShutDown;
+        std::mutex mPollMutex;
+        // Descriptors polled by thread that holds mPollMutex
+        std::vector<struct pollfd> mPollFds;
+        // Only the thread that polls removes idle connections (others add them at the end)
+        std::mutex mIdleMutex;
+        std::vector<std::unique_ptr<CLocalSocket::CLocalSocketImpl>> mIdleConnections;
+    };
+
+    // Writes log messages to stderr (Linux doesn't have a debug console) or appends them
+    // to a rotating log file.
+    class CLogger::CLoggerImpl
+    {
+    public:
+        CLoggerImpl() noexcept;
+        ~CLoggerImpl();
+        // nullptr means stderr
+        void Open(const wchar_t* sFilePathName, uint64_t maxFileSize, unsigned int maxFileCount);
+        // Writes UTF8 messages. Errors are ignored - there is nowhere to report them.
+        void Write(const char* data, size_t size) noexcept;
+    private:
+        // Renames files ({file} -> {file}.1 -> {file}.2 ...) and starts a new one
+        void Rotate() noexcept;
+
+        // -1 means stderr
+        int mFd;
+        std::string msPathName;
+        uint64_t mFileSize;
+        uint64_t mMaxFileSize;
+        unsigned int mMaxFileCount;
+    };
+}
+
+#endif
@@ -1,12 +1,45 @@
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #endif
 #include <iostream>
 #include <string>
 #include <vector>
 #include <functional>
-#include "..\XmlParserWrapper.h"
-#include "..\Util.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <set>
+#include <map>
+#include <mutex>
+#include <string.h>
+#include <errno.h>
+#include "../XmlParserWrapper.h"
+#include "../BatchConverter.h"
+#include "../StylesheetCache.h"
+#include "../StylesheetFile.h"
+#include "../OutputSink.h"
+#include "../CatalogEngine.h"
+#include "../CatalogRecordSorter.h"
+#include "../CatalogRowCache.h"
+#include "../CatalogIndex.h"
+#include "../ConversionServer.h"
+#include "../XmlParserPool.h"
+#include "../LocalSocket.h"
+#include "../ConversionArena.h"
+#include "../ConversionMetrics.h"
+#include "../Utf8Transcoder.h"
+#include "../HtmlEscaper.h"
+#include "../LogQueue.h"
+#include "../Trace.h"
+#include "../XmlPullParser.h"
+#include "../Util.h"
 using namespace OTInterviewExercise1;
 
 struct CTestFailureDescr
@@ -108,8 +141,104 @@ bool Test_TextFileReader()
 
     SYSTEST_RETURN();
 }
+#else
+bool Test_TextFileReader()
+{
+    SYSTEST_ENTER();
+
+    // Should fail - directory can't be read as a file
+    std::wstring errorMsg;
+    std::wstring fileData;
+    CTextFileReader reader(L"/");
+    SYSTEST_ASSERT(reader.Exists(errorMsg));
+    SYSTEST_ASSERT(!reader.GetContents(fileData, errorMsg));
+    SYSTEST_ASSERT(!errorMsg.empty());
+    SYSTEST_ASSERT(fileData.empty());
+
+    std::wstring errorMsg3;
+    std::wstring fileData3;
+    CTextFileReader reader3(L"/nonexisting_file.txt");
+    SYSTEST_ASSERT(!reader3.Exists(errorMsg3));
+    SYSTEST_ASSERT(!reader3.GetContents(fileData3, errorMsg3));
+    SYSTEST_ASSERT(!errorMsg3.empty());
+    SYSTEST_ASSERT(fileData3.empty());
+
+    SYSTEST_RETURN();
+}
+#endif
+
+bool Test_TextFileReaderModes()
+{
+    SYSTEST_ENTER();
+
+    const std::string sFileData = "<CATALOG><CD><TITLE>Caf\xC3\xA9</TITLE></CD></CATALOG>";
+    std::filesystem::path filePath = std::filesystem::temp_directory_path() / "ot_systemtests_reader.xml";
+    {
+        std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+        file.write(sFileData.data(), sFileData.size());
+    }
+    auto cleanup = MakeRAIICleanup([&filePath]() {
+        std::error_code ec;
+        std::filesystem::remove(filePath, ec);
+        });
+
+    for (auto readMode : { CTextFileReader::ReadMode::Read, CTextFileReader::ReadMode::Map })
+    {
+        std::wstring errorMsg;
+        std::string_view bytes;
+        std::wstring fileData;
+        CTextFileReader reader(filePath.wstring().c_str(), readMode);
+        SYSTEST_ASSERT(reader.Exists(errorMsg));
+        SYSTEST_ASSERT(reader.GetBytes(bytes, errorMsg));
+        SYSTEST_ASSERT(bytes == sFileData);
+        SYSTEST_ASSERT(reader.GetContents(fileData, errorMsg));
+        SYSTEST_ASSERT(fileData == L"<CATALOG><CD><TITLE>Caf\u00e9</TITLE></CD></CATALOG>");
+        SYSTEST_ASSERT(errorMsg.empty());
+    }
+
+    std::wstring errorMsg2;
+    std::string_view bytes2;
+    CTextFileReader reader2(L"nonexisting_file.txt", CTextFileReader::ReadMode::Map);
+    SYSTEST_ASSERT(!reader2.GetBytes(bytes2, errorMsg2));
+    SYSTEST_ASSERT(bytes2.empty());
+    SYSTEST_ASSERT(!errorMsg2.empty());
+
+#ifndef _WIN32
+    // Special file that reports 0 size - falls back to reading
+    std::wstring errorMsg3;
+    std::string_view bytes3;
+    CTextFileReader reader3(L"/proc/self/status", CTextFileReader::ReadMode::Map);
+    SYSTEST_ASSERT(reader3.GetBytes(bytes3, errorMsg3));
+    SYSTEST_ASSERT(!bytes3.empty());
 #endif
 
+    SYSTEST_RETURN();
+}
+
+bool Test_Result()
+{
+    SYSTEST_ENTER();
+
+    CResult<int> value(42);
+    SYSTEST_ASSERT(value && value.HasValue());
+    SYSTEST_ASSERT(value.GetValue() == 42);
+
+    // Expected failure keeps only pointers to literals - message is formatted on demand
+    CResult<int> failure(CError(7, L"File is empty"));
+    SYSTEST_ASSERT(!failure && !failure.HasValue());
+    SYSTEST_ASSERT(failure.GetError().mInternalErrorCode == 7);
+    SYSTEST_ASSERT(FormatError(failure.GetError()) == L"File is empty");
+
+    CStatus ok;
+    SYSTEST_ASSERT(ok.HasValue());
+    CStatus systemFailure(CError(1, L"", L"open", ENOENT));
+    SYSTEST_ASSERT(!systemFailure);
+    std::wstring sMsg = FormatError(systemFailure.GetError());
+    SYSTEST_ASSERT(sMsg.find(L"open failed") != std::wstring::npos);
+
+    SYSTEST_RETURN();
+}
+
 bool Test_RAIICleanup()
 {
     SYSTEST_ENTER();
@@ -162,14 +291,2177 @@ bool Test_XmlParserWrapper()
     SYSTEST_RETURN();
 }
 
-int main()
+bool Test_NativeXmlParserWrapper()
 {
-    std::vector<std::function<bool()>> v = {
-    Test_CException,
-    Test_OsInitialization,
+    SYSTEST_ENTER();
+
+    // Native engine supports built-in catalog style sheet only
+    CXmlParserWrapper parser(CXmlParserWrapper::EMXSLTFile::File, L"cat_items.xslt",
+        CXmlParserWrapper::EMEngine::Native);
+    std::wstring sHTML;
+    std::wstring sError;
+    SYSTEST_ASSERT(!parser.Parse(L"<some>ttt</some>", sHTML, sError));
+    SYSTEST_ASSERT(!sError.empty());
+
+    CXmlParserWrapper parser2(CXmlParserWrapper::EMXSLTFile::CatalogResources, nullptr,
+        CXmlParserWrapper::EMEngine::Native);
+    std::wstring sHTML2;
+    std::wstring sError2;
+    SYSTEST_ASSERT(!parser2.Parse(L"<some>ttt", sHTML2, sError2));
+    SYSTEST_ASSERT(sHTML2.empty());
+    SYSTEST_ASSERT(!sError2.empty());
+
+    std::wstring sHTML3;
+    std::wstring sError3;
+    SYSTEST_ASSERT(parser2.Parse(L"<some>ttt</some>", sHTML3, sError3));
+    SYSTEST_ASSERT(sError3.empty());
+    SYSTEST_ASSERT(sHTML3 ==
+        L"<html><body><h2>CD Catalog</h2><table border=\"1\">"
+        L"<tr bgcolor=\"#9acd32\"><th>Title</th><th>Artist</th><th>Country</th>"
+        L"<th>Company</th><th>Price</th><th>Year</th></tr></table></body></html>");
+
+    // Non-ASCII text must survive wchar_t -> UTF8 -> wchar_t round trip
+    std::wstring sHTML4;
+    std::wstring sError4;
+    SYSTEST_ASSERT(parser2.Parse(L"<CATALOG><CD><TITLE>Caf\u00e9 \u4e2d</TITLE></CD></CATALOG>", sHTML4, sError4));
+    SYSTEST_ASSERT(sHTML4.find(L"<td>Caf\u00e9 \u4e2d</td>") != std::wstring::npos);
+
+    SYSTEST_RETURN();
+}
+
+bool Test_ConversionArena()
+{
+    SYSTEST_ENTER();
+
+    // Counts allocations that weren't freed
+    struct CCountingResource : public std::pmr::memory_resource
+    {
+        CCountingResource() :
+            mAllocations(0),
+            mLiveBytes(0)
+        {}
+        void* do_allocate(size_t bytes, size_t alignment) override
+        {
+            mAllocations++;
+            mLiveBytes += bytes;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override
+        {
+            mLiveBytes -= bytes;
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+        size_t mAllocations;
+        size_t mLiveBytes;
+    };
+
+    std::string sXml = "<CATALOG>";
+    for (size_t i = 0; i < 3000; ++i)
+    {
+        sXml += "<CD><TITLE>A title that doesn't fit into small string " + std::to_string(i) +
+            "</TITLE><ARTIST>Artist " + std::to_string(i % 17) + "</ARTIST></CD>";
+    }
+    sXml += "</CATALOG>";
+
+    // Memory of conversion comes from caller's resource and is freed after it
+    CCountingResource resource;
+    CXmlParserWrapper parser(CXmlParserWrapper::EMXSLTFile::CatalogResources);
+    parser.SetMemoryResource(&resource);
+    std::string sHtml;
+    CStringOutputSink htmlSink(sHtml);
+    std::wstring sError;
+    SYSTEST_ASSERT(parser.Parse(sXml, htmlSink, sError));
+    SYSTEST_ASSERT(resource.mAllocations > 0);
+    SYSTEST_ASSERT(resource.mLiveBytes == 0);
+
+    // Default arena is reset between conversions - output doesn't change
+    CXmlParserWrapper arenaParser(CXmlParserWrapper::EMXSLTFile::CatalogResources);
+    for (int i = 0; i < 3; ++i)
+    {
+        std::string sArenaHtml;
+        CStringOutputSink arenaSink(sArenaHtml);
+        SYSTEST_ASSERT(arenaParser.Parse(sXml, arenaSink, sError));
+        SYSTEST_ASSERT(sArenaHtml == sHtml);
+    }
+
+    // Memory of arena can be used again after reset (initial buffer grows on reset)
+    CConversionArena arena;
+    for (int i = 0; i < 2; ++i)
+    {
+        std::pmr::vector<char> data(CConversionArena::INITIAL_BUFFER_SIZE * 4, 'a', arena.GetResource());
+        SYSTEST_ASSERT(data.back() == 'a');
+        arena.Reset();
+    }
+
+    SYSTEST_RETURN();
+}
+
+bool Test_Utf8XmlParserWrapper()
+{
+    SYSTEST_ENTER();
+
+    COsInitialization init;
+
+    CXmlParserWrapper parser(CXmlParserWrapper::EMXSLTFile::CatalogResources);
+    const wchar_t* sXMLWide =
+        L"<CATALOG><CD><TITLE>Caf\u00e9 \u4e2d</TITLE><ARTIST>B</ARTIST></CD>"
+        L"<CD><TITLE>T &amp; U</TITLE><ARTIST>A</ARTIST></CD></CATALOG>";
+    std::string sXML;
+    SYSTEST_ASSERT(WideToUtf8(sXMLWide, wcslen(sXMLWide), sXML));
+
+    // UTF8 and wchar_t versions of Parse must produce the same HTML
+    std::string sHTML;
+    CStringOutputSink htmlSink(sHTML);
+    std::wstring sError;
+    SYSTEST_ASSERT(parser.Parse(sXML, htmlSink, sError));
+    SYSTEST_ASSERT(sError.empty());
+    std::wstring sHTMLWide;
+    SYSTEST_ASSERT(parser.Parse(std::wstring(sXMLWide), sHTMLWide, sError));
+    std::wstring sHTMLConverted;
+    SYSTEST_ASSERT(Utf8ToWide(sHTML.data(), sHTML.size(), sHTMLConverted));
+    SYSTEST_ASSERT(sHTMLConverted == sHTMLWide);
+
+    // Invalid UTF8 is rejected
+    std::string sHTML2;
+    CStringOutputSink htmlSink2(sHTML2);
+    std::wstring sError2;
+    SYSTEST_ASSERT(!parser.Parse(std::string_view("<CATALOG>\xC3(</CATALOG>"), htmlSink2, sError2));
+    SYSTEST_ASSERT(!sError2.empty());
+
+    // Native engine streams rows into the sink in chunks
+    CXmlParserWrapper parser2(CXmlParserWrapper::EMXSLTFile::CatalogResources, nullptr,
+        CXmlParserWrapper::EMEngine::Native);
+    std::string sBigXML = "<CATALOG>";
+    for (int i = 0; i < 10000; ++i)
+    {
+        sBigXML += "<CD><TITLE>Title " + std::to_string(i) + "</TITLE><ARTIST>Artist</ARTIST></CD>";
+    }
+    sBigXML += "</CATALOG>";
+    std::string sHTML3;
+    CStringOutputSink htmlSink3(sHTML3);
+    std::wstring sError3;
+    SYSTEST_ASSERT(parser2.Parse(sBigXML, htmlSink3, sError3));
+    std::string sHTML4;
+    CCatalogEngine::Transform(sBigXML, sHTML4);
+    SYSTEST_ASSERT(sHTML3 == sHTML4);
+    SYSTEST_ASSERT(sHTML3.find("<td>Title 9999</td>") != std::string::npos);
+
+    SYSTEST_RETURN();
+}
+
+bool Test_FileOutputSink()
+{
+    SYSTEST_ENTER();
+
+    std::filesystem::path filePath = std::filesystem::temp_directory_path() / "ot_systemtests_sink.html";
+    auto cleanup = MakeRAIICleanup([&filePath]() {
+        std::error_code ec;
+        std::filesystem::remove(filePath, ec);
+        });
+    auto readFile = [&filePath]() {
+        std::ifstream file(filePath, std::ios::binary);
+        std::ostringstream ss;
+        ss << file.rdbuf();
+        return ss.str();
+    };
+
+    // Small writes are buffered, large ones and gather writes bypass the buffer.
+    // Unused preallocated space isn't part of the file.
+    std::string sExpected;
+    {
+        CFileOutputSink sink(filePath.wstring().c_str(), 1024 * 1024);
+        for (int i = 0; i < 1000; ++i)
+        {
+            std::string sRow = "<tr><td>" + std::to_string(i) + "</td></tr>";
+            sink.Write(sRow.data(), sRow.size());
+            sExpected += sRow;
+        }
+        std::string sLarge(CFileOutputSink::BUFFER_SIZE * 2, 'x');
+        const std::string_view buffers[] = { "a", sLarge, "", "b" };
+        sink.WriteGather(buffers, 4);
+        sExpected += "a" + sLarge + "b";
+        sink.Write("end", 3);
+        sExpected += "end";
+        SYSTEST_ASSERT(sink.GetSize() == sExpected.size());
+        sink.Close();
+        SYSTEST_ASSERT(!sink.HasWriteError());
+    }
+    SYSTEST_ASSERT(std::filesystem::file_size(filePath) == sExpected.size());
+    SYSTEST_ASSERT(readFile() == sExpected);
+
+    // Discarded file is deleted
+    {
+        CFileOutputSink sink(filePath.wstring().c_str(), 4096);
+        sink.Write("partial", 7);
+        sink.Discard();
+    }
+    SYSTEST_ASSERT(!std::filesystem::exists(filePath));
+
+    // File that can't be created
+    bool isThrown = false;
+    try
+    {
+        CFileOutputSink sink((filePath / "no_such_dir" / "a.html").wstring().c_str());
+    }
+    catch (const CException& /*ex*/)
+    {
+        isThrown = true;
+    }
+    SYSTEST_ASSERT(isThrown);
+
+    SYSTEST_RETURN();
+}
+
+bool Test_BatchConverter()
+{
+    SYSTEST_ENTER();
+
+    std::filesystem::path dirPath = std::filesystem::temp_directory_path() / "ot_systemtests_batch";
+    std::error_code ec;
+    std::filesystem::remove_all(dirPath, ec);
+    std::filesystem::create_directories(dirPath / "html");
+    auto cleanup = MakeRAIICleanup([&dirPath]() {
+        std::error_code ec;
+        std::filesystem::remove_all(dirPath, ec);
+        });
+    const int numFiles = 20;
+    for (int i = 0; i < numFiles; ++i)
+    {
+        std::ofstream file(dirPath / ("cat" + std::to_string(i) + ".xml"), std::ios::binary);
+        file << "<CATALOG><CD><TITLE>T" << i << "</TITLE></CD></CATALOG>";
+    }
+    {
+        std::ofstream file(dirPath / "bad.XML", std::ios::binary);
+        file << "<CATALOG>";
+        std::ofstream otherFile(dirPath / "notes.txt", std::ios::binary);
+        otherFile << "not XML";
+    }
+
+    SYSTEST_ASSERT(CBatchConverter::GetHtmlFilePathName(L"dir/a.xml", L"") ==
+        (std::filesystem::path("dir") / "a.html").wstring());
+    SYSTEST_ASSERT(CBatchConverter::GetHtmlFilePathName(L"dir/a.xml", L"out") ==
+        (std::filesystem::path("out") / "a.html").wstring());
+
+    // Directory, missing file and manifest
+    std::istringstream manifest((dirPath / "cat0.xml").string() + "\r\n\n");
+    std::vector<std::wstring> args = { dirPath.wstring(), L"nonexisting_file.xml", L"-" };
+    std::vector<std::wstring> xmlFiles;
+    std::wstring sError;
+    SYSTEST_ASSERT(CBatchConverter::CollectXmlFiles(args, manifest, xmlFiles, sError));
+    SYSTEST_ASSERT(xmlFiles.size() == numFiles + 3);
+    SYSTEST_ASSERT(xmlFiles.back() == (dirPath / "cat0.xml").wstring());
+
+    CBatchConverter converter(4, (dirPath / "html").wstring());
+    std::vector<CBatchConverter::CFileResult> results;
+    double seconds = 0;
+    SYSTEST_ASSERT(converter.Run(xmlFiles, results, seconds, sError));
+    SYSTEST_ASSERT(results.size() == xmlFiles.size());
+    size_t numSucceeded = 0;
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        SYSTEST_ASSERT(results[i].mXmlFilePathName == xmlFiles[i]);
+        if (results[i].mExitCode == OTInterviewExercise1ExitCode::SUCCESS)
+        {
+            numSucceeded++;
+            SYSTEST_ASSERT(std::filesystem::file_size(results[i].mHtmlFilePathName) == results[i].mHtmlSize);
+        }
+    }
+    SYSTEST_ASSERT(numSucceeded == numFiles + 1);
+    SYSTEST_ASSERT(results[0].mExitCode == OTInterviewExercise1ExitCode::XML_PARSER_ERROR);
+    SYSTEST_ASSERT(!std::filesystem::exists(dirPath / "html" / "bad.html"));
+    SYSTEST_ASSERT(results[numFiles + 1].mExitCode == OTInterviewExercise1ExitCode::XML_FILE_NOT_FOUND);
+
+    SYSTEST_RETURN();
+}
+
+bool Test_StylesheetCache()
+{
+    SYSTEST_ENTER();
+
+    struct CTestStylesheet : public CCompiledStylesheet
+    {
+        explicit CTestStylesheet(std::string_view sText) :
+            msText(sText)
+        {}
+        std::string msText;
+    };
+    std::atomic<int> numCompiled(0);
+    auto compile = [&numCompiled](std::string_view sStylesheet) -> CStylesheetCache::CompiledStylesheetPtr {
+        if (sStylesheet.empty())
+        {
+            THROW_ERROR(L"Empty style sheet");
+        }
+        numCompiled++;
+        return std::make_shared<CTestStylesheet>(sStylesheet);
+    };
+
+    CStylesheetCache cache;
+    auto compiled = cache.Get("engine", "<xsl:stylesheet/>", compile);
+    SYSTEST_ASSERT(static_cast<const CTestStylesheet*>(compiled.get())->msText == "<xsl:stylesheet/>");
+    SYSTEST_ASSERT(cache.Get("engine", "<xsl:stylesheet/>", compile) == compiled);
+    SYSTEST_ASSERT(cache.Get("engine2", "<xsl:stylesheet/>", compile) != compiled);
+    SYSTEST_ASSERT(cache.GetHits() == 1);
+    SYSTEST_ASSERT(cache.GetMisses() == 2);
+    SYSTEST_ASSERT(cache.GetSize() == 2);
+
+    // Failed compilation isn't cached
+    bool isThrown = false;
+    try
+    {
+        cache.Get("engine", "", compile);
+    }
+    catch (const CException& /*ex*/)
+    {
+        isThrown = true;
+    }
+    SYSTEST_ASSERT(isThrown);
+    SYSTEST_ASSERT(cache.GetSize() == 2);
+
+    // Style sheet is compiled once regardless of number of threads requesting it
+    numCompiled = 0;
+    std::vector<std::thread> threads;
+    std::vector<CStylesheetCache::CompiledStylesheetPtr> results(8);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        threads.emplace_back([&cache, &compile, &results, i]() {
+            results[i] = cache.Get("engine", "<xsl:stylesheet version=\"1.0\"/>", compile);
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    SYSTEST_ASSERT(numCompiled == 1);
+    for (const auto& result : results)
+    {
+        SYSTEST_ASSERT(result == results[0]);
+    }
+
+    cache.Clear();
+    SYSTEST_ASSERT(cache.GetSize() == 0);
+    SYSTEST_ASSERT(CStylesheetCache::Hash("a") != CStylesheetCache::Hash("b"));
+
+    SYSTEST_RETURN();
+}
+
+bool Test_StylesheetFile()
+{
+    SYSTEST_ENTER();
+
+    struct CTestStylesheet : public CCompiledStylesheet
+    {
+        explicit CTestStylesheet(std::string_view sText) :
+            msText(sText)
+        {}
+        std::string msText;
+    };
+    auto compile = [](std::string_view sStylesheet) -> CStylesheetCache::CompiledStylesheetPtr {
+        if (sStylesheet.find("broken") != std::string_view::npos)
+        {
+            THROW_ERROR(L"Broken style sheet");
+        }
+        return std::make_shared<CTestStylesheet>(sStylesheet);
+    };
+    auto textOf = [](const CStylesheetCache::CompiledStylesheetPtr& compiled) {
+        return static_cast<const CTestStylesheet*>(compiled.get())->msText;
+    };
+
+    std::filesystem::path filePath = std::filesystem::temp_directory_path() / "ot_systemtests_style.xslt";
+    auto writeFile = [&filePath](const char* sText) {
+        std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+        file << sText;
+    };
+    auto cleanup = MakeRAIICleanup([&filePath]() {
+        std::error_code ec;
+        std::filesystem::remove(filePath, ec);
+        });
+    writeFile("version 1");
+
+    CFileVersion version;
+    CFileVersion version2;
+    std::wstring sError;
+    SYSTEST_ASSERT(GetFileVersion(filePath.wstring().c_str(), version, sError));
+    SYSTEST_ASSERT(GetFileVersion(filePath.wstring().c_str(), version2, sError));
+    SYSTEST_ASSERT(version == version2 && version.mSize == 9);
+    SYSTEST_ASSERT(!GetFileVersion(L"nonexisting_file.xslt", version2, sError));
+    SYSTEST_ASSERT(!sError.empty());
+
+    CStylesheetFile stylesheetFile(filePath.wstring().c_str(), "test", compile);
+    auto compiled = stylesheetFile.Get();
+    SYSTEST_ASSERT(textOf(compiled) == "version 1");
+    SYSTEST_ASSERT(stylesheetFile.Get() == compiled);
+
+    // Modified file is recompiled in background, caller keeps getting previous version
+    writeFile("version 2 (longer)");
+    SYSTEST_ASSERT(stylesheetFile.Get() == compiled);
+    stylesheetFile.WaitForReload();
+    SYSTEST_ASSERT(textOf(stylesheetFile.Get()) == "version 2 (longer)");
+    SYSTEST_ASSERT(stylesheetFile.GetReloadCount() == 1);
+    SYSTEST_ASSERT(textOf(compiled) == "version 1");
+
+    // Broken file doesn't replace working version
+    writeFile("broken version 3");
+    stylesheetFile.Get();
+    stylesheetFile.WaitForReload();
+    SYSTEST_ASSERT(textOf(stylesheetFile.Get()) == "version 2 (longer)");
+    SYSTEST_ASSERT(stylesheetFile.GetReloadCount() == 1);
+
+    bool isThrown = false;
+    try
+    {
+        CStylesheetFile missingFile(L"nonexisting_file.xslt", "test", compile);
+    }
+    catch (const CException& /*ex*/)
+    {
+        isThrown = true;
+    }
+    SYSTEST_ASSERT(isThrown);
+
+    SYSTEST_RETURN();
+}
+
+bool Test_Utf8Transcoder()
+{
+    SYSTEST_ENTER();
+
+    const CUtf8Transcoder::EMKernel kernels[] = {
+        CUtf8Transcoder::EMKernel::Scalar,
+        CUtf8Transcoder::EMKernel::SSE2,
+        CUtf8Transcoder::EMKernel::AVX2
+    };
+    SYSTEST_ASSERT(CUtf8Transcoder::IsKernelSupported(CUtf8Transcoder::EMKernel::Scalar));
+    SYSTEST_ASSERT(CUtf8Transcoder::IsKernelSupported(CUtf8Transcoder::GetBestKernel()));
+
+    // Non-ASCII characters at different positions relative to 16/32 byte blocks
+    const std::string sPieces[] = { "a", "\xC3\xA9", "\xE4\xB8\xAD", "\xF0\x9F\x8E\xB5", "0123456789abcdef" };
+    const char32_t codePoints[] = { U'a', 0xE9, 0x4E2D, 0x1F3B5, 0 };
+    std::string sUtf8;
+    std::u32string sExpected32;
+    for (size_t i = 0; i < 300; ++i)
+    {
+        size_t piece = (i * 7 + i / 5) % 5;
+        sUtf8 += sPieces[piece];
+        if (piece == 4)
+        {
+            for (char c : sPieces[piece])
+                sExpected32.push_back(static_cast<char32_t>(c));
+        }
+        else
+        {
+            sExpected32.push_back(codePoints[piece]);
+        }
+    }
+    for (auto kernel : kernels)
+    {
+        for (size_t start = 0; start < 40; ++start)
+        {
+            std::string_view sInput = std::string_view(sUtf8).substr(start);
+            // Skip starts in the middle of a sequence
+            if ((static_cast<unsigned char>(sInput[0]) & 0xC0) == 0x80)
+                continue;
+            std::u32string sReference;
+            std::u16string sReference16;
+            SYSTEST_ASSERT(CUtf8Transcoder::ToUtf32(sInput, sReference, nullptr, CUtf8Transcoder::EMKernel::Scalar));
+            SYSTEST_ASSERT(CUtf8Transcoder::ToUtf16(sInput, sReference16, nullptr, CUtf8Transcoder::EMKernel::Scalar));
+            std::u32string s32;
+            std::u16string s16;
+            std::wstring sWide;
+            SYSTEST_ASSERT(CUtf8Transcoder::Validate(sInput, nullptr, kernel));
+            SYSTEST_ASSERT(CUtf8Transcoder::ToUtf32(sInput, s32, nullptr, kernel));
+            SYSTEST_ASSERT(CUtf8Transcoder::ToUtf16(sInput, s16, nullptr, kernel));
+            SYSTEST_ASSERT(CUtf8Transcoder::ToWide(sInput, sWide, nullptr, kernel));
+            SYSTEST_ASSERT(s32 == sReference);
+            SYSTEST_ASSERT(s16 == sReference16);
+            SYSTEST_ASSERT(sWide.size() == (sizeof(wchar_t) == 2 ? s16.size() : s32.size()));
+        }
+        std::u32string s32;
+        SYSTEST_ASSERT(CUtf8Transcoder::ToUtf32(sUtf8, s32, nullptr, kernel));
+        SYSTEST_ASSERT(s32 == sExpected32);
+        std::u16string s16;
+        SYSTEST_ASSERT(CUtf8Transcoder::ToUtf16("\xF0\x9F\x8E\xB5", s16, nullptr, kernel));
+        SYSTEST_ASSERT(s16 == u"\U0001F3B5");
+    }
+
+    // Invalid sequences are reported with offset of their 1st byte
+    struct CInvalidCase
+    {
+        std::string mUtf8;
+        size_t mOffset;
+    };
+    const std::string sAscii(45, 'x');
+    const CInvalidCase invalidCases[] = {
+        { "\x80", 0 }, // Stray continuation byte
+        { "ab\xC0\x80", 2 }, // Overlong form
+        { "abc\xE0\x80\xAF", 3 }, // Overlong form
+        { "\xED\xA0\x80", 0 }, // Surrogate
+        { "\xF4\x90\x80\x80", 0 }, // Above U+10FFFF
+        { "\xF5\x80\x80\x80", 0 }, // Invalid lead byte
+        { "abc\xE4\xB8", 3 }, // Truncated sequence
+        { sAscii + "\xC3\xA9\xC3" + sAscii, sAscii.size() + 2 }, // Invalid sequence inside SIMD block
+        { sAscii + sAscii + "\xFF", sAscii.size() * 2 } // Invalid byte in tail
+    };
+    for (auto kernel : kernels)
+    {
+        for (const auto& invalidCase : invalidCases)
+        {
+            size_t errorOffset = 12345;
+            std::u16string s16 = u"x";
+            SYSTEST_ASSERT(!CUtf8Transcoder::Validate(invalidCase.mUtf8, &errorOffset, kernel));
+            SYSTEST_ASSERT(errorOffset == invalidCase.mOffset);
+            errorOffset = 12345;
+            SYSTEST_ASSERT(!CUtf8Transcoder::ToUtf16(invalidCase.mUtf8, s16, &errorOffset, kernel));
+            SYSTEST_ASSERT(errorOffset == invalidCase.mOffset);
+            SYSTEST_ASSERT(s16.empty());
+        }
+    }
+
+    SYSTEST_RETURN();
+}
+
+bool Test_CatalogEngine()
+{
+    SYSTEST_ENTER();
+
+    const std::string sHeader =
+        "<html><body><h2>CD Catalog</h2><table border=\"1\">"
+        "<tr bgcolor=\"#9acd32\"><th>Title</th><th>Artist</th><th>Country</th>"
+        "<th>Company</th><th>Price</th><th>Year</th></tr>";
+    const std::string sFooter = "</table></body></html>";
+
+    // Rows are sorted by ARTIST (stable), missing fields produce empty cells,
+    // only 1st occurrence of a field is used, text is escaped.
+    std::string sHtml;
+    CCatalogEngine::Transform(
+        "\xEF\xBB\xBF<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n"
+        "<!DOCTYPE CATALOG [<!ELEMENT CATALOG (CD*)>]>\n"
+        "<!-- comment <CD> -->\n"
+        "<CATALOG a='1'>\n"
+        "  <CD><TITLE>T1</TITLE><ARTIST>Bob</ARTIST><COUNTRY>USA</COUNTRY>"
+        "<COMPANY>C1</COMPANY><PRICE>10.90</PRICE><YEAR>1985</YEAR></CD>\n"
+        "  <CD><TITLE>T2 &amp; &lt;b&gt; &#65;&#x42;</TITLE><ARTIST>Alice</ARTIST><EXTRA>x</EXTRA></CD>\n"
+        "  <CD><TITLE><![CDATA[<T3>]]></TITLE><ARTIST>Bob</ARTIST><ARTIST>Zed</ARTIST>"
+        "<YEAR>19<b>90</b></YEAR></CD>\n"
+        "  <CD/>\n"
+        "  <DVD><TITLE>Ignored</TITLE></DVD>\n"
+        "</CATALOG>\n",
+        sHtml);
+    SYSTEST_ASSERT(sHtml == sHeader +
+        "<tr><td></td><td></td><td></td><td></td><td></td><td></td></tr>"
+        "<tr><td>T2 &amp; &lt;b&gt; AB</td><td>Alice</td><td></td><td></td><td></td><td></td></tr>"
+        "<tr><td>T1</td><td>Bob</td><td>USA</td><td>C1</td><td>10.90</td><td>1985</td></tr>"
+        "<tr><td>&lt;T3&gt;</td><td>Bob</td><td></td><td></td><td></td><td>1990</td></tr>" +
+        sFooter);
+
+    // ARTIST is compared case-insensitively (like by MSXML), keys that differ only in
+    // case keep document order
+    std::string sMixedCaseHtml;
+    CCatalogEngine::Transform(
+        "<CATALOG><CD><TITLE>T1</TITLE><ARTIST>bob</ARTIST></CD>"
+        "<CD><TITLE>T2</TITLE><ARTIST>Alice</ARTIST></CD>"
+        "<CD><TITLE>T3</TITLE><ARTIST>Zed</ARTIST></CD>"
+        "<CD><TITLE>T4</TITLE><ARTIST>alice</ARTIST></CD>"
+        "<CD><TITLE>T5</TITLE><ARTIST>Bob</ARTIST></CD></CATALOG>",
+        sMixedCaseHtml);
+    SYSTEST_ASSERT(sMixedCaseHtml == sHeader +
+        "<tr><td>T2</td><td>Alice</td><td></td><td></td><td></td><td></td></tr>"
+        "<tr><td>T4</td><td>alice</td><td></td><td></td><td></td><td></td></tr>"
+        "<tr><td>T1</td><td>bob</td><td></td><td></td><td></td><td></td></tr>"
+        "<tr><td>T5</td><td>Bob</td><td></td><td></td><td></td><td></td></tr>"
+        "<tr><td>T3</td><td>Zed</td><td></td><td></td><td></td><td></td></tr>" +
+        sFooter);
+    SYSTEST_ASSERT(CompareSortKeys("alice", "Bob") < 0 && CompareSortKeys("ZED", "zed") == 0);
+    SYSTEST_ASSERT(CompareSortKeys("Al", "alice") < 0 && CompareSortKeys("\xC3\x89", "z") > 0);
+
+    // Root element isn't CATALOG - so there are no rows
+    std::string sHtml2;
+    CCatalogEngine::Transform("<CDS><CD><TITLE>T</TITLE></CD></CDS>", sHtml2);
+    SYSTEST_ASSERT(sHtml2 == sHeader + sFooter);
+
+    // Malformed documents
+    const char* malformed[] = {
+        "",
+        "<CATALOG>",
+        "<CATALOG></CD>",
+        "<CATALOG/><CATALOG/>",
+        "text<CATALOG/>",
+        "<CATALOG>&unknown;</CATALOG>",
+        "<CATALOG a=1/>",
+        "<CATALOG><!-- </CATALOG>"
+    };
+    // Malformed XML is an expected failure - it's returned rather than thrown
+    for (auto sXml : malformed)
+    {
+        bool isReported = false;
+        try
+        {
+            std::string sOut;
+            CStatus result = CCatalogEngine::Transform(sXml, sOut);
+            isReported = !result && result.GetError().mErrorDescription[0] != L'\0';
+        }
+        catch (const CException& /*ex*/)
+        {
+        }
+        SYSTEST_ASSERT(isReported);
+    }
+    {
+        std::string sOut;
+        CStatus result = CCatalogEngine::Transform("<CATALOG>\n<CD></DVD></CATALOG>", sOut);
+        SYSTEST_ASSERT(!result && FormatParseError(result.GetError()) ==
+            L"XML parse error at offset 19. End tag doesn't match start tag.");
+    }
+
+    // Rows of large document are rendered in parallel - output is the same
+    std::string sLargeXml = "<CATALOG>";
+    for (size_t i = 0; i < 20000; ++i)
+    {
+        sLargeXml += "<CD><TITLE>&lt;" + std::to_string(i) + "&gt;</TITLE><ARTIST>" +
+            std::to_string(i * 7919 % 1009) + "</ARTIST></CD>";
+    }
+    sLargeXml += "</CATALOG>";
+    CTransformOptions singleThreadOptions;
+    singleThreadOptions.mThreadCount = 1;
+    std::string sSingleThreadHtml;
+    CStringOutputSink singleThreadSink(sSingleThreadHtml);
+    CCatalogEngine::Transform(sLargeXml, singleThreadSink, singleThreadOptions);
+    CTransformOptions parallelOptions;
+    parallelOptions.mThreadCount = 4;
+    std::string sParallelHtml;
+    CStringOutputSink parallelSink(sParallelHtml);
+    CCatalogEngine::Transform(sLargeXml, parallelSink, parallelOptions);
+    SYSTEST_ASSERT(sParallelHtml == sSingleThreadHtml);
+    SYSTEST_ASSERT(sParallelHtml.find("<tr><td>&lt;19999&gt;</td>") != std::string::npos);
+
+    SYSTEST_RETURN();
+}
+
+bool Test_CatalogRecordSorter()
+{
+    SYSTEST_ENTER();
+
+    // Many duplicate keys (to check stability), keys that differ only in case, missing
+    // fields, non-ASCII keys and a record that's bigger than memory budget
+    std::vector<CCatalogRecord> records(20000);
+    unsigned int seed = 12345;
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        CCatalogRecord& record = records[i];
+        record.mFields[static_cast<size_t>(ECatalogField::Title)] = "T" + std::to_string(i);
+        record.mPresentFields |= 1u << static_cast<unsigned int>(ECatalogField::Title);
+        if (seed % 10 != 0)
+        {
+            unsigned int key = (seed >> 8) % 300;
+            record.mFields[static_cast<size_t>(ECatalogField::Artist)] =
+                (key % 7 == 0 ? "\xC3\x84" : (seed % 3 == 0 ? "a" : "A")) + std::to_string(key);
+            record.mPresentFields |= 1u << static_cast<unsigned int>(ECatalogField::Artist);
+        }
+        if (i % 5000 == 1)
+        {
+            record.mFields[static_cast<size_t>(ECatalogField::Company)].assign(200 * 1024, 'c');
+            record.mPresentFields |= 1u << static_cast<unsigned int>(ECatalogField::Company);
+        }
+    }
+    std::vector<CCatalogRecord> expected = records;
+    std::stable_sort(expected.begin(), expected.end(),
+        [](const CCatalogRecord& left, const CCatalogRecord& right) {
+            return CompareSortKeys(left.Get(ECatalogField::Artist), right.Get(ECatalogField::Artist)) < 0;
+        });
+
+    auto isSortedAsExpected = [&expected](CCatalogRecordSorter& sorter) {
+        CCatalogRecord record;
+        size_t count = 0;
+        while (sorter.Next(record))
+        {
+            if (count >= expected.size() || record.mPresentFields != expected[count].mPresentFields)
+                return false;
+            for (size_t i = 0; i < static_cast<size_t>(ECatalogField::Count); ++i)
+            {
+                if (record.mFields[i] != expected[count].mFields[i])
+                    return false;
+            }
+            count++;
+        }
+        return count == expected.size();
+    };
+
+    // Everything fits into memory
+    CCatalogRecordSorter inMemorySorter(ECatalogField::Artist, 64 * 1024 * 1024);
+    for (const auto& record : records)
+    {
+        inMemorySorter.Add(record);
+    }
+    inMemorySorter.Sort();
+    SYSTEST_ASSERT(inMemorySorter.GetRunCount() == 0);
+    SYSTEST_ASSERT(isSortedAsExpected(inMemorySorter));
+
+    // Smallest budget: many runs that are merged in several passes
+    CCatalogRecordSorter externalSorter(ECatalogField::Artist, 0);
+    for (const auto& record : records)
+    {
+        externalSorter.Add(record);
+    }
+    externalSorter.Sort();
+    SYSTEST_ASSERT(externalSorter.GetRunCount() > 1);
+    SYSTEST_ASSERT(isSortedAsExpected(externalSorter));
+
+    // No records
+    CCatalogRecordSorter emptySorter(ECatalogField::Artist, 0);
+    emptySorter.Sort();
+    CCatalogRecord record;
+    SYSTEST_ASSERT(!emptySorter.Next(record));
+
+    // Engine output doesn't depend on memory budget
+    std::string sXml = "<CATALOG>";
+    for (size_t i = 0; i < 5000; ++i)
+    {
+        sXml += "<CD><TITLE>Title " + std::to_string(i) + "</TITLE><ARTIST>Artist " +
+            std::to_string(i * 7919 % 613) + "</ARTIST><PRICE>9.90</PRICE></CD>";
+    }
+    sXml += "</CATALOG>";
+    std::string sHtml;
+    CCatalogEngine::Transform(sXml, sHtml);
+    std::string sExternalHtml;
+    CStringOutputSink htmlSink(sExternalHtml);
+    CTransformOptions options;
+    options.mSortMemoryBudget = 0;
+    CCatalogEngine::Transform(sXml, htmlSink, options);
+    SYSTEST_ASSERT(sExternalHtml == sHtml);
+
+    SYSTEST_RETURN();
+}
+
+bool Test_CatalogRowCache()
+{
+    SYSTEST_ENTER();
+
+    std::filesystem::path filePath = std::filesystem::temp_directory_path() / "ot_systemtests.rowcache";
+    auto cleanup = MakeRAIICleanup([&filePath]() {
+        std::error_code ec;
+        std::filesystem::remove(filePath, ec);
+        });
+    std::error_code ec;
+    std::filesystem::remove(filePath, ec);
+
+    // Artists repeat and aren't in order. The document has an empty CD element, a duplicate
+    // element and an element with nested CD element (it's never found in the cache).
+    auto makeXml = [](int changedIndex, const std::string& sExtraRecords) {
+        std::string sXml = "<?xml version=\"1.0\"?>\n<CATALOG>\n<CD/>\n";
+        for (int i = 0; i < 300; ++i)
+        {
+            sXml += "<CD><TITLE>T" + std::to_string(i) + (i == changedIndex ? " changed" : "") +
+                "</TITLE><ARTIST>A" + std::to_string((i * 37) % 50) + "</ARTIST><PRICE>1 &amp; 2</PRICE></CD>\n";
+        }
+        sXml += "<CD><TITLE>T5</TITLE><ARTIST>A35</ARTIST><PRICE>1 &amp; 2</PRICE></CD>\n";
+        sXml += "<CD><TITLE>Outer<CD>inner</CD></TITLE><ARTIST>A7</ARTIST></CD>\n";
+        return sXml + sExtraRecords + "</CATALOG>";
+    };
+    auto transform = [&filePath](const std::string& sXml, size_t& o_hitCount, size_t& o_missCount) {
+        std::string sHtml;
+        CStringOutputSink htmlSink(sHtml);
+        CCatalogRowCache rowCache(filePath.wstring().c_str());
+        CTransformOptions options;
+        options.mRowCache = &rowCache;
+        CCatalogEngine::Transform(sXml, htmlSink, options);
+        o_hitCount = rowCache.GetHitCount();
+        o_missCount = rowCache.GetMissCount();
+        rowCache.Save();
+        return sHtml;
+    };
+    auto transformFull = [](const std::string& sXml) {
+        std::string sHtml;
+        CCatalogEngine::Transform(sXml, sHtml);
+        return sHtml;
+    };
+    size_t hitCount = 0;
+    size_t missCount = 0;
+
+    // First conversion renders all rows
+    std::string sXml = makeXml(-1, "");
+    SYSTEST_ASSERT(transform(sXml, hitCount, missCount) == transformFull(sXml));
+    SYSTEST_ASSERT(hitCount == 1);
+    SYSTEST_ASSERT(missCount == 301);
+    SYSTEST_ASSERT(std::filesystem::exists(filePath));
+
+    // Only changed element and element with nested CD are rendered again
+    SYSTEST_ASSERT(transform(sXml, hitCount, missCount) == transformFull(sXml));
+    SYSTEST_ASSERT(missCount == 1);
+    sXml = makeXml(10, "");
+    SYSTEST_ASSERT(transform(sXml, hitCount, missCount) == transformFull(sXml));
+    SYSTEST_ASSERT(hitCount == 300);
+    SYSTEST_ASSERT(missCount == 2);
+
+    // New keys between cached ones, equal to cached ones and after all of them
+    sXml = makeXml(10, "<CD><TITLE>N1</TITLE><ARTIST>A15x</ARTIST></CD><CD><TITLE>N2</TITLE><ARTIST>A15</ARTIST></CD>"
+        "<CD><TITLE>N3</TITLE><ARTIST>A15</ARTIST></CD><CD><TITLE>N4</TITLE><ARTIST>Z</ARTIST></CD>"
+        "<CD><TITLE>N5</TITLE><ARTIST>A15y</ARTIST></CD><CD><TITLE>N6</TITLE><ARTIST>A15x</ARTIST></CD>");
+    SYSTEST_ASSERT(transform(sXml, hitCount, missCount) == transformFull(sXml));
+    SYSTEST_ASSERT(missCount == 7);
+    std::string sRemovedXml = makeXml(-1, "");
+    sRemovedXml.erase(sRemovedXml.find("<CD><TITLE>T7<"), sRemovedXml.find("<CD><TITLE>T8<") - sRemovedXml.find("<CD><TITLE>T7<"));
+    SYSTEST_ASSERT(transform(sRemovedXml, hitCount, missCount) == transformFull(sRemovedXml));
+    SYSTEST_ASSERT(missCount == 2);
+    SYSTEST_ASSERT(transform(sRemovedXml, hitCount, missCount) == transformFull(sRemovedXml));
+    SYSTEST_ASSERT(missCount == 1);
+
+    // Corrupt file is ignored
+    std::filesystem::resize_file(filePath, std::filesystem::file_size(filePath) / 2);
+    SYSTEST_ASSERT(transform(sXml, hitCount, missCount) == transformFull(sXml));
+    SYSTEST_ASSERT(hitCount == 1);
+    {
+        std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+        file << "garbage";
+    }
+    SYSTEST_ASSERT(transform(sXml, hitCount, missCount) == transformFull(sXml));
+    SYSTEST_ASSERT(hitCount == 1);
+    SYSTEST_ASSERT(transform(sXml, hitCount, missCount) == transformFull(sXml));
+    SYSTEST_ASSERT(missCount == 1);
+
+    // Parser wrapper saves the file after each conversion
+    CXmlParserWrapper parser(CXmlParserWrapper::EMXSLTFile::CatalogResources);
+    parser.SetRowCacheFile(filePath.wstring().c_str());
+    std::wstring sError;
+    for (int i = 0; i < 2; ++i)
+    {
+        sXml = makeXml(20 + i, "");
+        std::string sHtml;
+        CStringOutputSink htmlSink(sHtml);
+        SYSTEST_ASSERT(parser.Parse(sXml, htmlSink, sError));
+        SYSTEST_ASSERT(sHtml == transformFull(sXml));
+    }
+    SYSTEST_ASSERT(transform(sXml, hitCount, missCount) == transformFull(sXml));
+    SYSTEST_ASSERT(missCount == 1);
+
+    SYSTEST_RETURN();
+}
+
+bool Test_ConversionServer()
+{
+    SYSTEST_ENTER();
+
+    std::filesystem::path dirPath = std::filesystem::temp_directory_path() / "ot_systemtests_server";
+    std::error_code ec;
+    std::filesystem::remove_all(dirPath, ec);
+    std::filesystem::create_directories(dirPath);
+    auto cleanup = MakeRAIICleanup([&dirPath]() {
+        std::error_code ec;
+        std::filesystem::remove_all(dirPath, ec);
+        });
+    std::string sXml = "<CATALOG><CD><TITLE>T1</TITLE><ARTIST>B</ARTIST></CD>"
+        "<CD><TITLE>T2</TITLE><ARTIST>A</ARTIST></CD></CATALOG>";
+    {
+        std::ofstream file(dirPath / "cat.xml", std::ios::binary);
+        file << sXml;
+    }
+    std::string sExpectedHtml;
+    CCatalogEngine::Transform(sXml, sExpectedHtml);
+    std::wstring sSocketPathName = (dirPath / "daemon.sock").wstring();
+
+    CConversionServer server(sSocketPathName, 2);
+    std::wstring sError;
+    SYSTEST_ASSERT(server.Start(sError));
+    std::unique_ptr<CConversionClient> idleClient;
+    // Socket of running daemon isn't replaced
+    CConversionServer otherServer(sSocketPathName, 1);
+    SYSTEST_ASSERT(!otherServer.Start(sError));
+    try
+    {
+        CConversionClient client(sSocketPathName.c_str());
+        CConversionRequest request;
+        CConversionResponse response;
+        request.mInput = sXml;
+        client.Convert(request, response);
+        SYSTEST_ASSERT(response.mExitCode == OTInterviewExercise1ExitCode::SUCCESS);
+        SYSTEST_ASSERT(response.mPayload == sExpectedHtml);
+
+        request.mInputType = CConversionRequest::EMInput::FilePathName;
+        request.mInput = (dirPath / "cat.xml").u8string();
+        client.Convert(request, response);
+        SYSTEST_ASSERT(response.mExitCode == OTInterviewExercise1ExitCode::SUCCESS);
+        SYSTEST_ASSERT(response.mPayload == sExpectedHtml);
+
+        request.mInput = (dirPath / "missing.xml").u8string();
+        client.Convert(request, response);
+        SYSTEST_ASSERT(response.mExitCode == OTInterviewExercise1ExitCode::XML_FILE_NOT_FOUND);
+        SYSTEST_ASSERT(!response.mPayload.empty());
+
+        request.mInputType = CConversionRequest::EMInput::Inline;
+        request.mInput = "<CATALOG><CD>";
+        client.Convert(request, response);
+        SYSTEST_ASSERT(response.mExitCode == OTInterviewExercise1ExitCode::XML_PARSER_ERROR);
+        request.mInput.clear();
+        client.Convert(request, response);
+        SYSTEST_ASSERT(response.mExitCode == OTInterviewExercise1ExitCode::XML_FILE_IS_EMPTY);
+
+        // Connections are served in parallel
+        std::vector<std::thread> clients;
+        std::atomic<int> numSucceeded(0);
+        for (int i = 0; i < 4; ++i)
+        {
+            clients.emplace_back([&]() {
+                try
+                {
+                    CConversionClient otherClient(sSocketPathName.c_str());
+                    CConversionRequest otherRequest;
+                    CConversionResponse otherResponse;
+                    otherRequest.mInput = sXml;
+                    for (int j = 0; j < 50; ++j)
+                    {
+                        otherClient.Convert(otherRequest, otherResponse);
+                        if (otherResponse.mExitCode == OTInterviewExercise1ExitCode::SUCCESS &&
+                            otherResponse.mPayload == sExpectedHtml)
+                        {
+                            numSucceeded++;
+                        }
+                    }
+                }
+                catch (const CException&)
+                {
+                }
+            });
+        }
+        for (auto& thread : clients)
+        {
+            thread.join();
+        }
+        SYSTEST_ASSERT(numSucceeded == 200);
+        SYSTEST_ASSERT(server.GetRequestCount() == 205);
+
+        // Malformed request closes connection
+        {
+            CLocalSocket socket(sSocketPathName.c_str());
+            std::string_view sGarbage("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+            socket.Write(&sGarbage, 1);
+            char header[16];
+            SYSTEST_ASSERT(socket.Read(header, sizeof(header)));
+            SYSTEST_ASSERT(memcmp(header, "OTRS", 4) == 0 && header[4] == 1);
+            std::string sMessage(header[8], '\0');
+            SYSTEST_ASSERT(socket.Read(&sMessage[0], sMessage.size()));
+            // Unread bytes of the request might make it a reset rather than end of stream
+            char byte = 0;
+            bool isClosed = false;
+            try
+            {
+                isClosed = !socket.Read(&byte, 1);
+            }
+            catch (const CException&)
+            {
+                isClosed = true;
+            }
+            SYSTEST_ASSERT(isClosed);
+        }
+
+        // Clients that stay connected don't occupy workers (server has 2 of them)
+        {
+            std::vector<std::unique_ptr<CConversionClient>> connectedClients;
+            for (int i = 0; i < 4; ++i)
+            {
+                connectedClients.push_back(std::make_unique<CConversionClient>(sSocketPathName.c_str()));
+                connectedClients.back()->Convert(request, response);
+                SYSTEST_ASSERT(response.mExitCode == OTInterviewExercise1ExitCode::XML_FILE_IS_EMPTY);
+            }
+            request.mInput = sXml;
+            CConversionClient otherClient(sSocketPathName.c_str());
+            otherClient.Convert(request, response);
+            SYSTEST_ASSERT(response.mExitCode == OTInterviewExercise1ExitCode::SUCCESS);
+            connectedClients.front()->Convert(request, response);
+            SYSTEST_ASSERT(response.mPayload == sExpectedHtml);
+        }
+
+        // Requests that declare huge input and don't send it don't take workers away
+        for (int i = 0; i < 3; ++i)
+        {
+            CLocalSocket socket(sSocketPathName.c_str());
+            char header[20] = { 'O', 'T', 'R', 'Q', 1 };
+            uint64_t inputSize = CConversionServer::MAX_REQUEST_SIZE;
+            for (int j = 0; j < 8; ++j)
+            {
+                header[12 + j] = static_cast<char>(inputSize >> (8 * j));
+            }
+            std::string_view buffers[] = { std::string_view(header, sizeof(header)), std::string_view("<CATALOG>") };
+            socket.Write(buffers, 2);
+        }
+        client.Convert(request, response);
+        SYSTEST_ASSERT(response.mExitCode == OTInterviewExercise1ExitCode::SUCCESS);
+        SYSTEST_ASSERT(response.mPayload == sExpectedHtml);
+#ifndef _WIN32
+        // Only the owner can connect
+        SYSTEST_ASSERT(std::filesystem::status(dirPath / "daemon.sock").permissions() ==
+            (std::filesystem::perms::owner_read | std::filesystem::perms::owner_write));
+#endif
+
+        // Connection that's kept open doesn't prevent Stop()
+        idleClient = std::make_unique<CConversionClient>(sSocketPathName.c_str());
+        idleClient->Convert(request, response);
+    }
+    catch (const CException&)
+    {
+        SYSTEST_ASSERT(false);
+    }
+    server.Stop();
+    SYSTEST_ASSERT(!std::filesystem::exists(dirPath / "daemon.sock"));
+
+    SYSTEST_RETURN();
+}
+
+bool Test_XmlParserPool()
+{
+    SYSTEST_ENTER();
+
+    std::filesystem::path dirPath = std::filesystem::temp_directory_path() / "ot_systemtests_pool";
+    std::error_code ec;
+    std::filesystem::remove_all(dirPath, ec);
+    std::filesystem::create_directories(dirPath);
+    auto cleanup = MakeRAIICleanup([&dirPath]() {
+        std::error_code ec;
+        std::filesystem::remove_all(dirPath, ec);
+        });
+    // Documents of different sizes (so that they're scheduled in different order)
+    std::vector<std::string> xmls;
+    std::vector<std::string> expectedHtmls;
+    for (int i = 0; i < 40; ++i)
+    {
+        std::string sXml = "<CATALOG>";
+        for (int j = 0; j <= (i * 37) % 200; ++j)
+        {
+            sXml += "<CD><TITLE>T" + std::to_string(j) + "</TITLE><ARTIST>A" + std::to_string(i) +
+                "</ARTIST><YEAR>" + std::to_string(1990 + j % 30) + "</YEAR></CD>";
+        }
+        sXml += "</CATALOG>";
+        std::string sExpectedHtml;
+        CCatalogEngine::Transform(sXml, sExpectedHtml);
+        xmls.push_back(sXml);
+        expectedHtmls.push_back(sExpectedHtml);
+    }
+    {
+        std::ofstream file(dirPath / "cat.xml", std::ios::binary);
+        file << xmls[5];
+    }
+
+    CXmlParserPool pool(3, CXmlParserWrapper::EMXSLTFile::CatalogResources);
+    SYSTEST_ASSERT(pool.GetThreadCount() == 3);
+
+    CXmlParserPool::CConversion conversion = pool.SubmitFile((dirPath / "cat.xml").wstring()).get();
+    SYSTEST_ASSERT(conversion.mExitCode == OTInterviewExercise1ExitCode::SUCCESS);
+    SYSTEST_ASSERT(conversion.mHtml == expectedHtmls[5]);
+    conversion = pool.SubmitFile((dirPath / "missing.xml").wstring()).get();
+    SYSTEST_ASSERT(conversion.mExitCode == OTInterviewExercise1ExitCode::XML_FILE_NOT_FOUND);
+    SYSTEST_ASSERT(!conversion.mError.empty());
+    conversion = pool.Submit("<CATALOG><CD>").get();
+    SYSTEST_ASSERT(conversion.mExitCode == OTInterviewExercise1ExitCode::XML_PARSER_ERROR);
+    SYSTEST_ASSERT(conversion.mHtml.empty());
+    conversion = pool.Submit(std::string()).get();
+    SYSTEST_ASSERT(conversion.mExitCode == OTInterviewExercise1ExitCode::XML_FILE_IS_EMPTY);
+
+    // Documents are submitted by several threads at once
+    std::vector<std::thread> submitters;
+    std::atomic<int> numSucceeded(0);
+    for (int t = 0; t < 4; ++t)
+    {
+        submitters.emplace_back([&pool, &xmls, &expectedHtmls, &numSucceeded, t]() {
+            std::vector<std::future<CXmlParserPool::CConversion>> futures;
+            for (size_t i = t; i < xmls.size(); i += 4)
+            {
+                futures.push_back(pool.Submit(xmls[i]));
+            }
+            for (size_t i = t, j = 0; i < xmls.size(); i += 4, ++j)
+            {
+                CXmlParserPool::CConversion result = futures[j].get();
+                if (result.mExitCode == OTInterviewExercise1ExitCode::SUCCESS && result.mHtml == expectedHtmls[i])
+                {
+                    numSucceeded++;
+                }
+            }
+            });
+    }
+    for (auto& submitter : submitters)
+    {
+        submitter.join();
+    }
+    SYSTEST_ASSERT(numSucceeded == static_cast<int>(xmls.size()));
+
+#ifndef _WIN32
+    // Workers are blocked by jobs that read FIFOs (until test writes them) - so jobs that
+    // are submitted meanwhile are queued before they're scheduled
+    auto releaseFifo = [](int fd, const std::string& sXml) {
+        bool isWritten = ::write(fd, sXml.data(), sXml.size()) == static_cast<ssize_t>(sXml.size());
+        ::close(fd);
+        return isWritten;
+    };
+    {
+        // The largest job is started first
+        std::filesystem::path fifoPath = dirPath / "order.fifo";
+        SYSTEST_ASSERT(::mkfifo(fifoPath.c_str(), 0600) == 0);
+        CXmlParserPool orderPool(1, CXmlParserWrapper::EMXSLTFile::CatalogResources);
+        std::future<CXmlParserPool::CConversion> blocked = orderPool.SubmitFile(fifoPath.wstring());
+        // open() returns when worker opened FIFO for reading
+        int fd = ::open(fifoPath.c_str(), O_WRONLY | O_CLOEXEC);
+        SYSTEST_ASSERT(fd != -1);
+        std::vector<size_t> indexes = { 3, 30, 10, 1, 25, 17, 8 };
+        std::vector<std::future<CXmlParserPool::CConversion>> orderFutures;
+        for (size_t index : indexes)
+        {
+            orderFutures.push_back(orderPool.Submit(xmls[index]));
+        }
+        SYSTEST_ASSERT(releaseFifo(fd, xmls[5]));
+        CXmlParserPool::CConversion blockedConversion = blocked.get();
+        SYSTEST_ASSERT(blockedConversion.mExitCode == OTInterviewExercise1ExitCode::SUCCESS);
+        SYSTEST_ASSERT(blockedConversion.mHtml == expectedHtmls[5] && blockedConversion.mStartIndex == 0);
+        std::vector<std::pair<size_t, uint64_t>> sizeStarts;
+        for (size_t i = 0; i < indexes.size(); ++i)
+        {
+            CXmlParserPool::CConversion orderConversion = orderFutures[i].get();
+            SYSTEST_ASSERT(orderConversion.mHtml == expectedHtmls[indexes[i]]);
+            sizeStarts.emplace_back(xmls[indexes[i]].size(), orderConversion.mStartIndex);
+        }
+        std::sort(sizeStarts.begin(), sizeStarts.end());
+        for (size_t i = 1; i < sizeStarts.size(); ++i)
+        {
+            SYSTEST_ASSERT(sizeStarts[i - 1].first < sizeStarts[i].first);
+            SYSTEST_ASSERT(sizeStarts[i - 1].second > sizeStarts[i].second);
+        }
+    }
+    {
+        // Jobs queued for a blocked worker are stolen by the other one
+        std::filesystem::path fifoPaths[] = { dirPath / "steal1.fifo", dirPath / "steal2.fifo" };
+        CXmlParserPool stealPool(2, CXmlParserWrapper::EMXSLTFile::CatalogResources);
+        int fds[2] = { -1, -1 };
+        std::future<CXmlParserPool::CConversion> blocked[2];
+        for (int i = 0; i < 2; ++i)
+        {
+            SYSTEST_ASSERT(::mkfifo(fifoPaths[i].c_str(), 0600) == 0);
+            blocked[i] = stealPool.SubmitFile(fifoPaths[i].wstring());
+            fds[i] = ::open(fifoPaths[i].c_str(), O_WRONLY | O_CLOEXEC);
+            SYSTEST_ASSERT(fds[i] != -1);
+        }
+        // Jobs are spread over queues of both workers
+        std::vector<std::future<CXmlParserPool::CConversion>> stealFutures;
+        for (size_t i = 0; i < 6; ++i)
+        {
+            stealFutures.push_back(stealPool.Submit(xmls[i]));
+        }
+        SYSTEST_ASSERT(releaseFifo(fds[0], xmls[5]));
+        for (size_t i = 0; i < stealFutures.size(); ++i)
+        {
+            SYSTEST_ASSERT(stealFutures[i].wait_for(std::chrono::seconds(30)) == std::future_status::ready);
+        }
+        SYSTEST_ASSERT(stealPool.GetStolenCount() >= 3);
+        SYSTEST_ASSERT(releaseFifo(fds[1], xmls[5]));
+        // Sizes of documents grow with index, and queues get every other one - the largest
+        // job of both queues is taken first, not the largest of worker's own queue
+        uint64_t previousStartIndex = UINT64_MAX;
+        for (size_t i = 0; i < stealFutures.size(); ++i)
+        {
+            CXmlParserPool::CConversion stealConversion = stealFutures[i].get();
+            SYSTEST_ASSERT(stealConversion.mHtml == expectedHtmls[i]);
+            SYSTEST_ASSERT(i == 0 || stealConversion.mStartIndex < previousStartIndex);
+            previousStartIndex = stealConversion.mStartIndex;
+        }
+        SYSTEST_ASSERT(blocked[0].get().mHtml == expectedHtmls[5] && blocked[1].get().mHtml == expectedHtmls[5]);
+    }
+#endif
+
+    // Jobs that are still queued are converted before pool is destroyed
+    std::vector<std::future<CXmlParserPool::CConversion>> futures;
+    {
+        CXmlParserPool shortLivedPool(2, CXmlParserWrapper::EMXSLTFile::CatalogResources);
+        for (const std::string& sXml : xmls)
+        {
+            futures.push_back(shortLivedPool.Submit(sXml));
+        }
+    }
+    for (size_t i = 0; i < futures.size(); ++i)
+    {
+        SYSTEST_ASSERT(futures[i].wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+        SYSTEST_ASSERT(futures[i].get().mHtml == expectedHtmls[i]);
+    }
+
+    SYSTEST_RETURN();
+}
+
+bool Test_ConversionMetrics()
+{
+    SYSTEST_ENTER();
+
+    std::string sXml = "<CATALOG><CD><TITLE>B</TITLE><ARTIST>Y</ARTIST></CD>"
+        "<CD><TITLE>A</TITLE><ARTIST>X</ARTIST></CD></CATALOG>";
+    CXmlParserWrapper parser(CXmlParserWrapper::EMXSLTFile::CatalogResources, nullptr,
+        CXmlParserWrapper::EMEngine::Native);
+    // Metrics aren't collected by default
+    SYSTEST_ASSERT(parser.GetMetrics() == nullptr);
+    std::string sHtml;
+    CStringOutputSink htmlSink(sHtml);
+    std::wstring sError;
+    SYSTEST_ASSERT(parser.Parse(sXml, htmlSink, sError));
+
+    parser.EnableMetrics(true);
+    CConversionMetrics* metrics = parser.GetMetrics();
+    SYSTEST_ASSERT(metrics != nullptr);
+    if (metrics == nullptr)
+    {
+        SYSTEST_RETURN();
+    }
+    SYSTEST_ASSERT(metrics->GetConversionCount() == 0);
+    std::string sHtml2;
+    CStringOutputSink htmlSink2(sHtml2);
+    SYSTEST_ASSERT(parser.Parse(sXml, htmlSink2, sError));
+    SYSTEST_ASSERT(sHtml2 == sHtml);
+    SYSTEST_ASSERT(metrics->GetConversionCount() == 1);
+    SYSTEST_ASSERT(metrics->GetFailureCount() == 0);
+    auto decode = metrics->GetPhase(CConversionMetrics::EMPhase::Decode);
+    SYSTEST_ASSERT(decode.mCount == 1 && decode.mBytes == sXml.size());
+    auto load = metrics->GetPhase(CConversionMetrics::EMPhase::Load);
+    SYSTEST_ASSERT(load.mCount == 1 && load.mBytes == sXml.size());
+    auto transform = metrics->GetPhase(CConversionMetrics::EMPhase::Transform);
+    SYSTEST_ASSERT(transform.mCount == 1);
+    // Every byte of HTML passed through Output phase
+    auto output = metrics->GetPhase(CConversionMetrics::EMPhase::Output);
+    SYSTEST_ASSERT(output.mCount >= 1 && output.mBytes == sHtml2.size());
+    SYSTEST_ASSERT(metrics->GetPhase(CConversionMetrics::EMPhase::Read).mCount == 0);
+
+    // Failed conversion is counted separately
+    SYSTEST_ASSERT(!parser.Parse(std::string_view("<CATALOG><CD>"), htmlSink2, sError));
+    SYSTEST_ASSERT(metrics->GetConversionCount() == 1);
+    SYSTEST_ASSERT(metrics->GetFailureCount() == 1);
+
+    // Read phase is added by ConvertXmlFile()
+    std::filesystem::path dirPath = std::filesystem::temp_directory_path() / "OTConversionMetricsTest";
+    std::filesystem::remove_all(dirPath);
+    std::filesystem::create_directories(dirPath);
+    {
+        std::ofstream file(dirPath / "catalog.xml", std::ios::binary);
+        file << sXml;
+    }
+    std::string sHtml3;
+    CStringOutputSink htmlSink3(sHtml3);
+    uint64_t xmlSize = 0;
+    SYSTEST_ASSERT(ConvertXmlFile(parser, (dirPath / "catalog.xml").wstring().c_str(), htmlSink3,
+        xmlSize, sError) == OTInterviewExercise1ExitCode::SUCCESS);
+    auto read = metrics->GetPhase(CConversionMetrics::EMPhase::Read);
+    SYSTEST_ASSERT(read.mCount == 1 && read.mBytes == sXml.size());
+    SYSTEST_ASSERT(metrics->GetConversionCount() == 2);
+
+    std::string sJson = metrics->ToJson();
+    SYSTEST_ASSERT(sJson.find("\"conversions\":2,\"failures\":1") != std::string::npos);
+    for (const char* sPhase : { "read", "decode", "load", "transform", "output" })
+    {
+        SYSTEST_ASSERT(sJson.find(std::string("\"") + sPhase + "\":{\"count\":") != std::string::npos);
+    }
+
+    // Metrics of workers are merged
+    CConversionMetrics total;
+    total.Merge(*metrics);
+    total.Merge(*metrics);
+    SYSTEST_ASSERT(total.GetConversionCount() == 4);
+    SYSTEST_ASSERT(total.GetPhase(CConversionMetrics::EMPhase::Read).mBytes == 2 * sXml.size());
+    total.Reset();
+    SYSTEST_ASSERT(total.GetConversionCount() == 0 && total.GetTotalNanoseconds() == 0);
+
+    parser.EnableMetrics(false);
+    SYSTEST_ASSERT(parser.GetMetrics() == nullptr);
+    SYSTEST_ASSERT(parser.Parse(sXml, htmlSink3, sError));
+
+    std::filesystem::remove_all(dirPath);
+
+    SYSTEST_RETURN();
+}
+
+bool Test_Logger()
+{
+    SYSTEST_ENTER();
+
+    std::filesystem::path dirPath = std::filesystem::temp_directory_path() / "OTLoggerTest";
+    std::filesystem::remove_all(dirPath);
+    std::filesystem::create_directories(dirPath);
+    auto readFile = [](const std::filesystem::path& filePath) {
+        std::ifstream file(filePath, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    };
+    std::filesystem::path logPath = dirPath / "log.txt";
+    {
+        CLogger logger(CLogger::LogLevel::Warning);
+        std::wstring sError;
+        SYSTEST_ASSERT(logger.SetLogFile(logPath.wstring().c_str(), 1024 * 1024, 3, sError));
+        SYSTEST_ASSERT(sError.empty());
+        logger.Log(CLogger::LogLevel::Error, "Func1", 12, L"Caf\u00e9 error");
+        logger.Log(CLogger::LogLevel::Info, "Func2", 13, L"filtered out");
+        SYSTEST_ASSERT(logger.IsEnabled(CLogger::LogLevel::Warning) && !logger.IsEnabled(CLogger::LogLevel::Info));
+        logger.SetLogLevel(CLogger::LogLevel::Info);
+        SYSTEST_ASSERT(logger.GetLogLevel() == CLogger::LogLevel::Info);
+        SYSTEST_ASSERT(logger.IsEnabled(CLogger::LogLevel::Info) && !logger.IsEnabled(CLogger::LogLevel::All));
+        logger.Log(CLogger::LogLevel::Info, "Func3", 14, L"info");
+        logger.Flush();
+        SYSTEST_ASSERT(readFile(logPath) ==
+            "Error. Func: Func1, Lineno: 12  Msg: Caf\xc3\xa9 error\n"
+            "Info. Func: Func3, Lineno: 14  Msg: info\n");
+
+        // Long message is truncated to one record
+        logger.Log(CLogger::LogLevel::Error, "Func4", 15, std::wstring(10000, L'x'));
+        logger.Flush();
+        std::string sLog = readFile(logPath);
+        SYSTEST_ASSERT(sLog.size() < 3 * CLogRecord::MAX_SIZE && sLog.back() == '\n');
+
+        // Logging threads never wait: messages that don't fit into the queue are dropped
+        // and counted
+        const unsigned int threadCount = 4;
+        const unsigned int messageCount = 20000;
+        std::vector<std::thread> threads;
+        for (unsigned int i = 0; i < threadCount; ++i)
+        {
+            threads.emplace_back([&logger]() {
+                for (unsigned int j = 0; j < messageCount; ++j)
+                    logger.Log(CLogger::LogLevel::Error, __FUNCTION__, j, L"Message");
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        logger.Flush();
+        sLog = readFile(logPath);
+        // Every message is either written or counted (writer reports drops in the log)
+        size_t lineCount = std::count(sLog.begin(), sLog.end(), '\n');
+        size_t reportCount = 0;
+        for (size_t pos = sLog.find("log messages were dropped"); pos != std::string::npos;
+            pos = sLog.find("log messages were dropped", pos + 1))
+        {
+            reportCount++;
+        }
+        SYSTEST_ASSERT((logger.GetDroppedCount() == 0) == (reportCount == 0));
+        SYSTEST_ASSERT(lineCount - 3 - reportCount + logger.GetDroppedCount() == threadCount * messageCount);
+    }
+
+    // Files are rotated: at most 3 files are kept
+    {
+        CLogger logger(CLogger::LogLevel::Error);
+        std::wstring sError;
+        SYSTEST_ASSERT(logger.SetLogFile(logPath.wstring().c_str(), 4096, 3, sError));
+        for (unsigned int i = 0; i < 200; ++i)
+        {
+            logger.Log(CLogger::LogLevel::Error, "Rotation", i, std::wstring(100, L'r'));
+            // Every message is written in its own batch
+            logger.Flush();
+        }
+        SYSTEST_ASSERT(std::filesystem::file_size(logPath) <= 4096);
+        SYSTEST_ASSERT(std::filesystem::exists(dirPath / "log.txt.1"));
+        SYSTEST_ASSERT(std::filesystem::exists(dirPath / "log.txt.2"));
+        SYSTEST_ASSERT(!std::filesystem::exists(dirPath / "log.txt.3"));
+        SYSTEST_ASSERT(readFile(logPath).find("Lineno: 199 ") != std::string::npos);
+
+        SYSTEST_ASSERT(!logger.SetLogFile((dirPath / "no_such_dir" / "log.txt").wstring().c_str(), 4096, 3, sError));
+        SYSTEST_ASSERT(!sError.empty());
+    }
+
+    std::filesystem::remove_all(dirPath);
+
+    SYSTEST_RETURN();
+}
+
+bool Test_Trace()
+{
+    SYSTEST_ENTER();
+
+    CTracer& tracer = CTracer::Instance();
+    tracer.Clear();
+    {
+        // Disabled tracer doesn't record anything
+        CTraceSpan span("disabled");
+    }
+    SYSTEST_ASSERT(tracer.ToJson().find("disabled") == std::string::npos);
+
+    // Rows of a large document are rendered by worker threads - their spans are
+    // recorded into their own buffers
+    std::string sXml = "<CATALOG>";
+    for (unsigned int i = 0; i < 5000; ++i)
+    {
+        sXml += "<CD><TITLE>T" + std::to_string(i) + "</TITLE><ARTIST>A" + std::to_string(i % 97) +
+            "</ARTIST></CD>";
+    }
+    sXml += "</CATALOG>";
+    tracer.Enable(true);
+    {
+        CTraceSpan span("test", "test\"category");
+        span.SetDetail(L"caf\u00e9\n");
+        std::string sHtml;
+        CStringOutputSink htmlSink(sHtml);
+        CTransformOptions options;
+        options.mThreadCount = 3;
+        CCatalogEngine::Transform(sXml, htmlSink, options);
+    }
+    tracer.Enable(false);
+    {
+        CTraceSpan span("disabled");
+    }
+    std::string sJson = tracer.ToJson();
+    for (const char* sName : { "\"decode\"", "\"load\"", "\"sort\"", "\"transform\"", "\"render\"",
+        "\"test\"", "\"thread_name\"" })
+    {
+        SYSTEST_ASSERT(sJson.find(std::string("{\"name\":") + sName) != std::string::npos);
+    }
+    SYSTEST_ASSERT(sJson.find("\"disabled\"") == std::string::npos);
+    SYSTEST_ASSERT(sJson.find("\"cat\":\"test\\\"category\"") != std::string::npos);
+    SYSTEST_ASSERT(sJson.find("\"args\":{\"detail\":\"caf\xc3\xa9\\u000a\"}") != std::string::npos);
+    SYSTEST_ASSERT(sJson.find("\"ph\":\"X\"") != std::string::npos);
+    // Render spans were recorded by other threads than the one that transformed
+    std::set<std::string> threadIds;
+    for (size_t pos = sJson.find("{\"name\":\"render\""); pos != std::string::npos;
+        pos = sJson.find("{\"name\":\"render\"", pos + 1))
+    {
+        size_t tidPos = sJson.find("\"tid\":", pos);
+        threadIds.insert(sJson.substr(tidPos, sJson.find(',', tidPos) - tidPos));
+    }
+    size_t testPos = sJson.find("{\"name\":\"test\"");
+    size_t testTidPos = sJson.find("\"tid\":", testPos);
+    SYSTEST_ASSERT(!threadIds.empty() &&
+        threadIds.count(sJson.substr(testTidPos, sJson.find(',', testTidPos) - testTidPos)) == 0);
+    SYSTEST_ASSERT(tracer.GetDroppedCount() == 0);
+
+    std::filesystem::path filePath = std::filesystem::temp_directory_path() / "OTTraceTest.json";
+    std::wstring sError;
+    SYSTEST_ASSERT(tracer.WriteJson(filePath.wstring().c_str(), sError));
+    SYSTEST_ASSERT(std::filesystem::file_size(filePath) == sJson.size());
+    std::filesystem::remove(filePath);
+
+    tracer.Clear();
+    SYSTEST_ASSERT(tracer.ToJson().find("\"render\"") == std::string::npos);
+
+    SYSTEST_RETURN();
+}
+
+// Passes string to the parser in chunks of fixed size
+class CStringChunkInput : public CXmlInputSource
+{
+public:
+    CStringChunkInput(std::string_view sText, size_t chunkSize) :
+        msText(sText),
+        mChunkSize(chunkSize)
+    {}
+    std::string_view NextChunk() override
+    {
+        std::string_view sChunk = msText.substr(0, mChunkSize);
+        msText.remove_prefix(sChunk.size());
+        return sChunk;
+    }
+private:
+    std::string_view msText;
+    size_t mChunkSize;
+};
+
+bool Test_PipelinedInput()
+{
+    SYSTEST_ENTER();
+
+    // Sequences split between chunks are validated when they're completed
+    const std::string sUtf8 = "a\xC3\xA9" "b\xE2\x82\xAC" "c\xF0\x9F\x8E\xB5";
+    for (size_t chunkSize = 1; chunkSize <= sUtf8.size(); ++chunkSize)
+    {
+        CUtf8StreamValidator validator;
+        bool isValid = true;
+        for (size_t pos = 0; pos < sUtf8.size(); pos += chunkSize)
+            isValid = isValid && validator.Validate(std::string_view(sUtf8).substr(pos, chunkSize));
+        SYSTEST_ASSERT(isValid && validator.Finish());
+    }
+    CUtf8StreamValidator invalidValidator;
+    uint64_t errorOffset = 0;
+    SYSTEST_ASSERT(invalidValidator.Validate("ab\xC3"));
+    SYSTEST_ASSERT(!invalidValidator.Validate("(", &errorOffset) && errorOffset == 2);
+    CUtf8StreamValidator truncatedValidator;
+    SYSTEST_ASSERT(truncatedValidator.Validate("abc\xE2\x82"));
+    SYSTEST_ASSERT(!truncatedValidator.Finish(&errorOffset) && errorOffset == 3);
+
+    // Document is larger than parser's lookahead - so tokens, references, CDATA sections
+    // and UTF8 sequences are split between chunks
+    std::string sXml = "\xEF\xBB\xBF<?xml version=\"1.0\"?>\n<!DOCTYPE CATALOG [<!ENTITY x \">\">]>\n<CATALOG>";
+    for (size_t i = 0; i < 2000; ++i)
+    {
+        sXml += "<CD id=\"a>" + std::to_string(i) + "\"><TITLE>T&amp;" + std::to_string(i) +
+            "\xE2\x82\xAC</TITLE><!-- <CD> --><ARTIST><![CDATA[<" + std::to_string(i * 7919 % 1009) +
+            ">]]>\r\n</ARTIST><YEAR>&#x31;9" + std::to_string(i % 100) + "</YEAR></CD>\n";
+    }
+    sXml += "</CATALOG>\n";
+    SYSTEST_ASSERT(sXml.size() > 2 * CXmlPullParser::MIN_LOOKAHEAD);
+    std::string sExpectedHtml;
+    CCatalogEngine::Transform(sXml, sExpectedHtml);
+    for (size_t chunkSize : { 1, 7, 4096, 1024 * 1024 })
+    {
+        CStringChunkInput input(sXml, chunkSize);
+        std::string sHtml;
+        CStringOutputSink htmlSink(sHtml);
+        CCatalogEngine::Transform(input, htmlSink);
+        SYSTEST_ASSERT(sHtml == sExpectedHtml);
+    }
+
+    // Errors are reported at the same document offsets as for whole document
+    const std::string sMalformed[] = {
+        sXml.substr(0, sXml.size() - 4),
+        sXml.substr(0, 100000) + "</DVD>" + sXml.substr(100000),
+        sXml.substr(0, 100000) + "\xC3(" + sXml.substr(100000)
+    };
+    // Malformed XML is returned, invalid UTF8 is thrown
+    auto getError = [](auto transform) {
+        std::wstring sError;
+        try
+        {
+            CStatus result = transform();
+            if (!result)
+                sError = FormatParseError(result.GetError());
+        }
+        catch (const CException& ex)
+        {
+            sError = ex.mErrorDescription;
+        }
+        return sError;
+    };
+    for (const std::string& sMalformedXml : sMalformed)
+    {
+        std::wstring sExpectedError = getError([&sMalformedXml]() {
+            std::string sHtml;
+            return CCatalogEngine::Transform(sMalformedXml, sHtml);
+        });
+        std::wstring sError = getError([&sMalformedXml]() {
+            CStringChunkInput input(sMalformedXml, 4096);
+            std::string sHtml;
+            CStringOutputSink htmlSink(sHtml);
+            return CCatalogEngine::Transform(input, htmlSink);
+        });
+        SYSTEST_ASSERT(!sExpectedError.empty() && sError == sExpectedError);
+    }
+
+    std::filesystem::path dirPath = std::filesystem::temp_directory_path() / "OTPipelinedInputTest";
+    std::filesystem::remove_all(dirPath);
+    std::filesystem::create_directories(dirPath);
+    {
+        std::ofstream file(dirPath / "catalog.xml", std::ios::binary);
+        file << sXml;
+        std::ofstream emptyFile(dirPath / "empty.xml", std::ios::binary);
+    }
+
+    // Chunks of file are read in order by few buffers
+    CChunkedFileReader reader((dirPath / "catalog.xml").wstring().c_str(), 4096, 3);
+    std::wstring sErrorMsg;
+    SYSTEST_ASSERT(reader.Exists(sErrorMsg));
+    std::string sContents;
+    std::string_view sChunk;
+    size_t chunkCount = 0;
+    while (reader.NextChunk(sChunk, sErrorMsg) && !sChunk.empty())
+    {
+        SYSTEST_ASSERT(sChunk.size() <= 4096);
+        sContents.append(sChunk);
+        chunkCount++;
+    }
+    SYSTEST_ASSERT(sContents == sXml);
+    SYSTEST_ASSERT(chunkCount == (sXml.size() + 4095) / 4096);
+    SYSTEST_ASSERT(reader.NextChunk(sChunk, sErrorMsg) && sChunk.empty());
+    CChunkedFileReader missingReader((dirPath / "missing.xml").wstring().c_str());
+    SYSTEST_ASSERT(!missingReader.Exists(sErrorMsg) && !sErrorMsg.empty());
+    SYSTEST_ASSERT(!missingReader.NextChunk(sChunk, sErrorMsg));
+
+    // Pipelined conversion of file produces the same HTML
+    CXmlParserWrapper parser(CXmlParserWrapper::EMXSLTFile::CatalogResources);
+    parser.EnableMetrics(true);
+    std::string sHtml;
+    CStringOutputSink htmlSink(sHtml);
+    uint64_t xmlSize = 0;
+    SYSTEST_ASSERT(ConvertXmlFile(parser, (dirPath / "catalog.xml").wstring().c_str(), htmlSink,
+        xmlSize, sErrorMsg, EMXmlFileInput::Pipelined) == OTInterviewExercise1ExitCode::SUCCESS);
+    SYSTEST_ASSERT(sHtml == sExpectedHtml);
+    SYSTEST_ASSERT(xmlSize == sXml.size());
+    if (parser.GetMetrics() != nullptr)
+    {
+        SYSTEST_ASSERT(parser.GetMetrics()->GetPhase(CConversionMetrics::EMPhase::Read).mBytes == sXml.size());
+        SYSTEST_ASSERT(parser.GetMetrics()->GetPhase(CConversionMetrics::EMPhase::Decode).mBytes == sXml.size());
+    }
+    std::string sHtml2;
+    CStringOutputSink htmlSink2(sHtml2);
+    SYSTEST_ASSERT(ConvertXmlFile(parser, (dirPath / "empty.xml").wstring().c_str(), htmlSink2,
+        xmlSize, sErrorMsg, EMXmlFileInput::Pipelined) == OTInterviewExercise1ExitCode::XML_FILE_IS_EMPTY);
+    SYSTEST_ASSERT(ConvertXmlFile(parser, (dirPath / "missing.xml").wstring().c_str(), htmlSink2,
+        xmlSize, sErrorMsg, EMXmlFileInput::Pipelined) == OTInterviewExercise1ExitCode::XML_FILE_NOT_FOUND);
+
+    // Incremental conversion reads whole file first - output is the same
+    parser.SetRowCacheFile((dirPath / "catalog.rowcache").wstring().c_str());
+    std::string sHtml3;
+    CStringOutputSink htmlSink3(sHtml3);
+    SYSTEST_ASSERT(ConvertXmlFile(parser, (dirPath / "catalog.xml").wstring().c_str(), htmlSink3,
+        xmlSize, sErrorMsg, EMXmlFileInput::Pipelined) == OTInterviewExercise1ExitCode::SUCCESS);
+    SYSTEST_ASSERT(sHtml3 == sExpectedHtml);
+    parser.SetRowCacheFile(nullptr);
+
+    std::filesystem::remove_all(dirPath);
+
+    SYSTEST_RETURN();
+}
+
+// Generates document on the fly: it consists of parts, each is a text repeated count
+// times (so documents larger than memory are passed to the parser)
+class CGeneratedInput : public CXmlInputSource
+{
+public:
+    CGeneratedInput() :
+        mPart(0),
+        mSize(0)
+    {}
+    void Add(std::string sText, uint64_t count = 1)
+    {
+        mSize += sText.size() * count;
+        mParts.push_back(std::make_pair(std::move(sText), count));
+    }
+    uint64_t GetSize() const noexcept
+    {
+        return mSize;
+    }
+    std::string_view NextChunk() override
+    {
+        while (mPart < mParts.size() && mParts[mPart].second == 0)
+            mPart++;
+        if (mPart == mParts.size())
+            return std::string_view();
+        mParts[mPart].second--;
+        return mParts[mPart].first;
+    }
+private:
+    std::vector<std::pair<std::string, uint64_t>> mParts;
+    size_t mPart;
+    uint64_t mSize;
+};
+
+bool Test_LargeInput()
+{
+    SYSTEST_ENTER();
+
+    // Tracks the largest amount of memory allocated by the parser
+    struct CPeakResource : public std::pmr::memory_resource
+    {
+        CPeakResource() :
+            mLiveBytes(0),
+            mPeakBytes(0)
+        {}
+        void* do_allocate(size_t bytes, size_t alignment) override
+        {
+            mLiveBytes += bytes;
+            mPeakBytes = std::max(mPeakBytes, mLiveBytes);
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override
+        {
+            mLiveBytes -= bytes;
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+        size_t mLiveBytes;
+        size_t mPeakBytes;
+    };
+
+    const uint64_t FourGB = 4ull * 1024 * 1024 * 1024;
+    const uint64_t BlockCount = 2100;
+    std::string sCommentBlock;
+    std::string sCDataBlock;
+    while (sCommentBlock.size() < 1024 * 1024)
+    {
+        sCommentBlock += "Comment - it's long, but it doesn't end -- here.\n";
+        sCDataBlock += "<![CDATA[ section ]] doesn't end ]]] here either.\r\n";
+    }
+    // Line ends are normalized in CDATA text
+    const uint64_t CDataTextSize = (sCDataBlock.size() - sCDataBlock.size() / 51) * BlockCount;
+
+    // Document over 4GB has comment and CDATA section over 2GB each - they're skipped and
+    // returned through the window without growing it
+    CGeneratedInput input;
+    input.Add("<?xml version=\"1.0\"?>\n<CATALOG>\n<CD><TITLE>First</TITLE></CD>\n<!--");
+    input.Add(sCommentBlock, BlockCount);
+    input.Add("-->\n<CD><TITLE>Middle</TITLE></CD>\n<![CDATA[");
+    input.Add(sCDataBlock, BlockCount);
+    input.Add("]]>\n");
+    const uint64_t LastOffset = input.GetSize();
+    input.Add("<CD><TITLE>Last</TITLE></CD>\n</CATALOGUE>\n");
+    const uint64_t ErrorOffset = LastOffset + strlen("<CD><TITLE>Last</TITLE></CD>\n</CATALOGUE");
+    SYSTEST_ASSERT(LastOffset > FourGB);
+
+    CPeakResource memoryResource;
+    {
+        CXmlPullParser parser(input, &memoryResource);
+        std::vector<std::pair<std::string, uint64_t>> records;
+        uint64_t textSize = 0;
+        CXmlPullParser::Token token = parser.Next();
+        for (; token != CXmlPullParser::Token::EndOfDocument && token != CXmlPullParser::Token::Error;
+            token = parser.Next())
+        {
+            if (token == CXmlPullParser::Token::StartElement && parser.Name() == "CD")
+                records.push_back(std::make_pair(std::string(), parser.StartTagOffset()));
+            else if (token == CXmlPullParser::Token::Text && parser.Depth() == 1)
+                textSize += parser.Text().size();
+            else if (token == CXmlPullParser::Token::Text && parser.Depth() == 3)
+                records.back().first += parser.Text();
+        }
+        // Error is returned by following calls, too
+        SYSTEST_ASSERT(token == CXmlPullParser::Token::Error && parser.Next() == CXmlPullParser::Token::Error);
+        CStatus result = parser.GetStatus();
+        SYSTEST_ASSERT(!result && result.GetError().mOffset == ErrorOffset);
+        std::wstring sError = result ? std::wstring() : FormatParseError(result.GetError());
+        SYSTEST_ASSERT(records.size() == 3);
+        SYSTEST_ASSERT(records[0].first == "First" && records[1].first == "Middle" && records[2].first == "Last");
+        SYSTEST_ASSERT(records[2].second == LastOffset);
+        // Whitespace between elements is counted, too
+        SYSTEST_ASSERT(textSize == CDataTextSize + 6);
+        std::wostringstream ss;
+        ss << L"XML parse error at offset " << ErrorOffset << L". End tag doesn't match start tag.";
+        SYSTEST_ASSERT(sError == ss.str());
+    }
+    SYSTEST_ASSERT(memoryResource.mPeakBytes < 16 * 1024 * 1024);
+
+    // Sparse file over 4GB is converted in chunks (even though mapped input is requested)
+    std::filesystem::path dirPath = std::filesystem::temp_directory_path() / "OTLargeInputTest";
+    std::filesystem::remove_all(dirPath);
+    std::filesystem::create_directories(dirPath);
+    const std::string sHead = "<CATALOG><CD><TITLE>Sparse</TITLE><ARTIST>File</ARTIST></CD><!--";
+    const std::string sTail = "--></CATALOG>\n";
+    const uint64_t FileSize = FourGB + 100 * 1024 * 1024;
+    {
+        std::ofstream file(dirPath / "large.xml", std::ios::binary);
+        file << sHead;
+    }
+    std::filesystem::resize_file(dirPath / "large.xml", FileSize - sTail.size());
+    {
+        std::ofstream file(dirPath / "large.xml", std::ios::binary | std::ios::app);
+        file << sTail;
+    }
+    SYSTEST_ASSERT(std::filesystem::file_size(dirPath / "large.xml") == FileSize);
+    std::string sExpectedHtml;
+    CCatalogEngine::Transform(sHead + sTail, sExpectedHtml);
+    CXmlParserWrapper parser(CXmlParserWrapper::EMXSLTFile::CatalogResources);
+    parser.EnableMetrics(true);
+    std::string sHtml;
+    CStringOutputSink htmlSink(sHtml);
+    uint64_t xmlSize = 0;
+    std::wstring sErrorMsg;
+    SYSTEST_ASSERT(ConvertXmlFile(parser, (dirPath / "large.xml").wstring().c_str(), htmlSink,
+        xmlSize, sErrorMsg) == OTInterviewExercise1ExitCode::SUCCESS);
+    SYSTEST_ASSERT(xmlSize == FileSize);
+    SYSTEST_ASSERT(sHtml == sExpectedHtml);
+    if (parser.GetMetrics() != nullptr)
+    {
+        CConversionMetrics::CPhaseTotals readTotals = parser.GetMetrics()->GetPhase(CConversionMetrics::EMPhase::Read);
+        SYSTEST_ASSERT(readTotals.mBytes == FileSize && readTotals.mCount > 1);
+    }
+
+    std::filesystem::remove_all(dirPath);
+
+    SYSTEST_RETURN();
+}
+
+bool Test_CatalogIndex()
+{
+    SYSTEST_ENTER();
+
+    std::string sXml = "<?xml version=\"1.0\"?>\n<CATALOG>\n";
+    for (size_t i = 0; i < 3000; ++i)
+    {
+        sXml += "<CD><TITLE>Title &amp; " + std::to_string(i) + "</TITLE>";
+        // Some records miss artist - they sort as empty ones
+        if (i % 7 != 0)
+            sXml += "<ARTIST>\xC3\x89tienne " + std::to_string(i * 7919 % 101) + "</ARTIST>";
+        sXml += "<COUNTRY>UK</COUNTRY><PRICE>" + std::to_string(i % 30) + ".90</PRICE><YEAR>19" +
+            std::to_string(i % 100) + "</YEAR></CD>\n";
+    }
+    sXml += "</CATALOG>\n";
+    std::string sExpectedHtml;
+    CCatalogEngine::Transform(sXml, sExpectedHtml);
+
+    std::filesystem::path dirPath = std::filesystem::temp_directory_path() / "OTCatalogIndexTest";
+    std::filesystem::remove_all(dirPath);
+    std::filesystem::create_directories(dirPath);
+    const std::filesystem::path xmlPath = dirPath / "catalog.xml";
+    const std::filesystem::path indexPath = dirPath / "catalog.xml.catidx";
+    auto writeXml = [&xmlPath](const std::string& sContents) {
+        std::ofstream file(xmlPath, std::ios::binary | std::ios::trunc);
+        file << sContents;
+    };
+    writeXml(sXml);
+
+    CXmlParserWrapper parser(CXmlParserWrapper::EMXSLTFile::CatalogResources);
+    parser.EnableMetrics(true);
+    SYSTEST_ASSERT(parser.SupportsCatalogIndex());
+    // Returns number of times XML was parsed so far (or UINT64_MAX if conversion failed)
+    auto convert = [&parser, &xmlPath](std::string& o_sHtml) {
+        o_sHtml.clear();
+        CStringOutputSink htmlSink(o_sHtml);
+        uint64_t xmlSize = 0;
+        std::wstring sErrorMsg;
+        if (ConvertXmlFile(parser, xmlPath.wstring().c_str(), htmlSink, xmlSize, sErrorMsg,
+            EMXmlFileInput::Indexed) != OTInterviewExercise1ExitCode::SUCCESS ||
+            xmlSize != std::filesystem::file_size(xmlPath))
+        {
+            return UINT64_MAX;
+        }
+        return parser.GetMetrics()->GetPhase(CConversionMetrics::EMPhase::Load).mCount;
+    };
+
+    // The first conversion parses XML and writes index, the next ones only render it
+    std::string sHtml;
+    SYSTEST_ASSERT(convert(sHtml) == 1);
+    SYSTEST_ASSERT(sHtml == sExpectedHtml);
+    SYSTEST_ASSERT(std::filesystem::exists(indexPath));
+    SYSTEST_ASSERT(convert(sHtml) == 1);
+    SYSTEST_ASSERT(sHtml == sExpectedHtml);
+
+    // Index contains all records and fields
+    {
+        CCatalogIndex index;
+        std::wstring sReason;
+        SYSTEST_ASSERT(index.Load(indexPath.wstring().c_str(), xmlPath.wstring().c_str(), sReason));
+        SYSTEST_ASSERT(index.GetRecordCount() == 3000 && index.GetXmlSize() == sXml.size());
+        SYSTEST_ASSERT(index.Get(10, ECatalogField::Title) == "Title & 10");
+        SYSTEST_ASSERT(index.Has(10, ECatalogField::Year) && index.Get(10, ECatalogField::Year) == "1910");
+        SYSTEST_ASSERT(!index.Has(14, ECatalogField::Artist) && !index.Has(14, ECatalogField::Company));
+        SYSTEST_ASSERT(index.GetSortedRecord(0) == 0 && index.GetSortedRecord(1) == 7);
+    }
+
+    // Touched file with the same contents isn't parsed again
+    std::filesystem::last_write_time(xmlPath, std::filesystem::last_write_time(xmlPath) + std::chrono::hours(1));
+    SYSTEST_ASSERT(convert(sHtml) == 1);
+    SYSTEST_ASSERT(sHtml == sExpectedHtml);
+
+    // Index is rebuilt when XML file changes: same size, other contents...
+    std::string sChangedXml = sXml;
+    sChangedXml.replace(sChangedXml.find("Title &amp; 5<"), 14, "Title &amp; X<");
+    writeXml(sChangedXml);
+    std::filesystem::last_write_time(xmlPath, std::filesystem::last_write_time(xmlPath) + std::chrono::hours(2));
+    CCatalogEngine::Transform(sChangedXml, sExpectedHtml);
+    SYSTEST_ASSERT(convert(sHtml) == 2);
+    SYSTEST_ASSERT(sHtml == sExpectedHtml);
+    SYSTEST_ASSERT(convert(sHtml) == 2);
+    // ...or other size
+    sChangedXml.insert(sChangedXml.find("</CATALOG>"), "<CD><TITLE>New</TITLE><ARTIST>A</ARTIST></CD>\n");
+    writeXml(sChangedXml);
+    CCatalogEngine::Transform(sChangedXml, sExpectedHtml);
+    SYSTEST_ASSERT(convert(sHtml) == 3);
+    SYSTEST_ASSERT(sHtml == sExpectedHtml);
+
+    // Corrupt index is rebuilt
+    std::filesystem::resize_file(indexPath, std::filesystem::file_size(indexPath) - 100);
+    SYSTEST_ASSERT(convert(sHtml) == 4);
+    SYSTEST_ASSERT(sHtml == sExpectedHtml);
+    SYSTEST_ASSERT(convert(sHtml) == 4);
+
+    // Malformed XML fails conversion (stale index isn't used)
+    writeXml(sChangedXml.substr(0, sChangedXml.size() - 5));
+    std::string sFailedHtml;
+    CStringOutputSink failedSink(sFailedHtml);
+    uint64_t xmlSize = 0;
+    std::wstring sErrorMsg;
+    SYSTEST_ASSERT(ConvertXmlFile(parser, xmlPath.wstring().c_str(), failedSink, xmlSize, sErrorMsg,
+        EMXmlFileInput::Indexed) == OTInterviewExercise1ExitCode::XML_PARSER_ERROR);
+    SYSTEST_ASSERT(ConvertXmlFile(parser, (dirPath / "missing.xml").wstring().c_str(), failedSink, xmlSize, sErrorMsg,
+        EMXmlFileInput::Indexed) == OTInterviewExercise1ExitCode::XML_FILE_NOT_FOUND);
+
+    std::filesystem::remove_all(dirPath);
+
+    SYSTEST_RETURN();
+}
+
+// Keeps pages in memory. Page failPage (if it isn't SIZE_MAX) fails to be written.
+class CStringPageOutput : public CPageOutput
+{
+public:
+    explicit CStringPageOutput(size_t failPage = SIZE_MAX) :
+        mFailPage(failPage)
+    {}
+    std::string GetPageLink(size_t page) const override
+    {
+        return "page\"" + std::to_string(page) + ".html";
+    }
+    void WritePage(size_t page, std::string_view sHtml) override
+    {
+        if (page == mFailPage)
+        {
+            THROW_ERROR(L"Page can't be written");
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPages[page] = sHtml;
+    }
+    std::map<size_t, std::string> mPages;
+private:
+    size_t mFailPage;
+    std::mutex mMutex;
+};
+
+bool Test_PagedOutput()
+{
+    SYSTEST_ENTER();
+
+    std::string sXml = "<CATALOG>";
+    for (size_t i = 0; i < 2500; ++i)
+    {
+        sXml += "<CD><TITLE>T&amp;" + std::to_string(i) + "</TITLE>";
+        if (i % 11 != 0)
+            sXml += "<ARTIST>A&lt;" + std::to_string(i * 7919 % 97) + "</ARTIST>";
+        sXml += "<YEAR>" + std::to_string(1900 + i % 100) + "</YEAR></CD>";
+    }
+    sXml += "</CATALOG>";
+    std::string sExpectedHtml;
+    CCatalogEngine::Transform(sXml, sExpectedHtml);
+    const std::string sHeader = sExpectedHtml.substr(0, sExpectedHtml.find("</tr>") + 5);
+    const std::string sFooter = "</table></body></html>";
+    const std::string sExpectedRows = sExpectedHtml.substr(sHeader.size(),
+        sExpectedHtml.size() - sHeader.size() - sFooter.size());
+
+    // Pages are complete documents - their rows follow each other in the sort order
+    for (unsigned int threadCount : { 1u, 4u })
+    {
+        for (size_t pageSize : { size_t(7), size_t(1000), size_t(2500), size_t(3000) })
+        {
+            CStringPageOutput pageOutput;
+            CTransformOptions options;
+            options.mThreadCount = threadCount;
+            options.mPageOutput = &pageOutput;
+            options.mPageSize = pageSize;
+            std::string sIndexHtml;
+            CStringOutputSink indexSink(sIndexHtml);
+            CCatalogEngine::Transform(sXml, indexSink, options);
+            const size_t pageCount = (2500 + pageSize - 1) / pageSize;
+            SYSTEST_ASSERT(pageOutput.mPages.size() == pageCount);
+            std::string sRows;
+            for (const auto& page : pageOutput.mPages)
+            {
+                const std::string& sPage = page.second;
+                SYSTEST_ASSERT(sPage.compare(0, sHeader.size(), sHeader) == 0);
+                SYSTEST_ASSERT(sPage.size() >= sHeader.size() + sFooter.size() &&
+                    sPage.compare(sPage.size() - sFooter.size(), sFooter.size(), sFooter) == 0);
+                sRows += sPage.substr(sHeader.size(), sPage.size() - sHeader.size() - sFooter.size());
+            }
+            SYSTEST_ASSERT(sRows == sExpectedRows);
+
+            // Index page links to every page (links are escaped)
+            SYSTEST_ASSERT(sIndexHtml.find("<th>First Artist</th><th>Last Artist</th>") != std::string::npos);
+            SYSTEST_ASSERT(sIndexHtml.find("<a href=\"page&quot;" + std::to_string(pageCount - 1) + ".html\">" +
+                std::to_string(pageCount) + "</a>") != std::string::npos);
+            SYSTEST_ASSERT(sIndexHtml.find("<a href=\"page&quot;" + std::to_string(pageCount) + ".html\">") == std::string::npos);
+        }
+    }
+    {
+        // The first page starts with records without artist, the last page ends with the greatest one
+        CStringPageOutput pageOutput;
+        CTransformOptions options;
+        options.mPageOutput = &pageOutput;
+        options.mPageSize = 1000;
+        std::string sIndexHtml;
+        CStringOutputSink indexSink(sIndexHtml);
+        CCatalogEngine::Transform(sXml, indexSink, options);
+        SYSTEST_ASSERT(sIndexHtml.find("<td>1-1000</td><td></td><td>") != std::string::npos);
+        SYSTEST_ASSERT(sIndexHtml.find("<td>2001-2500</td><td>A&lt;") != std::string::npos);
+        SYSTEST_ASSERT(sIndexHtml.find("<td>A&lt;96</td></tr></table>") != std::string::npos);
+    }
+
+    // Catalog without records has no pages
+    {
+        CStringPageOutput pageOutput;
+        CTransformOptions options;
+        options.mPageOutput = &pageOutput;
+        std::string sIndexHtml;
+        CStringOutputSink indexSink(sIndexHtml);
+        CCatalogEngine::Transform("<CATALOG/>", indexSink, options);
+        SYSTEST_ASSERT(pageOutput.mPages.empty());
+        SYSTEST_ASSERT(sIndexHtml.find("</th></tr></table></body></html>") != std::string::npos);
+    }
+
+    // Failure to write a page fails conversion
+    for (unsigned int threadCount : { 1u, 4u })
+    {
+        CStringPageOutput pageOutput(1);
+        CTransformOptions options;
+        options.mThreadCount = threadCount;
+        options.mPageOutput = &pageOutput;
+        options.mPageSize = 10;
+        std::string sIndexHtml;
+        CStringOutputSink indexSink(sIndexHtml);
+        bool isFailed = false;
+        try
+        {
+            CCatalogEngine::Transform(sXml, indexSink, options);
+        }
+        catch (const CException& ex)
+        {
+            isFailed = ex.mErrorDescription == L"Page can't be written";
+        }
+        SYSTEST_ASSERT(isFailed && sIndexHtml.empty());
+    }
+
+    // Batch converter writes pages next to HTML file, which becomes index page
+    std::filesystem::path dirPath = std::filesystem::temp_directory_path() / "ot_systemtests_pages";
+    std::error_code ec;
+    std::filesystem::remove_all(dirPath, ec);
+    std::filesystem::create_directories(dirPath);
+    auto cleanup = MakeRAIICleanup([&dirPath]() {
+        std::error_code ec;
+        std::filesystem::remove_all(dirPath, ec);
+        });
+    {
+        std::ofstream file(dirPath / "cat alog.xml", std::ios::binary);
+        file << sXml;
+    }
+    CBatchConverter converter(1, L"");
+    converter.SetPageSize(1000);
+    std::vector<CBatchConverter::CFileResult> results;
+    double seconds = 0;
+    std::wstring sError;
+    SYSTEST_ASSERT(converter.Run({ (dirPath / "cat alog.xml").wstring() }, results, seconds, sError));
+    SYSTEST_ASSERT(results.size() == 1 && results[0].mExitCode == OTInterviewExercise1ExitCode::SUCCESS);
+    std::string sRows;
+    uint64_t htmlSize = std::filesystem::file_size(dirPath / "cat alog.html");
+    for (int i = 1; i <= 3; ++i)
+    {
+        std::filesystem::path pagePath = dirPath / ("cat alog-" + std::to_string(i) + ".html");
+        std::ifstream file(pagePath, std::ios::binary);
+        std::string sPage((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        sRows += sPage.substr(sHeader.size(), sPage.size() - sHeader.size() - sFooter.size());
+        htmlSize += sPage.size();
+    }
+    SYSTEST_ASSERT(sRows == sExpectedRows);
+    SYSTEST_ASSERT(results[0].mHtmlSize == htmlSize);
+    SYSTEST_ASSERT(!std::filesystem::exists(dirPath / "cat alog-4.html"));
+    {
+        std::ifstream file(dirPath / "cat alog.html", std::ios::binary);
+        std::string sIndexHtml((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        SYSTEST_ASSERT(sIndexHtml.find("<a href=\"cat%20alog-3.html\">3</a>") != std::string::npos);
+    }
+
+    SYSTEST_RETURN();
+}
+
+// Byte by byte escaping that kernels of CHtmlEscaper are compared with
+std::string EscapeHtmlReference(std::string_view sText, bool isAttribute)
+{
+    std::string sHtml;
+    for (char c : sText)
+    {
+        switch (c)
+        {
+        case '&':
+            sHtml += "&amp;";
+            break;
+        case '<':
+            sHtml += "&lt;";
+            break;
+        case '>':
+            sHtml += "&gt;";
+            break;
+        case '"':
+            sHtml += isAttribute ? "&quot;" : "\"";
+            break;
+        default:
+            sHtml += c;
+        }
+    }
+    return sHtml;
+}
+
+bool Test_HtmlEscaper()
+{
+    SYSTEST_ENTER();
+
+    const CHtmlEscaper::EMKernel kernels[] = {
+        CHtmlEscaper::EMKernel::Auto,
+        CHtmlEscaper::EMKernel::Scalar,
+        CHtmlEscaper::EMKernel::SSE2,
+        CHtmlEscaper::EMKernel::AVX2
+    };
+    const CHtmlEscaper::EMContext contexts[] = { CHtmlEscaper::EMContext::Text, CHtmlEscaper::EMContext::Attribute };
+    SYSTEST_ASSERT(CHtmlEscaper::IsKernelSupported(CHtmlEscaper::EMKernel::Scalar));
+    SYSTEST_ASSERT(CHtmlEscaper::IsKernelSupported(CHtmlEscaper::GetBestKernel()));
+
+    // Random texts biased towards special characters at any position relative to 16/32 byte
+    // blocks (and runs of clean blocks), including bytes with the high bit set
+    const char SPECIAL[] = "&<>\"";
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    auto next = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+    std::string sBuffer(512, ' ');
+    for (size_t round = 0; round < 2000; ++round)
+    {
+        size_t size = next() % 301;
+        size_t offset = next() % 64;
+        unsigned int specialPercent = round % 4 == 0 ? 0 : static_cast<unsigned int>(next() % 30);
+        for (size_t i = 0; i < size; ++i)
+        {
+            uint64_t value = next();
+            if (value % 100 < specialPercent)
+                sBuffer[offset + i] = SPECIAL[(value >> 8) % 4];
+            else if ((value >> 16) % 16 == 0)
+                sBuffer[offset + i] = static_cast<char>(0x80 + (value >> 24) % 128);
+            else
+                sBuffer[offset + i] = static_cast<char>(' ' + (value >> 24) % 95);
+        }
+        std::string_view sText(sBuffer.data() + offset, size);
+        for (auto context : contexts)
+        {
+            std::string sExpected = EscapeHtmlReference(sText, context == CHtmlEscaper::EMContext::Attribute);
+            for (auto kernel : kernels)
+            {
+                SYSTEST_ASSERT(CHtmlEscaper::GetEscapedSize(sText, context, kernel) == sExpected.size());
+                // Output past the escaped text stays untouched
+                std::string sOutput(sExpected.size() + 1, '#');
+                SYSTEST_ASSERT(CHtmlEscaper::Escape(sText, &sOutput[0], context, kernel) == sExpected.size());
+                SYSTEST_ASSERT(sOutput.compare(0, sExpected.size(), sExpected) == 0);
+                SYSTEST_ASSERT(sOutput.back() == '#');
+                std::pmr::string sHtml = "<td>";
+                CHtmlEscaper::Append(sText, sHtml, context, kernel);
+                SYSTEST_ASSERT(sHtml.size() == 4 + sExpected.size());
+                SYSTEST_ASSERT(std::string_view(sHtml).substr(4) == sExpected);
+            }
+        }
+    }
+
+    std::pmr::string sHtml;
+    CHtmlEscaper::Append("", sHtml);
+    SYSTEST_ASSERT(sHtml.empty());
+    CHtmlEscaper::Append("a\"b", sHtml);
+    CHtmlEscaper::Append("a\"b", sHtml, CHtmlEscaper::EMContext::Attribute);
+    SYSTEST_ASSERT(sHtml == "a\"ba&quot;b");
+
+    SYSTEST_RETURN();
+}
+
+int main()
+{
+    std::vector<std::function<bool()>> v = {
+    Test_CException,
+#ifdef _WIN32
+    Test_OsInitialization,
+#endif
     Test_TextFileReader,
+    Test_TextFileReaderModes,
+    Test_Result,
     Test_RAIICleanup,
-    Test_XmlParserWrapper
+    Test_XmlParserWrapper,
+    Test_NativeXmlParserWrapper,
+    Test_ConversionArena,
+    Test_Utf8XmlParserWrapper,
+    Test_FileOutputSink,
+    Test_BatchConverter,
+    Test_StylesheetCache,
+    Test_StylesheetFile,
+    Test_Utf8Transcoder,
+    Test_CatalogEngine,
+    Test_CatalogRecordSorter,
+    Test_CatalogRowCache,
+    Test_ConversionServer,
+    Test_XmlParserPool,
+    Test_ConversionMetrics,
+    Test_Logger,
+    Test_Trace,
+    Test_PipelinedInput,
+    Test_LargeInput,
+    Test_CatalogIndex,
+    Test_PagedOutput,
+    Test_HtmlEscaper
     };
 
     for (auto f : v)
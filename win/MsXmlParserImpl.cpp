@@ -0,0 +1,258 @@
+// Contains OS-specific (Windows) implementation of XML parser engine that converts
+// an XML file into HTML format by using MSXML6.
+
+#include <windows.h>
+#include "resource.h"
+#include "..\XmlParserWrapper.h"
+#include "..\XmlParserWrapperImpl.h"
+#include "..\Util.h"
+#include "..\Utf8Transcoder.h"
+#include "..\ConversionMetrics.h"
+#include "..\Trace.h"
+#include "..\StylesheetCache.h"
+#include "..\StylesheetFile.h"
+#include "WinUtil.h"
+#import <msxml6.dll>
+#include <sstream>
+
+namespace OTInterviewExercise1
+{
+    namespace
+    {
+        // Name of engine in style sheet cache
+        const char MsXmlEngineName[] = "MSXML6";
+
+        // Compiled MSXML style sheet. IXSLTemplate is free-threaded: every conversion
+        // creates its own IXSLProcessor from it.
+        class CMsXmlCompiledStylesheet : public CCompiledStylesheet
+        {
+        public:
+            MSXML2::IXSLTemplatePtr mTemplate;
+        };
+    }
+
+    // Uses MSXML6.DLL XSLT engine to generate HTML from XML (by using appropriate
+    // XSLT files).
+    class CMsXmlParserImpl : public CXmlParserWrapper::CXmlParserWrapperImpl
+    {
+    public:
+        // Methods
+        CMsXmlParserImpl(CXmlParserWrapper::EMXSLTFile xsltFileId, const wchar_t* sXSLTFilePathName);
+        ~CMsXmlParserImpl() = default;
+
+        CStatus Parse(const std::wstring& sXML, std::wstring& o_sHTML) override;
+        CStatus Parse(std::string_view sXML, COutputSink& o_html) override;
+    private:
+        // Retrieve XSLT stylesheet from file (it's recompiled when file changes)
+        void ReadXSLTFile(const wchar_t* strFileFullPath);
+        // Retrieve XSLT stylesheet from resources
+        void ReadXSLTFromResources(DWORD resId);
+        // Takes compiled style sheet from process-wide cache (compiles it on miss)
+        void CompileXSLT(std::string_view sXslt);
+        static CStylesheetCache::CompiledStylesheetPtr Compile(std::string_view sXslt);
+
+        // Data
+        // Style sheet from resources
+        std::shared_ptr<const CMsXmlCompiledStylesheet> mStylesheet;
+        // Style sheet from file
+        std::unique_ptr<CStylesheetFile> mStylesheetFile;
+    };
+
+    std::unique_ptr<CXmlParserWrapper::CXmlParserWrapperImpl> CreateMsXmlParserImpl(
+        CXmlParserWrapper::EMXSLTFile xsltFileId, const wchar_t* sXSLTFilePathName)
+    {
+        return std::make_unique<CMsXmlParserImpl>(xsltFileId, sXSLTFilePathName);
+    }
+
+    CMsXmlParserImpl::CMsXmlParserImpl(
+        CXmlParserWrapper::EMXSLTFile xsltFileId,
+        const wchar_t* sXSLTFilePathName)
+    {
+        if (xsltFileId == CXmlParserWrapper::EMXSLTFile::CatalogResources)
+        {
+            ReadXSLTFromResources(IDR_RCDATA_CAT_XSLT);
+        }
+        if (xsltFileId == CXmlParserWrapper::EMXSLTFile::File)
+        {
+            ReadXSLTFile(sXSLTFilePathName);
+        }
+    }
+
+    CStatus CMsXmlParserImpl::Parse(
+        const std::wstring& sXML, std::wstring& o_sHTML)
+    {
+        o_sHTML.clear();
+
+        bstr_t sXMLBstr(sXML.c_str());
+        if (!sXMLBstr)
+        {
+            THROW_ERROR(L"Memory allocation error");
+        }
+        MSXML2::IXMLDOMDocumentPtr xmlObj;
+        HRESULT hr = xmlObj.CreateInstance(__uuidof(MSXML2::DOMDocument60));
+        assert(SUCCEEDED(hr));
+        if (FAILED(hr))
+        {
+            std::wostringstream ss;
+            ss << L"MSXML2::DOMDocument60::CreateInstance failed. Error code: " << std::hex << hr;
+            THROW_ERROR(ss.str().c_str());
+        }
+        CTraceSpan loadSpan("load");
+        CMetricsTimer loadTimer(mMetrics, CConversionMetrics::EMPhase::Load, sXML.size() * sizeof(wchar_t));
+        VARIANT_BOOL vLoadStatus = xmlObj->loadXML(sXMLBstr);
+        if (VARIANT_TRUE != vLoadStatus)
+        {
+            THROW_ERROR(L"MSXML2::DOMDocument60::loadXML failed");
+        }
+        loadTimer.Stop();
+        loadSpan.Stop();
+        CTraceSpan transformSpan("transform");
+        CMetricsTimer transformTimer(mMetrics, CConversionMetrics::EMPhase::Transform);
+        // Conversion keeps the version of style sheet it started with (even if the
+        // file is reloaded meanwhile)
+        std::shared_ptr<const CMsXmlCompiledStylesheet> stylesheet = mStylesheet;
+        if (mStylesheetFile != nullptr)
+        {
+            stylesheet = std::static_pointer_cast<const CMsXmlCompiledStylesheet>(mStylesheetFile->Get());
+        }
+        // Processor is cheap to create - the style sheet was compiled once
+        MSXML2::IXSLProcessorPtr processor = stylesheet->mTemplate->createProcessor();
+        if (processor == nullptr)
+        {
+            THROW_ERROR(L"MSXML2::IXSLTemplate::createProcessor failed");
+        }
+        processor->input = _variant_t(static_cast<IUnknown*>(xmlObj));
+        if (VARIANT_TRUE != processor->transform())
+        {
+            THROW_ERROR(L"MSXML2::IXSLProcessor::transform failed");
+        }
+        bstr_t sHTMLBstr(processor->output);
+        if (!sHTMLBstr)
+        {
+            THROW_ERROR(L"MSXML2::IXSLProcessor::transform returned no output");
+        }
+        o_sHTML = sHTMLBstr.GetBSTR();
+        return CStatus();
+    }
+
+    CStatus CMsXmlParserImpl::Parse(std::string_view sXML, COutputSink& o_html)
+    {
+        // MSXML takes input as BSTR, so the wide conversion can't be avoided here
+        std::wstring sXMLWide;
+        size_t errorOffset = 0;
+        CTraceSpan decodeSpan("decode");
+        CMetricsTimer decodeTimer(mMetrics, CConversionMetrics::EMPhase::Decode, sXML.size());
+        if (!CUtf8Transcoder::ToWide(sXML, sXMLWide, &errorOffset))
+        {
+            std::wostringstream ss;
+            ss << L"Document isn't valid UTF8. Invalid UTF8 sequence at offset " << errorOffset;
+            THROW_ERROR(ss.str().c_str());
+        }
+        decodeTimer.Stop();
+        decodeSpan.Stop();
+        std::wstring sHTMLWide;
+        CStatus status = Parse(sXMLWide, sHTMLWide);
+        if (!status)
+            return status;
+        std::string sHTML;
+        CTraceSpan encodeSpan("encode");
+        CMetricsTimer encodeTimer(mMetrics, CConversionMetrics::EMPhase::Decode, sHTMLWide.size() * sizeof(wchar_t));
+        if (!WideToUtf8(sHTMLWide.data(), sHTMLWide.size(), sHTML))
+        {
+            THROW_ERROR(L"Failed to convert wchar_t string to UTF8");
+        }
+        encodeTimer.Stop();
+        encodeSpan.Stop();
+        o_html.Write(sHTML.data(), sHTML.size());
+        return status;
+    }
+
+    void CMsXmlParserImpl::ReadXSLTFile(const wchar_t* strFileFullPath)
+    {
+        assert(strFileFullPath != nullptr);
+        mStylesheetFile = std::make_unique<CStylesheetFile>(strFileFullPath, MsXmlEngineName,
+            &CMsXmlParserImpl::Compile);
+    }
+
+    void CMsXmlParserImpl::ReadXSLTFromResources(DWORD resId)
+    {
+        assert(resId != 0);
+
+        HMODULE hModule = ::GetModuleHandle(nullptr);
+        HRSRC hRes = ::FindResource(hModule, MAKEINTRESOURCE(resId), RT_RCDATA);
+        if (!hRes)
+        {
+            DWORD lastErr = ::GetLastError();
+            std::wostringstream ss;
+            ss << L"FindResource failed. Error code: " << std::hex << lastErr;
+            THROW_ERROR(ss.str().c_str());
+        }
+        HGLOBAL hResourceLoaded = LoadResource(hModule, hRes);
+        if (!hResourceLoaded)
+        {
+            DWORD lastErr = ::GetLastError();
+            std::wostringstream ss;
+            ss << L"LoadResource failed. Error code: " << std::hex << lastErr;
+            THROW_ERROR(ss.str().c_str());
+        }
+        char* lpResLock = static_cast<char*>(LockResource(hResourceLoaded));
+        DWORD dwSizeRes = SizeofResource(hModule, hRes);
+        if (!lpResLock || !dwSizeRes)
+        {
+            THROW_ERROR(L"Resource is null or 0 size.");
+        }
+        CompileXSLT(std::string_view(lpResLock, dwSizeRes));
+    }
+
+    void CMsXmlParserImpl::CompileXSLT(std::string_view sXslt)
+    {
+        mStylesheet = std::static_pointer_cast<const CMsXmlCompiledStylesheet>(
+            CStylesheetCache::Instance().Get(MsXmlEngineName, sXslt, &CMsXmlParserImpl::Compile));
+    }
+
+    CStylesheetCache::CompiledStylesheetPtr CMsXmlParserImpl::Compile(std::string_view sXslt)
+    {
+        std::wstring sXsltWide;
+        size_t errorOffset = 0;
+        if (!CUtf8Transcoder::ToWide(sXslt, sXsltWide, &errorOffset))
+        {
+            std::wostringstream ss;
+            ss << L"XSLT isn't valid UTF8. Invalid UTF8 sequence at offset " << errorOffset;
+            THROW_ERROR(ss.str().c_str());
+        }
+        bstr_t bstrXslt(sXsltWide.c_str());
+        if (!bstrXslt)
+        {
+            THROW_ERROR(L"BSTR memory allocation error");
+        }
+        // IXSLTemplate requires free-threaded style sheet document
+        MSXML2::IXMLDOMDocumentPtr xslObj;
+        HRESULT hr = xslObj.CreateInstance(__uuidof(MSXML2::FreeThreadedDOMDocument60));
+        if (FAILED(hr))
+        {
+            std::wostringstream ss;
+            ss << L"MSXML2::FreeThreadedDOMDocument60::CreateInstance failed. Error code: " << std::hex << hr;
+            THROW_ERROR(ss.str().c_str());
+        }
+        if (VARIANT_TRUE != xslObj->loadXML(bstrXslt))
+        {
+            THROW_ERROR(L"MSXML2::IXMLDOMDocumentPtr::loadXML failed");
+        }
+        auto compiled = std::make_shared<CMsXmlCompiledStylesheet>();
+        hr = compiled->mTemplate.CreateInstance(__uuidof(MSXML2::XSLTemplate60));
+        if (FAILED(hr))
+        {
+            std::wostringstream ss;
+            ss << L"MSXML2::XSLTemplate60::CreateInstance failed. Error code: " << std::hex << hr;
+            THROW_ERROR(ss.str().c_str());
+        }
+        hr = compiled->mTemplate->putref_stylesheet(xslObj);
+        if (FAILED(hr))
+        {
+            std::wostringstream ss;
+            ss << L"MSXML2::IXSLTemplate::putref_stylesheet failed. Error code: " << std::hex << hr;
+            THROW_ERROR(ss.str().c_str());
+        }
+        return compiled;
+    }
+}
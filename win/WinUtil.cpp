@@ -2,11 +2,16 @@
 
 #include "..\Util.h"
 #include "WinUtil.h"
+#include <afunix.h>
+#include <psapi.h>
 #include <assert.h>
 #include <sstream>
 #include <functional>
 #include <algorithm>
 
+#pragma comment(lib, "Ws2_32.lib")
+#pragma comment(lib, "Psapi.lib")
+
 namespace OTInterviewExercise1
 {
     bool COsInitialization::COsInitializationImpl::IsOk(std::wstring& o_errorMsg) const noexcept
@@ -110,166 +115,1202 @@ namespace OTInterviewExercise1
         }
     }
 
-    CTextFileReader::CTextFileReaderImpl::CTextFileReaderImpl(const wchar_t* filePathName) :
+    std::wstring FormatError(const CError& error)
+    {
+        if (error.mSystemCallName == nullptr)
+            return error.mErrorDescription;
+        std::wostringstream ss;
+        ss << error.mSystemCallName << L" failed. Error code: " << std::hex << static_cast<DWORD>(error.mSystemErrorCode);
+        return ss.str();
+    }
+
+    CTextFileReader::CTextFileReaderImpl::CTextFileReaderImpl(const wchar_t* filePathName, ReadMode readMode) :
+        mMappedData(nullptr),
+        mMappedSize(0),
+        mStatus(Status::NotFound)
+    {
+        try
+        {
+            CStatus status = Open(filePathName, readMode);
+            if (status)
+            {
+                mStatus = Status::ValidContents;
+                return;
+            }
+            mError = status.GetError();
+            mStatus = static_cast<Status>(mError.mInternalErrorCode);
+            // Missing and empty files are ordinary outcomes - caller reports them
+            if (Status::NotFound == mStatus || Status::NoContents == mStatus)
+                return;
+            mErrMsg = FormatError(mError);
+        }
+        catch (const std::bad_alloc& /*ex*/)
+        {
+            mStatus = Status::ReadContentsError;
+            mErrMsg = L"Memory allocation error.";
+        }
+        catch (const std::exception& ex)
+        {
+            mStatus = Status::ReadContentsError;
+            std::wostringstream ss;
+            ss << L"C++ exception caught. ";
+            if (ex.what())
+            {
+                std::vector<wchar_t> sWhat(strlen(ex.what()) + 1, 0);
+                size_t numConverted = 0;
+                mbstowcs_s(&numConverted, &sWhat[0], sWhat.size() + 1, ex.what(), sWhat.size());
+                assert(numConverted);
+                ss.write(sWhat.data(), wcslen(sWhat.data()));
+            }
+            mErrMsg = ss.str();
+        }
+        catch (...)
+        {
+            mStatus = Status::ReadContentsError;
+            mErrMsg = L"Unknown exception caught.";
+        }
+        LogError(__FUNCTION__, __LINE__, mErrMsg);
+    }
+
+    CStatus CTextFileReader::CTextFileReaderImpl::Open(const wchar_t* filePathName, ReadMode readMode)
+    {
+        HANDLE hFileFind = INVALID_HANDLE_VALUE;
+        HANDLE hFile = INVALID_HANDLE_VALUE;
+
+        // Cleanup resources before function returning
+        auto cleanup = MakeRAIICleanup([&hFileFind, &hFile]() {
+            if (INVALID_HANDLE_VALUE != hFileFind)
+            {
+                ::FindClose(hFileFind);
+                hFileFind = INVALID_HANDLE_VALUE;
+            }
+            if (INVALID_HANDLE_VALUE != hFile)
+            {
+                ::CloseHandle(hFile);
+                hFile = INVALID_HANDLE_VALUE;
+            }
+            });
+
+        WIN32_FIND_DATAW data = { 0 };
+        hFileFind = ::FindFirstFile(filePathName, &data);
+        if (INVALID_HANDLE_VALUE == hFileFind)
+        {
+            DWORD lastErr = ::GetLastError();
+            if (ERROR_FILE_NOT_FOUND == lastErr)
+            {
+                return CError(static_cast<unsigned int>(Status::NotFound), L"File not found");
+            }
+            return CError(static_cast<unsigned int>(Status::FindError), L"", L"FindFirstFile", static_cast<int>(lastErr));
+        }
+
+        hFile = ::CreateFile(
+            filePathName,
+            GENERIC_READ,
+            0,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr
+        );
+        if (INVALID_HANDLE_VALUE == hFile)
+        {
+            return CError(static_cast<unsigned int>(Status::ReadContentsError), L"", L"CreateFile",
+                static_cast<int>(::GetLastError()));
+        }
+        LARGE_INTEGER liSize = { 0 };
+        if (!GetFileSizeEx(hFile, &liSize))
+        {
+            return CError(static_cast<unsigned int>(Status::ReadContentsError), L"", L"GetFileSizeEx",
+                static_cast<int>(::GetLastError()));
+        }
+        else if (liSize.QuadPart == 0)
+        {
+            return CError(static_cast<unsigned int>(Status::NoContents), L"File is empty");
+        }
+        else if (static_cast<ULONGLONG>(liSize.QuadPart) > SIZE_MAX)
+        {
+            // Only 32-bit builds get here - such files can be read in chunks
+            return CError(static_cast<unsigned int>(Status::ReadContentsError), L"File doesn't fit into address space");
+        }
+        // Only disk files can be mapped - pipes, devices, etc. are read
+        if (ReadMode::Map == readMode && FILE_TYPE_DISK == ::GetFileType(hFile) &&
+            MapFile(hFile, static_cast<size_t>(liSize.QuadPart)))
+        {
+            return CStatus();
+        }
+        mFileContents.reserve(static_cast<size_t>(liSize.QuadPart));
+        std::vector<BYTE> buf(INTERNAL_BUF_SIZE);
+        for (;;)
+        {
+            DWORD numRead = 0;
+            if (!::ReadFile(hFile, buf.data(), static_cast<DWORD>(buf.size()), &numRead, nullptr))
+            {
+                mFileContents.clear();
+                return CError(static_cast<unsigned int>(Status::ReadContentsError), L"", L"ReadFile",
+                    static_cast<int>(::GetLastError()));
+            }
+            else if (numRead == 0)
+            {
+                return CStatus();
+            }
+            mFileContents.insert(end(mFileContents), buf.data(), buf.data() + numRead);
+        }
+    }
+
+    CTextFileReader::CTextFileReaderImpl::~CTextFileReaderImpl()
+    {
+        if (mMappedData != nullptr)
+            ::UnmapViewOfFile(mMappedData);
+    }
+
+    bool CTextFileReader::CTextFileReaderImpl::MapFile(HANDLE hFile, size_t fileSize) noexcept
+    {
+        HANDLE hMapping = ::CreateFileMapping(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (hMapping == nullptr)
+            return false;
+        // View keeps the mapping alive - so mapping handle can be closed right away
+        const void* data = ::MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, fileSize);
+        ::CloseHandle(hMapping);
+        if (data == nullptr)
+            return false;
+        mMappedData = data;
+        mMappedSize = fileSize;
+        return true;
+    }
+
+    CTextFileReader::Status CTextFileReader::CTextFileReaderImpl::GetStatus(std::wstring& o_sErrorMsg) const noexcept
+    {
+        try
+        {
+            if (!mErrMsg.empty() || Status::ValidContents == mStatus)
+                o_sErrorMsg = mErrMsg;
+            else
+                o_sErrorMsg = FormatError(mError);
+        }
+        catch (...)
+        {
+            o_sErrorMsg.clear();
+        }
+        return mStatus;
+    }
+
+    bool CTextFileReader::CTextFileReaderImpl::GetBytes(std::string_view& o_fileData) const noexcept
+    {
+        if (Status::ValidContents == mStatus)
+        {
+            if (mMappedData != nullptr)
+                o_fileData = std::string_view(static_cast<const char*>(mMappedData), mMappedSize);
+            else
+                o_fileData = std::string_view(reinterpret_cast<const char*>(mFileContents.data()), mFileContents.size());
+            return true;
+        }
+        return false;
+    }
+
+    CChunkedFileReader::CChunkedFileReaderImpl::CChunkedFileReaderImpl(const wchar_t* filePathName,
+        size_t chunkSize, unsigned int chunkCount) :
+        mFile(INVALID_HANDLE_VALUE),
+        mIsQueued(false),
+        mChunkSize(0),
+        mMemory(nullptr),
+        mNextChunk(0),
+        mNextOffset(0),
+        mIsEndOfFileSeen(false),
+        mIsEndOfFileReturned(false),
         mStatus(Status::NotFound)
     {
         std::string functionName;
         unsigned int lineNo = 0;
         try
         {
-            HANDLE hFileFind = INVALID_HANDLE_VALUE;
-            HANDLE hFile = INVALID_HANDLE_VALUE;
+            // Buffers are page-aligned and their size is multiple of page size. ReadFile
+            // reads less than 4 GB at once.
+            SYSTEM_INFO systemInfo = { 0 };
+            ::GetSystemInfo(&systemInfo);
+            const size_t pageSize = systemInfo.dwPageSize;
+            size_t size = std::min<size_t>(std::max<size_t>(chunkSize, 1), 1024 * 1024 * 1024);
+            mChunkSize = static_cast<DWORD>((size + pageSize - 1) / pageSize * pageSize);
+            CStatus status = Open(filePathName, std::max(chunkCount, 1u));
+            if (status)
+            {
+                mStatus = Status::Open;
+                mErrMsg.clear();
+                return;
+            }
+            mError = status.GetError();
+            mStatus = static_cast<Status>(mError.mInternalErrorCode);
+            // Missing file is an ordinary outcome - caller reports it
+            if (Status::NotFound == mStatus)
+                return;
+            mErrMsg = FormatError(mError);
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+        }
+        catch (const CException& ex)
+        {
+            mStatus = static_cast<Status>(ex.mInternalErrorCode);
+            mErrMsg = ex.mErrorDescription;
+            // If it's not an error - don't log it - just return
+            if (ex.mCode == CException::ErrorCode::NoError)
+                return;
+            functionName = ex.mFunctionName;
+            lineNo = ex.mLineNo;
+        }
+        catch (const std::bad_alloc& /*ex*/)
+        {
+            mStatus = Status::ReadError;
+            mErrMsg = L"Memory allocation error.";
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+        }
+        catch (...)
+        {
+            mStatus = Status::ReadError;
+            mErrMsg = L"Unknown exception caught.";
+            functionName = __FUNCTION__;
+            lineNo = __LINE__;
+        }
+        LogError(functionName.c_str(), lineNo, mErrMsg);
+    }
 
-            // Cleanup resources before function returning
-            auto cleanup = MakeRAIICleanup([&hFileFind, &hFile]() {
-                if (INVALID_HANDLE_VALUE != hFileFind)
-                {
-                    ::FindClose(hFileFind);
-                    hFileFind = INVALID_HANDLE_VALUE;
-                }
-                if (INVALID_HANDLE_VALUE != hFile)
-                {
-                    ::CloseHandle(hFile);
-                    hFile = INVALID_HANDLE_VALUE;
-                }
-                });
+    CChunkedFileReader::CChunkedFileReaderImpl::~CChunkedFileReaderImpl()
+    {
+        for (CBuffer& buffer : mBuffers)
+        {
+            // Kernel writes into buffer until its read completes
+            if (buffer.mIsInFlight)
+            {
+                ::CancelIoEx(mFile, &buffer.mOverlapped);
+                DWORD numRead = 0;
+                ::GetOverlappedResult(mFile, &buffer.mOverlapped, &numRead, TRUE);
+            }
+            if (buffer.mOverlapped.hEvent != nullptr)
+                ::CloseHandle(buffer.mOverlapped.hEvent);
+        }
+        if (mMemory != nullptr)
+            ::VirtualFree(mMemory, 0, MEM_RELEASE);
+        if (INVALID_HANDLE_VALUE != mFile)
+            ::CloseHandle(mFile);
+    }
 
-            WIN32_FIND_DATAW data = { 0 };
-            hFileFind = ::FindFirstFile(filePathName, &data);
-            if (INVALID_HANDLE_VALUE == hFileFind)
+    CStatus CChunkedFileReader::CChunkedFileReaderImpl::Open(const wchar_t* filePathName, unsigned int chunkCount)
+    {
+        mFile = ::CreateFile(
+            filePathName,
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr
+        );
+        if (INVALID_HANDLE_VALUE == mFile)
+        {
+            DWORD lastErr = ::GetLastError();
+            if (ERROR_FILE_NOT_FOUND == lastErr || ERROR_PATH_NOT_FOUND == lastErr)
+            {
+                return CError(static_cast<unsigned int>(Status::NotFound), L"File not found");
+            }
+            return CError(static_cast<unsigned int>(Status::ReadError), L"", L"CreateFile", static_cast<int>(lastErr));
+        }
+        // Offsets of pipes, devices, etc. are ignored - so they are read on demand by one buffer
+        mIsQueued = FILE_TYPE_DISK == ::GetFileType(mFile);
+        size_t bufferCount = mIsQueued ? chunkCount : 1;
+        mMemory = ::VirtualAlloc(nullptr, static_cast<SIZE_T>(mChunkSize) * bufferCount,
+            MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        if (mMemory == nullptr)
+        {
+            THROW_ERROR_CODE(static_cast<int>(Status::ReadError), L"Memory allocation error.");
+        }
+        mBuffers.resize(bufferCount);
+        for (size_t i = 0; i < bufferCount; ++i)
+        {
+            CBuffer& buffer = mBuffers[i];
+            memset(&buffer, 0, sizeof(buffer));
+            buffer.mData = static_cast<char*>(mMemory) + i * mChunkSize;
+            buffer.mOffset = mNextOffset;
+            mNextOffset += mChunkSize;
+            buffer.mOverlapped.hEvent = ::CreateEvent(nullptr, TRUE, FALSE, nullptr);
+            if (buffer.mOverlapped.hEvent == nullptr)
             {
                 DWORD lastErr = ::GetLastError();
-                if (ERROR_FILE_NOT_FOUND == lastErr)
-                {
-                    THROW_ERROR_CODE(static_cast<int>(Status::NotFound), L"File not found");
-                }
-                else
+                std::wostringstream ss;
+                ss << L"CreateEvent failed. Error code: " << std::hex << lastErr;
+                THROW_ERROR_CODE(static_cast<int>(Status::ReadError), ss.str().c_str());
+            }
+        }
+        // Reads of all buffers are queued right away
+        if (mIsQueued)
+        {
+            for (CBuffer& buffer : mBuffers)
+                Submit(buffer);
+        }
+        return CStatus();
+    }
+
+    void CChunkedFileReader::CChunkedFileReaderImpl::Submit(CBuffer& buffer)
+    {
+        uint64_t offset = buffer.mOffset + buffer.mSize;
+        buffer.mOverlapped.Offset = static_cast<DWORD>(offset);
+        buffer.mOverlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        // Read that completes synchronously is reported by GetOverlappedResult() as well
+        if (::ReadFile(mFile, buffer.mData + buffer.mSize, mChunkSize - static_cast<DWORD>(buffer.mSize),
+            nullptr, &buffer.mOverlapped))
+        {
+            buffer.mIsInFlight = true;
+            return;
+        }
+        DWORD lastErr = ::GetLastError();
+        if (ERROR_IO_PENDING == lastErr)
+        {
+            buffer.mIsInFlight = true;
+        }
+        else if (ERROR_HANDLE_EOF == lastErr || ERROR_BROKEN_PIPE == lastErr)
+        {
+            buffer.mIsComplete = true;
+            buffer.mIsEndOfFile = true;
+            mIsEndOfFileSeen = true;
+        }
+        else
+        {
+            std::wostringstream ss;
+            ss << L"ReadFile failed. Error code: " << std::hex << lastErr;
+            THROW_ERROR_CODE(static_cast<int>(Status::ReadError), ss.str().c_str());
+        }
+    }
+
+    void CChunkedFileReader::CChunkedFileReaderImpl::Complete(CBuffer& buffer)
+    {
+        while (!buffer.mIsComplete)
+        {
+            if (!buffer.mIsInFlight)
+            {
+                Submit(buffer);
+                continue;
+            }
+            DWORD numRead = 0;
+            BOOL isOk = ::GetOverlappedResult(mFile, &buffer.mOverlapped, &numRead, TRUE);
+            buffer.mIsInFlight = false;
+            if (!isOk)
+            {
+                DWORD lastErr = ::GetLastError();
+                if (ERROR_HANDLE_EOF != lastErr && ERROR_BROKEN_PIPE != lastErr)
                 {
                     std::wostringstream ss;
-                    ss << L"FindFirstFile failed. Error code: " << std::hex << lastErr;
-                    THROW_ERROR_CODE(static_cast<int>(Status::FindError), ss.str().c_str());
+                    ss << L"GetOverlappedResult failed. Error code: " << std::hex << lastErr;
+                    THROW_ERROR_CODE(static_cast<int>(Status::ReadError), ss.str().c_str());
                 }
+                numRead = 0;
+            }
+            if (numRead == 0)
+            {
+                buffer.mIsComplete = true;
+                buffer.mIsEndOfFile = true;
+                mIsEndOfFileSeen = true;
+                break;
             }
-            mStatus = Status::Found;
-
-            hFile = ::CreateFile(
-                filePathName,
-                GENERIC_READ,
-                0,
-                nullptr,
-                OPEN_EXISTING,
-                0,
-                nullptr
-            );
+            buffer.mSize += numRead;
+            // Rest of the chunk is read after short read of disk file (pipe returns what
+            // it has)
+            if (buffer.mSize == mChunkSize || !mIsQueued)
+                buffer.mIsComplete = true;
+        }
+    }
+
+    bool CChunkedFileReader::CChunkedFileReaderImpl::Exists(std::wstring& o_sErrorMsg) const noexcept
+    {
+        try
+        {
+            o_sErrorMsg = GetErrorMessage();
+        }
+        catch (...)
+        {
+            o_sErrorMsg.clear();
+        }
+        return mStatus != Status::NotFound && mStatus != Status::FindError;
+    }
+
+    std::wstring CChunkedFileReader::CChunkedFileReaderImpl::GetErrorMessage() const
+    {
+        if (!mErrMsg.empty() || Status::Open == mStatus)
+            return mErrMsg;
+        return FormatError(mError);
+    }
+
+    void CChunkedFileReader::CChunkedFileReaderImpl::NextChunk(std::string_view& o_chunk)
+    {
+        o_chunk = std::string_view();
+        if (mStatus != Status::Open)
+        {
+            THROW_ERROR_CODE(static_cast<int>(mStatus), GetErrorMessage().c_str());
+        }
+        if (mIsEndOfFileReturned)
+            return;
+        try
+        {
+            ReadNextChunk(o_chunk);
+        }
+        catch (const CException& ex)
+        {
+            // Reader can't be used anymore
+            mStatus = Status::ReadError;
+            mErrMsg = ex.mErrorDescription;
+            throw;
+        }
+    }
+
+    void CChunkedFileReader::CChunkedFileReaderImpl::ReadNextChunk(std::string_view& o_chunk)
+    {
+        const size_t bufferCount = mBuffers.size();
+        if (mNextChunk != 0)
+        {
+            // Caller is done with the previous chunk - its buffer reads the chunk that's
+            // bufferCount chunks ahead
+            CBuffer& previous = mBuffers[static_cast<size_t>((mNextChunk - 1) % bufferCount)];
+            previous.mOffset = mNextOffset;
+            previous.mSize = 0;
+            previous.mIsComplete = false;
+            previous.mIsEndOfFile = false;
+            mNextOffset += mChunkSize;
+            if (mIsQueued && !mIsEndOfFileSeen)
+                Submit(previous);
+        }
+        CBuffer& buffer = mBuffers[static_cast<size_t>(mNextChunk % bufferCount)];
+        if (mIsQueued && !buffer.mIsInFlight && !buffer.mIsComplete && mIsEndOfFileSeen)
+        {
+            // Chunk wasn't queued - it's past end of file
+            buffer.mIsComplete = true;
+            buffer.mIsEndOfFile = true;
+        }
+        Complete(buffer);
+        mNextChunk++;
+        if (buffer.mIsEndOfFile)
+            mIsEndOfFileReturned = true;
+        o_chunk = std::string_view(buffer.mData, buffer.mSize);
+    }
+
+    bool GetFileVersion(const wchar_t* filePathName, CFileVersion& o_version, std::wstring& o_sErrorMsg) noexcept
+    {
+        try
+        {
+            o_version = CFileVersion();
+            o_sErrorMsg.clear();
+            // Only attributes are queried - so file can be opened even if it's being written
+            HANDLE hFile = ::CreateFile(filePathName, FILE_READ_ATTRIBUTES,
+                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                FILE_FLAG_BACKUP_SEMANTICS, nullptr);
             if (INVALID_HANDLE_VALUE == hFile)
             {
                 DWORD lastErr = ::GetLastError();
                 std::wostringstream ss;
                 ss << L"CreateFile failed. Error code: " << std::hex << lastErr;
-                THROW_ERROR_CODE(static_cast<int>(Status::ReadContentsError), ss.str().c_str());
+                o_sErrorMsg = ss.str();
+                return false;
             }
-            LARGE_INTEGER liSize = { 0 };
-            if (!GetFileSizeEx(hFile, &liSize))
+            auto cleanup = MakeRAIICleanup([&hFile]() {
+                ::CloseHandle(hFile);
+                });
+            BY_HANDLE_FILE_INFORMATION info = { 0 };
+            if (!::GetFileInformationByHandle(hFile, &info))
             {
                 DWORD lastErr = ::GetLastError();
                 std::wostringstream ss;
-                ss << L"GetFileSizeEx failed. Error code: " << std::hex << lastErr;
-                THROW_ERROR_CODE(static_cast<int>(Status::ReadContentsError), ss.str().c_str());
+                ss << L"GetFileInformationByHandle failed. Error code: " << std::hex << lastErr;
+                o_sErrorMsg = ss.str();
+                return false;
             }
-            else if (liSize.HighPart != 0)
+            o_version.mDevice = info.dwVolumeSerialNumber;
+            o_version.mFileId = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+            o_version.mModificationTime = static_cast<int64_t>(
+                (static_cast<uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime);
+            o_version.mSize = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+            return true;
+        }
+        catch (...)
+        {
+            o_sErrorMsg = L"Memory allocation error.";
+            return false;
+        }
+    }
+
+    bool RenameFile(const wchar_t* sFromPathName, const wchar_t* sToPathName, std::wstring& o_sErrorMsg) noexcept
+    {
+        try
+        {
+            o_sErrorMsg.clear();
+            if (!::MoveFileEx(sFromPathName, sToPathName, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
             {
-                THROW_ERROR_CODE(static_cast<int>(Status::ReadContentsError), L"File is too large");
+                DWORD lastErr = ::GetLastError();
+                std::wostringstream ss;
+                ss << L"MoveFileEx failed. Error code: " << std::hex << lastErr;
+                o_sErrorMsg = ss.str();
+                return false;
             }
-            else if (liSize.LowPart == 0)
+            return true;
+        }
+        catch (...)
+        {
+            o_sErrorMsg = L"Memory allocation error.";
+            return false;
+        }
+    }
+
+    bool RemoveFile(const wchar_t* sPathName, std::wstring& o_sErrorMsg) noexcept
+    {
+        try
+        {
+            o_sErrorMsg.clear();
+            if (!::DeleteFileW(sPathName))
             {
-                THROW_ERROR_CODE(static_cast<int>(Status::NoContents), L"File is empty");
+                DWORD lastErr = ::GetLastError();
+                std::wostringstream ss;
+                ss << L"DeleteFile failed. Error code: " << std::hex << lastErr;
+                o_sErrorMsg = ss.str();
+                return false;
             }
-            mStatus = Status::NoContents;
-            BYTE buf[INTERNAL_BUF_SIZE] = { 0 };
-            for (bool inLoop = true; inLoop;)
+            return true;
+        }
+        catch (...)
+        {
+            o_sErrorMsg = L"Memory allocation error.";
+            return false;
+        }
+    }
+
+    bool GetPeakMemoryUsage(uint64_t& o_bytes, std::wstring& o_sErrorMsg) noexcept
+    {
+        try
+        {
+            o_sErrorMsg.clear();
+            o_bytes = 0;
+            PROCESS_MEMORY_COUNTERS counters = {};
+            if (!::GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters)))
             {
-                DWORD numRead = 0;
-                if (!::ReadFile(hFile, buf, sizeof(buf), &numRead, nullptr))
+                DWORD lastErr = ::GetLastError();
+                std::wostringstream ss;
+                ss << L"GetProcessMemoryInfo failed. Error code: " << std::hex << lastErr;
+                o_sErrorMsg = ss.str();
+                return false;
+            }
+            o_bytes = counters.PeakWorkingSetSize;
+            return true;
+        }
+        catch (...)
+        {
+            o_sErrorMsg = L"Memory allocation error.";
+            return false;
+        }
+    }
+
+    bool GetEnvironmentValue(const wchar_t* sName, std::wstring& o_sValue) noexcept
+    {
+        try
+        {
+            o_sValue.clear();
+            if (sName == nullptr)
+                return false;
+            // Size includes terminating zero (0 means the variable isn't set)
+            DWORD size = ::GetEnvironmentVariableW(sName, nullptr, 0);
+            if (size == 0)
+                return false;
+            o_sValue.resize(size);
+            size = ::GetEnvironmentVariableW(sName, &o_sValue[0], size);
+            o_sValue.resize(size);
+            return true;
+        }
+        catch (...)
+        {
+            return false;
+        }
+    }
+
+    CFileOutputSink::CFileOutputSinkImpl::CFileOutputSinkImpl() :
+        mFile(::GetStdHandle(STD_OUTPUT_HANDLE)),
+        mOwnsHandle(false),
+        mIsPreallocated(false)
+    {
+        if (mFile == INVALID_HANDLE_VALUE || mFile == nullptr)
+        {
+            THROW_ERROR(L"Standard output isn't available");
+        }
+    }
+
+    CFileOutputSink::CFileOutputSinkImpl::CFileOutputSinkImpl(const wchar_t* sFilePathName,
+        uint64_t preallocatedSize) :
+        mFile(INVALID_HANDLE_VALUE),
+        mOwnsHandle(true),
+        mIsPreallocated(false),
+        msPathName(sFilePathName ? sFilePathName : L"")
+    {
+        mFile = ::CreateFile(msPathName.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+            CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (INVALID_HANDLE_VALUE == mFile)
+        {
+            DWORD lastErr = ::GetLastError();
+            std::wostringstream ss;
+            ss << L"CreateFile failed. Error code: " << std::hex << lastErr;
+            THROW_ERROR(ss.str().c_str());
+        }
+        // Space is allocated at once, so file isn't fragmented by many small extensions
+        if (preallocatedSize != 0)
+        {
+            FILE_ALLOCATION_INFO allocationInfo = {};
+            allocationInfo.AllocationSize.QuadPart = static_cast<LONGLONG>(preallocatedSize);
+            mIsPreallocated = ::SetFileInformationByHandle(mFile, FileAllocationInfo,
+                &allocationInfo, sizeof(allocationInfo)) != FALSE;
+        }
+    }
+
+    CFileOutputSink::CFileOutputSinkImpl::~CFileOutputSinkImpl()
+    {
+        if (mOwnsHandle && mFile != INVALID_HANDLE_VALUE)
+        {
+            if (mIsPreallocated)
+                ::SetEndOfFile(mFile);
+            ::CloseHandle(mFile);
+        }
+    }
+
+    void CFileOutputSink::CFileOutputSinkImpl::Write(const std::string_view* buffers, size_t count)
+    {
+        if (mFile == INVALID_HANDLE_VALUE)
+        {
+            THROW_ERROR(L"File is closed");
+        }
+        // WriteFileGather requires page-aligned buffers - so buffers are written one by one
+        for (size_t i = 0; i < count; ++i)
+        {
+            const char* data = buffers[i].data();
+            size_t size = buffers[i].size();
+            while (size > 0)
+            {
+                DWORD numWritten = 0;
+                DWORD toWrite = static_cast<DWORD>(std::min<size_t>(size, 0x40000000));
+                if (!::WriteFile(mFile, data, toWrite, &numWritten, nullptr))
                 {
-                    mFileContents.clear();
                     DWORD lastErr = ::GetLastError();
                     std::wostringstream ss;
-                    ss << L"ReadFile failed. Error code: " << std::hex << lastErr;
-                    THROW_ERROR_CODE(static_cast<int>(Status::ReadContentsError), ss.str().c_str());
+                    ss << L"WriteFile failed. Error code: " << std::hex << lastErr;
+                    THROW_ERROR(ss.str().c_str());
                 }
-                else if (numRead == 0)
+                data += numWritten;
+                size -= numWritten;
+            }
+        }
+    }
+
+    void CFileOutputSink::CFileOutputSinkImpl::Close(uint64_t size)
+    {
+        if (!mOwnsHandle || mFile == INVALID_HANDLE_VALUE)
+            return;
+        HANDLE hFile = mFile;
+        mFile = INVALID_HANDLE_VALUE;
+        auto cleanup = MakeRAIICleanup([hFile]() {
+            ::CloseHandle(hFile);
+            });
+        if (mIsPreallocated)
+        {
+            // Allocated space beyond end of file is released
+            LARGE_INTEGER endOfFile = {};
+            endOfFile.QuadPart = static_cast<LONGLONG>(size);
+            if (!::SetFilePointerEx(hFile, endOfFile, nullptr, FILE_BEGIN) || !::SetEndOfFile(hFile))
+            {
+                DWORD lastErr = ::GetLastError();
+                std::wostringstream ss;
+                ss << L"SetEndOfFile failed. Error code: " << std::hex << lastErr;
+                THROW_ERROR(ss.str().c_str());
+            }
+        }
+    }
+
+    void CFileOutputSink::CFileOutputSinkImpl::Discard() noexcept
+    {
+        if (!mOwnsHandle)
+            return;
+        if (mFile != INVALID_HANDLE_VALUE)
+        {
+            ::CloseHandle(mFile);
+            mFile = INVALID_HANDLE_VALUE;
+        }
+        ::DeleteFile(msPathName.c_str());
+    }
+
+    HANDLE CTerminationSignal::CTerminationSignalImpl::sEvent = nullptr;
+
+    CTerminationSignal::CTerminationSignalImpl::CTerminationSignalImpl() noexcept :
+        mError(0)
+    {
+        sEvent = ::CreateEvent(nullptr, TRUE, FALSE, nullptr);
+        if (sEvent == nullptr || !::SetConsoleCtrlHandler(ConsoleCtrlHandler, TRUE))
+        {
+            mError = ::GetLastError();
+        }
+    }
+
+    CTerminationSignal::CTerminationSignalImpl::~CTerminationSignalImpl()
+    {
+        ::SetConsoleCtrlHandler(ConsoleCtrlHandler, FALSE);
+        if (sEvent != nullptr)
+        {
+            ::CloseHandle(sEvent);
+            sEvent = nullptr;
+        }
+    }
+
+    BOOL WINAPI CTerminationSignal::CTerminationSignalImpl::ConsoleCtrlHandler(DWORD ctrlType)
+    {
+        (void)ctrlType;
+        ::SetEvent(sEvent);
+        return TRUE;
+    }
+
+    bool CTerminationSignal::CTerminationSignalImpl::Wait(std::wstring& o_sErrorMsg) noexcept
+    {
+        try
+        {
+            o_sErrorMsg.clear();
+            DWORD lastErr = mError;
+            if (lastErr == 0 && ::WaitForSingleObject(sEvent, INFINITE) != WAIT_OBJECT_0)
+            {
+                lastErr = ::GetLastError();
+            }
+            if (lastErr != 0)
+            {
+                std::wostringstream ss;
+                ss << L"Waiting for console control event failed. Error code: " << std::hex << lastErr;
+                o_sErrorMsg = ss.str();
+                return false;
+            }
+            return true;
+        }
+        catch (...)
+        {
+            o_sErrorMsg = L"Memory allocation error.";
+            return false;
+        }
+    }
+
+    CWsaInitialize::CWsaInitialize()
+    {
+        WSADATA wsaData;
+        int err = ::WSAStartup(MAKEWORD(2, 2), &wsaData);
+        if (err != 0)
+        {
+            std::wostringstream ss;
+            ss << L"WSAStartup failed. Error code: " << std::hex << err;
+            THROW_ERROR(ss.str().c_str());
+        }
+    }
+
+    CWsaInitialize::~CWsaInitialize()
+    {
+        ::WSACleanup();
+    }
+
+    // Fills address of AF_UNIX socket. Throws CException if path name doesn't fit.
+    static void MakeSocketAddress(const wchar_t* sSocketPathName, SOCKADDR_UN& o_address)
+    {
+        std::string sPathName;
+        if (sSocketPathName == nullptr || !WideToUtf8(sSocketPathName, wcslen(sSocketPathName), sPathName))
+        {
+            THROW_ERROR(L"Invalid socket path name");
+        }
+        o_address = {};
+        o_address.sun_family = AF_UNIX;
+        if (sPathName.empty() || sPathName.size() >= sizeof(o_address.sun_path))
+        {
+            THROW_ERROR(L"Socket path name is empty or too long");
+        }
+        memcpy(o_address.sun_path, sPathName.c_str(), sPathName.size() + 1);
+    }
+
+    // Description of last Winsock error
+    static std::wstring SocketErrorDescription(const wchar_t* sFunction)
+    {
+        int lastErr = ::WSAGetLastError();
+        std::wostringstream ss;
+        ss << sFunction << L" failed. Error code: " << std::hex << lastErr;
+        return ss.str();
+    }
+
+    CLocalSocket::CLocalSocketImpl::CLocalSocketImpl(SOCKET socket) noexcept :
+        mSocket(socket)
+    {}
+
+    CLocalSocket::CLocalSocketImpl::CLocalSocketImpl(const wchar_t* sSocketPathName) :
+        mSocket(INVALID_SOCKET)
+    {
+        SOCKADDR_UN address;
+        MakeSocketAddress(sSocketPathName, address);
+        mSocket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (mSocket == INVALID_SOCKET)
+        {
+            THROW_ERROR(SocketErrorDescription(L"socket").c_str());
+        }
+        if (::connect(mSocket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            int lastErr = ::WSAGetLastError();
+            ::closesocket(mSocket);
+            ::WSASetLastError(lastErr);
+            THROW_ERROR(SocketErrorDescription(L"connect").c_str());
+        }
+    }
+
+    CLocalSocket::CLocalSocketImpl::~CLocalSocketImpl()
+    {
+        if (mSocket != INVALID_SOCKET)
+            ::closesocket(mSocket);
+    }
+
+    bool CLocalSocket::CLocalSocketImpl::Read(char* data, size_t size)
+    {
+        size_t numRead = 0;
+        while (numRead < size)
+        {
+            int ret = ::recv(mSocket, data + numRead, static_cast<int>(std::min<size_t>(size - numRead, INT_MAX)), 0);
+            if (ret == SOCKET_ERROR)
+            {
+                THROW_ERROR(SocketErrorDescription(L"recv").c_str());
+            }
+            if (ret == 0)
+            {
+                if (numRead == 0)
+                    return false;
+                THROW_ERROR(L"Connection was closed in the middle of a message");
+            }
+            numRead += static_cast<size_t>(ret);
+        }
+        return true;
+    }
+
+    void CLocalSocket::CLocalSocketImpl::Write(const std::string_view* buffers, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const char* data = buffers[i].data();
+            size_t remaining = buffers[i].size();
+            while (remaining > 0)
+            {
+                int ret = ::send(mSocket, data, static_cast<int>(std::min<size_t>(remaining, INT_MAX)), 0);
+                if (ret == SOCKET_ERROR)
                 {
-                    mStatus = Status::ValidContents;
-                    mErrMsg.clear();
-                    inLoop = false;
+                    THROW_ERROR(SocketErrorDescription(L"send").c_str());
                 }
-                else
+                data += ret;
+                remaining -= static_cast<size_t>(ret);
+            }
+        }
+    }
+
+    void CLocalSocket::CLocalSocketImpl::Shutdown() noexcept
+    {
+        ::shutdown(mSocket, SD_BOTH);
+    }
+
+    CLocalSocketListener::CLocalSocketListenerImpl::CLocalSocketListenerImpl(const wchar_t* sSocketPathName) :
+        mSocket(INVALID_SOCKET),
+        mWakeSender(INVALID_SOCKET),
+        mWakeReceiver(INVALID_SOCKET),
+        msPathName(sSocketPathName != nullptr ? sSocketPathName : L""),
+        mIsShutDown(false)
+    {
+        SOCKADDR_UN address;
+        MakeSocketAddress(sSocketPathName, address);
+        // Socket file of a process that exited refuses connections - so it can be replaced
+        if (::GetFileAttributes(msPathName.c_str()) != INVALID_FILE_ATTRIBUTES)
+        {
+            SOCKET probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (probe != INVALID_SOCKET)
+            {
+                if (::connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 &&
+                    ::WSAGetLastError() == WSAECONNREFUSED)
                 {
-                    mFileContents.insert(end(mFileContents), buf, buf + numRead);
+                    ::DeleteFile(msPathName.c_str());
                 }
+                ::closesocket(probe);
             }
-            return;
         }
-        catch (const CException& ex)
+        CreateWakeConnection();
+        mSocket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (mSocket == INVALID_SOCKET)
         {
-            mStatus = static_cast<Status>(ex.mInternalErrorCode);
-            mErrMsg = ex.mErrorDescription;
-            // If it's not an error - don't log it - just return
-            if (ex.mCode == CException::ErrorCode::NoError)
-                return;
-            functionName = ex.mFunctionName;
-            lineNo = ex.mLineNo;
+            int lastErr = ::WSAGetLastError();
+            ::closesocket(mWakeSender);
+            ::closesocket(mWakeReceiver);
+            ::WSASetLastError(lastErr);
+            THROW_ERROR(SocketErrorDescription(L"socket").c_str());
         }
-        catch (const std::bad_alloc& /*ex*/)
+        // Listening socket is non-blocking: connection that WSAPoll() reported might be
+        // reset before it's accepted (and polling thread mustn't block in accept() then)
+        u_long isNonBlocking = 1;
+        const wchar_t* sFunction = L"ioctlsocket";
+        if (::ioctlsocket(mSocket, FIONBIO, &isNonBlocking) == 0)
         {
-            mErrMsg = L"Memory allocation error.";
-            functionName = __FUNCTION__;
-            lineNo = __LINE__;
+            sFunction = L"bind";
+            if (::bind(mSocket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0)
+            {
+                sFunction = L"listen";
+                if (::listen(mSocket, SOMAXCONN) == 0)
+                    return;
+                ::DeleteFile(msPathName.c_str());
+            }
         }
-        catch (const std::exception& ex)
+        int lastErr = ::WSAGetLastError();
+        ::closesocket(mSocket);
+        ::closesocket(mWakeSender);
+        ::closesocket(mWakeReceiver);
+        ::WSASetLastError(lastErr);
+        THROW_ERROR(SocketErrorDescription(sFunction).c_str());
+    }
+
+    CLocalSocketListener::CLocalSocketListenerImpl::~CLocalSocketListenerImpl()
+    {
+        ::closesocket(mSocket);
+        ::closesocket(mWakeSender);
+        ::closesocket(mWakeReceiver);
+        ::DeleteFile(msPathName.c_str());
+    }
+
+    void CLocalSocketListener::CLocalSocketListenerImpl::CreateWakeConnection()
+    {
+        SOCKET listener = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (listener == INVALID_SOCKET)
         {
-            std::wostringstream ss;
-            ss << L"C++ exception caught. ";
-            if (ex.what())
+            THROW_ERROR(SocketErrorDescription(L"socket").c_str());
+        }
+        auto closeListener = MakeRAIICleanup([listener]() {
+            ::closesocket(listener);
+            });
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = ::htonl(INADDR_LOOPBACK);
+        int addressSize = sizeof(address);
+        if (::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::listen(listener, 1) != 0 ||
+            ::getsockname(listener, reinterpret_cast<sockaddr*>(&address), &addressSize) != 0)
+        {
+            THROW_ERROR(SocketErrorDescription(L"bind").c_str());
+        }
+        mWakeSender = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (mWakeSender == INVALID_SOCKET ||
+            ::connect(mWakeSender, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            int lastErr = ::WSAGetLastError();
+            ::closesocket(mWakeSender);
+            ::WSASetLastError(lastErr);
+            THROW_ERROR(SocketErrorDescription(L"connect").c_str());
+        }
+        // Another process might connect to the loopback port first - accepted connection
+        // has to come from mWakeSender
+        sockaddr_in senderAddress = {};
+        int senderAddressSize = sizeof(senderAddress);
+        ::getsockname(mWakeSender, reinterpret_cast<sockaddr*>(&senderAddress), &senderAddressSize);
+        for (;;)
+        {
+            sockaddr_in peerAddress = {};
+            int peerAddressSize = sizeof(peerAddress);
+            mWakeReceiver = ::accept(listener, reinterpret_cast<sockaddr*>(&peerAddress), &peerAddressSize);
+            if (mWakeReceiver == INVALID_SOCKET)
             {
-                std::vector<wchar_t> sWhat(strlen(ex.what()) + 1, 0);
-                size_t numConverted = 0;
-                mbstowcs_s(&numConverted, &sWhat[0], sWhat.size() + 1, ex.what(), sWhat.size());
-                assert(numConverted);
-                ss.write(sWhat.data(), wcslen(sWhat.data()));
+                int lastErr = ::WSAGetLastError();
+                ::closesocket(mWakeSender);
+                ::WSASetLastError(lastErr);
+                THROW_ERROR(SocketErrorDescription(L"accept").c_str());
             }
-            mErrMsg = ss.str();
-            functionName = __FUNCTION__;
-            lineNo = __LINE__;
+            if (peerAddress.sin_port == senderAddress.sin_port &&
+                peerAddress.sin_addr.s_addr == senderAddress.sin_addr.s_addr)
+            {
+                break;
+            }
+            ::closesocket(mWakeReceiver);
         }
-        catch (...)
+        u_long isNonBlocking = 1;
+        ::ioctlsocket(mWakeReceiver, FIONBIO, &isNonBlocking);
+    }
+
+    void CLocalSocketListener::CLocalSocketListenerImpl::Wake() noexcept
+    {
+        char byte = 0;
+        // Buffer of wake connection is never full: receiver reads everything it gets
+        ::send(mWakeSender, &byte, 1, 0);
+    }
+
+    std::unique_ptr<CLocalSocket::CLocalSocketImpl> CLocalSocketListener::CLocalSocketListenerImpl::Accept()
+    {
+        std::lock_guard<std::mutex> pollLock(mPollMutex);
+        for (;;)
         {
-            mErrMsg = L"Unknown exception caught.";
-            functionName = __FUNCTION__;
-            lineNo = __LINE__;
+            if (mIsShutDown)
+                return nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mIdleMutex);
+                mPollFds.resize(2 + mIdleConnections.size());
+                for (size_t i = 0; i < mIdleConnections.size(); ++i)
+                {
+                    mPollFds[2 + i] = { mIdleConnections[i]->GetSocket(), POLLRDNORM, 0 };
+                }
+            }
+            mPollFds[0] = { mSocket, POLLRDNORM, 0 };
+            mPollFds[1] = { mWakeReceiver, POLLRDNORM, 0 };
+            if (::WSAPoll(mPollFds.data(), static_cast<ULONG>(mPollFds.size()), -1) == SOCKET_ERROR)
+            {
+                THROW_ERROR(SocketErrorDescription(L"WSAPoll").c_str());
+            }
+            if (mIsShutDown)
+                return nullptr;
+            if (mPollFds[1].revents != 0)
+            {
+                char buffer[256];
+                while (::recv(mWakeReceiver, buffer, sizeof(buffer), 0) > 0)
+                {
+                }
+            }
+            // Connection that's returned goes to the end of the list when it becomes idle
+            // again - so ready connections are served in turn
+            for (size_t i = 2; i < mPollFds.size(); ++i)
+            {
+                if (mPollFds[i].revents != 0)
+                {
+                    std::lock_guard<std::mutex> lock(mIdleMutex);
+                    std::unique_ptr<CLocalSocket::CLocalSocketImpl> connection = std::move(mIdleConnections[i - 2]);
+                    mIdleConnections.erase(mIdleConnections.begin() + (i - 2));
+                    return connection;
+                }
+            }
+            if (mPollFds[0].revents == 0)
+                continue;
+            SOCKET socket = ::accept(mSocket, nullptr, nullptr);
+            if (socket != INVALID_SOCKET)
+            {
+                // Accepted socket inherits non-blocking mode of the listening one
+                u_long isNonBlocking = 0;
+                ::ioctlsocket(socket, FIONBIO, &isNonBlocking);
+                return std::make_unique<CLocalSocket::CLocalSocketImpl>(socket);
+            }
+            int lastErr = ::WSAGetLastError();
+            if (lastErr == WSAEWOULDBLOCK || lastErr == WSAECONNRESET)
+                continue;
+            THROW_ERROR(SocketErrorDescription(L"accept").c_str());
         }
-        LogError(functionName.c_str(), lineNo, mErrMsg);
     }
 
-    CTextFileReader::Status CTextFileReader::CTextFileReaderImpl::GetStatus(std::wstring& o_sErrorMsg) const noexcept
+    void CLocalSocketListener::CLocalSocketListenerImpl::AddIdleConnection(
+        std::unique_ptr<CLocalSocket::CLocalSocketImpl> connection)
     {
-        o_sErrorMsg = mErrMsg;
-        return mStatus;
+        if (mIsShutDown)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mIdleMutex);
+            mIdleConnections.push_back(std::move(connection));
+        }
+        Wake();
     }
 
-    bool CTextFileReader::CTextFileReaderImpl::GetContents(std::vector<unsigned char>& o_fileData) const noexcept
+    void CLocalSocketListener::CLocalSocketListenerImpl::Shutdown() noexcept
     {
-        if (Status::ValidContents == mStatus)
+        // Threads that wait for mPollMutex see mIsShutDown when they get it
+        mIsShutDown = true;
+        Wake();
+    }
+
+    CLogger::CLoggerImpl::CLoggerImpl() noexcept :
+        mFile(INVALID_HANDLE_VALUE),
+        mFileSize(0),
+        mMaxFileSize(0),
+        mMaxFileCount(0)
+    {}
+
+    CLogger::CLoggerImpl::~CLoggerImpl()
+    {
+        if (mFile != INVALID_HANDLE_VALUE)
+            ::CloseHandle(mFile);
+    }
+
+    HANDLE CLogger::CLoggerImpl::CreateLogFile(const wchar_t* sFilePathName, DWORD creationDisposition) noexcept
+    {
+        // Log file can be read (and rotated away) while it's written
+        return ::CreateFile(sFilePathName, FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_DELETE,
+            nullptr, creationDisposition, FILE_ATTRIBUTE_NORMAL, nullptr);
+    }
+
+    void CLogger::CLoggerImpl::Open(const wchar_t* sFilePathName, uint64_t maxFileSize, unsigned int maxFileCount)
+    {
+        HANDLE file = INVALID_HANDLE_VALUE;
+        std::wstring sPathName;
+        uint64_t fileSize = 0;
+        if (sFilePathName != nullptr)
         {
-            o_fileData = mFileContents;
-            return true;
+            sPathName = sFilePathName;
+            file = CreateLogFile(sFilePathName, OPEN_ALWAYS);
+            if (INVALID_HANDLE_VALUE == file)
+            {
+                DWORD lastErr = ::GetLastError();
+                std::wostringstream ss;
+                ss << L"CreateFile failed. Error code: " << std::hex << lastErr;
+                THROW_ERROR(ss.str().c_str());
+            }
+            LARGE_INTEGER size = {};
+            if (::GetFileSizeEx(file, &size))
+                fileSize = static_cast<uint64_t>(size.QuadPart);
         }
-        return false;
+        if (mFile != INVALID_HANDLE_VALUE)
+            ::CloseHandle(mFile);
+        mFile = file;
+        msPathName.swap(sPathName);
+        mFileSize = fileSize;
+        mMaxFileSize = maxFileSize;
+        mMaxFileCount = maxFileCount;
     }
 
-    void CLogger::CLoggerImpl::Log(const wchar_t* message)
+    void CLogger::CLoggerImpl::Write(const char* data, size_t size) noexcept
     {
-        if (message != nullptr)
-            ::OutputDebugStringW(message);
+        if (mFile == INVALID_HANDLE_VALUE)
+        {
+            // Debug console takes wchar_t strings
+            try
+            {
+                std::wstring sMessages;
+                if (Utf8ToWide(data, size, sMessages))
+                    ::OutputDebugStringW(sMessages.c_str());
+            }
+            catch (...)
+            {}
+            return;
+        }
+        if (mFileSize != 0 && mFileSize + size > mMaxFileSize)
+            Rotate();
+        while (size > 0 && mFile != INVALID_HANDLE_VALUE)
+        {
+            DWORD numWritten = 0;
+            DWORD toWrite = static_cast<DWORD>(std::min<size_t>(size, 0x40000000));
+            if (!::WriteFile(mFile, data, toWrite, &numWritten, nullptr))
+                return;
+            data += numWritten;
+            size -= numWritten;
+            mFileSize += numWritten;
+        }
+    }
+
+    void CLogger::CLoggerImpl::Rotate() noexcept
+    {
+        ::CloseHandle(mFile);
+        mFile = INVALID_HANDLE_VALUE;
+        try
+        {
+            for (unsigned int i = mMaxFileCount > 0 ? mMaxFileCount - 1 : 0; i >= 1; --i)
+            {
+                std::wstring sFrom = i == 1 ? msPathName : msPathName + L"." + std::to_wstring(i - 1);
+                std::wstring sTo = msPathName + L"." + std::to_wstring(i);
+                // Older files might not exist yet
+                ::MoveFileEx(sFrom.c_str(), sTo.c_str(), MOVEFILE_REPLACE_EXISTING);
+            }
+        }
+        catch (...)
+        {
+            // Current file is truncated if it couldn't be renamed
+        }
+        // Messages go to debug console if the new file couldn't be created
+        mFile = CreateLogFile(msPathName.c_str(), CREATE_ALWAYS);
+        mFileSize = 0;
     }
 }
\ No newline at end of file
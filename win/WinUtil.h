@@ -2,8 +2,14 @@
 #ifndef _WINUTIL_H__
 #define _WINUTIL_H__
 
+// winsock2.h has to be included before Windows.h
+#include <winsock2.h>
 #include <Windows.h>
 #include "..\Util.h"
+#include "..\OutputSink.h"
+#include "..\LocalSocket.h"
+#include <atomic>
+#include <mutex>
 #include <vector>
 #include <string>
 
@@ -44,24 +50,210 @@ namespace OTInterviewExercise1
     class CTextFileReader::CTextFileReaderImpl
     {
     public:
-        CTextFileReaderImpl(const wchar_t* filePathName);
-        ~CTextFileReaderImpl() = default;
+        CTextFileReaderImpl(const wchar_t* filePathName, ReadMode readMode);
+        ~CTextFileReaderImpl();
         Status GetStatus(std::wstring& o_sErrorMsg) const noexcept;
-        bool GetContents(std::vector<unsigned char>& o_fileData) const noexcept;
+        bool GetBytes(std::string_view& o_fileData) const noexcept;
     private:
         enum
         {
-            INTERNAL_BUF_SIZE = 2048
+            INTERNAL_BUF_SIZE = 65536
         };
+        // Maps or reads file. Status of failure is code of returned error.
+        CStatus Open(const wchar_t* filePathName, ReadMode readMode);
+        // Maps disk file into memory. Returns false if file can't be mapped.
+        bool MapFile(HANDLE hFile, size_t fileSize) noexcept;
+
         std::vector<unsigned char> mFileContents;
+        // Memory-mapped file view (nullptr if file was read into mFileContents)
+        const void* mMappedData;
+        size_t mMappedSize;
+        Status mStatus;
+        // Error of expected failure (its message is formatted when it's asked for)
+        CError mError;
+        // Message of exceptional failure (empty if there is none)
+        std::wstring mErrMsg;
+    };
+
+    // Low-level class for reading files in chunks. Reads of disk files are overlapped:
+    // every buffer that's not being processed by the caller has a read in flight. Other
+    // files (pipes, devices) are read on demand.
+    class CChunkedFileReader::CChunkedFileReaderImpl
+    {
+    public:
+        CChunkedFileReaderImpl(const wchar_t* filePathName, size_t chunkSize, unsigned int chunkCount);
+        ~CChunkedFileReaderImpl();
+        bool Exists(std::wstring& o_sErrorMsg) const noexcept;
+        void NextChunk(std::string_view& o_chunk);
+        bool IsQueued() const noexcept
+        {
+            return mIsQueued;
+        }
+    private:
+        enum class Status
+        {
+            NotFound,
+            FindError,
+            Open,
+            ReadError
+        };
+        struct CBuffer
+        {
+            char* mData;
+            // Offset of the chunk in the file
+            uint64_t mOffset;
+            // Bytes read so far
+            size_t mSize;
+            // Buffer is full or end of file was reached
+            bool mIsComplete;
+            bool mIsEndOfFile;
+            bool mIsInFlight;
+            OVERLAPPED mOverlapped;
+        };
+
+        // Opens file and queues reads. Status of expected failure is code of returned
+        // error (exceptional ones are thrown).
+        CStatus Open(const wchar_t* filePathName, unsigned int chunkCount);
+        std::wstring GetErrorMessage() const;
+        // Starts read of the rest of buffer
+        void Submit(CBuffer& buffer);
+        // Waits for read of buffer (rest of the chunk is read if read was short)
+        void Complete(CBuffer& buffer);
+        void ReadNextChunk(std::string_view& o_chunk);
+
+        HANDLE mFile;
+        bool mIsQueued;
+        DWORD mChunkSize;
+        // Page-aligned memory of all buffers
+        void* mMemory;
+        std::vector<CBuffer> mBuffers;
+        // Index of the chunk that will be returned by the next NextChunk() call
+        uint64_t mNextChunk;
+        // Offset of the next chunk that will be queued
+        uint64_t mNextOffset;
+        // Chunks past end of file aren't queued
+        bool mIsEndOfFileSeen;
+        bool mIsEndOfFileReturned;
         Status mStatus;
+        // Error of expected failure (its message is formatted when it's asked for)
+        CError mError;
+        // Message of exceptional failure (empty if there is none)
         std::wstring mErrMsg;
     };
 
+    // Low-level class for writing output files (or standard output)
+    class CFileOutputSink::CFileOutputSinkImpl
+    {
+    public:
+        CFileOutputSinkImpl();
+        CFileOutputSinkImpl(const wchar_t* sFilePathName, uint64_t preallocatedSize);
+        ~CFileOutputSinkImpl();
+        // Writes all buffers (retries partial writes)
+        void Write(const std::string_view* buffers, size_t count);
+        // size - number of bytes written (end of file is set to it if space was preallocated)
+        void Close(uint64_t size);
+        void Discard() noexcept;
+    private:
+        HANDLE mFile;
+        // Standard output isn't closed
+        bool mOwnsHandle;
+        bool mIsPreallocated;
+        std::wstring msPathName;
+    };
+
+    // Low-level class for waiting for Ctrl+C (Ctrl+Break, closing of console)
+    class CTerminationSignal::CTerminationSignalImpl
+    {
+    public:
+        CTerminationSignalImpl() noexcept;
+        ~CTerminationSignalImpl();
+        bool Wait(std::wstring& o_sErrorMsg) noexcept;
+    private:
+        static BOOL WINAPI ConsoleCtrlHandler(DWORD ctrlType);
+
+        // Console handler can't have context - it signals this event
+        static HANDLE sEvent;
+        DWORD mError;
+    };
+
+    // (Un)initializes Winsock
+    class CWsaInitialize
+    {
+    public:
+        CWsaInitialize();
+        ~CWsaInitialize();
+    };
+
+    // Low-level class for stream connections over AF_UNIX socket
+    class CLocalSocket::CLocalSocketImpl
+    {
+    public:
+        explicit CLocalSocketImpl(SOCKET socket) noexcept;
+        explicit CLocalSocketImpl(const wchar_t* sSocketPathName);
+        ~CLocalSocketImpl();
+        bool Read(char* data, size_t size);
+        void Write(const std::string_view* buffers, size_t count);
+        void Shutdown() noexcept;
+        SOCKET GetSocket() const noexcept
+        {
+            return mSocket;
+        }
+    private:
+        CWsaInitialize mWsaInitialize;
+        SOCKET mSocket;
+    };
+
+    // Low-level class for listening AF_UNIX socket. Listening socket and idle connections
+    // are polled by one thread at a time (others wait for it in Accept()).
+    class CLocalSocketListener::CLocalSocketListenerImpl
+    {
+    public:
+        explicit CLocalSocketListenerImpl(const wchar_t* sSocketPathName);
+        ~CLocalSocketListenerImpl();
+        std::unique_ptr<CLocalSocket::CLocalSocketImpl> Accept();
+        void AddIdleConnection(std::unique_ptr<CLocalSocket::CLocalSocketImpl> connection);
+        void Shutdown() noexcept;
+    private:
+        // WSAPoll() waits for sockets only - so it's woken up by a byte sent over loopback
+        // connection (mWakeSender -> mWakeReceiver)
+        void CreateWakeConnection();
+        void Wake() noexcept;
+
+        CWsaInitialize mWsaInitialize;
+        SOCKET mSocket;
+        SOCKET mWakeSender;
+        SOCKET mWakeReceiver;
+        std::wstring msPathName;
+        std::atomic<bool> mIsShutDown;
+        std::mutex mPollMutex;
+        // Sockets polled by thread that holds mPollMutex
+        std::vector<WSAPOLLFD> mPollFds;
+        // Only the thread that polls removes idle connections (others add them at the end)
+        std::mutex mIdleMutex;
+        std::vector<std::unique_ptr<CLocalSocket::CLocalSocketImpl>> mIdleConnections;
+    };
+
+    // Writes log messages to debug console or appends them to a rotating log file
     class CLogger::CLoggerImpl
     {
     public:
-        void Log(const wchar_t *message);
+        CLoggerImpl() noexcept;
+        ~CLoggerImpl();
+        // nullptr means debug console
+        void Open(const wchar_t* sFilePathName, uint64_t maxFileSize, unsigned int maxFileCount);
+        // Writes UTF8 messages. Errors are ignored - there is nowhere to report them.
+        void Write(const char* data, size_t size) noexcept;
+    private:
+        // Renames files ({file} -> {file}.1 -> {file}.2 ...) and starts a new one
+        void Rotate() noexcept;
+        static HANDLE CreateLogFile(const wchar_t* sFilePathName, DWORD creationDisposition) noexcept;
+
+        // INVALID_HANDLE_VALUE means debug console
+        HANDLE mFile;
+        std::wstring msPathName;
+        uint64_t mFileSize;
+        uint64_t mMaxFileSize;
+        unsigned int mMaxFileCount;
     };
 }
 